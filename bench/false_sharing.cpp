@@ -0,0 +1,313 @@
+// False sharing in WheelDevice's state layout.
+//
+// Four threads play the writers WheelDevice has (seat loop, physics tick, vJoy
+// polling, vJoy FFB callback) against the members of a real WheelDevice and
+// against the same members in the old declaration order, where flags and
+// per-thread fields share lines. Each thread only writes its own fields, so
+// any coherence traffic between them is false sharing.
+//
+// On Linux the run is wrapped in perf_event_open counters (cache misses and
+// references, L1D read misses, and an optional raw event for HITM, whose
+// encoding is CPU-specific, e.g. --hitm=0x04d2 for MEM_LOAD_L3_HIT_RETIRED.XSNP_HITM
+// on Skylake). Elsewhere, or without perf permissions, only ns/op is reported.
+//
+//   bench_false_sharing [--iterations=N] [--hitm=0xCONFIG]
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "cache_line.h"
+#include "wake_signal.h"
+#include "wheel_device.h"
+#include "wheel_lifecycle.h"
+#include "wheel_types.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+std::atomic<bool> running{true};
+
+namespace {
+
+// WheelDevice's members in the declaration order before the regrouping, so
+// flags and each thread's fields share lines. The other side of the
+// comparison is a real WheelDevice.
+struct PackedLayout {
+    std::atomic<bool> polling_running{true};
+    WakeSignal report_wake;
+    WheelLifecycle lifecycle;
+    std::atomic<bool> physics_parked{false};
+    float steering = 0.0f;
+    float user_steering = 0.0f;
+    float ffb_offset = 0.0f;
+    float ffb_velocity = 0.0f;
+    float ffb_gain = 1.0f;
+    float throttle = 0.0f;
+    float brake = 0.0f;
+    float clutch = 0.0f;
+    std::array<float, kPedalCount> pedal_analog{};
+    ButtonMask button_states;
+    ButtonMask reported_pulses;
+    int8_t dpad_x = 0;
+    int16_t ffb_force = 0;
+};
+
+// The fields the workload touches, wherever the layout puts them
+struct View {
+    WakeSignal* report_wake;
+    WheelLifecycle* lifecycle;
+    float* user_steering;
+    std::array<float, kPedalCount>* pedal_analog;
+    ButtonMask* button_states;
+    int8_t* dpad_x;
+    float* steering;
+    float* ffb_offset;
+    float* ffb_velocity;
+    float* ffb_gain;
+    float* throttle;
+    ButtonMask* reported_pulses;
+    int16_t* ffb_force;
+};
+
+View ViewOf(PackedLayout& state) {
+    return {&state.report_wake, &state.lifecycle, &state.user_steering, &state.pedal_analog,
+            &state.button_states, &state.dpad_x, &state.steering, &state.ffb_offset,
+            &state.ffb_velocity, &state.ffb_gain, &state.throttle, &state.reported_pulses,
+            &state.ffb_force};
+}
+
+}  // namespace
+
+// Declared a friend by WheelDevice
+struct WheelBench {
+    static View ViewOf(WheelDevice& wheel) {
+        return {&wheel.report_wake_, &wheel.lifecycle_, &wheel.user_steering, &wheel.pedal_analog,
+                &wheel.button_states, &wheel.dpad_x, &wheel.steering, &wheel.ffb_offset,
+                &wheel.ffb_velocity, &wheel.ffb_gain, &wheel.throttle, &wheel.reported_pulses,
+                &wheel.ffb_force};
+    }
+};
+
+namespace {
+
+// Writes go through volatile so the compiler keeps every store
+template <typename T>
+void Store(T* field, T value) {
+    *const_cast<volatile T*>(field) = value;
+}
+
+template <typename T>
+T Load(const T* field) {
+    return *const_cast<const volatile T*>(field);
+}
+
+// The threads write the fields without state_mutex: the lock would serialize
+// them and hide the line traffic this measures
+double RunWorkload(const View& state, uint64_t iterations) {
+    std::atomic<int> ready{0};
+    std::atomic<bool> go{false};
+    auto start_gate = [&] {
+        ready.fetch_add(1);
+        while (!go.load(std::memory_order_acquire)) {
+            std::this_thread::yield();
+        }
+    };
+    state.lifecycle->BeginArming();
+
+    std::vector<std::thread> threads;
+    // Seat loop: steering delta, analog pedals, buttons; wakes the report thread
+    threads.emplace_back([&] {
+        start_gate();
+        for (uint64_t i = 0; i < iterations; ++i) {
+            Store(state.user_steering, Load(state.user_steering) + 1.0f);
+            Store(&(*state.pedal_analog)[i % kPedalCount], static_cast<float>(i & 0xFF));
+            Store(&state.button_states->words[0], i);
+            Store(state.dpad_x, static_cast<int8_t>(i & 1));
+            if ((i & 15) == 0 && state.lifecycle->IsLive()) {
+                state.report_wake->Signal(1);
+            }
+        }
+    });
+    // Physics tick: offset/velocity, steering, pedal travel; reads the FFB force
+    threads.emplace_back([&] {
+        start_gate();
+        for (uint64_t i = 0; i < iterations; ++i) {
+            float force = static_cast<float>(Load(state.ffb_force));
+            Store(state.ffb_velocity, Load(state.ffb_velocity) * 0.99f + force * 0.001f);
+            Store(state.ffb_offset, Load(state.ffb_offset) + Load(state.ffb_velocity) * 0.001f);
+            Store(state.steering, Load(state.ffb_offset) * Load(state.ffb_gain));
+            Store(state.throttle, static_cast<float>(i & 0x3F));
+        }
+    });
+    // vJoy polling: takes the report wakes, records reported pulses
+    threads.emplace_back([&] {
+        start_gate();
+        for (uint64_t i = 0; i < iterations; ++i) {
+            if ((i & 63) == 0 && state.lifecycle->IsLive()) {
+                state.report_wake->Take();
+            }
+            Store(&state.reported_pulses->words[0], i);
+        }
+    });
+    // vJoy FFB callback: new constant force
+    threads.emplace_back([&] {
+        start_gate();
+        for (uint64_t i = 0; i < iterations; ++i) {
+            Store(state.ffb_force, static_cast<int16_t>(i));
+        }
+    });
+
+    while (ready.load() != static_cast<int>(threads.size())) {
+        std::this_thread::yield();
+    }
+    const auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    state.lifecycle->ForceDisabled();
+    return std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(iterations);
+}
+
+struct CounterSpec {
+    const char* name;
+    uint32_t type;
+    uint64_t config;
+};
+
+class PerfCounters {
+public:
+    explicit PerfCounters(const std::vector<CounterSpec>& specs) : specs_(specs) {
+#ifdef __linux__
+        for (const CounterSpec& spec : specs_) {
+            perf_event_attr attr{};
+            attr.size = sizeof(attr);
+            attr.type = spec.type;
+            attr.config = spec.config;
+            attr.disabled = 1;
+            attr.inherit = 1;  // count the worker threads spawned after opening
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+            fds_.push_back(fd);
+        }
+#endif
+    }
+
+    ~PerfCounters() {
+#ifdef __linux__
+        for (int fd : fds_) {
+            if (fd >= 0) close(fd);
+        }
+#endif
+    }
+
+    void Start() {
+#ifdef __linux__
+        for (int fd : fds_) {
+            if (fd < 0) continue;
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    // Returns -1 for counters that could not be opened
+    std::vector<long long> Stop() {
+        std::vector<long long> values(specs_.size(), -1);
+#ifdef __linux__
+        for (size_t i = 0; i < fds_.size(); ++i) {
+            if (fds_[i] < 0) continue;
+            ioctl(fds_[i], PERF_EVENT_IOC_DISABLE, 0);
+            long long value = 0;
+            if (read(fds_[i], &value, sizeof(value)) == static_cast<ssize_t>(sizeof(value))) {
+                values[i] = value;
+            }
+        }
+#endif
+        return values;
+    }
+
+    const std::vector<CounterSpec>& Specs() const { return specs_; }
+
+private:
+    std::vector<CounterSpec> specs_;
+    std::vector<int> fds_;
+};
+
+std::vector<CounterSpec> DefaultCounters(uint64_t hitm_config) {
+    std::vector<CounterSpec> specs;
+#ifdef __linux__
+    specs.push_back({"cache-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES});
+    specs.push_back({"cache-refs", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES});
+    specs.push_back({"l1d-read-miss", PERF_TYPE_HW_CACHE,
+                     PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                         (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)});
+    if (hitm_config != 0) {
+        specs.push_back({"hitm", PERF_TYPE_RAW, hitm_config});
+    }
+#else
+    (void)hitm_config;
+#endif
+    return specs;
+}
+
+void Report(const char* name, size_t size, const View& state, uint64_t iterations, uint64_t hitm_config) {
+    PerfCounters counters(DefaultCounters(hitm_config));
+    counters.Start();
+    const double ns_per_op = RunWorkload(state, iterations);
+    const std::vector<long long> values = counters.Stop();
+
+    std::printf("%-12s %5zu B  %8.2f ns/op", name, size, ns_per_op);
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (values[i] < 0) {
+            std::printf("  %s=n/a", counters.Specs()[i].name);
+        } else {
+            std::printf("  %s=%.3f/op", counters.Specs()[i].name,
+                        static_cast<double>(values[i]) / static_cast<double>(iterations));
+        }
+    }
+    std::printf("\n");
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    uint64_t iterations = 20000000;
+    uint64_t hitm_config = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strncmp(argv[i], "--iterations=", 13) == 0) {
+            iterations = std::strtoull(argv[i] + 13, nullptr, 0);
+        } else if (std::strncmp(argv[i], "--hitm=", 7) == 0) {
+            hitm_config = std::strtoull(argv[i] + 7, nullptr, 0);
+        } else {
+            std::fprintf(stderr, "usage: %s [--iterations=N] [--hitm=0xCONFIG]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (iterations == 0) iterations = 1;
+
+    std::printf("%u hardware threads, %llu iterations per thread, %zu-byte lines\n",
+                std::thread::hardware_concurrency(), static_cast<unsigned long long>(iterations), kCacheLineSize);
+    if (std::thread::hardware_concurrency() < 4) {
+        std::printf("note: fewer than 4 hardware threads; writers time-slice and little sharing is visible\n");
+    }
+    auto packed = std::make_unique<PackedLayout>();
+    Report("packed", sizeof(PackedLayout), ViewOf(*packed), iterations, hitm_config);
+    auto wheel = std::make_unique<WheelDevice>();
+    Report("WheelDevice", sizeof(WheelDevice), WheelBench::ViewOf(*wheel), iterations, hitm_config);
+    return 0;
+}
@@ -0,0 +1,217 @@
+// FFB dynamics on simulated time. Headless WheelDevices run on an EventLoop
+// driven by a SimulatedClock, set up as RunEventLoop sets up the real one; a
+// timer plays the game, sending every seat a new constant force at --ffb-hz,
+// and another moves the mouse at --input-hz. Nothing sleeps, so the cost is
+// the ticks themselves. Each run starts from the same state and must produce
+// the same report stream (compared by hash); a mismatch exits 1.
+//
+//   bench_ffb_sim [--seconds=S] [--seats=N] [--hz=N] [--ffb-hz=N] [--input-hz=N] [--runs=N]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "event_loop.h"
+#include "input/input_manager.h"
+#include "logging/logger.h"
+#include "simulated_clock.h"
+#include "wheel_device.h"
+
+std::atomic<bool> running{true};
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int kSensitivity = 50;
+constexpr double kPi = 3.14159265358979323846;
+constexpr uint64_t kFnvOffset = 1469598103934665603ull;
+constexpr uint64_t kFnvPrime = 1099511628211ull;
+
+struct Options {
+    double seconds = 600.0;
+    double seats = 1.0;
+    double hz = 1000.0;
+    double ffb_hz = 60.0;
+    double input_hz = 125.0;
+    double runs = 2.0;
+};
+
+struct Seat {
+    WheelDevice wheel;
+    InputManager input;
+    size_t report_timer = 0;
+    uint64_t reports = 0;
+    uint64_t hash = kFnvOffset;
+};
+
+struct RunResult {
+    double wall_s = 0.0;
+    uint64_t ticks = 0;
+    uint64_t reports = 0;
+    uint64_t hash = kFnvOffset;
+};
+
+Clock::duration Period(double hz) {
+    return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / hz));
+}
+
+// A game's steering force: a slow sweep plus road texture, out of phase per seat
+int16_t GameForce(Clock::time_point now, size_t seat) {
+    const double t = std::chrono::duration<double>(now.time_since_epoch()).count();
+    const double force = 4000.0 * std::sin(2.0 * kPi * 0.3 * t + static_cast<double>(seat)) +
+                         800.0 * std::sin(2.0 * kPi * 11.0 * t);
+    return static_cast<int16_t>(force);
+}
+
+RunResult Run(const Options& options) {
+    SimulatedClock clock;
+    EventLoop loop;
+    loop.SetSimulatedClock(&clock);
+    const Clock::duration period = Period(options.hz);
+    const Clock::time_point start = clock.Now();
+
+    RunResult result;
+    std::vector<std::unique_ptr<Seat>> seats;
+    for (size_t i = 0; i < static_cast<size_t>(options.seats); ++i) {
+        seats.push_back(std::make_unique<Seat>());
+        Seat& seat = *seats.back();
+        WheelDevice& wheel = seat.wheel;
+        wheel.SetVJoyId(static_cast<unsigned>(i % kMaxSeats) + 1);
+        wheel.SetHeadless();
+        wheel.UseExternalReportLoop();
+        wheel.SetReportSink([&seat](const HidReport& report) {
+            for (uint8_t byte : report) {
+                seat.hash = (seat.hash ^ byte) * kFnvPrime;
+            }
+            ++seat.reports;
+        });
+        wheel.Create();
+
+        const size_t physics_timer = loop.AddTimer(
+            start + period, [&wheel, &result, period, next = start + period](Clock::time_point now) mutable {
+                ++result.ticks;
+                if (!wheel.PhysicsTick(now)) {
+                    return Clock::time_point::max();
+                }
+                next += period;
+                if (next <= now) {
+                    next = now + period;
+                }
+                return next;
+            });
+        const size_t wake = loop.AddSignal([&loop, &wheel, &result, physics_timer, period] {
+            const Clock::time_point now = loop.Now();
+            ++result.ticks;
+            if (wheel.PhysicsTick(now) && !loop.TimerArmed(physics_timer)) {
+                loop.ArmTimer(physics_timer, now + period);
+            }
+        });
+        wheel.SetPhysicsWake([&loop, wake] { loop.Signal(wake); });
+        seat.report_timer =
+            loop.AddTimer(Clock::time_point::max(), [&wheel](Clock::time_point now) { return wheel.ServiceReports(now); });
+
+        wheel.SetEnabled(true, seat.input);
+        // Enabling grabbed the idle input manager; on Windows that clips the cursor
+        seat.input.GrabDevices(false);
+    }
+    loop.SetIdleHandler([&] {
+        const Clock::time_point now = loop.Now();
+        for (auto& seat : seats) {
+            loop.ArmTimer(seat->report_timer, seat->wheel.ServiceReports(now));
+        }
+    });
+
+    const Clock::duration ffb_period = Period(options.ffb_hz);
+    loop.AddTimer(start + ffb_period, [&](Clock::time_point now) {
+        for (size_t i = 0; i < seats.size(); ++i) {
+            seats[i]->wheel.ApplyFFBForce(GameForce(now, i));
+        }
+        return now + ffb_period;
+    });
+    const Clock::duration input_period = Period(options.input_hz);
+    uint64_t input_frames = 0;
+    loop.AddTimer(start + input_period, [&](Clock::time_point now) {
+        InputFrame frame;
+        frame.timestamp = now;
+        // Small corrections around the centre, repeating every 16 frames
+        frame.mouse_dx = static_cast<int>((input_frames * 5) % 16) - 7;
+        ++input_frames;
+        for (auto& seat : seats) {
+            seat->wheel.ProcessInputFrame(frame, kSensitivity);
+        }
+        return now + input_period;
+    });
+
+    const auto wall_start = Clock::now();
+    loop.RunUntil(start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.seconds)));
+    result.wall_s = std::chrono::duration<double>(Clock::now() - wall_start).count();
+    for (const auto& seat : seats) {
+        result.reports += seat->reports;
+        result.hash = (result.hash ^ seat->hash) * kFnvPrime;
+    }
+    return result;
+}
+
+bool ParseArg(const char* arg, const char* name, double& out) {
+    const size_t len = std::strlen(name);
+    if (std::strncmp(arg, name, len) != 0 || arg[len] != '=') {
+        return false;
+    }
+    out = std::atof(arg + len + 1);
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        if (ParseArg(argv[i], "--seconds", options.seconds) || ParseArg(argv[i], "--seats", options.seats) ||
+            ParseArg(argv[i], "--hz", options.hz) || ParseArg(argv[i], "--ffb-hz", options.ffb_hz) ||
+            ParseArg(argv[i], "--input-hz", options.input_hz) || ParseArg(argv[i], "--runs", options.runs)) {
+            continue;
+        }
+        std::fprintf(stderr,
+                     "usage: %s [--seconds=S] [--seats=N] [--hz=N] [--ffb-hz=N] [--input-hz=N] [--runs=N]\n",
+                     argv[0]);
+        return 2;
+    }
+    options.seconds = std::max(options.seconds, 0.01);
+    options.seats = std::clamp(options.seats, 1.0, 64.0);
+    options.hz = std::clamp(options.hz, 250.0, 4000.0);
+    options.ffb_hz = std::clamp(options.ffb_hz, 1.0, 1000.0);
+    options.input_hz = std::clamp(options.input_hz, 1.0, 8000.0);
+    options.runs = std::max(options.runs, 1.0);
+    logging::InitLogger(static_cast<int>(logging::LogLevel::Error));
+
+    std::printf("%.0f simulated s, %.0f seat(s), physics %.0f Hz, FFB %.0f Hz, input %.0f Hz\n", options.seconds,
+                options.seats, options.hz, options.ffb_hz, options.input_hz);
+    std::printf("%-4s %10s %10s %12s %10s %10s %16s\n", "run", "wall ms", "speedup", "ticks", "ns/tick", "reports",
+                "report hash");
+    uint64_t first_hash = 0;
+    bool deterministic = true;
+    for (int run = 0; run < static_cast<int>(options.runs); ++run) {
+        const RunResult result = Run(options);
+        std::printf("%-4d %10.1f %9.0fx %12llu %10.0f %10llu %016llx\n", run + 1, result.wall_s * 1000.0,
+                    result.wall_s > 0.0 ? options.seconds / result.wall_s : 0.0,
+                    static_cast<unsigned long long>(result.ticks),
+                    result.ticks ? result.wall_s * 1e9 / static_cast<double>(result.ticks) : 0.0,
+                    static_cast<unsigned long long>(result.reports), static_cast<unsigned long long>(result.hash));
+        if (run == 0) {
+            first_hash = result.hash;
+        } else if (result.hash != first_hash) {
+            deterministic = false;
+        }
+    }
+    std::printf("deterministic: %s\n", deterministic ? "yes" : "NO, report streams differ between runs");
+    logging::ShutdownLogger();
+    return deterministic ? 0 : 1;
+}
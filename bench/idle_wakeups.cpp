@@ -0,0 +1,443 @@
+// Wakeups of an idle emulator: physics ticking at rest against parking.
+//
+// Each synthetic seat runs the FFB step plus the rest check WheelDevice uses.
+// An FFB packet kicks every seat at the start; once the wheels have settled
+// the process is measured for --seconds with no input at all, then one more
+// packet measures how long a parked seat takes to tick again. Both runtimes
+// are run with parking off (the tick always reports activity) and on.
+// A real headless WheelDevice with the default pedal ramps then presses and
+// releases the throttle while its physics is parked: the ramp must wake the
+// tick and reach full travel in about its attack or release time.
+//
+//   bench_idle_wakeups [--seconds=S] [--seats=N] [--hz=N]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "config.h"
+#include "event_loop.h"
+#include "ffb_physics.h"
+#include "input/input_manager.h"
+#include "logging/logger.h"
+#include "physics_scheduler.h"
+#include "wheel_device.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
+std::atomic<bool> running{true};
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int kSensitivity = 50;
+// Raw throttle axis of a released and a fully pressed pedal; 100% scales by
+// 655.35f, so full travel may read one count short
+constexpr int kThrottleReleased = 65535;
+constexpr int kThrottlePressed = 0;
+
+struct Usage {
+    double cpu_seconds = 0.0;
+    // -1 where the platform does not report them per process
+    long long switches = -1;
+};
+
+Usage ProcessUsage() {
+    Usage usage;
+#ifdef _WIN32
+    FILETIME created, exited, kernel, user;
+    GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user);
+    auto to_seconds = [](const FILETIME& ft) {
+        ULARGE_INTEGER value;
+        value.LowPart = ft.dwLowDateTime;
+        value.HighPart = ft.dwHighDateTime;
+        return static_cast<double>(value.QuadPart) * 1e-7;
+    };
+    usage.cpu_seconds = to_seconds(kernel) + to_seconds(user);
+#else
+    rusage ru{};
+    getrusage(RUSAGE_SELF, &ru);
+    usage.cpu_seconds = static_cast<double>(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) +
+                        static_cast<double>(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1e-6;
+    usage.switches = ru.ru_nvcsw + ru.ru_nivcsw;
+#endif
+    return usage;
+}
+
+// The parts of WheelDevice::PhysicsTick that decide rest
+struct RestSeat {
+    std::mutex mutex;
+    int16_t force = 0;
+    FfbPhysicsState physics;
+    bool resting = false;
+    std::atomic<bool> parked{false};
+    std::atomic<uint64_t> ticks{0};
+    std::atomic<int64_t> kicked_at_ns{0};
+    std::atomic<int64_t> resume_ns{-1};
+    std::function<void()> wake;
+    bool park = true;
+
+    bool Tick(Clock::time_point now) {
+        ticks.fetch_add(1, std::memory_order_relaxed);
+        const int64_t kicked = kicked_at_ns.exchange(0, std::memory_order_relaxed);
+        if (kicked != 0) {
+            resume_ns.store(now.time_since_epoch().count() - kicked, std::memory_order_relaxed);
+        }
+        if (resting && parked.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        FfbPhysicsInput input;
+        input.force = force;
+        input.gain = 0.5f;
+        input.steering = physics.offset;
+        StepFfbPhysics(physics, input, 0.001f);
+        const bool at_rest = park && SettleFfbPhysics(physics, input);
+        resting = at_rest;
+        if (at_rest) {
+            parked.store(true, std::memory_order_relaxed);
+        }
+        return !at_rest;
+    }
+
+    // OnFFBPacket: new force under the lock, clear the flag, wake
+    void Kick(int16_t new_force) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            force = new_force;
+        }
+        kicked_at_ns.store(Clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+        parked.store(false, std::memory_order_relaxed);
+        wake();
+    }
+};
+
+struct Result {
+    double ticks_per_second = 0.0;
+    double switches_per_second = -1.0;
+    double cpu_percent = 0.0;
+    double resume_us = -1.0;
+};
+
+// Kick, wait for the wheels to settle, measure the idle window, kick again
+Result Measure(std::vector<std::unique_ptr<RestSeat>>& seats, double seconds) {
+    for (auto& seat : seats) {
+        seat->Kick(3000);
+    }
+    // The spring/damper settles in about 3 s
+    std::this_thread::sleep_for(std::chrono::milliseconds(4000));
+    for (auto& seat : seats) {
+        seat->Kick(3000);  // same force: nothing to do beyond one tick
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    uint64_t ticks_before = 0;
+    for (auto& seat : seats) {
+        ticks_before += seat->ticks.load();
+    }
+    const Usage before = ProcessUsage();
+    const auto start = Clock::now();
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    const double wall = std::chrono::duration<double>(Clock::now() - start).count();
+    const Usage after = ProcessUsage();
+    uint64_t ticks_after = 0;
+    for (auto& seat : seats) {
+        ticks_after += seat->ticks.load();
+    }
+
+    Result result;
+    result.ticks_per_second = static_cast<double>(ticks_after - ticks_before) / wall;
+    if (after.switches >= 0) {
+        result.switches_per_second = static_cast<double>(after.switches - before.switches) / wall;
+    }
+    result.cpu_percent = 100.0 * (after.cpu_seconds - before.cpu_seconds) / wall;
+
+    seats[0]->resume_ns.store(-1);
+    seats[0]->Kick(-2000);
+    for (int i = 0; i < 1000 && seats[0]->resume_ns.load() < 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    result.resume_us = static_cast<double>(seats[0]->resume_ns.load()) / 1000.0;
+    return result;
+}
+
+std::vector<std::unique_ptr<RestSeat>> MakeSeats(size_t count, bool park) {
+    std::vector<std::unique_ptr<RestSeat>> seats;
+    for (size_t i = 0; i < count; ++i) {
+        seats.push_back(std::make_unique<RestSeat>());
+        seats.back()->park = park;
+    }
+    return seats;
+}
+
+PreciseTimer SleepOnlyTimer() {
+    PreciseTimer timer;
+    timer.Configure(PreciseTimer::Mode::PowerSave, std::chrono::microseconds(0), std::chrono::microseconds(0));
+    return timer;
+}
+
+Result RunThreaded(size_t seat_count, bool park, std::chrono::microseconds period, double seconds) {
+    auto seats = MakeSeats(seat_count, park);
+    PhysicsScheduler scheduler;
+    scheduler.SetTimer(SleepOnlyTimer());
+    for (auto& seat_ptr : seats) {
+        RestSeat* seat = seat_ptr.get();
+        const size_t task = scheduler.AddTask([seat](Clock::time_point now) { return seat->Tick(now); });
+        seat->wake = [&scheduler, task] { scheduler.Wake(task); };
+    }
+    scheduler.Start(0, period);
+    const Result result = Measure(seats, seconds);
+    scheduler.Stop();
+    return result;
+}
+
+Result RunEventLoop(size_t seat_count, bool park, std::chrono::microseconds period, double seconds) {
+    auto seats = MakeSeats(seat_count, park);
+    EventLoop loop;
+    if (!loop.Init()) {
+        std::fprintf(stderr, "event loop init failed\n");
+        return Result();
+    }
+    loop.SetTimer(SleepOnlyTimer());
+    const Clock::time_point first = Clock::now() + period;
+    for (auto& seat_ptr : seats) {
+        RestSeat* seat = seat_ptr.get();
+        // Same wiring as RunEventLoop() in main.cpp
+        const size_t timer = loop.AddTimer(first, [seat, period, next = first](Clock::time_point now) mutable {
+            if (!seat->Tick(now)) {
+                return Clock::time_point::max();
+            }
+            next += period;
+            if (next <= now) next = now + period;
+            return next;
+        });
+        const size_t signal = loop.AddSignal([&loop, seat, timer, period] {
+            const Clock::time_point now = Clock::now();
+            if (seat->Tick(now) && !loop.TimerArmed(timer)) {
+                loop.ArmTimer(timer, now + period);
+            }
+        });
+        seat->wake = [&loop, signal] { loop.Signal(signal); };
+    }
+    std::atomic<bool> loop_running{true};
+    std::thread loop_thread([&] { loop.Run(loop_running); });
+    const Result result = Measure(seats, seconds);
+    loop.Stop();
+    loop_thread.join();
+    return result;
+}
+
+// A real headless seat; the runtime runs its PhysicsTick() through Tick()
+struct PedalSeat {
+    WheelDevice wheel;
+    // Never initialized: SetEnabled() only grabs and resyncs it
+    InputManager input;
+    std::atomic<uint64_t> ticks{0};
+    std::atomic<int> throttle{-1};
+
+    explicit PedalSeat(bool external_reports) {
+        const Config defaults;
+        wheel.SetHeadless();
+        if (external_reports) {
+            wheel.UseExternalReportLoop();
+        }
+        wheel.SetPedalRamps(defaults.throttle_ramp, defaults.brake_ramp, defaults.clutch_ramp);
+        wheel.SetReportSink([this](const HidReport& report) {
+            throttle.store(static_cast<int>(report[4]) | (static_cast<int>(report[5]) << 8), std::memory_order_relaxed);
+        });
+        wheel.Create();
+    }
+
+    bool Tick(Clock::time_point now) {
+        ticks.fetch_add(1, std::memory_order_relaxed);
+        return wheel.PhysicsTick(now);
+    }
+
+    void Enable() {
+        wheel.SetEnabled(true, input);
+        // Enabling grabbed the idle input manager; on Windows that clips the cursor
+        input.GrabDevices(false);
+    }
+};
+
+struct Travel {
+    double ms = -1.0;  // -1: never reached full travel
+    uint64_t ticks = 0;
+};
+
+struct PedalResult {
+    double idle_ticks_per_second = 0.0;
+    Travel press;
+    Travel release;
+};
+
+// Sets the throttle and waits up to 1 s for the report to reach `target`
+Travel MoveThrottle(PedalSeat& seat, bool pressed, int target) {
+    InputFrame frame;
+    frame.logical.throttle = pressed;
+    frame.timestamp = Clock::now();
+    const uint64_t ticks_before = seat.ticks.load();
+    seat.wheel.ProcessInputFrame(frame, kSensitivity);
+    Travel travel;
+    while (Clock::now() - frame.timestamp < std::chrono::seconds(1)) {
+        if (std::abs(seat.throttle.load(std::memory_order_relaxed) - target) <= 1) {
+            travel.ms = std::chrono::duration<double, std::milli>(Clock::now() - frame.timestamp).count();
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    travel.ticks = seat.ticks.load() - ticks_before;
+    return travel;
+}
+
+// Enable, let the seat park, then press and release with a pause to park in between
+PedalResult MeasurePedal(PedalSeat& seat) {
+    seat.Enable();
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    PedalResult result;
+    const uint64_t ticks_before = seat.ticks.load();
+    const auto start = Clock::now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    result.idle_ticks_per_second = static_cast<double>(seat.ticks.load() - ticks_before) /
+                                   std::chrono::duration<double>(Clock::now() - start).count();
+    result.press = MoveThrottle(seat, true, kThrottlePressed);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    result.release = MoveThrottle(seat, false, kThrottleReleased);
+    return result;
+}
+
+PedalResult RunPedalThreaded(std::chrono::microseconds period) {
+    PedalSeat seat(false);
+    PhysicsScheduler scheduler;
+    scheduler.SetTimer(SleepOnlyTimer());
+    const size_t task = scheduler.AddTask([&seat](Clock::time_point now) { return seat.Tick(now); });
+    seat.wheel.SetPhysicsWake([&scheduler, task] { scheduler.Wake(task); });
+    scheduler.Start(0, period);
+    const PedalResult result = MeasurePedal(seat);
+    seat.wheel.SetEnabled(false, seat.input);
+    scheduler.Stop();
+    return result;
+}
+
+PedalResult RunPedalEventLoop(std::chrono::microseconds period) {
+    PedalSeat seat(true);
+    EventLoop loop;
+    if (!loop.Init()) {
+        std::fprintf(stderr, "event loop init failed\n");
+        return PedalResult();
+    }
+    loop.SetTimer(SleepOnlyTimer());
+    const Clock::time_point first = Clock::now() + period;
+    const size_t timer = loop.AddTimer(first, [&seat, period, next = first](Clock::time_point now) mutable {
+        if (!seat.Tick(now)) {
+            return Clock::time_point::max();
+        }
+        next += period;
+        if (next <= now) next = now + period;
+        return next;
+    });
+    const size_t signal = loop.AddSignal([&loop, &seat, timer, period] {
+        const Clock::time_point now = Clock::now();
+        if (seat.Tick(now) && !loop.TimerArmed(timer)) {
+            loop.ArmTimer(timer, now + period);
+        }
+    });
+    seat.wheel.SetPhysicsWake([&loop, signal] { loop.Signal(signal); });
+    const size_t reports = loop.AddTimer(Clock::time_point::max(),
+                                         [&seat](Clock::time_point now) { return seat.wheel.ServiceReports(now); });
+    loop.SetIdleHandler([&loop, &seat, reports] { loop.ArmTimer(reports, seat.wheel.ServiceReports(Clock::now())); });
+    std::atomic<bool> loop_running{true};
+    std::thread loop_thread([&] { loop.Run(loop_running); });
+    const PedalResult result = MeasurePedal(seat);
+    seat.wheel.SetEnabled(false, seat.input);
+    loop.Stop();
+    loop_thread.join();
+    return result;
+}
+
+void PrintTravel(const Travel& travel) {
+    if (travel.ms >= 0.0) {
+        std::printf(" %9.1f %7llu", travel.ms, static_cast<unsigned long long>(travel.ticks));
+    } else {
+        std::printf(" %9s %7llu", "stuck", static_cast<unsigned long long>(travel.ticks));
+    }
+}
+
+void PrintPedal(const char* runtime, const PedalResult& result) {
+    std::printf("%-10s %9.0f", runtime, result.idle_ticks_per_second);
+    PrintTravel(result.press);
+    PrintTravel(result.release);
+    std::printf("\n");
+}
+
+void Print(const char* runtime, const char* mode, const Result& result) {
+    std::printf("%-10s %-6s %9.0f", runtime, mode, result.ticks_per_second);
+    if (result.switches_per_second >= 0) {
+        std::printf(" %9.1f", result.switches_per_second);
+    } else {
+        std::printf(" %9s", "n/a");
+    }
+    std::printf(" %7.3f %11.0f\n", result.cpu_percent, result.resume_us);
+}
+
+bool ParseArg(const char* arg, const char* name, double& out) {
+    const size_t len = std::strlen(name);
+    if (std::strncmp(arg, name, len) != 0 || arg[len] != '=') {
+        return false;
+    }
+    out = std::atof(arg + len + 1);
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    double seconds = 3.0;
+    double seat_count = 2.0;
+    double hz = 1000.0;
+    for (int i = 1; i < argc; ++i) {
+        if (ParseArg(argv[i], "--seconds", seconds) || ParseArg(argv[i], "--seats", seat_count) ||
+            ParseArg(argv[i], "--hz", hz)) {
+            continue;
+        }
+        std::fprintf(stderr, "usage: %s [--seconds=S] [--seats=N] [--hz=N]\n", argv[0]);
+        return 2;
+    }
+    const size_t seats = static_cast<size_t>(std::clamp(seat_count, 1.0, 16.0));
+    logging::InitLogger(static_cast<int>(logging::LogLevel::Error));
+    const auto period = std::chrono::microseconds(static_cast<int>(1000000 / std::clamp(hz, 250.0, 4000.0)));
+
+    std::printf("%zu seat(s), %lld us period, %.1f s idle window per run\n\n", seats,
+                static_cast<long long>(period.count()), seconds);
+    std::printf("%-10s %-6s %9s %9s %7s %11s\n", "runtime", "park", "ticks/s", "csw/s", "cpu %", "resume us");
+    Print("threads", "off", RunThreaded(seats, false, period, seconds));
+    Print("threads", "on", RunThreaded(seats, true, period, seconds));
+    Print("eventloop", "off", RunEventLoop(seats, false, period, seconds));
+    Print("eventloop", "on", RunEventLoop(seats, true, period, seconds));
+
+    const Config defaults;
+    std::printf("\nthrottle pressed and released while parked (ramp %.0f/%.0f ms)\n", defaults.throttle_ramp.attack_ms,
+                defaults.throttle_ramp.release_ms);
+    std::printf("%-10s %9s %9s %7s %9s %7s\n", "runtime", "idle t/s", "press ms", "ticks", "release ms", "ticks");
+    const PedalResult threaded = RunPedalThreaded(period);
+    PrintPedal("threads", threaded);
+    const PedalResult event_loop = RunPedalEventLoop(period);
+    PrintPedal("eventloop", event_loop);
+    // A ramp that never wakes the parked tick leaves the pedal stuck
+    const bool stuck = threaded.press.ms < 0.0 || threaded.release.ms < 0.0 || event_loop.press.ms < 0.0 ||
+                       event_loop.release.ms < 0.0;
+    return stuck ? 1 : 0;
+}
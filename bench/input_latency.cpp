@@ -0,0 +1,456 @@
+// Input-to-report latency through the real pipeline. Synthetic events are
+// injected into DeviceScanner the way the Raw Input backend feeds it, pass the
+// reader thread, the seat loop and the report thread, and every submitted
+// report is caught by a recording sink on HidDevice. An event's latency is the
+// time from its injection to the first report that contains it.
+//
+// Each mouse event moves the wheel by exactly one steering count, so a
+// report's steering value tells how many events it contains; the wheel is
+// re-centred every kMouseChunk events. Key bursts press --burst-keys bound
+// buttons at once and are matched by the button bit rising. --load adds
+// spinning threads that compete with the pipeline for the CPU. --trace writes
+// a Chrome trace of every pipeline thread, with a flow per input frame,
+// --record a session file for wheel-replay and --scope the physics signals.
+//
+//   bench_input_latency [--seconds=S] [--rates=125,1000,8000] [--burst-keys=N]
+//                       [--burst-hz=N] [--load=N] [--hz=N] [--timer=hybrid|powersave]
+//                       [--trace=FILE] [--record=FILE] [--scope=FILE]
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "input/input_manager.h"
+#include "logging/logger.h"
+#include "physics_scheduler.h"
+#include "session_recorder.h"
+#include "signal_scope.h"
+#include "trace.h"
+#include "tsc_clock.h"
+#include "wheel_device.h"
+
+std::atomic<bool> running{true};
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// One count of steering per mouse count (ApplySteeringDeltaLocked: 0.05 per unit)
+constexpr int kSensitivity = 20;
+// Steering counts available before the axis clamps at 32767
+constexpr size_t kMouseChunk = 30000;
+constexpr uintptr_t kMouse = 1;
+constexpr uintptr_t kKeyboard = 2;
+
+int ReportSteering(const HidReport& report) {
+    const uint16_t steering_u = static_cast<uint16_t>(report[0] | (report[1] << 8));
+    return static_cast<int>(steering_u) - 32768;
+}
+
+ButtonMask ReportButtons(const HidReport& report) {
+    ButtonMask buttons;
+    for (size_t w = 0; w < ButtonMask::kWords; ++w) {
+        for (size_t b = 0; b < 8; ++b) {
+            buttons.words[w] |= static_cast<uint64_t>(report[kReportButtonOffset + w * 8 + b]) << (b * 8);
+        }
+    }
+    return buttons;
+}
+
+// The sink side; runs on the report thread. The injector stamps events under
+// the same mutex just before handing them to the scanner.
+class LatencyRecorder {
+public:
+    void BeginMouseChunk(size_t events) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        mode_ = Mode::Mouse;
+        sent_.assign(events, Clock::time_point());
+        stamped_ = 0;
+        matched_ = 0;
+    }
+
+    // Events are stamped in order
+    void StampMouse() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        sent_[stamped_++] = Clock::now();
+    }
+
+    void BeginKeys() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        mode_ = Mode::Keys;
+        pending_.Clear();
+    }
+
+    void StampPress(size_t button) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        press_time_[button] = Clock::now();
+        pending_.Set(button);
+    }
+
+    // Events still waiting for a report
+    size_t Unmatched() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (mode_ == Mode::Mouse) {
+            return sent_.size() - matched_;
+        }
+        size_t count = 0;
+        for (size_t button = 0; button < kMaxButtons; ++button) {
+            count += pending_.Test(button) ? 1 : 0;
+        }
+        return count;
+    }
+
+    void End() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        mode_ = Mode::Idle;
+    }
+
+    void OnReport(const HidReport& report) {
+        const Clock::time_point now = Clock::now();
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++reports_;
+        const ButtonMask buttons = ReportButtons(report);
+        const ButtonMask rising = buttons & ~last_buttons_;
+        last_buttons_ = buttons;
+        if (mode_ == Mode::Mouse) {
+            const int steering = ReportSteering(report);
+            const size_t contained = steering > 0 ? static_cast<size_t>(steering) : 0;
+            for (; matched_ < contained && matched_ < stamped_; ++matched_) {
+                Record(now - sent_[matched_]);
+            }
+        } else if (mode_ == Mode::Keys) {
+            const ButtonMask hits = rising & pending_;
+            for (size_t button = 0; button < kMaxButtons; ++button) {
+                if (hits.Test(button)) {
+                    pending_.Reset(button);
+                    Record(now - press_time_[button]);
+                }
+            }
+        }
+    }
+
+    // Moves out the latencies (us) and report count since the last call
+    void Take(std::vector<double>& latencies_us, uint64_t& reports) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        latencies_us.swap(latencies_us_);
+        latencies_us_.clear();
+        reports = reports_;
+        reports_ = 0;
+    }
+
+private:
+    enum class Mode { Idle, Mouse, Keys };
+
+    void Record(Clock::duration latency) {
+        latencies_us_.push_back(std::chrono::duration<double, std::micro>(latency).count());
+    }
+
+    std::mutex mutex_;
+    Mode mode_ = Mode::Idle;
+    std::vector<Clock::time_point> sent_;
+    size_t stamped_ = 0;
+    size_t matched_ = 0;
+    std::array<Clock::time_point, kMaxButtons> press_time_{};
+    ButtonMask pending_;
+    ButtonMask last_buttons_;
+    std::vector<double> latencies_us_;
+    uint64_t reports_ = 0;
+};
+
+struct PassResult {
+    std::string name;
+    uint64_t events = 0;
+    double events_per_second = 0.0;
+    uint64_t reports = 0;
+    uint64_t lost = 0;
+    std::vector<double> latencies_us;
+};
+
+// The wheel runs as in main's threaded runtime: reader thread, seat loop,
+// report thread and a physics worker
+struct Pipeline {
+    InputManager input;
+    WheelDevice wheel;
+    PhysicsScheduler physics;
+    std::thread seat_thread;
+
+    bool Start(LatencyRecorder& recorder, const PreciseTimer& timer, std::chrono::microseconds period) {
+        wheel.SetReportSink([&recorder](const HidReport& report) { recorder.OnReport(report); });
+        wheel.SetTimer(timer);
+        if (!input.Initialize("", "") || !wheel.Create()) {
+            return false;
+        }
+        wheel.AttachPhysics(physics);
+        physics.SetTimer(timer);
+        physics.Start(1, period);
+        seat_thread = std::thread([this] {
+            trace::SetThreadName("seat loop");
+            InputFrame frame;
+            while (running) {
+                if (input.WaitForFrame(frame) && wheel.IsEnabled()) {
+                    wheel.ProcessInputFrame(frame, kSensitivity);
+                }
+            }
+        });
+        wheel.SetEnabled(true, input);
+        // Let the arming reports go out
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        return wheel.IsEnabled();
+    }
+
+    void Stop() {
+        running.store(false);
+        wheel.SetEnabled(false, input);
+        wheel.WakeForShutdown();
+        input.Shutdown();
+        if (seat_thread.joinable()) {
+            seat_thread.join();
+        }
+        physics.Stop();
+        wheel.ShutdownThreads();
+    }
+};
+
+// Waits up to 1 s for the reports of everything injected so far
+size_t Drain(LatencyRecorder& recorder) {
+    const auto give_up = Clock::now() + std::chrono::seconds(1);
+    size_t unmatched = recorder.Unmatched();
+    while (unmatched > 0 && Clock::now() < give_up) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        unmatched = recorder.Unmatched();
+    }
+    return unmatched;
+}
+
+PassResult RunMouse(Pipeline& pipeline, LatencyRecorder& recorder, double rate, double seconds) {
+    PassResult result;
+    result.name = "mouse " + std::to_string(static_cast<int>(rate)) + " Hz";
+    const auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / rate));
+    const uint64_t total = std::max<uint64_t>(1, static_cast<uint64_t>(rate * seconds));
+    DeviceScanner& scanner = pipeline.input.Scanner();
+
+    double wall = 0.0;
+    uint64_t done = 0;
+    while (done < total) {
+        const size_t chunk = static_cast<size_t>(std::min<uint64_t>(kMouseChunk, total - done));
+        // Back to the centre; the neutral report is not matched
+        pipeline.wheel.SendNeutral(false);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        recorder.BeginMouseChunk(chunk);
+        const auto start = Clock::now();
+        Clock::time_point next = start;
+        for (size_t i = 0; i < chunk; ++i) {
+            std::this_thread::sleep_until(next);
+            next += period;
+            recorder.StampMouse();
+            scanner.UpdateMouseState(kMouse, 1, 0, 0);
+        }
+        wall += std::chrono::duration<double>(Clock::now() - start).count();
+        result.lost += Drain(recorder);
+        recorder.End();
+        done += chunk;
+    }
+    result.events = total;
+    result.events_per_second = static_cast<double>(total) / wall;
+    recorder.Take(result.latencies_us, result.reports);
+    return result;
+}
+
+// Bursts of `keys` presses, released after a third of the burst period so
+// the minimum button pulse has ended before the next burst
+PassResult RunKeys(Pipeline& pipeline, LatencyRecorder& recorder, size_t keys, double burst_hz, double seconds) {
+    struct BoundKey {
+        uint16_t key;
+        size_t button;
+    };
+    std::vector<BoundKey> bound;
+    for (const BindingSchemaEntry& entry : kBindingSchema) {
+        if (entry.action >= InputAction::FirstButton && bound.size() < keys) {
+            const size_t button =
+                static_cast<size_t>(entry.action) - static_cast<size_t>(InputAction::FirstButton);
+            bound.push_back({entry.default_key, button});
+        }
+    }
+
+    PassResult result;
+    result.name = "keys x" + std::to_string(bound.size()) + " " + std::to_string(static_cast<int>(burst_hz)) + " Hz";
+    const auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / burst_hz));
+    const uint64_t bursts = std::max<uint64_t>(1, static_cast<uint64_t>(burst_hz * seconds));
+    DeviceScanner& scanner = pipeline.input.Scanner();
+
+    recorder.BeginKeys();
+    const auto start = Clock::now();
+    Clock::time_point next = start;
+    for (uint64_t burst = 0; burst < bursts; ++burst) {
+        std::this_thread::sleep_until(next);
+        for (const BoundKey& key : bound) {
+            recorder.StampPress(key.button);
+            scanner.UpdateKeyState(kKeyboard, InputDeviceKind::Keyboard, key.key, true);
+        }
+        std::this_thread::sleep_until(next + period / 3);
+        for (const BoundKey& key : bound) {
+            scanner.UpdateKeyState(kKeyboard, InputDeviceKind::Keyboard, key.key, false);
+        }
+        next += period;
+    }
+    result.lost = Drain(recorder);
+    recorder.End();
+    const double wall = std::chrono::duration<double>(Clock::now() - start).count();
+    result.events = bursts * bound.size();
+    result.events_per_second = static_cast<double>(result.events) / wall;
+    recorder.Take(result.latencies_us, result.reports);
+    return result;
+}
+
+double Quantile(const std::vector<double>& sorted, double q) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    const size_t index = static_cast<size_t>(q * static_cast<double>(sorted.size()));
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+void Print(PassResult& result) {
+    std::sort(result.latencies_us.begin(), result.latencies_us.end());
+    const std::vector<double>& l = result.latencies_us;
+    std::printf("%-16s %9.0f %8llu %8llu %8.1f %8.1f %8.1f %8.1f %6llu\n", result.name.c_str(),
+                result.events_per_second, static_cast<unsigned long long>(result.events),
+                static_cast<unsigned long long>(result.reports), Quantile(l, 0.50), Quantile(l, 0.99),
+                Quantile(l, 0.999), l.empty() ? 0.0 : l.back(), static_cast<unsigned long long>(result.lost));
+}
+
+bool ParseArg(const char* arg, const char* name, double& out) {
+    const size_t len = std::strlen(name);
+    if (std::strncmp(arg, name, len) != 0 || arg[len] != '=') {
+        return false;
+    }
+    out = std::atof(arg + len + 1);
+    return true;
+}
+
+bool ParseArg(const char* arg, const char* name, std::string& out) {
+    const size_t len = std::strlen(name);
+    if (std::strncmp(arg, name, len) != 0 || arg[len] != '=') {
+        return false;
+    }
+    out = arg + len + 1;
+    return true;
+}
+
+std::vector<double> ParseRates(const std::string& list) {
+    std::vector<double> rates;
+    size_t begin = 0;
+    while (begin < list.size()) {
+        size_t end = list.find(',', begin);
+        if (end == std::string::npos) end = list.size();
+        const double rate = std::atof(list.substr(begin, end - begin).c_str());
+        if (rate > 0.0) {
+            rates.push_back(std::clamp(rate, 1.0, 8000.0));
+        }
+        begin = end + 1;
+    }
+    return rates;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    double seconds = 2.0;
+    std::string rate_list = "125,1000,8000";
+    double burst_keys = 8.0;
+    double burst_hz = 20.0;
+    double load = 0.0;
+    double hz = 1000.0;
+    std::string timer_name = "hybrid";
+    std::string trace_file;
+    std::string record_file;
+    std::string scope_file;
+    for (int i = 1; i < argc; ++i) {
+        if (ParseArg(argv[i], "--seconds", seconds) || ParseArg(argv[i], "--rates", rate_list) ||
+            ParseArg(argv[i], "--burst-keys", burst_keys) || ParseArg(argv[i], "--burst-hz", burst_hz) ||
+            ParseArg(argv[i], "--load", load) || ParseArg(argv[i], "--hz", hz) ||
+            ParseArg(argv[i], "--timer", timer_name) || ParseArg(argv[i], "--trace", trace_file) ||
+            ParseArg(argv[i], "--record", record_file) || ParseArg(argv[i], "--scope", scope_file)) {
+            continue;
+        }
+        std::fprintf(stderr,
+                     "usage: %s [--seconds=S] [--rates=125,1000,8000] [--burst-keys=N] [--burst-hz=N] [--load=N] "
+                     "[--hz=N] [--timer=hybrid|powersave] [--trace=FILE] [--record=FILE] [--scope=FILE]\n",
+                     argv[0]);
+        return 2;
+    }
+    PreciseTimer::Mode mode;
+    if (!PreciseTimer::ParseMode(timer_name, mode)) {
+        std::fprintf(stderr, "unknown timer mode %s\n", timer_name.c_str());
+        return 2;
+    }
+    tsc::Init();
+    logging::InitLogger(static_cast<int>(logging::LogLevel::Error));
+    const auto period = std::chrono::microseconds(static_cast<int>(1000000 / std::clamp(hz, 250.0, 4000.0)));
+    PreciseTimer timer;
+    timer.Configure(mode, std::chrono::microseconds(0), period);
+    if (mode == PreciseTimer::Mode::Hybrid) {
+        timer.Calibrate(period);
+    }
+
+    std::atomic<bool> stop_load{false};
+    std::vector<std::thread> load_threads;
+    for (int i = 0; i < static_cast<int>(std::clamp(load, 0.0, 64.0)); ++i) {
+        load_threads.emplace_back([&stop_load] {
+            volatile uint64_t sink = 0;
+            while (!stop_load.load(std::memory_order_relaxed)) {
+                sink = sink + 1;
+            }
+        });
+    }
+
+    if (!trace_file.empty()) {
+        trace::Start(trace_file);
+    }
+    if (!record_file.empty() && !session::Start(record_file, period, 1)) {
+        return 1;
+    }
+    if (!scope_file.empty() && !scope::Start(scope_file)) {
+        return 1;
+    }
+    LatencyRecorder recorder;
+    Pipeline pipeline;
+    if (!pipeline.Start(recorder, timer, period)) {
+        std::fprintf(stderr, "could not start the pipeline\n");
+        pipeline.Stop();
+        return 1;
+    }
+
+    std::printf("%u hardware threads, %zu load thread(s), physics %lld us, %s, %.1f s per pass\n\n",
+                std::thread::hardware_concurrency(), load_threads.size(), static_cast<long long>(period.count()),
+                timer.Describe().c_str(), seconds);
+    std::printf("%-16s %9s %8s %8s %8s %8s %8s %8s %6s\n", "pass", "events/s", "events", "reports", "p50 us",
+                "p99 us", "p99.9 us", "max us", "lost");
+    for (double rate : ParseRates(rate_list)) {
+        PassResult result = RunMouse(pipeline, recorder, rate, seconds);
+        Print(result);
+    }
+    if (burst_keys >= 1.0) {
+        const double burst_rate = std::clamp(burst_hz, 1.0, 25.0);
+        PassResult result = RunKeys(pipeline, recorder, static_cast<size_t>(burst_keys), burst_rate, seconds);
+        Print(result);
+    }
+
+    pipeline.Stop();
+    stop_load.store(true);
+    for (std::thread& thread : load_threads) {
+        thread.join();
+    }
+    trace::Stop();
+    session::Stop();
+    scope::Stop();
+    return 0;
+}
@@ -0,0 +1,189 @@
+// Stress test for the WheelLifecycle enable/disable protocol.
+//
+// Drives one real headless WheelDevice from the threads that run around its
+// lifecycle: a control thread toggling emulation, an input thread feeding
+// frames, a physics thread ticking, an FFB thread applying forces, and a
+// report thread running ServiceReports() as the event-loop runtime does.
+// Checks the protocol's guarantees on the reports the sink sees:
+//   - the report that finishes Draining is the neutral report
+//   - nothing is reported while Disabled
+// A phase is only judged when no toggle overlapped the report pass. The
+// neutral report is taken from a second seat that is enabled with no input.
+// Build with WHEEL_SANITIZE_THREAD=ON to run it under ThreadSanitizer.
+//
+//   bench_lifecycle_stress [--seconds=S]
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include "input/input_manager.h"
+#include "logging/logger.h"
+#include "wheel_device.h"
+
+std::atomic<bool> running{true};
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int kSensitivity = 50;
+
+// Headless seat whose reports are serviced by the caller
+struct Seat {
+    WheelDevice wheel;
+    // Never initialized: SetEnabled() only grabs and resyncs it
+    InputManager input;
+    // Written by the sink on the thread calling ServiceReports()
+    HidReport last_report{};
+    uint64_t reports = 0;
+
+    Seat() {
+        wheel.SetHeadless();
+        wheel.UseExternalReportLoop();
+        wheel.SetReportSink([this](const HidReport& report) {
+            last_report = report;
+            ++reports;
+        });
+        wheel.Create();
+    }
+};
+
+HidReport NeutralReport() {
+    Seat seat;
+    seat.wheel.SetEnabled(true, seat.input);
+    seat.wheel.ServiceReports(Clock::now());
+    seat.wheel.SetEnabled(false, seat.input);
+    return seat.last_report;
+}
+
+struct Counts {
+    std::atomic<uint64_t> toggles{0};
+    std::atomic<uint64_t> armed{0};
+    std::atomic<uint64_t> drained{0};
+    std::atomic<uint64_t> violations{0};
+};
+
+void Violation(Counts& counts, const char* what) {
+    if (counts.violations.fetch_add(1, std::memory_order_relaxed) < 5) {
+        std::fprintf(stderr, "violation: %s\n", what);
+    }
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    double seconds = 3.0;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strncmp(argv[i], "--seconds=", 10) == 0) {
+            seconds = std::atof(argv[i] + 10);
+        } else {
+            std::fprintf(stderr, "usage: %s [--seconds=S]\n", argv[0]);
+            return 2;
+        }
+    }
+    // SetEnabled() logs every toggle
+    logging::InitLogger(static_cast<int>(logging::LogLevel::Error));
+
+    const HidReport neutral = NeutralReport();
+    Seat seat;
+    WheelDevice& wheel = seat.wheel;
+    Counts counts;
+    // Odd while the control thread is inside SetEnabled()
+    std::atomic<uint64_t> toggle_sequence{0};
+    std::atomic<bool> stop{false};
+    std::atomic<bool> stop_reports{false};
+
+    std::thread reporter([&] {
+        while (!stop_reports.load(std::memory_order_relaxed)) {
+            const uint64_t sequence = toggle_sequence.load(std::memory_order_acquire);
+            const LifecycleState before = wheel.GetLifecycleState();
+            const uint64_t reports = seat.reports;
+            wheel.ServiceReports(Clock::now());
+            const LifecycleState after = wheel.GetLifecycleState();
+            const bool sent = seat.reports != reports;
+            if ((sequence & 1) == 0 && toggle_sequence.load(std::memory_order_acquire) == sequence) {
+                if (before == LifecycleState::Draining && after == LifecycleState::Disabled) {
+                    counts.drained.fetch_add(1, std::memory_order_relaxed);
+                    if (!sent || seat.last_report != neutral) {
+                        Violation(counts, "Draining finished without a neutral report");
+                    }
+                } else if (before == LifecycleState::Arming && after == LifecycleState::Active) {
+                    counts.armed.fetch_add(1, std::memory_order_relaxed);
+                } else if (before == LifecycleState::Disabled && sent) {
+                    Violation(counts, "report sent while disabled");
+                }
+            }
+            std::this_thread::yield();
+        }
+    });
+    std::thread input([&] {
+        InputFrame frame;
+        for (uint64_t seq = 0; !stop.load(std::memory_order_relaxed); ++seq) {
+            frame.timestamp = Clock::now();
+            frame.mouse_dx = (seq & 1) ? 40 : -30;
+            frame.logical.throttle = (seq & 2) != 0;
+            frame.logical.dpad_x = static_cast<int8_t>(static_cast<int>(seq % 3) - 1);
+            frame.logical.buttons.Clear();
+            frame.logical.buttons.Set(static_cast<size_t>(seq % kMaxButtons));
+            frame.edges.assign(1, ButtonEdge{static_cast<uint8_t>(seq % kMaxButtons), true, frame.timestamp});
+            wheel.ProcessInputFrame(frame, kSensitivity);
+            if ((seq & 63) == 0) std::this_thread::yield();
+        }
+    });
+    std::thread physics([&] {
+        while (!stop.load(std::memory_order_relaxed)) {
+            wheel.PhysicsTick(Clock::now());
+            std::this_thread::yield();
+        }
+    });
+    std::thread ffb([&] {
+        for (int16_t force = 0; !stop.load(std::memory_order_relaxed); force = static_cast<int16_t>(force + 97)) {
+            wheel.ApplyFFBForce(force);
+            std::this_thread::yield();
+        }
+    });
+    std::thread control([&] {
+        auto set_enabled = [&](bool enable) {
+            toggle_sequence.fetch_add(1, std::memory_order_acq_rel);
+            wheel.SetEnabled(enable, seat.input);
+            toggle_sequence.fetch_add(1, std::memory_order_acq_rel);
+        };
+        // Toggle at irregular intervals so transitions land mid-phase
+        for (uint32_t i = 1; !stop.load(std::memory_order_relaxed); ++i) {
+            set_enabled((i & 1) != 0);
+            counts.toggles.fetch_add(1, std::memory_order_relaxed);
+            std::this_thread::sleep_for(std::chrono::microseconds((i * 2654435761u) % 1500));
+        }
+        set_enabled(false);
+        // Enabling grabbed the idle input manager; on Windows that clips the cursor
+        seat.input.GrabDevices(false);
+    });
+
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    stop.store(true);
+    control.join();
+    input.join();
+    physics.join();
+    ffb.join();
+    // Let the last drain finish before stopping the report thread
+    for (int i = 0; i < 100 && wheel.GetLifecycleState() != LifecycleState::Disabled; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    stop_reports.store(true);
+    reporter.join();
+    if (wheel.GetLifecycleState() != LifecycleState::Disabled) {
+        Violation(counts, "the last drain never finished");
+    }
+
+    std::printf("toggles=%llu reports=%llu armed=%llu drained=%llu violations=%llu\n",
+                static_cast<unsigned long long>(counts.toggles.load()), static_cast<unsigned long long>(seat.reports),
+                static_cast<unsigned long long>(counts.armed.load()),
+                static_cast<unsigned long long>(counts.drained.load()),
+                static_cast<unsigned long long>(counts.violations.load()));
+    return counts.violations.load() == 0 ? 0 : 1;
+}
@@ -0,0 +1,418 @@
+// Context switches and CPU time of the threaded runtime against the
+// single-threaded event loop ([threading] runtime=eventloop).
+//
+// Each seat is a headless WheelDevice (reports are built and counted, no
+// vJoy) with its own InputManager. An injector thread standing in for the OS
+// and the game feeds every seat mouse events at --input-hz through the
+// DeviceScanner and FFB packets at 60 Hz; physics ticks at --hz. The threaded
+// mode wires the seats as main does (reader thread -> seat loop -> report
+// thread, physics on the PhysicsScheduler pool); the event-loop mode as
+// RunEventLoop does, on one EventLoop thread. The injector is identical in
+// both, so differences come from the runtime.
+//
+//   bench_runtime_compare [--seconds=S] [--seats=N] [--hz=N] [--input-hz=N]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "config.h"
+#include "event_loop.h"
+#include "input/input_manager.h"
+#include "logging/logger.h"
+#include "physics_scheduler.h"
+#include "wheel_device.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+std::atomic<bool> running{true};
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr int kSensitivity = 50;
+constexpr uintptr_t kMouse = 1;
+// Mouse events per direction of the steering sweep
+constexpr uint64_t kSweepEvents = 512;
+
+struct Usage {
+    double cpu_seconds = 0.0;
+    // -1 where the platform does not report them per process
+    long long voluntary_switches = -1;
+    long long involuntary_switches = -1;
+};
+
+Usage ProcessUsage() {
+    Usage usage;
+#ifdef _WIN32
+    FILETIME created, exited, kernel, user;
+    GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user);
+    auto to_seconds = [](const FILETIME& ft) {
+        ULARGE_INTEGER value;
+        value.LowPart = ft.dwLowDateTime;
+        value.HighPart = ft.dwHighDateTime;
+        return static_cast<double>(value.QuadPart) * 1e-7;
+    };
+    usage.cpu_seconds = to_seconds(kernel) + to_seconds(user);
+#else
+    rusage ru{};
+    getrusage(RUSAGE_SELF, &ru);
+    usage.cpu_seconds = static_cast<double>(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) +
+                        static_cast<double>(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1e-6;
+    usage.voluntary_switches = ru.ru_nvcsw;
+    usage.involuntary_switches = ru.ru_nivcsw;
+#endif
+    return usage;
+}
+
+// OS-style input notification: an eventfd on Linux, an auto-reset event on Windows
+class InputSignal {
+public:
+    InputSignal() {
+#ifdef _WIN32
+        handle_ = CreateEvent(NULL, FALSE, FALSE, NULL);
+#else
+        handle_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#endif
+    }
+    ~InputSignal() {
+#ifdef _WIN32
+        CloseHandle(static_cast<HANDLE>(handle_));
+#else
+        close(handle_);
+#endif
+    }
+    void Raise() {
+#ifdef _WIN32
+        SetEvent(static_cast<HANDLE>(handle_));
+#else
+        const uint64_t one = 1;
+        ssize_t written = write(handle_, &one, sizeof(one));
+        (void)written;
+#endif
+    }
+    void Consume() {
+#ifndef _WIN32
+        uint64_t value = 0;
+        ssize_t got = read(handle_, &value, sizeof(value));
+        (void)got;
+#endif
+    }
+    EventLoop::NativeHandle Handle() const { return handle_; }
+
+private:
+    EventLoop::NativeHandle handle_;
+};
+
+// Both runtimes sleep without spinning so the CPU column compares wakeups only
+PreciseTimer SleepOnlyTimer() {
+    PreciseTimer timer;
+    timer.Configure(PreciseTimer::Mode::PowerSave, std::chrono::microseconds(0), std::chrono::microseconds(0));
+    return timer;
+}
+
+// One headless seat, wired for either runtime. Ticks and reports are counted
+// on the way through; the wheel logic is the emulator's.
+struct Seat {
+    WheelDevice wheel;
+    InputManager input;
+    InputSignal signal;  // injector -> event loop
+    std::thread loop_thread;
+    std::atomic<uint64_t> ticks{0};
+    std::atomic<uint64_t> reports{0};
+
+    Seat(size_t index, bool event_loop) {
+        const Config defaults;
+        wheel.SetVJoyId(static_cast<unsigned int>(index + 1));
+        wheel.SetHeadless();
+        wheel.SetTimer(SleepOnlyTimer());
+        wheel.SetPedalRamps(defaults.throttle_ramp, defaults.brake_ramp, defaults.clutch_ramp);
+        wheel.SetReportSink([this](const HidReport&) { reports.fetch_add(1, std::memory_order_relaxed); });
+        if (event_loop) {
+            wheel.UseExternalReportLoop();
+            input.UseExternalPump();
+        }
+    }
+
+    bool Start() { return input.Initialize("", "") && wheel.Create(); }
+
+    bool Tick(Clock::time_point now) {
+        ticks.fetch_add(1, std::memory_order_relaxed);
+        return wheel.PhysicsTick(now);
+    }
+
+    void Enable() {
+        wheel.SetEnabled(true, input);
+        // Enabling grabbed the idle input manager; on Windows that clips the cursor
+        input.GrabDevices(false);
+    }
+};
+
+struct Result {
+    double seconds = 0.0;
+    Usage usage;
+    uint64_t ticks = 0;
+    uint64_t reports = 0;
+    size_t threads = 0;
+};
+
+// What a game sends: a slow sweep with some road texture, different per seat
+int16_t GameForce(Clock::time_point now, size_t seat) {
+    const double t = std::chrono::duration<double>(now.time_since_epoch()).count();
+    const double force = 4000.0 * std::sin(2.0 * kPi * 0.3 * t + static_cast<double>(seat)) +
+                         800.0 * std::sin(2.0 * kPi * 11.0 * t);
+    return static_cast<int16_t>(force);
+}
+
+// Stands in for the OS and the game: one mouse event per seat every input
+// period, sweeping back and forth so the steering never clamps, and an FFB
+// packet per seat at 60 Hz from this thread as the vJoy callback would
+void Inject(std::vector<std::unique_ptr<Seat>>& seats, bool event_loop, int input_hz, std::atomic<bool>& stop) {
+    const auto period = std::chrono::microseconds(1000000 / input_hz);
+    const uint64_t ffb_every = static_cast<uint64_t>(std::max(1, input_hz / 60));
+    auto next = Clock::now() + period;
+    uint64_t events = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+        std::this_thread::sleep_until(next);
+        next += period;
+        const int dx = ((events / kSweepEvents) & 1) ? -1 : 1;
+        const bool ffb = (events % ffb_every) == 0;
+        ++events;
+        for (size_t i = 0; i < seats.size(); ++i) {
+            Seat& seat = *seats[i];
+            seat.input.Scanner().UpdateMouseState(kMouse, dx, 0, 0);
+            if (event_loop) {
+                seat.signal.Raise();
+            }
+            if (ffb) {
+                seat.wheel.ApplyFFBForce(GameForce(Clock::now(), i));
+            }
+        }
+    }
+}
+
+Usage UsageSince(const Usage& before) {
+    const Usage after = ProcessUsage();
+    Usage delta;
+    delta.cpu_seconds = after.cpu_seconds - before.cpu_seconds;
+    delta.voluntary_switches = after.voluntary_switches - before.voluntary_switches;
+    delta.involuntary_switches = after.involuntary_switches - before.involuntary_switches;
+    return delta;
+}
+
+// As main's threaded runtime: a reader thread, seat loop and report thread
+// per seat, physics on the PhysicsScheduler pool
+Result RunThreaded(size_t seat_count, int hz, int input_hz, double seconds) {
+    // Declared first: the seats' physics wakes point at it
+    PhysicsScheduler scheduler;
+    scheduler.SetTimer(SleepOnlyTimer());
+    std::vector<std::unique_ptr<Seat>> seats;
+    for (size_t i = 0; i < seat_count; ++i) {
+        seats.push_back(std::make_unique<Seat>(i, false));
+        Seat* seat = seats.back().get();
+        if (!seat->Start()) {
+            std::fprintf(stderr, "seat %zu failed to start\n", i + 1);
+            return Result();
+        }
+        // As AttachPhysics, plus the tick count
+        const size_t task = scheduler.AddTask([seat](Clock::time_point now) { return seat->Tick(now); });
+        seat->wheel.SetPhysicsWake([&scheduler, task] { scheduler.Wake(task); });
+    }
+    scheduler.Start(0, std::chrono::microseconds(1000000 / hz));
+    for (auto& seat_ptr : seats) {
+        Seat* seat = seat_ptr.get();
+        seat->loop_thread = std::thread([seat] {
+            InputFrame frame;
+            while (running.load(std::memory_order_relaxed)) {
+                if (seat->input.WaitForFrame(frame) && seat->wheel.IsEnabled()) {
+                    seat->wheel.ProcessInputFrame(frame, kSensitivity);
+                }
+            }
+        });
+        seat->Enable();
+    }
+
+    std::atomic<bool> stop{false};
+    std::thread injector(Inject, std::ref(seats), false, input_hz, std::ref(stop));
+    const Usage before = ProcessUsage();
+    const auto start = Clock::now();
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    Result result;
+    result.usage = UsageSince(before);
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    for (auto& seat : seats) {
+        result.ticks += seat->ticks.load();
+        result.reports += seat->reports.load();
+    }
+    // Injector, plus reader, seat loop and report thread per seat
+    result.threads = 1 + 3 * seats.size() + scheduler.WorkerCount();
+
+    stop.store(true);
+    injector.join();
+    running.store(false);
+    for (auto& seat : seats) {
+        seat->wheel.SetEnabled(false, seat->input);
+        seat->wheel.WakeForShutdown();
+        seat->input.Shutdown();
+        seat->loop_thread.join();
+    }
+    scheduler.Stop();
+    for (auto& seat : seats) {
+        seat->wheel.ShutdownThreads();
+    }
+    running.store(true);
+    return result;
+}
+
+// As main's RunEventLoop, with the injector's signal standing in for the Raw
+// Input message queue
+Result RunEventLoop(size_t seat_count, int hz, int input_hz, double seconds) {
+    EventLoop loop;
+    if (!loop.Init()) {
+        std::fprintf(stderr, "event loop init failed\n");
+        return Result();
+    }
+    loop.SetTimer(SleepOnlyTimer());
+
+    std::vector<std::unique_ptr<Seat>> seats;
+    std::vector<size_t> report_timers;
+    const auto period = std::chrono::microseconds(1000000 / hz);
+    const Clock::time_point first = loop.Now() + period;
+    for (size_t i = 0; i < seat_count; ++i) {
+        seats.push_back(std::make_unique<Seat>(i, true));
+        Seat* seat = seats.back().get();
+        if (!seat->Start()) {
+            std::fprintf(stderr, "seat %zu failed to start\n", i + 1);
+            return Result();
+        }
+        const size_t physics_timer =
+            loop.AddTimer(first, [seat, period, next = first](Clock::time_point now) mutable {
+                if (!seat->Tick(now)) {
+                    return Clock::time_point::max();  // at rest: parked until the physics wake
+                }
+                next += period;
+                if (next <= now) next = now + period;
+                return next;
+            });
+        const size_t ffb_signal = loop.AddSignal([&loop, seat, physics_timer, period] {
+            const Clock::time_point now = loop.Now();
+            if (seat->Tick(now) && !loop.TimerArmed(physics_timer)) {
+                loop.ArmTimer(physics_timer, now + period);
+            }
+        });
+        seat->wheel.SetPhysicsWake([&loop, ffb_signal] { loop.Signal(ffb_signal); });
+        report_timers.push_back(loop.AddTimer(Clock::time_point::max(), [seat](Clock::time_point now) {
+            return seat->wheel.ServiceReports(now);
+        }));
+        loop.AddHandle(seat->signal.Handle(), [seat] {
+            seat->signal.Consume();
+            seat->input.PumpOnce();
+            InputFrame frame;
+            if (seat->input.TryGetFrame(frame) && seat->wheel.IsEnabled()) {
+                seat->wheel.ProcessInputFrame(frame, kSensitivity);
+            }
+        });
+        seat->Enable();
+    }
+    loop.SetIdleHandler([&] {
+        const Clock::time_point now = loop.Now();
+        for (size_t i = 0; i < seats.size(); ++i) {
+            loop.ArmTimer(report_timers[i], seats[i]->wheel.ServiceReports(now));
+        }
+    });
+
+    std::atomic<bool> stop{false};
+    std::atomic<bool> loop_running{true};
+    std::thread injector(Inject, std::ref(seats), true, input_hz, std::ref(stop));
+    std::thread loop_thread([&] { loop.Run(loop_running); });
+
+    const Usage before = ProcessUsage();
+    const auto start = Clock::now();
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    Result result;
+    result.usage = UsageSince(before);
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    for (auto& seat : seats) {
+        result.ticks += seat->ticks.load();
+        result.reports += seat->reports.load();
+    }
+    result.threads = 2;
+
+    stop.store(true);
+    injector.join();
+    loop.Stop();
+    loop_thread.join();
+    for (auto& seat : seats) {
+        seat->wheel.SetEnabled(false, seat->input);
+        seat->input.Shutdown();
+        seat->wheel.ShutdownThreads();
+    }
+    return result;
+}
+
+void Print(const char* name, const Result& result, size_t seats) {
+    auto per_second = [&](double value) { return value / result.seconds; };
+    std::printf("%-10s %7zu %8.2f", name, result.threads, 100.0 * result.usage.cpu_seconds / result.seconds);
+    if (result.usage.voluntary_switches >= 0) {
+        std::printf(" %10.0f %10.0f", per_second(static_cast<double>(result.usage.voluntary_switches)),
+                    per_second(static_cast<double>(result.usage.involuntary_switches)));
+    } else {
+        std::printf(" %10s %10s", "n/a", "n/a");
+    }
+    std::printf(" %9.0f %9.0f\n", per_second(static_cast<double>(result.ticks)) / static_cast<double>(seats),
+                per_second(static_cast<double>(result.reports)) / static_cast<double>(seats));
+}
+
+bool ParseArg(const char* arg, const char* name, double& out) {
+    const size_t len = std::strlen(name);
+    if (std::strncmp(arg, name, len) != 0 || arg[len] != '=') {
+        return false;
+    }
+    out = std::atof(arg + len + 1);
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    double seconds = 3.0;
+    double seat_count = 1.0;
+    double hz = 1000.0;
+    double input_hz = 1000.0;
+    for (int i = 1; i < argc; ++i) {
+        if (ParseArg(argv[i], "--seconds", seconds) || ParseArg(argv[i], "--seats", seat_count) ||
+            ParseArg(argv[i], "--hz", hz) || ParseArg(argv[i], "--input-hz", input_hz)) {
+            continue;
+        }
+        std::fprintf(stderr, "usage: %s [--seconds=S] [--seats=N] [--hz=N] [--input-hz=N]\n", argv[0]);
+        return 2;
+    }
+    const size_t seats = static_cast<size_t>(std::clamp(seat_count, 1.0, 16.0));
+    const int tick_hz = static_cast<int>(std::clamp(hz, 250.0, 4000.0));
+    const int mouse_hz = static_cast<int>(std::clamp(input_hz, 10.0, 8000.0));
+    logging::InitLogger(static_cast<int>(logging::LogLevel::Error));
+
+    std::printf("%u hardware threads, %zu seat(s), %d Hz physics, %d Hz input, %.1f s per mode\n\n",
+                std::thread::hardware_concurrency(), seats, tick_hz, mouse_hz, seconds);
+    std::printf("%-10s %7s %8s %10s %10s %9s %9s\n", "runtime", "threads", "cpu %", "vcsw/s", "ivcsw/s",
+                "ticks/s", "reports/s");
+    Print("threads", RunThreaded(seats, tick_hz, mouse_hz, seconds), seats);
+    Print("eventloop", RunEventLoop(seats, tick_hz, mouse_hz, seconds), seats);
+    std::printf("\nthreads includes the injector thread in both modes; per-seat rates in the last two columns\n");
+    return 0;
+}
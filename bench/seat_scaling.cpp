@@ -0,0 +1,249 @@
+// Physics CPU cost as the seat count grows.
+//
+// Runs N headless WheelDevices (no vJoy; reports are built and dropped) whose
+// PhysicsTick is driven by a game thread sending FFB packets at 60 Hz and
+// swapping throttle and brake every 250 ms, and reports process CPU time and
+// tick lateness (p99/max) for the shared pool against one thread per seat. --priority/--cpus apply [threading]'s physics
+// settings to the workers, to compare jitter with and without them under load;
+// --hz/--timer select the tick rate and the PreciseTimer mode.
+//
+//   bench_seat_scaling [--seconds=S] [--max-seats=N] [--workers=W]
+//                      [--priority=normal|high|realtime] [--cpus=LIST]
+//                      [--hz=N] [--timer=hybrid|powersave] [--spin-margin-us=N]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "config.h"
+#include "input/input_manager.h"
+#include "logging/logger.h"
+#include "physics_scheduler.h"
+#include "thread_tuning.h"
+#include "wheel_device.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
+std::atomic<bool> running{true};
+
+namespace {
+
+double ProcessCpuSeconds() {
+#ifdef _WIN32
+    FILETIME created, exited, kernel, user;
+    GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user);
+    auto to_seconds = [](const FILETIME& ft) {
+        ULARGE_INTEGER value;
+        value.LowPart = ft.dwLowDateTime;
+        value.HighPart = ft.dwHighDateTime;
+        return static_cast<double>(value.QuadPart) * 1e-7;
+    };
+    return to_seconds(kernel) + to_seconds(user);
+#else
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<double>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+           static_cast<double>(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+#endif
+}
+
+constexpr double kPi = 3.14159265358979323846;
+
+// One headless seat whose physics task counts its own ticks
+struct Seat {
+    WheelDevice wheel;
+    // Never initialized: SetEnabled() only grabs and resyncs it
+    InputManager input;
+    std::atomic<uint64_t> ticks{0};
+
+    Seat(size_t index, PhysicsScheduler& scheduler) {
+        const Config defaults;
+        wheel.SetVJoyId(static_cast<unsigned int>(index + 1));
+        wheel.SetHeadless();
+        wheel.UseExternalReportLoop();
+        wheel.SetPedalRamps(defaults.throttle_ramp, defaults.brake_ramp, defaults.clutch_ramp);
+        wheel.Create();
+        // As AttachPhysics, plus the tick count
+        const size_t task = scheduler.AddTask([this](PhysicsScheduler::Clock::time_point now) {
+            ticks.fetch_add(1, std::memory_order_relaxed);
+            return wheel.PhysicsTick(now);
+        });
+        wheel.SetPhysicsWake([&scheduler, task] { scheduler.Wake(task); });
+    }
+
+    void Enable() {
+        wheel.SetEnabled(true, input);
+        // Enabling grabbed the idle input manager; on Windows that clips the cursor
+        input.GrabDevices(false);
+        // No report thread: send the arming reports here so the seat goes Active
+        for (int i = 0; i < 1000 && wheel.GetLifecycleState() == LifecycleState::Arming; ++i) {
+            wheel.ServiceReports(PhysicsScheduler::Clock::now());
+        }
+    }
+};
+
+// What a game sends: a slow sweep with some road texture, different per seat
+int16_t GameForce(PhysicsScheduler::Clock::time_point now, size_t seat) {
+    const double t = std::chrono::duration<double>(now.time_since_epoch()).count();
+    const double force = 4000.0 * std::sin(2.0 * kPi * 0.3 * t + static_cast<double>(seat)) +
+                         800.0 * std::sin(2.0 * kPi * 11.0 * t);
+    return static_cast<int16_t>(force);
+}
+
+// Stands in for the game and the driver: FFB packets at 60 Hz, and throttle
+// and brake swapped every 250 ms so the pedal ramps keep moving
+void DriveSeats(std::vector<std::unique_ptr<Seat>>& seats, std::atomic<bool>& stop) {
+    const auto period = std::chrono::microseconds(1000000 / 60);
+    auto next = PhysicsScheduler::Clock::now();
+    uint64_t frame = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+        const auto now = PhysicsScheduler::Clock::now();
+        const bool swap = (frame % 15) == 0;
+        WheelInputState pedals;
+        pedals.throttle = ((frame / 15) & 1) != 0;
+        pedals.brake = !pedals.throttle;
+        for (size_t i = 0; i < seats.size(); ++i) {
+            seats[i]->wheel.ApplyFFBForce(GameForce(now, i));
+            if (swap) {
+                seats[i]->wheel.ApplySnapshot(pedals);
+            }
+        }
+        ++frame;
+        next += period;
+        std::this_thread::sleep_until(next);
+    }
+}
+
+struct RunResult {
+    size_t workers = 0;
+    double cpu_percent = 0.0;
+    double ns_per_seat_tick = 0.0;
+    double ticks_per_seat_per_s = 0.0;
+    uint32_t late_p99_us = 0;
+    uint64_t late_max_us = 0;
+};
+
+RunResult Run(size_t seat_count, size_t workers, double seconds, const ThreadingConfig& threading,
+              const PreciseTimer& timer) {
+    // Declared first: the seats' physics wakes point at it
+    PhysicsScheduler scheduler;
+    scheduler.SetThreading(threading);
+    scheduler.SetTimer(timer);
+    std::vector<std::unique_ptr<Seat>> seats;
+    for (size_t i = 0; i < seat_count; ++i) {
+        seats.push_back(std::make_unique<Seat>(i, scheduler));
+    }
+
+    const double cpu_start = ProcessCpuSeconds();
+    const auto wall_start = std::chrono::steady_clock::now();
+    scheduler.Start(workers, std::chrono::microseconds(1000000 / threading.physics_hz));
+    for (auto& seat : seats) {
+        seat->Enable();
+    }
+    std::atomic<bool> stop{false};
+    std::thread game(DriveSeats, std::ref(seats), std::ref(stop));
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    stop.store(true);
+    game.join();
+    scheduler.Stop();
+    const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+    const double cpu = ProcessCpuSeconds() - cpu_start;
+
+    const PhysicsScheduler::Stats stats = scheduler.TotalStats();
+    uint64_t seat_ticks = 0;
+    for (const auto& seat : seats) {
+        seat_ticks += seat->ticks.load();
+    }
+
+    RunResult result;
+    result.workers = scheduler.WorkerCount();
+    result.cpu_percent = 100.0 * cpu / wall;
+    result.ns_per_seat_tick = seat_ticks ? static_cast<double>(stats.busy_ns) / static_cast<double>(seat_ticks) : 0.0;
+    result.ticks_per_seat_per_s = static_cast<double>(seat_ticks) / static_cast<double>(seat_count) / wall;
+    result.late_p99_us = stats.LateQuantileUs(0.99);
+    result.late_max_us = stats.late_max_ns / 1000;
+    return result;
+}
+
+bool ParseArg(const char* arg, const char* name, double& out) {
+    const size_t len = std::strlen(name);
+    if (std::strncmp(arg, name, len) != 0 || arg[len] != '=') {
+        return false;
+    }
+    out = std::atof(arg + len + 1);
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    double seconds = 2.0;
+    double max_seats = 16.0;
+    double pool_workers = 0.0;
+    double hz = 1000.0;
+    double spin_margin_us = 0.0;
+    ThreadingConfig threading;
+    for (int i = 1; i < argc; ++i) {
+        if (ParseArg(argv[i], "--seconds", seconds) || ParseArg(argv[i], "--max-seats", max_seats) ||
+            ParseArg(argv[i], "--workers", pool_workers)) {
+            continue;
+        }
+        if (std::strncmp(argv[i], "--priority=", 11) == 0 &&
+            ParseThreadPriority(argv[i] + 11, threading.physics.priority)) {
+            continue;
+        }
+        if (std::strncmp(argv[i], "--cpus=", 7) == 0 && ParseCpuList(argv[i] + 7, threading.physics.cpus)) {
+            continue;
+        }
+        if (ParseArg(argv[i], "--hz", hz) || ParseArg(argv[i], "--spin-margin-us", spin_margin_us)) {
+            continue;
+        }
+        if (std::strncmp(argv[i], "--timer=", 8) == 0 && PreciseTimer::ParseMode(argv[i] + 8, threading.timer_mode)) {
+            continue;
+        }
+        std::fprintf(stderr,
+                     "usage: %s [--seconds=S] [--max-seats=N] [--workers=W] [--priority=normal|high|realtime] "
+                     "[--cpus=LIST] [--hz=N] [--timer=hybrid|powersave] [--spin-margin-us=N]\n",
+                     argv[0]);
+        return 2;
+    }
+    // Tuning failures are reported as warnings
+    logging::InitLogger(1);
+    threading.physics_hz = static_cast<int>(std::clamp(hz, 250.0, 4000.0));
+    const std::chrono::microseconds period(1000000 / threading.physics_hz);
+    PreciseTimer timer;
+    timer.Configure(threading.timer_mode, std::chrono::microseconds(static_cast<int>(spin_margin_us)), period);
+    if (threading.timer_mode == PreciseTimer::Mode::Hybrid && spin_margin_us <= 0.0) {
+        timer.Calibrate(period);
+    }
+    const size_t seat_limit = static_cast<size_t>(std::clamp(max_seats, 1.0, 16.0));
+
+    std::printf("%zu hardware threads, %.1f s per run, %d Hz physics, %s priority\ntimer: %s\n\n",
+                static_cast<size_t>(std::thread::hardware_concurrency()), seconds, threading.physics_hz,
+                ThreadPriorityName(threading.physics.priority), timer.Describe().c_str());
+    std::printf("%5s | %-44s | %-44s\n", "", "shared pool", "thread per seat");
+    std::printf("%5s | %7s %7s %6s %7s %6s %6s | %7s %7s %6s %7s %6s %6s\n", "seats", "workers", "cpu %", "ns/st", "hz",
+                "p99us", "maxus", "workers", "cpu %", "ns/st", "hz", "p99us", "maxus");
+    for (size_t seats = 1; seats <= seat_limit; ++seats) {
+        RunResult pool = Run(seats, static_cast<size_t>(pool_workers), seconds, threading, timer);
+        RunResult dedicated = Run(seats, seats, seconds, threading, timer);
+        std::printf("%5zu | %7zu %7.2f %6.0f %7.0f %6u %6llu | %7zu %7.2f %6.0f %7.0f %6u %6llu\n", seats,
+                    pool.workers, pool.cpu_percent, pool.ns_per_seat_tick, pool.ticks_per_seat_per_s,
+                    pool.late_p99_us, static_cast<unsigned long long>(pool.late_max_us), dedicated.workers,
+                    dedicated.cpu_percent, dedicated.ns_per_seat_tick, dedicated.ticks_per_seat_per_s,
+                    dedicated.late_p99_us, static_cast<unsigned long long>(dedicated.late_max_us));
+    }
+    return 0;
+}
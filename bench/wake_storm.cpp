@@ -0,0 +1,245 @@
+// Report-thread wakeups: the old dirty flag + notify_all + 2 ms poll against
+// WakeSignal.
+//
+// An input thread changes the state at --input-hz and a physics thread at
+// --hz (each change signals the report thread, as WheelDevice does). The
+// report thread "sends" when the state is dirty. The table shows how often it
+// woke, how many wakes sent a report, and the process context switches and CPU.
+// A second, quiet pass (20 Hz input, wheel centred so physics changes nothing)
+// shows the idle cost.
+//
+//   bench_wake_storm [--seconds=S] [--hz=N] [--input-hz=N]
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "wake_signal.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Usage {
+    double cpu_seconds = 0.0;
+    // -1 where the platform does not report them per process
+    long long switches = -1;
+};
+
+Usage ProcessUsage() {
+    Usage usage;
+#ifdef _WIN32
+    FILETIME created, exited, kernel, user;
+    GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user);
+    auto to_seconds = [](const FILETIME& ft) {
+        ULARGE_INTEGER value;
+        value.LowPart = ft.dwLowDateTime;
+        value.HighPart = ft.dwHighDateTime;
+        return static_cast<double>(value.QuadPart) * 1e-7;
+    };
+    usage.cpu_seconds = to_seconds(kernel) + to_seconds(user);
+#else
+    rusage ru{};
+    getrusage(RUSAGE_SELF, &ru);
+    usage.cpu_seconds = static_cast<double>(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) +
+                        static_cast<double>(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1e-6;
+    usage.switches = ru.ru_nvcsw + ru.ru_nivcsw;
+#endif
+    return usage;
+}
+
+struct Counts {
+    uint64_t changes = 0;
+    uint64_t wakes = 0;
+    uint64_t reports = 0;
+    uint64_t kernel_wakes = 0;  // WakeSignal only
+};
+
+// The state both producers write, under `mutex` as with state_mutex
+struct State {
+    std::mutex mutex;
+    uint64_t version = 0;
+};
+
+// Calls change() at `hz` until stop
+template <typename Fn>
+void Produce(int hz, const std::atomic<bool>& stop, Fn change) {
+    if (hz <= 0) {
+        return;
+    }
+    const auto period = std::chrono::nanoseconds(1000000000 / hz);
+    auto next = Clock::now() + period;
+    while (!stop.load(std::memory_order_relaxed)) {
+        std::this_thread::sleep_until(next);
+        next += period;
+        change();
+    }
+}
+
+// The pre-WakeSignal VJoyPollingThread
+Counts RunCondvar(int hz, int input_hz, double seconds) {
+    State state;
+    std::condition_variable state_cv;
+    std::atomic<bool> state_dirty{false};
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> changes{0};
+    Counts counts;
+
+    auto change = [&] {
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            ++state.version;
+        }
+        changes.fetch_add(1, std::memory_order_relaxed);
+        state_dirty.store(true, std::memory_order_release);
+        state_cv.notify_all();
+    };
+    std::thread reporter([&] {
+        std::unique_lock<std::mutex> lock(state.mutex);
+        while (!stop.load(std::memory_order_relaxed)) {
+            state_cv.wait_for(lock, std::chrono::milliseconds(2), [&] {
+                return stop.load(std::memory_order_relaxed) || state_dirty.load(std::memory_order_acquire);
+            });
+            ++counts.wakes;
+            if (state_dirty.exchange(false, std::memory_order_acq_rel)) {
+                ++counts.reports;
+            }
+        }
+    });
+    std::thread input([&] { Produce(input_hz, stop, change); });
+    std::thread physics([&] { Produce(hz, stop, change); });
+
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    stop.store(true);
+    input.join();
+    physics.join();
+    state_cv.notify_all();
+    reporter.join();
+    counts.changes = changes.load();
+    return counts;
+}
+
+// WheelDevice's report thread since WakeSignal
+Counts RunWakeSignal(int hz, int input_hz, double seconds, std::string& detail) {
+    enum : uint32_t { kInput = 1u << 0, kPhysics = 1u << 1, kStop = 1u << 2 };
+    State state;
+    WakeSignal wake;
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> changes{0};
+    Counts counts;
+
+    auto change = [&](uint32_t reason) {
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            ++state.version;
+        }
+        changes.fetch_add(1, std::memory_order_relaxed);
+        wake.Signal(reason);
+    };
+    std::thread reporter([&] {
+        while (!stop.load(std::memory_order_relaxed)) {
+            const uint32_t reasons = wake.Wait();
+            ++counts.wakes;
+            const bool dirty = (reasons & (kInput | kPhysics)) != 0;
+            if (dirty) {
+                std::lock_guard<std::mutex> lock(state.mutex);
+                ++counts.reports;
+            }
+            wake.CountOutcome(dirty);
+        }
+    });
+    std::thread input([&] { Produce(input_hz, stop, [&] { change(kInput); }); });
+    std::thread physics([&] { Produce(hz, stop, [&] { change(kPhysics); }); });
+
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    stop.store(true);
+    input.join();
+    physics.join();
+    wake.Signal(kStop);
+    reporter.join();
+    counts.changes = changes.load();
+    counts.kernel_wakes = wake.GetStats().kernel_wakes;
+
+    static const char* const kNames[WakeSignal::kMaxReasons] = {"input", "physics", "stop"};
+    detail = WakeSignal::Format("wakesignal", wake.GetStats(), kNames);
+    return counts;
+}
+
+template <typename Run>
+void Measure(const char* name, Run run) {
+    const Usage before = ProcessUsage();
+    const auto start = Clock::now();
+    const Counts counts = run();
+    const double wall = std::chrono::duration<double>(Clock::now() - start).count();
+    const Usage after = ProcessUsage();
+
+    const uint64_t idle = counts.wakes - counts.reports;
+    std::printf("%-10s %9.0f %9.0f %9.0f %7.1f%% %9.0f", name, counts.changes / wall, counts.wakes / wall,
+                counts.reports / wall, counts.wakes ? 100.0 * idle / counts.wakes : 0.0,
+                counts.kernel_wakes / wall);
+    if (after.switches >= 0) {
+        std::printf(" %9.0f", (after.switches - before.switches) / wall);
+    } else {
+        std::printf(" %9s", "n/a");
+    }
+    std::printf(" %7.2f\n", 100.0 * (after.cpu_seconds - before.cpu_seconds) / wall);
+}
+
+bool ParseArg(const char* arg, const char* name, double& out) {
+    const size_t len = std::strlen(name);
+    if (std::strncmp(arg, name, len) != 0 || arg[len] != '=') {
+        return false;
+    }
+    out = std::atof(arg + len + 1);
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    double seconds = 3.0;
+    double hz = 1000.0;
+    double input_hz = 1000.0;
+    for (int i = 1; i < argc; ++i) {
+        if (ParseArg(argv[i], "--seconds", seconds) || ParseArg(argv[i], "--hz", hz) ||
+            ParseArg(argv[i], "--input-hz", input_hz)) {
+            continue;
+        }
+        std::fprintf(stderr, "usage: %s [--seconds=S] [--hz=N] [--input-hz=N]\n", argv[0]);
+        return 2;
+    }
+    const int tick_hz = hz < 10.0 ? 10 : static_cast<int>(hz);
+    const int mouse_hz = input_hz < 10.0 ? 10 : static_cast<int>(input_hz);
+
+    std::printf("%u hardware threads, physics %d Hz, input %d Hz, %.1f s per mode\n\n",
+                std::thread::hardware_concurrency(), tick_hz, mouse_hz, seconds);
+    std::string busy_detail;
+    std::string quiet_detail;
+    const struct {
+        const char* label;
+        int hz;
+        int input_hz;
+        std::string* detail;
+    } passes[] = {{"busy", tick_hz, mouse_hz, &busy_detail}, {"quiet", 0, 20, &quiet_detail}};
+    for (const auto& pass : passes) {
+        std::printf("%s\n%-10s %9s %9s %9s %8s %9s %9s %7s\n", pass.label, "mode", "changes/s", "wakes/s",
+                    "reports/s", "idle", "kwakes/s", "csw/s", "cpu %");
+        Measure("condvar", [&] { return RunCondvar(pass.hz, pass.input_hz, seconds); });
+        Measure("wakesignal", [&] { return RunWakeSignal(pass.hz, pass.input_hz, seconds, *pass.detail); });
+        std::printf("\n");
+    }
+    std::printf("busy  %s\nquiet %s\n", busy_detail.c_str(), quiet_detail.c_str());
+    return 0;
+}
@@ -0,0 +1,331 @@
+// Microbenchmarks of the per-event and per-tick hot paths: the report build,
+// FFB shaping, steering and snapshot application, the logical state build,
+// key handling, one full physics tick, the metrics and flight recorder sites
+// and the instrumentation timestamps (steady_clock against tsc::Now()). Each
+// case reports the median and best ns/op over --reps batches and the heap
+// allocations per op (global operator new is counted). --json writes the same
+// numbers for tracking regressions between releases.
+//
+// Runs without vJoy: outside Windows HidDevice discards reports and nothing
+// reads the OS input devices, so the wheel is driven directly. Configure with
+// -DCMAKE_BUILD_TYPE=Release; unoptimized numbers are flagged.
+//
+//   bench_wheel [--min-time=S] [--reps=N] [--filter=TEXT] [--json[=FILE]]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "ffb_physics.h"
+#include "flight_recorder.h"
+#include "input/input_manager.h"
+#include "logging/logger.h"
+#include "metrics.h"
+#include "tsc_clock.h"
+#include "wheel_device.h"
+
+std::atomic<bool> running{true};
+
+namespace {
+std::atomic<uint64_t> g_allocations{0};
+}
+
+void* operator new(std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* block = std::malloc(size ? size : 1)) {
+        return block;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* block) noexcept {
+    std::free(block);
+}
+
+void operator delete[](void* block) noexcept {
+    std::free(block);
+}
+
+void operator delete(void* block, std::size_t) noexcept {
+    std::free(block);
+}
+
+void operator delete[](void* block, std::size_t) noexcept {
+    std::free(block);
+}
+
+// Declared a friend by WheelDevice and InputManager
+struct WheelBench {
+    // Enabled with no report thread; the arming reports are sent here
+    static bool Enable(WheelDevice& wheel, InputManager& input) {
+        wheel.UseExternalReportLoop();
+        if (!wheel.Create()) {
+            return false;
+        }
+        wheel.SetEnabled(true, input);
+        for (int i = 0; i < 100 && wheel.lifecycle_.Load() == LifecycleState::Arming; ++i) {
+            wheel.ServiceReports(std::chrono::steady_clock::now());
+        }
+        return wheel.lifecycle_.Load() == LifecycleState::Active;
+    }
+    static HidReport BuildReport(const WheelDevice& wheel) { return wheel.BuildHIDReportLocked(); }
+    static bool SteeringDelta(WheelDevice& wheel, int delta, int sensitivity) {
+        return wheel.ApplySteeringDeltaLocked(delta, sensitivity);
+    }
+    static bool Snapshot(WheelDevice& wheel, const WheelInputState& snapshot) {
+        bool ramp_started = false;
+        return wheel.ApplySnapshotLocked(snapshot, ramp_started);
+    }
+    // The tick samples this under state_mutex; the bench is single-threaded
+    static void SetForce(WheelDevice& wheel, int16_t force) { wheel.ffb_force = force; }
+    static WheelInputState LogicalState(InputManager& input) { return input.BuildLogicalState(); }
+};
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Keeps `value` (and the writes behind it) from being optimized away
+template <typename T>
+inline void KeepAlive(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+struct Options {
+    double min_time = 0.5;  // seconds per case, split over the repetitions
+    int reps = 5;
+    std::string filter;
+    bool json = false;
+    std::string json_path;  // empty: stdout, instead of the table
+};
+
+struct Result {
+    std::string name;
+    uint64_t iterations = 0;  // per repetition
+    double ns_per_op = 0.0;   // median over repetitions
+    double min_ns_per_op = 0.0;
+    double allocs_per_op = 0.0;
+};
+
+template <typename Op>
+double TimeBatch(Op& op, uint64_t count) {
+    const auto start = Clock::now();
+    for (uint64_t i = 0; i < count; ++i) {
+        op(i);
+    }
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+template <typename Op>
+Result Measure(const char* name, const Options& options, Op op) {
+    // Grow the batch until it can be timed (this also warms up), then size it
+    // so the repetitions fill --min-time
+    uint64_t count = 16;
+    double elapsed = TimeBatch(op, count);
+    while (elapsed < 0.01 && count < (uint64_t{1} << 40)) {
+        count *= 4;
+        elapsed = TimeBatch(op, count);
+    }
+    const double per_rep = options.min_time / options.reps;
+    count = std::max<uint64_t>(1, static_cast<uint64_t>(static_cast<double>(count) * per_rep / elapsed));
+
+    std::vector<double> samples;
+    const uint64_t allocations_before = g_allocations.load(std::memory_order_relaxed);
+    for (int rep = 0; rep < options.reps; ++rep) {
+        samples.push_back(TimeBatch(op, count) * 1e9 / static_cast<double>(count));
+    }
+    const uint64_t allocations = g_allocations.load(std::memory_order_relaxed) - allocations_before;
+    std::sort(samples.begin(), samples.end());
+
+    Result result;
+    result.name = name;
+    result.iterations = count;
+    result.ns_per_op = samples[samples.size() / 2];
+    result.min_ns_per_op = samples.front();
+    result.allocs_per_op = static_cast<double>(allocations) / (static_cast<double>(count) * options.reps);
+    return result;
+}
+
+bool Optimized() {
+#ifdef __OPTIMIZE__
+    return true;
+#elif defined(_MSC_VER) && defined(NDEBUG)
+    return true;
+#else
+    return false;
+#endif
+}
+
+void WriteJson(std::FILE* out, const std::vector<Result>& results, const Options& options) {
+    std::fprintf(out, "{\n  \"bench\": \"bench_wheel\",\n  \"schema\": 1,\n  \"optimized\": %s,\n",
+                 Optimized() ? "true" : "false");
+    std::fprintf(out, "  \"min_time\": %.3f,\n  \"reps\": %d,\n  \"results\": [\n", options.min_time, options.reps);
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        std::fprintf(out,
+                     "    {\"name\": \"%s\", \"iterations\": %llu, \"ns_per_op\": %.3f, \"min_ns_per_op\": %.3f, "
+                     "\"allocs_per_op\": %.4f}%s\n",
+                     r.name.c_str(), static_cast<unsigned long long>(r.iterations), r.ns_per_op, r.min_ns_per_op,
+                     r.allocs_per_op, i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(out, "  ]\n}\n");
+}
+
+void PrintTable(const std::vector<Result>& results) {
+    if (!Optimized()) {
+        std::printf("warning: unoptimized build, configure with -DCMAKE_BUILD_TYPE=Release\n\n");
+    }
+    std::printf("%-34s %10s %10s %10s %12s\n", "case", "ns/op", "best", "allocs/op", "iterations");
+    for (const Result& r : results) {
+        std::printf("%-34s %10.2f %10.2f %10.3f %12llu\n", r.name.c_str(), r.ns_per_op, r.min_ns_per_op,
+                    r.allocs_per_op, static_cast<unsigned long long>(r.iterations));
+    }
+}
+
+bool ParseArg(const char* arg, const char* name, double& out) {
+    const size_t len = std::strlen(name);
+    if (std::strncmp(arg, name, len) != 0 || arg[len] != '=') {
+        return false;
+    }
+    out = std::atof(arg + len + 1);
+    return true;
+}
+
+bool ParseArg(const char* arg, const char* name, std::string& out) {
+    const size_t len = std::strlen(name);
+    if (std::strncmp(arg, name, len) != 0 || arg[len] != '=') {
+        return false;
+    }
+    out = arg + len + 1;
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    double reps = options.reps;
+    for (int i = 1; i < argc; ++i) {
+        if (ParseArg(argv[i], "--min-time", options.min_time) || ParseArg(argv[i], "--reps", reps) ||
+            ParseArg(argv[i], "--filter", options.filter)) {
+            continue;
+        }
+        if (std::strcmp(argv[i], "--json") == 0 || ParseArg(argv[i], "--json", options.json_path)) {
+            options.json = true;
+            continue;
+        }
+        std::fprintf(stderr, "usage: %s [--min-time=S] [--reps=N] [--filter=TEXT] [--json[=FILE]]\n", argv[0]);
+        return 2;
+    }
+    options.min_time = std::clamp(options.min_time, 0.01, 60.0);
+    options.reps = static_cast<int>(std::clamp(reps, 1.0, 101.0));
+    tsc::Init();
+    logging::InitLogger(static_cast<int>(logging::LogLevel::Error));
+
+    InputManager input;
+    WheelDevice wheel;
+    if (!WheelBench::Enable(wheel, input)) {
+        std::fprintf(stderr, "could not enable the wheel\n");
+        return 1;
+    }
+    DeviceScanner& scanner = input.Scanner();
+    constexpr uintptr_t kKeyboard = 1;
+    // Throttle, dpad up, two buttons and an unbound key held
+    for (int key : {KEY_W, KEY_UP, KEY_Q, KEY_SPACE, KEY_Z}) {
+        scanner.UpdateKeyState(kKeyboard, InputDeviceKind::Keyboard, key, true);
+    }
+    std::vector<KeyEdge> edges;
+    scanner.DrainKeyEdges(edges);
+
+    WheelInputState pressed;
+    pressed.throttle = true;
+    pressed.dpad_x = 1;
+    pressed.buttons.Set(0);
+    pressed.buttons.Set(3);
+    WheelInputState released;
+    released.brake = true;
+    released.buttons.Set(5);
+    released.analog_pedals[static_cast<size_t>(Pedal::Clutch)] = 0.4f;
+    released.analog_mask = 1u << static_cast<size_t>(Pedal::Clutch);
+
+    static constexpr uint16_t kKeys[] = {KEY_W, KEY_S, KEY_A, KEY_Q, KEY_LEFT, KEY_SPACE, KEY_Z, KEY_F12};
+    Keymap keymap;
+    Clock::time_point tick_time = Clock::now();
+
+    std::vector<Result> results;
+    auto run = [&](const char* name, auto op) {
+        if (options.filter.empty() || std::strstr(name, options.filter.c_str()) != nullptr) {
+            results.push_back(Measure(name, options, op));
+        }
+    };
+
+    run("WheelDevice::BuildHIDReportLocked", [&](uint64_t) { KeepAlive(WheelBench::BuildReport(wheel)); });
+    run("ShapeFFBTorque", [&](uint64_t i) {
+        KeepAlive(ShapeFFBTorque(static_cast<float>(static_cast<int>(i & 8191) * 8 - 32768)));
+    });
+    run("WheelDevice::ApplySteeringDelta", [&](uint64_t i) {
+        KeepAlive(WheelBench::SteeringDelta(wheel, (i & 1) ? 7 : -7, 50));
+    });
+    run("WheelDevice::ApplySnapshotLocked", [&](uint64_t i) {
+        KeepAlive(WheelBench::Snapshot(wheel, (i & 1) ? released : pressed));
+    });
+    run("InputManager::BuildLogicalState", [&](uint64_t) { KeepAlive(WheelBench::LogicalState(input)); });
+    run("Keymap::ActionForKey", [&](uint64_t i) { KeepAlive(keymap.ActionForKey(kKeys[i & 7])); });
+    // Press and release in turn; the edges are drained as the reader would
+    run("DeviceScanner::UpdateKeyState", [&](uint64_t i) {
+        scanner.UpdateKeyState(kKeyboard, InputDeviceKind::Keyboard, KEY_E, (i & 1) == 0);
+        if ((i & 63) == 63) {
+            scanner.DrainKeyEdges(edges);
+        }
+    });
+    // A force that changes every tick, so the wheel never settles and parks
+    run("WheelDevice::PhysicsTick", [&](uint64_t i) {
+        WheelBench::SetForce(wheel, static_cast<int16_t>(static_cast<int>(i & 1023) * 8 - 4096));
+        tick_time += std::chrono::milliseconds(1);
+        KeepAlive(wheel.PhysicsTick(tick_time));
+    });
+
+    run("metrics::Increment", [&](uint64_t) { metrics::Increment(metrics::Counter::StateLocks); });
+    run("metrics::Record", [&](uint64_t i) {
+        metrics::Record(metrics::Histogram::TickDuration, (i & 4095) * 37);
+    });
+    run("flight::RecordPhysics", [&](uint64_t i) {
+        flight::RecordPhysics(1, static_cast<int16_t>(i), 0.5f, 12.0f, -3.0f);
+    });
+    run("steady_clock::now", [&](uint64_t) { KeepAlive(Clock::now()); });
+    run("tsc::Now", [&](uint64_t) { KeepAlive(tsc::Now()); });
+    // A histogram site: two readings and a conversion
+    run("tsc::NanosSince", [&](uint64_t) { KeepAlive(tsc::NanosSince(tsc::Now())); });
+
+    if (!options.json || !options.json_path.empty()) {
+        PrintTable(results);
+    }
+    if (options.json) {
+        std::FILE* out = options.json_path.empty() ? stdout : std::fopen(options.json_path.c_str(), "w");
+        if (!out) {
+            std::fprintf(stderr, "cannot write %s\n", options.json_path.c_str());
+            return 1;
+        }
+        WriteJson(out, results, options);
+        if (out != stdout) {
+            std::fclose(out);
+        }
+    }
+    return 0;
+}
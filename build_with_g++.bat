@@ -26,11 +26,27 @@ g++ -std=c++17 ^
     src/main.cpp ^
     src/config.cpp ^
     src/wheel_device.cpp ^
+    src/pedal_ramp.cpp ^
+    src/ffb_physics.cpp ^
+    src/physics_scheduler.cpp ^
+    src/metrics.cpp ^
+    src/trace.cpp ^
+    src/session_recorder.cpp ^
+    src/tsc_clock.cpp ^
+    src/flight_recorder.cpp ^
+    src/signal_scope.cpp ^
+    src/shared_stats.cpp ^
+    src/precise_timer.cpp ^
+    src/thread_tuning.cpp ^
+    src/event_loop.cpp ^
+    src/wake_signal.cpp ^
     src/hid/hid_device.cpp ^
     src/hid/vjoy_loader.cpp ^
     src/logging/logger.cpp ^
     src/input/device_scanner.cpp ^
     src/input/input_manager.cpp ^
+    src/input/keymap.cpp ^
+    src/input/device_routing.cpp ^
     vjoy_dll.o ^
     -I src/vjoy_sdk/inc ^
     -lwinmm ^
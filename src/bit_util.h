@@ -0,0 +1,52 @@
+#ifndef BIT_UTIL_H
+#define BIT_UTIL_H
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+inline int CountTrailingZeros64(uint64_t value) {
+#if defined(_MSC_VER)
+    unsigned long index = 0;
+    _BitScanForward64(&index, value);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctzll(value);
+#endif
+}
+
+// value must be nonzero
+inline int CountLeadingZeros64(uint64_t value) {
+#if defined(_MSC_VER)
+    unsigned long index = 0;
+    _BitScanReverse64(&index, value);
+    return 63 - static_cast<int>(index);
+#else
+    return __builtin_clzll(value);
+#endif
+}
+
+inline int PopCount64(uint64_t value) {
+#if defined(_MSC_VER)
+    return static_cast<int>(__popcnt64(value));
+#else
+    return __builtin_popcountll(value);
+#endif
+}
+
+// Calls fn(bit_index) for every set bit of a word array, lowest first.
+template <typename Words, typename Fn>
+inline void ForEachSetBit(const Words& words, Fn&& fn) {
+    for (size_t w = 0; w < words.size(); ++w) {
+        uint64_t bits = words[w];
+        while (bits) {
+            fn(w * 64 + static_cast<size_t>(CountTrailingZeros64(bits)));
+            bits &= bits - 1;
+        }
+    }
+}
+
+#endif  // BIT_UTIL_H
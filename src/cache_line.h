@@ -0,0 +1,16 @@
+#ifndef CACHE_LINE_H
+#define CACHE_LINE_H
+
+#include <cstddef>
+#include <new>
+
+// Spacing that keeps data written by different threads off each other's cache
+// lines. GCC/Clang warn that std::hardware_destructive_interference_size can
+// change with -mtune, which would change struct layout, so they use 64 bytes.
+#if defined(__cpp_lib_hardware_interference_size) && !defined(__GNUC__)
+constexpr std::size_t kCacheLineSize = std::hardware_destructive_interference_size;
+#else
+constexpr std::size_t kCacheLineSize = 64;
+#endif
+
+#endif  // CACHE_LINE_H
@@ -1,9 +1,17 @@
 #include "config.h"
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <sys/stat.h>
 
+PedalRampConfig Config::DefaultRamp(float attack_ms, float release_ms) {
+    PedalRampConfig ramp;
+    ramp.attack_ms = attack_ms;
+    ramp.release_ms = release_ms;
+    return ramp;
+}
+
 bool Config::Load() {
     const char* system_config = "./wheel-emulator.conf";
 
@@ -18,6 +26,7 @@ bool Config::Load() {
     
     sensitivity = 50;
     ffb_gain = 0.3f;
+    FinalizeSeats();
     
     return true;
 }
@@ -85,8 +94,327 @@ void Config::ParseINI(const std::string& content) {
                 if (val > 4.0f) val = 4.0f;
                 ffb_gain = val;
             }
+        } else if (section == "buttons") {
+            if (key == "min_pulse_ms") {
+                int val = std::stoi(value);
+                if (val < 0) val = 0;
+                if (val > 500) val = 500;
+                button_min_pulse_ms = val;
+            }
+        } else if (section == "diagnostics") {
+            if (key == "metrics_interval_s") {
+                int val = std::stoi(value);
+                if (val < 0) val = 0;
+                if (val > 3600) val = 3600;
+                metrics_interval_s = val;
+            } else if (key == "shared_stats") {
+                shared_stats = (value == "1" || value == "true" || value == "on" || value == "yes");
+            } else if (key == "shared_stats_name") {
+                shared_stats_name = value;
+            } else if (key == "trace_file") {
+                trace_file = value;
+            } else if (key == "record_file") {
+                record_file = value;
+            } else if (key == "scope_file") {
+                scope_file = value;
+            } else if (key == "flight_file") {
+                flight_file = value;
+            }
+        } else if (section == "pedals") {
+            if (!ParsePedalKey(key, value)) {
+                std::cerr << "Ignoring unknown pedal setting: " << key << std::endl;
+            }
+        } else if (section == "seats") {
+            if (key == "count") {
+                size_t count = 0;
+                if (ParseSeatNumber(value, count) && seats.size() < count) {
+                    seats.resize(count);
+                }
+            } else if (key == "physics_workers") {
+                int val = std::stoi(value);
+                if (val < 0) val = 0;
+                if (val > static_cast<int>(kMaxSeats)) val = static_cast<int>(kMaxSeats);
+                physics_workers = val;
+            }
+        } else if (section == "threading") {
+            if (!ParseThreading(key, value)) {
+                std::cerr << "Ignoring invalid threading setting: " << key << "=" << value << std::endl;
+            }
+        } else if (section.rfind("seat.", 0) == 0) {
+            if (!ParseSeat(section.substr(5), key, value)) {
+                std::cerr << "Ignoring invalid seat setting in [" << section << "]: " << key << std::endl;
+            }
+        } else if (section.rfind("device.", 0) == 0) {
+            if (!ParseDeviceRoute(section.substr(7), key, value)) {
+                std::cerr << "Ignoring invalid device setting in [" << section << "]: " << key << std::endl;
+            }
+        } else if (section == "bindings") {
+            if (!ParseBinding(key, value)) {
+                std::cerr << "Ignoring invalid binding: " << key << "=" << value << std::endl;
+            }
+        }
+    }
+    FinalizeSeats();
+}
+
+// <role>_priority / <role>_cpus for the physics, report and input threads,
+// plus the platform-specific realtime knobs
+bool Config::ParseThreading(const std::string& key, const std::string& value) {
+    ThreadTuning* tuning = nullptr;
+    std::string setting;
+    for (ThreadRole role : {ThreadRole::Physics, ThreadRole::Report, ThreadRole::Input}) {
+        const std::string prefix = std::string(ThreadRoleName(role)) + "_";
+        if (key.rfind(prefix, 0) == 0) {
+            tuning = &threading.For(role);
+            setting = key.substr(prefix.size());
+        }
+    }
+    if (tuning) {
+        if (setting == "priority") {
+            return ParseThreadPriority(value, tuning->priority);
+        }
+        if (setting == "cpus") {
+            return ParseCpuList(value, tuning->cpus);
+        }
+        return false;
+    }
+
+    const bool flag = (value == "1" || value == "true" || value == "on" || value == "yes");
+    if (key == "mmcss_task") {
+        threading.mmcss_task = (value == "none") ? std::string() : value;
+    } else if (key == "rt_policy") {
+        if (value != "fifo" && value != "rr") {
+            return false;
         }
+        threading.round_robin = (value == "rr");
+    } else if (key == "rt_priority") {
+        int val = std::stoi(value);
+        if (val < 1) val = 1;
+        if (val > 99) val = 99;
+        threading.rt_priority = val;
+    } else if (key == "lock_memory") {
+        threading.lock_memory = flag;
+    } else if (key == "jitter_report") {
+        threading.jitter_report = flag;
+    } else if (key == "physics_hz") {
+        int val = std::stoi(value);
+        if (val < 250) val = 250;
+        if (val > 4000) val = 4000;
+        threading.physics_hz = val;
+    } else if (key == "runtime") {
+        if (value != "threads" && value != "eventloop") {
+            return false;
+        }
+        threading.event_loop = (value == "eventloop");
+    } else if (key == "timer") {
+        return PreciseTimer::ParseMode(value, threading.timer_mode);
+    } else if (key == "spin_margin_us") {
+        int val = (value == "auto") ? 0 : std::stoi(value);
+        if (val < 0) val = 0;
+        if (val > static_cast<int>(PreciseTimer::kMaxSpinMargin.count())) {
+            val = static_cast<int>(PreciseTimer::kMaxSpinMargin.count());
+        }
+        threading.spin_margin_us = val;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Seats are numbered 1..kMaxSeats in the file and stored 0-based
+bool Config::ParseSeatNumber(const std::string& value, size_t& seat) {
+    int number = std::stoi(value);
+    if (number < 1 || number > static_cast<int>(kMaxSeats)) {
+        return false;
+    }
+    seat = static_cast<size_t>(number);
+    return true;
+}
+
+bool Config::ParseSeat(const std::string& seat_name, const std::string& key, const std::string& value) {
+    size_t number = 0;
+    if (!ParseSeatNumber(seat_name, number)) {
+        return false;
+    }
+    if (seats.size() < number) {
+        seats.resize(number);
+    }
+    if (key == "vjoy_id") {
+        int val = std::stoi(value);
+        if (val < 1 || val > static_cast<int>(kMaxSeats)) {
+            return false;
+        }
+        seats[number - 1].vjoy_id = val;
+        return true;
     }
+    return false;
+}
+
+void Config::FinalizeSeats() {
+    for (const DeviceRouteConfig& route : device_routes) {
+        if (seats.size() <= route.seat) {
+            seats.resize(route.seat + 1);
+        }
+    }
+    // Two seats on one vJoy device would fight over it. Explicit ids are taken
+    // first (the first seat to name one keeps it); a seat left on its number
+    // or naming a taken id gets the lowest free one.
+    std::vector<bool> taken(kMaxSeats + 1, false);
+    std::vector<int> wanted(seats.size(), 0);
+    for (size_t i = 0; i < seats.size(); ++i) {
+        int& id = seats[i].vjoy_id;
+        if (id != 0 && taken[id]) {
+            wanted[i] = id;
+            id = 0;
+        } else if (id != 0) {
+            taken[id] = true;
+        }
+    }
+    for (size_t i = 0; i < seats.size(); ++i) {
+        if (seats[i].vjoy_id != 0) {
+            continue;
+        }
+        int id = wanted[i] != 0 ? wanted[i] : static_cast<int>(i + 1);
+        if (taken[id]) {
+            const int used = id;
+            id = static_cast<int>(std::find(taken.begin() + 1, taken.end(), false) - taken.begin());
+            std::cerr << "Seat " << (i + 1) << ": vJoy device " << used
+                      << " is already used by another seat; using vJoy device " << id << std::endl;
+        }
+        seats[i].vjoy_id = id;
+        taken[id] = true;
+    }
+}
+
+// [device.<name>] sections route one physical device's axes and keys
+bool Config::ParseDeviceRoute(const std::string& route_name, const std::string& key, const std::string& value) {
+    auto it = std::find_if(device_routes.begin(), device_routes.end(),
+                           [&](const DeviceRouteConfig& r) { return r.name == route_name; });
+    if (it == device_routes.end()) {
+        DeviceRouteConfig route;
+        route.name = route_name;
+        device_routes.push_back(route);
+        it = device_routes.end() - 1;
+    }
+    DeviceRouteConfig& route = *it;
+
+    if (key == "match") {
+        route.match = value;
+    } else if (key == "x") {
+        return ParseAxisTarget(value, route.x);
+    } else if (key == "y") {
+        return ParseAxisTarget(value, route.y);
+    } else if (key == "wheel") {
+        return ParseAxisTarget(value, route.wheel);
+    } else if (key == "scale") {
+        float val = std::stof(value);
+        if (val < -100.0f) val = -100.0f;
+        if (val > 100.0f) val = 100.0f;
+        route.scale = val;
+    } else if (key == "keys") {
+        route.keys = (value == "1" || value == "true" || value == "on" || value == "yes");
+    } else if (key == "seat") {
+        size_t number = 0;
+        if (!ParseSeatNumber(value, number)) {
+            return false;
+        }
+        route.seat = number - 1;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// "<action>=<KEY>[,<KEY>...]" replaces every default key of that action.
+// "none" leaves the action unbound. A key can drive one action only: it is
+// taken from whatever action held it before.
+bool Config::ParseBinding(const std::string& key, const std::string& value) {
+    InputAction action;
+    if (!ParseActionName(key, action)) {
+        return false;
+    }
+
+    std::vector<uint16_t> keys;
+    std::istringstream names(value);
+    std::string name;
+    while (std::getline(names, name, ',')) {
+        name.erase(0, name.find_first_not_of(" \t"));
+        name.erase(name.find_last_not_of(" \t") + 1);
+        if (name.empty() || name == "none" || name == "NONE") {
+            continue;
+        }
+        uint16_t code = KEY_RESERVED;
+        if (!ParseKeyName(name, code)) {
+            return false;
+        }
+        keys.push_back(code);
+    }
+
+    bindings.erase(std::remove_if(bindings.begin(), bindings.end(),
+                                  [&](const KeyBinding& b) { return b.action == action; }),
+                   bindings.end());
+    auto taken = [&](const KeyBinding& b) {
+        if (std::find(keys.begin(), keys.end(), b.key) == keys.end()) {
+            return false;
+        }
+        std::cerr << "Key " << KeyName(b.key) << " moves from " << ActionName(b.action) << " to " << ActionName(action)
+                  << std::endl;
+        return true;
+    };
+    bindings.erase(std::remove_if(bindings.begin(), bindings.end(), taken), bindings.end());
+    for (uint16_t code : keys) {
+        bindings.push_back({action, code});
+    }
+    return true;
+}
+
+// Keys look like "<pedal>_<attack|release>_<ms|curve|exponent|lut>"
+bool Config::ParsePedalKey(const std::string& key, const std::string& value) {
+    size_t first = key.find('_');
+    size_t second = (first == std::string::npos) ? std::string::npos : key.find('_', first + 1);
+    if (second == std::string::npos) {
+        return false;
+    }
+    std::string pedal = key.substr(0, first);
+    std::string phase = key.substr(first + 1, second - first - 1);
+    std::string field = key.substr(second + 1);
+
+    PedalRampConfig* ramp = nullptr;
+    if (pedal == "throttle") ramp = &throttle_ramp;
+    else if (pedal == "brake") ramp = &brake_ramp;
+    else if (pedal == "clutch") ramp = &clutch_ramp;
+    if (!ramp || (phase != "attack" && phase != "release")) {
+        return false;
+    }
+    bool attack = (phase == "attack");
+    PedalCurveConfig& curve = attack ? ramp->attack_curve : ramp->release_curve;
+
+    if (field == "ms") {
+        float val = std::stof(value);
+        if (val < 0.0f) val = 0.0f;
+        if (val > 5000.0f) val = 5000.0f;
+        (attack ? ramp->attack_ms : ramp->release_ms) = val;
+    } else if (field == "curve") {
+        if (!ParsePedalCurve(value, curve.type)) {
+            std::cerr << "Unknown pedal curve '" << value << "' for " << key << std::endl;
+        }
+    } else if (field == "exponent") {
+        float val = std::stof(value);
+        if (val < -10.0f) val = -10.0f;
+        if (val > 10.0f) val = 10.0f;
+        curve.exponent = val;
+    } else if (field == "lut") {
+        // Comma separated percentages, evenly spaced over the ramp time
+        curve.lut.clear();
+        std::istringstream points(value);
+        std::string point;
+        while (std::getline(points, point, ',')) {
+            curve.lut.push_back(std::stof(point) / 100.0f);
+        }
+    } else {
+        return false;
+    }
+    return true;
 }
 
 void Config::SaveDefault(const char* path) {
@@ -104,30 +432,116 @@ void Config::SaveDefault(const char* path) {
     file << "[ffb]\n";
     file << "# Overall force feedback strength multiplier (0.1 - 4.0)\n";
     file << "gain=0.3\n\n";
+
+    file << "[pedals]\n";
+    file << "# Keyboard pedal travel time in ms for a full press (attack) and release (0 = instant)\n";
+    file << "# Curves: linear | exponential (uses *_exponent) | lut (uses *_lut, percentages)\n";
+    file << "throttle_attack_ms=150\n";
+    file << "throttle_release_ms=100\n";
+    file << "throttle_attack_curve=linear\n";
+    file << "throttle_release_curve=linear\n";
+    file << "brake_attack_ms=200\n";
+    file << "brake_release_ms=120\n";
+    file << "brake_attack_curve=linear\n";
+    file << "# brake_attack_exponent=2.0\n";
+    file << "brake_release_curve=linear\n";
+    file << "clutch_attack_ms=120\n";
+    file << "clutch_release_ms=120\n";
+    file << "# clutch_attack_curve=lut\n";
+    file << "# clutch_attack_lut=0,10,30,60,100\n\n";
     
-    file << "# === CONTROLS (Hardcoded) ===\n";
+    file << "[buttons]\n";
+    file << "# Every key press is held on the virtual wheel for at least this long (0 - 500 ms),\n";
+    file << "# so taps shorter than the game's polling interval are not missed\n";
+    file << "min_pulse_ms=25\n\n";
+
+    file << "[bindings]\n";
+    file << "# <action>=<KEY>[,<KEY>...] or none. Actions: throttle, brake, clutch, dpad_*, button1-button"
+         << kMaxButtons << "\n";
+    file << "# Keys: A-Z, 0-9, F1-F12, SPACE, TAB, ENTER, LEFTSHIFT, LEFTCTRL, UP, MOUSE_LEFT, ...\n";
+    file << "# A key bound here is taken from the action that had it (e.g. its default).\n";
+    for (const BindingSchemaEntry& entry : kBindingSchema) {
+        file << entry.name << "=" << KeyName(entry.default_key) << "\n";
+    }
+    file << "\n";
+
+    file << "# === DEVICE ROUTING (optional) ===\n";
+    file << "# Route one physical mouse/keyboard by a substring of its device path\n";
+    file << "# (paths are logged at --log-level=2 when a device is first used).\n";
+    file << "# Targets: steering, throttle, brake, clutch, none. scale = pedal % per count.\n";
+    file << "# [device.pedal_mouse]\n";
+    file << "# match=VID_046D&PID_C077\n";
+    file << "# x=none\n";
+    file << "# y=throttle\n";
+    file << "# wheel=brake\n";
+    file << "# scale=-0.5\n";
+    file << "# keys=off\n";
+    file << "# seat=1\n\n";
+
+    file << "# === SEATS (optional) ===\n";
+    file << "# Each seat is a separate virtual wheel with its own devices and vJoy device.\n";
+    file << "# Devices go to a seat with seat=<n> in their [device.*] section; seat 1 also\n";
+    file << "# gets every device no route matches. Physics for all seats runs on a shared pool.\n";
+    file << "# [seats]\n";
+    file << "# count=2\n";
+    file << "# physics_workers=0\n";
+    file << "# [seat.2]\n";
+    file << "# vjoy_id=2\n\n";
+
+    file << "# === THREADING (optional) ===\n";
+    file << "# Priority and CPU set of the physics tick, vJoy report and input threads.\n";
+    file << "# priority: normal | high | realtime. cpus: e.g. 2,3 or 2-5 (empty = any).\n";
+    file << "# realtime is an MMCSS task on Windows (falls back to TIME_CRITICAL) and\n";
+    file << "# SCHED_FIFO/RR on Linux (needs CAP_SYS_NICE; falls back to nice -10).\n";
+    file << "# The physics tick jitter histogram is logged at exit.\n";
+    file << "# [threading]\n";
+    file << "# physics_priority=realtime\n";
+    file << "# physics_cpus=2\n";
+    file << "# report_priority=high\n";
+    file << "# report_cpus=2\n";
+    file << "# input_priority=high\n";
+    file << "# input_cpus=\n";
+    file << "# mmcss_task=Games\n";
+    file << "# rt_policy=fifo\n";
+    file << "# rt_priority=10\n";
+    file << "# lock_memory=true\n";
+    file << "# jitter_report=true\n";
+    file << "# Physics tick rate (250 - 4000 Hz). timer=hybrid sleeps until a calibrated margin\n";
+    file << "# before each tick and spins the rest (at most half the period); timer=powersave\n";
+    file << "# never spins.\n";
+    file << "# physics_hz=1000\n";
+    file << "# timer=hybrid\n";
+    file << "# spin_margin_us=auto\n";
+    file << "# runtime=eventloop runs input, physics and vJoy reports of every seat on one\n";
+    file << "# thread instead of one thread each (for 2-core machines).\n";
+    file << "# runtime=threads\n\n";
+
+    file << "# === DIAGNOSTICS (optional) ===\n";
+    file << "# Report rate, FFB packets, state lock contention and tick/report latency\n";
+    file << "# percentiles are logged at exit; metrics_interval_s also logs them every N s.\n";
+    file << "# [diagnostics]\n";
+    file << "# metrics_interval_s=60\n";
+    file << "# Live wheel state and metrics in shared memory for overlays (read with wheel-stats).\n";
+    file << "# shared_stats=true\n";
+    file << "# shared_stats_name=wheel-emulator-stats\n";
+    file << "# Record what every thread does (input, seat loop, physics, reports, FFB callback)\n";
+    file << "# and write it at exit, or on Ctrl+Break while running; open in ui.perfetto.dev.\n";
+    file << "# trace_file=wheel-trace.json\n";
+    file << "# Record every input frame, FFB packet and report to a compact file that\n";
+    file << "# wheel-replay can play back; cheap enough to leave on.\n";
+    file << "# record_file=session.wrec\n";
+    file << "# Every physics step's forces, spring, offset, velocity, dt and steering, for FFB\n";
+    file << "# tuning; wheel-scope converts the file to CSV.\n";
+    file << "# scope_file=wheel-scope.wsc\n";
+    file << "# The last seconds of events are always kept in memory and written here on a\n";
+    file << "# crash or Ctrl+C (read with wheel-flight); empty writes nothing.\n";
+    file << "# flight_file=wheel-flight.bin\n\n";
+
+    file << "# === CONTROLS ===\n";
     file << "# Steering: Mouse horizontal movement (sensitivity adjustable above)\n";
-    file << "# Throttle: Hold W (analog ramping 0-100%)\n";
-    file << "# Brake: Hold S (analog ramping 0-100%)\n";
-    file << "# Clutch: Hold A (analog ramping 0-100%)\n";
-    file << "# D-Pad: Arrow keys (UP/DOWN/LEFT/RIGHT)\n";
+    file << "# Pedals: analog ramping 0-100% (see [pedals])\n";
     file << "# Toggle Emulation: Ctrl+M\n";
     file << "#\n";
-    file << "# === BUTTON MAPPINGS (Hardcoded) ===\n";
-    file << "# Button 1:  Q              Button 2:  E\n";
-    file << "# Button 3:  F              Button 4:  G\n";
-    file << "# Button 5:  H              Button 6:  R\n";
-    file << "# Button 7:  T              Button 8:  Y\n";
-    file << "# Button 9:  U              Button 10: I\n";
-    file << "# Button 11: O              Button 12: P\n";
-    file << "# Button 13: 1              Button 14: 2\n";
-    file << "# Button 15: 3              Button 16: 4\n";
-    file << "# Button 17: 5              Button 18: 6\n";
-    file << "# Button 19: 7              Button 20: 8\n";
-    file << "# Button 21: 9              Button 22: 0\n";
-    file << "# Button 23: Left Shift     Button 24: Space\n";
-    file << "# Button 25: Tab            Button 26: Enter\n";
-    file << "#\n";
     file << "# NOTE: Real G29 has INVERTED pedals (32767=rest, -32768=pressed).\n";
     file << "#       Enable 'Invert Pedals' option in your game settings if needed.\n";
 }
@@ -2,11 +2,48 @@
 #define CONFIG_H
 
 #include <string>
+#include <vector>
+
+#include "input/device_routing.h"
+#include "input/keymap.h"
+#include "pedal_ramp.h"
+#include "thread_tuning.h"
+
+// One [seat.<n>] section: a virtual wheel with its own routing, physics and vJoy device
+struct SeatConfig {
+    // 0 = use the seat number
+    int vjoy_id = 0;
+};
 
 class Config {
 public:
     int sensitivity = 50;
     float ffb_gain = 0.3f;
+    PedalRampConfig throttle_ramp = DefaultRamp(150.0f, 100.0f);
+    PedalRampConfig brake_ramp = DefaultRamp(200.0f, 120.0f);
+    PedalRampConfig clutch_ramp = DefaultRamp(120.0f, 120.0f);
+    std::vector<KeyBinding> bindings = DefaultKeyBindings();
+    int button_min_pulse_ms = 25;
+    std::vector<DeviceRouteConfig> device_routes;
+    // Grown to cover every seat referenced by [seats], [seat.<n>] or a device route
+    std::vector<SeatConfig> seats = std::vector<SeatConfig>(1);
+    // Threads shared by all seats' physics ticks (0 = one per 4 seats)
+    int physics_workers = 0;
+    ThreadingConfig threading;
+    // [diagnostics] Log the metrics of each interval while running (0 = only at exit)
+    int metrics_interval_s = 0;
+    // [diagnostics] Publish the wheel state and metrics in shared memory (shared_stats.h)
+    bool shared_stats = false;
+    // Empty = shared_stats::kDefaultName; a second emulator needs its own
+    std::string shared_stats_name;
+    // [diagnostics] Chrome trace JSON of every thread's activity (empty = off, trace.h)
+    std::string trace_file;
+    // [diagnostics] Session recording of inputs, FFB and reports (empty = off, session_recorder.h)
+    std::string record_file;
+    // [diagnostics] Columnar file of every FFB physics step (empty = off, signal_scope.h)
+    std::string scope_file;
+    // [diagnostics] Where a crash or Ctrl+C writes the last seconds of events (empty = nowhere, flight_recorder.h)
+    std::string flight_file = "wheel-flight.bin";
     
     // Load configuration from default locations
     // Returns true if successful, false otherwise
@@ -14,10 +51,20 @@ public:
     
     // Save default configuration to specified path
     void SaveDefault(const char* path);
+
+    // Load one specific file (wheel-replay --config); false if it cannot be read
+    bool LoadFromFile(const char* path);
     
 private:
-    bool LoadFromFile(const char* path);
+    static PedalRampConfig DefaultRamp(float attack_ms, float release_ms);
     void ParseINI(const std::string& content);
+    bool ParsePedalKey(const std::string& key, const std::string& value);
+    bool ParseBinding(const std::string& key, const std::string& value);
+    bool ParseThreading(const std::string& key, const std::string& value);
+    bool ParseSeat(const std::string& seat_name, const std::string& key, const std::string& value);
+    static bool ParseSeatNumber(const std::string& value, size_t& seat);
+    void FinalizeSeats();
+    bool ParseDeviceRoute(const std::string& route_name, const std::string& key, const std::string& value);
 };
 
 #endif // CONFIG_H
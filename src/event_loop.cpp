@@ -0,0 +1,320 @@
+#include "event_loop.h"
+
+#include <algorithm>
+
+#ifdef _WIN32
+#include <windows.h>
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#else
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#endif
+
+namespace {
+#ifndef _WIN32
+// epoll data tags ahead of the registered handles
+constexpr uint64_t kWakeTag = 0;
+constexpr uint64_t kTimerTag = 1;
+constexpr uint64_t kFirstHandleTag = 2;
+constexpr int kMaxEpollEvents = 16;
+#endif
+}  // namespace
+
+EventLoop::EventLoop() = default;
+
+EventLoop::~EventLoop() {
+#ifdef _WIN32
+    if (waitable_timer_) CloseHandle(static_cast<HANDLE>(waitable_timer_));
+    if (wake_event_) CloseHandle(static_cast<HANDLE>(wake_event_));
+#else
+    if (timer_fd_ >= 0) close(timer_fd_);
+    if (wake_fd_ >= 0) close(wake_fd_);
+    if (epoll_fd_ >= 0) close(epoll_fd_);
+#endif
+}
+
+bool EventLoop::Init() {
+#ifdef _WIN32
+    wake_event_ = CreateEvent(NULL, FALSE, FALSE, NULL);
+    // High-resolution timers (Windows 10 1803+) do not depend on timeBeginPeriod
+    waitable_timer_ = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+    if (!waitable_timer_) {
+        waitable_timer_ = CreateWaitableTimer(NULL, FALSE, NULL);
+    }
+    return wake_event_ != NULL && waitable_timer_ != NULL;
+#else
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (epoll_fd_ < 0 || wake_fd_ < 0 || timer_fd_ < 0) {
+        return false;
+    }
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.u64 = kWakeTag;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &event) != 0) {
+        return false;
+    }
+    event.data.u64 = kTimerTag;
+    return epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, timer_fd_, &event) == 0;
+#endif
+}
+
+size_t EventLoop::AddTimer(Clock::time_point deadline, TimerFn fn) {
+    TimerEntry entry;
+    entry.fn = std::move(fn);
+    timers_.push_back(std::move(entry));
+    const size_t id = timers_.size() - 1;
+    ArmTimer(id, deadline);
+    return id;
+}
+
+void EventLoop::ArmTimer(size_t timer, Clock::time_point deadline) {
+    TimerEntry& entry = timers_[timer];
+    // Older heap entries for this timer become stale
+    ++entry.generation;
+    entry.deadline = deadline;
+    if (deadline != Clock::time_point::max()) {
+        heap_.push(HeapEntry{deadline, timer, entry.generation});
+    }
+}
+
+size_t EventLoop::AddSignal(Handler handler) {
+    signals_.emplace_back();
+    signals_.back().handler = std::move(handler);
+    return signals_.size() - 1;
+}
+
+void EventLoop::Signal(size_t signal) {
+    if (!signals_[signal].pending.exchange(true, std::memory_order_acq_rel)) {
+        WakeLoop();
+    }
+}
+
+bool EventLoop::AddHandle(NativeHandle handle, Handler handler) {
+#ifdef _WIN32
+    // Two slots go to the wake event and the timer
+    if (handles_.size() + 2 >= MAXIMUM_WAIT_OBJECTS) {
+        return false;
+    }
+#else
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.u64 = kFirstHandleTag + handles_.size();
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, handle, &event) != 0) {
+        return false;
+    }
+#endif
+    handles_.push_back(handle);
+    handle_handlers_.push_back(std::move(handler));
+    return true;
+}
+
+void EventLoop::Stop() {
+    stop_.store(true, std::memory_order_release);
+    WakeLoop();
+}
+
+void EventLoop::WakeLoop() {
+    if (wake_pending_.exchange(true, std::memory_order_acq_rel) || sim_clock_) {
+        return;  // simulated: the loop checks the flag before advancing the clock
+    }
+#ifdef _WIN32
+    SetEvent(static_cast<HANDLE>(wake_event_));
+#else
+    const uint64_t one = 1;
+    ssize_t written = write(wake_fd_, &one, sizeof(one));
+    (void)written;
+#endif
+}
+
+EventLoop::Clock::time_point EventLoop::NextDeadline() {
+    while (!heap_.empty()) {
+        const HeapEntry& top = heap_.top();
+        if (top.generation == timers_[top.timer].generation) {
+            return top.deadline;
+        }
+        heap_.pop();
+    }
+    return Clock::time_point::max();
+}
+
+bool EventLoop::RunDueTimers(Clock::time_point now) {
+    bool fired = false;
+    while (NextDeadline() <= now) {
+        const HeapEntry top = heap_.top();
+        heap_.pop();
+        TimerEntry& entry = timers_[top.timer];
+        ++entry.generation;
+        entry.deadline = Clock::time_point::max();
+        const Clock::time_point next = entry.fn(now);
+        // The callback may have re-armed it already
+        if (timers_[top.timer].deadline == Clock::time_point::max()) {
+            ArmTimer(top.timer, next);
+        }
+        ++stats_.timer_fires;
+        fired = true;
+    }
+    return fired;
+}
+
+bool EventLoop::RunSignals() {
+    bool ran = false;
+    for (SignalEntry& signal : signals_) {
+        if (signal.pending.load(std::memory_order_acquire) && signal.pending.exchange(false, std::memory_order_acq_rel)) {
+            signal.handler();
+            ++stats_.signals;
+            ran = true;
+        }
+    }
+    return ran;
+}
+
+void EventLoop::Run(const std::atomic<bool>& running) {
+    if (sim_clock_) {
+        RunSimulated(running, Clock::time_point::max());
+        return;
+    }
+    while (running.load(std::memory_order_relaxed) && !stop_.load(std::memory_order_acquire)) {
+        bool dispatched = RunDueTimers(Clock::now());
+        dispatched |= RunSignals();
+        if (dispatched && idle_handler_) {
+            idle_handler_();
+        }
+
+        const Clock::time_point deadline = NextDeadline();
+        if (deadline <= Clock::now()) {
+            continue;
+        }
+        // All timers parked: no timeout at all, so an idle loop never wakes
+        const Clock::time_point wake_at = deadline == Clock::time_point::max() ? deadline : timer_.SleepDeadline(deadline);
+        if (WaitUntil(wake_at) > 0) {
+            if (idle_handler_) {
+                idle_handler_();
+            }
+            continue;
+        }
+        // Woken at the sleep deadline: spin out the margin unless something is pending
+        if (deadline != Clock::time_point::max() && timer_.SpinMargin().count() > 0 &&
+            !wake_pending_.load(std::memory_order_acquire)) {
+            stats_.spin_ns += static_cast<uint64_t>(PreciseTimer::SpinUntil(deadline).count());
+        }
+    }
+}
+
+void EventLoop::RunUntil(Clock::time_point end) {
+    static const std::atomic<bool> kRunning{true};
+    if (sim_clock_) {
+        RunSimulated(kRunning, end);
+    }
+}
+
+// The dispatch order of Run(); where Run() waits, the clock jumps instead
+void EventLoop::RunSimulated(const std::atomic<bool>& running, Clock::time_point end) {
+    while (running.load(std::memory_order_relaxed) && !stop_.load(std::memory_order_acquire)) {
+        bool dispatched = RunDueTimers(sim_clock_->Now());
+        dispatched |= RunSignals();
+        if (dispatched && idle_handler_) {
+            idle_handler_();
+        }
+        // A handler raised a signal: it runs at this same instant
+        if (wake_pending_.exchange(false, std::memory_order_acq_rel)) {
+            continue;
+        }
+        // Every timer parked: nothing is left to happen
+        const Clock::time_point deadline = NextDeadline();
+        if (deadline == Clock::time_point::max() || deadline > end) {
+            break;
+        }
+        ++stats_.waits;
+        sim_clock_->AdvanceTo(deadline);
+    }
+    if (end != Clock::time_point::max()) {
+        sim_clock_->AdvanceTo(end);
+    }
+}
+
+size_t EventLoop::WaitUntil(Clock::time_point deadline) {
+    ++stats_.waits;
+    const Clock::time_point now = Clock::now();
+    const bool poll_only = deadline <= now;
+#ifdef _WIN32
+    HANDLE timer = static_cast<HANDLE>(waitable_timer_);
+    if (deadline == Clock::time_point::max()) {
+        CancelWaitableTimer(timer);
+    } else if (!poll_only) {
+        // Negative due time = relative, in 100 ns units
+        const auto relative = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - now).count();
+        LARGE_INTEGER due;
+        due.QuadPart = -std::max<long long>(1, relative / 100);
+        SetWaitableTimer(timer, &due, 0, NULL, NULL, FALSE);
+    }
+
+    std::vector<HANDLE> wait_handles;
+    wait_handles.reserve(handles_.size() + 2);
+    wait_handles.push_back(static_cast<HANDLE>(wake_event_));
+    wait_handles.push_back(timer);
+    for (NativeHandle handle : handles_) {
+        wait_handles.push_back(static_cast<HANDLE>(handle));
+    }
+    const DWORD count = static_cast<DWORD>(wait_handles.size());
+    const DWORD result = MsgWaitForMultipleObjectsEx(count, wait_handles.data(), poll_only ? 0 : INFINITE,
+                                                     message_handler_ ? QS_ALLINPUT : 0, MWMO_INPUTAVAILABLE);
+    if (result == WAIT_OBJECT_0) {
+        wake_pending_.store(false, std::memory_order_release);
+        return 1;
+    }
+    if (result == WAIT_OBJECT_0 + 1 || result == WAIT_TIMEOUT) {
+        return 0;
+    }
+    if (result >= WAIT_OBJECT_0 + 2 && result < WAIT_OBJECT_0 + count) {
+        handle_handlers_[result - WAIT_OBJECT_0 - 2]();
+        ++stats_.handle_events;
+        return 1;
+    }
+    if (result == WAIT_OBJECT_0 + count && message_handler_) {
+        message_handler_();
+        ++stats_.handle_events;
+        return 1;
+    }
+    return 0;
+#else
+    int timeout_ms = -1;
+    itimerspec spec{};
+    if (poll_only) {
+        timeout_ms = 0;
+    } else if (deadline != Clock::time_point::max()) {
+        const auto relative = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - now).count();
+        spec.it_value.tv_sec = static_cast<time_t>(relative / 1000000000);
+        spec.it_value.tv_nsec = static_cast<long>(relative % 1000000000);
+    }
+    // An all-zero it_value disarms the timer
+    timerfd_settime(timer_fd_, 0, &spec, nullptr);
+
+    epoll_event events[kMaxEpollEvents];
+    const int ready = epoll_wait(epoll_fd_, events, kMaxEpollEvents, timeout_ms);
+    size_t dispatched = 0;
+    for (int i = 0; i < ready; ++i) {
+        const uint64_t tag = events[i].data.u64;
+        uint64_t value = 0;
+        if (tag == kWakeTag) {
+            wake_pending_.store(false, std::memory_order_release);
+            ssize_t got = read(wake_fd_, &value, sizeof(value));
+            (void)got;
+            ++dispatched;
+        } else if (tag == kTimerTag) {
+            ssize_t got = read(timer_fd_, &value, sizeof(value));
+            (void)got;
+        } else if (tag - kFirstHandleTag < handle_handlers_.size()) {
+            handle_handlers_[tag - kFirstHandleTag]();
+            ++stats_.handle_events;
+            ++dispatched;
+        }
+    }
+    return dispatched;
+#endif
+}
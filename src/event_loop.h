@@ -0,0 +1,138 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <queue>
+#include <vector>
+
+#include "precise_timer.h"
+#include "simulated_clock.h"
+
+// Single-threaded runtime: timers, cross-thread signals and OS handles are
+// multiplexed on the thread that calls Run(). Timers sit in a deadline-ordered
+// heap; the OS wait is bounded by the earliest one (a waitable timer on
+// Windows, a timerfd under epoll on Linux) and finished with the PreciseTimer
+// spin, so ticks keep the accuracy of the threaded runtime.
+//
+// Everything except Signal() and Stop() must be called from the loop thread
+// (or before Run()).
+//
+// With a SimulatedClock the loop never waits: whenever nothing is pending it
+// advances the clock to the earliest deadline. Init() is not needed then, and
+// signals may only be raised by the loop's own handlers.
+class EventLoop {
+public:
+    using Clock = std::chrono::steady_clock;
+    // Returns the next deadline, or Clock::time_point::max() to park the timer
+    using TimerFn = std::function<Clock::time_point(Clock::time_point now)>;
+    using Handler = std::function<void()>;
+#ifdef _WIN32
+    using NativeHandle = void*;  // HANDLE
+#else
+    using NativeHandle = int;  // file descriptor
+#endif
+
+    struct Stats {
+        uint64_t waits = 0;
+        uint64_t timer_fires = 0;
+        uint64_t signals = 0;
+        uint64_t handle_events = 0;
+        uint64_t spin_ns = 0;
+    };
+
+    EventLoop();
+    ~EventLoop();
+
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    bool Init();
+    void SetTimer(const PreciseTimer& timer) { timer_ = timer; }
+    // Runs the loop on `clock` instead of steady_clock; set before adding timers
+    void SetSimulatedClock(SimulatedClock* clock) { sim_clock_ = clock; }
+    // steady_clock, or the simulated clock; timer callbacks are passed the same
+    Clock::time_point Now() const { return sim_clock_ ? sim_clock_->Now() : Clock::now(); }
+
+    size_t AddTimer(Clock::time_point deadline, TimerFn fn);
+    // Moves a timer; max() parks it
+    void ArmTimer(size_t timer, Clock::time_point deadline);
+    bool TimerArmed(size_t timer) const { return timers_[timer].deadline != Clock::time_point::max(); }
+
+    // Handler runs on the loop thread after Signal(); signals raised before
+    // the handler runs are coalesced into one call
+    size_t AddSignal(Handler handler);
+    void Signal(size_t signal);
+
+    // Handler runs when the handle is signalled (Windows) or readable (Linux)
+    bool AddHandle(NativeHandle handle, Handler handler);
+#ifdef _WIN32
+    // Handler runs when the thread's message queue has input (Raw Input pump)
+    void SetMessageHandler(Handler handler) { message_handler_ = std::move(handler); }
+#endif
+    // Runs after every pass that dispatched something
+    void SetIdleHandler(Handler handler) { idle_handler_ = std::move(handler); }
+
+    // Returns when running turns false (checked after every wake) or Stop() is
+    // called; simulated, also once every timer is parked and nothing is pending
+    void Run(const std::atomic<bool>& running);
+    // Simulated only: runs everything due up to `end` and leaves the clock
+    // there. Stepping by the physics period single-steps a tick.
+    void RunUntil(Clock::time_point end);
+    void Stop();
+
+    Stats GetStats() const { return stats_; }
+
+private:
+    struct TimerEntry {
+        TimerFn fn;
+        Clock::time_point deadline;
+        uint64_t generation = 0;
+    };
+    struct HeapEntry {
+        Clock::time_point deadline;
+        size_t timer;
+        uint64_t generation;
+        bool operator>(const HeapEntry& other) const { return deadline > other.deadline; }
+    };
+    struct SignalEntry {
+        Handler handler;
+        std::atomic<bool> pending{false};
+    };
+
+    Clock::time_point NextDeadline();
+    bool RunDueTimers(Clock::time_point now);
+    bool RunSignals();
+    // Blocks until `deadline` or an OS event; returns the dispatched handle count
+    size_t WaitUntil(Clock::time_point deadline);
+    void WakeLoop();
+    void RunSimulated(const std::atomic<bool>& running, Clock::time_point end);
+
+    PreciseTimer timer_;
+    SimulatedClock* sim_clock_ = nullptr;
+    std::vector<TimerEntry> timers_;
+    std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<HeapEntry>> heap_;
+    // deque: entries hold atomics and must not move once registered
+    std::deque<SignalEntry> signals_;
+    std::atomic<bool> wake_pending_{false};
+    std::atomic<bool> stop_{false};
+    std::vector<NativeHandle> handles_;
+    std::vector<Handler> handle_handlers_;
+    Handler idle_handler_;
+    Stats stats_;
+#ifdef _WIN32
+    Handler message_handler_;
+    void* wake_event_ = nullptr;
+    void* waitable_timer_ = nullptr;
+#else
+    int epoll_fd_ = -1;
+    int wake_fd_ = -1;
+    int timer_fd_ = -1;
+#endif
+};
+
+#endif  // EVENT_LOOP_H
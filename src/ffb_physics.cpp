@@ -0,0 +1,98 @@
+#include "ffb_physics.h"
+
+#include <algorithm>
+#include <cmath>
+
+// FFB Torque Shaping
+float ShapeFFBTorque(float raw_force) {
+    float abs_force = std::fabs(raw_force);
+    if (abs_force < 80.0f) {
+        return raw_force * (abs_force / 80.0f);
+    }
+
+    const float min_gain = 0.25f;
+    const float slip_knee = 4000.0f;
+    const float slip_full = 14000.0f;
+    float t = (abs_force - 80.0f) / (slip_full - 80.0f);
+    t = std::clamp(t, 0.0f, 1.0f);
+    float slip_weight = t * t;
+
+    float gain = min_gain;
+    if (abs_force > slip_knee) {
+        float heavy = (abs_force - slip_knee) / (slip_full - slip_knee);
+        heavy = std::clamp(heavy, 0.0f, 1.0f);
+        gain = min_gain + (1.0f - min_gain) * heavy;
+    } else {
+        gain = min_gain + (slip_weight * (1.0f - min_gain));
+    }
+
+    const float boost = 3.0f; // Restored to 3.0f to match Linux config exactly
+    return raw_force * gain * boost;
+}
+
+namespace {
+constexpr float kOffsetLimit = 22000.0f;
+// Rest thresholds: the steering axis only moves for changes of 0.1 or more
+constexpr float kRestOffset = 0.01f;
+constexpr float kRestVelocity = 0.5f;
+constexpr float kRestForce = 0.05f;
+
+float Spring(const FfbPhysicsInput& input) {
+    if (input.autocenter > 0) {
+        return -(input.steering * static_cast<float>(input.autocenter)) / 32768.0f;
+    }
+    return 0.0f;
+}
+
+float TargetOffset(float filtered_force, float spring, const FfbPhysicsInput& input) {
+    return std::clamp((filtered_force + spring) * input.gain, -kOffsetLimit, kOffsetLimit);
+}
+}  // namespace
+
+void StepFfbPhysics(FfbPhysicsState& state, const FfbPhysicsInput& input, float dt, FfbPhysicsSignals* signals) {
+    float commanded_force = ShapeFFBTorque(static_cast<float>(input.force));
+
+    const float force_filter_hz = 38.0f;
+    float alpha = 1.0f - std::exp(-dt * force_filter_hz);
+    alpha = std::clamp(alpha, 0.0f, 1.0f);
+    state.filtered_force += (commanded_force - state.filtered_force) * alpha;
+
+    const float spring = Spring(input);
+    float target_offset = TargetOffset(state.filtered_force, spring, input);
+    if (signals) {
+        signals->commanded_force = commanded_force;
+        signals->spring = spring;
+        signals->target_offset = target_offset;
+    }
+
+    const float stiffness = 120.0f;
+    const float damping = 8.0f;
+    const float max_velocity = 90000.0f;
+    float error = target_offset - state.offset;
+    state.velocity += error * stiffness * dt;
+    float damping_factor = std::exp(-damping * dt);
+    state.velocity *= damping_factor;
+    state.velocity = std::clamp(state.velocity, -max_velocity, max_velocity);
+
+    state.offset += state.velocity * dt;
+    if (state.offset > kOffsetLimit) {
+        state.offset = kOffsetLimit;
+        state.velocity = 0.0f;
+    } else if (state.offset < -kOffsetLimit) {
+        state.offset = -kOffsetLimit;
+        state.velocity = 0.0f;
+    }
+}
+
+bool SettleFfbPhysics(FfbPhysicsState& state, const FfbPhysicsInput& input) {
+    const float commanded_force = ShapeFFBTorque(static_cast<float>(input.force));
+    const float target_offset = TargetOffset(commanded_force, Spring(input), input);
+    if (std::fabs(commanded_force - state.filtered_force) > kRestForce ||
+        std::fabs(target_offset - state.offset) > kRestOffset || std::fabs(state.velocity) > kRestVelocity) {
+        return false;
+    }
+    state.filtered_force = commanded_force;
+    state.offset = target_offset;
+    state.velocity = 0.0f;
+    return true;
+}
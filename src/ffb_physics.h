@@ -0,0 +1,41 @@
+#ifndef FFB_PHYSICS_H
+#define FFB_PHYSICS_H
+
+#include <cstdint>
+
+// Per-wheel FFB spring/damper state, owned by whoever runs the tick
+struct FfbPhysicsState {
+    float filtered_force = 0.0f;
+    float offset = 0.0f;
+    float velocity = 0.0f;
+};
+
+// Inputs sampled under the wheel's state lock
+struct FfbPhysicsInput {
+    int16_t force = 0;
+    int16_t autocenter = 0;
+    float gain = 1.0f;
+    float steering = 0.0f;
+};
+
+// Intermediate values of one step, for the signal scope
+struct FfbPhysicsSignals {
+    float commanded_force = 0.0f;
+    float spring = 0.0f;
+    float target_offset = 0.0f;
+};
+
+// Maps the game's constant force to the torque the offset model chases
+float ShapeFFBTorque(float raw_force);
+
+// Advances the steering offset by dt seconds towards the shaped FFB target;
+// fills `signals` when given
+void StepFfbPhysics(FfbPhysicsState& state, const FfbPhysicsInput& input, float dt,
+                    FfbPhysicsSignals* signals = nullptr);
+
+// True once the state has converged on what `input` commands (below what the
+// steering axis can show); snaps it onto that equilibrium so further steps
+// with the same input change nothing and the tick can stop until input changes
+bool SettleFfbPhysics(FfbPhysicsState& state, const FfbPhysicsInput& input);
+
+#endif  // FFB_PHYSICS_H
@@ -0,0 +1,211 @@
+#include "flight_recorder.h"
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+
+#include "tsc_clock.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace flight {
+
+namespace {
+struct AtomicSlot {
+    std::atomic<uint64_t> sequence{0};
+    std::atomic<uint64_t> reading{0};
+    std::atomic<uint64_t> head{0};
+    std::atomic<uint64_t> payload{0};
+};
+static_assert(sizeof(AtomicSlot) == sizeof(Slot), "the ring is dumped as Slots");
+static_assert((kCapacity & (kCapacity - 1)) == 0, "kCapacity must be a power of two");
+
+// Static, so neither recording nor dumping ever allocates
+AtomicSlot g_slots[kCapacity];
+std::atomic<uint64_t> g_next{0};
+// Dump() copies the ring through this, one chunk at a time; g_dumping keeps
+// it to one dump at once
+constexpr size_t kStagingSlots = 2048;
+static_assert(kCapacity % kStagingSlots == 0, "the ring is staged in whole chunks");
+Slot g_staging[kStagingSlots];
+
+char g_path[512] = {};
+double g_readings_per_second = 1e9;
+int64_t g_install_unix_ms = 0;
+std::atomic_flag g_dumping = ATOMIC_FLAG_INIT;
+
+// Copies kStagingSlots slots from `first`. A slot whose sequence changed while
+// it was read was rewritten under the copy and is staged as empty.
+void StageSlots(size_t first) {
+    for (size_t i = 0; i < kStagingSlots; ++i) {
+        const AtomicSlot& slot = g_slots[first + i];
+        Slot& copy = g_staging[i];
+        const uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+        copy.reading = slot.reading.load(std::memory_order_relaxed);
+        copy.head = slot.head.load(std::memory_order_relaxed);
+        copy.payload = slot.payload.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        copy.sequence = slot.sequence.load(std::memory_order_relaxed) == sequence ? sequence : 0;
+    }
+}
+
+#ifdef _WIN32
+LPTOP_LEVEL_EXCEPTION_FILTER g_previous_filter = nullptr;
+
+LONG WINAPI OnUnhandledException(EXCEPTION_POINTERS* info) {
+    Dump(DumpReason::Exception, info && info->ExceptionRecord ? info->ExceptionRecord->ExceptionCode : 0);
+    return g_previous_filter ? g_previous_filter(info) : EXCEPTION_CONTINUE_SEARCH;
+}
+
+void OnAbort(int signal_number) {
+    Dump(DumpReason::Signal, static_cast<uint32_t>(signal_number));
+    std::signal(signal_number, SIG_DFL);
+    std::raise(signal_number);
+}
+
+bool WriteAll(HANDLE file, const void* data, size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        const DWORD chunk = size > (1u << 30) ? (1u << 30) : static_cast<DWORD>(size);
+        DWORD written = 0;
+        if (!WriteFile(file, bytes, chunk, &written, nullptr) || written == 0) {
+            return false;
+        }
+        bytes += written;
+        size -= written;
+    }
+    return true;
+}
+
+bool WriteDump(const DumpHeader& header) {
+    HANDLE file = CreateFileA(g_path, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    bool written = WriteAll(file, &header, sizeof(header));
+    for (size_t first = 0; written && first < kCapacity; first += kStagingSlots) {
+        StageSlots(first);
+        written = WriteAll(file, g_staging, sizeof(g_staging));
+    }
+    CloseHandle(file);
+    return written;
+}
+#else
+constexpr int kCrashSignals[] = {SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT};
+// A stack overflow leaves no stack to run the handler on
+alignas(16) char g_signal_stack[64 * 1024];
+
+void OnCrashSignal(int signal_number) {
+    Dump(DumpReason::Signal, static_cast<uint32_t>(signal_number));
+    // SA_RESETHAND restored the default action: die as the signal would have
+    raise(signal_number);
+}
+
+bool WriteAll(int fd, const void* data, size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        const ssize_t written = write(fd, bytes, size);
+        if (written <= 0) {
+            return false;
+        }
+        bytes += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+bool WriteDump(const DumpHeader& header) {
+    const int fd = open(g_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    bool written = WriteAll(fd, &header, sizeof(header));
+    for (size_t first = 0; written && first < kCapacity; first += kStagingSlots) {
+        StageSlots(first);
+        written = WriteAll(fd, g_staging, sizeof(g_staging));
+    }
+    close(fd);
+    return written;
+}
+#endif
+}  // namespace
+
+namespace detail {
+void Write(EventKind kind, unsigned vjoy_id, uint16_t small, uint32_t value, uint64_t payload) {
+    const uint64_t sequence = g_next.fetch_add(1, std::memory_order_relaxed);
+    AtomicSlot& slot = g_slots[sequence & (kCapacity - 1)];
+    // Cleared first and fenced, so a dump that reads any of the new fields
+    // also sees the sequence change and stages the slot as empty
+    slot.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.reading.store(tsc::Now(), std::memory_order_relaxed);
+    slot.head.store(static_cast<uint64_t>(kind) | static_cast<uint64_t>((vjoy_id - 1) & 0xFF) << 8 |
+                        static_cast<uint64_t>(small) << 16 | static_cast<uint64_t>(value) << 32,
+                    std::memory_order_relaxed);
+    slot.payload.store(payload, std::memory_order_relaxed);
+    slot.sequence.store(sequence + 1, std::memory_order_release);
+}
+}  // namespace detail
+
+void Install(const char* path) {
+    size_t length = 0;
+    for (; path && path[length] && length + 1 < sizeof(g_path); ++length) {
+        g_path[length] = path[length];
+    }
+    g_path[length] = '\0';
+    g_readings_per_second = tsc::Frequency();
+    g_install_unix_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                            std::chrono::system_clock::now().time_since_epoch())
+                            .count();
+    if (length == 0) {
+        return;
+    }
+#ifdef _WIN32
+    g_previous_filter = SetUnhandledExceptionFilter(OnUnhandledException);
+    std::signal(SIGABRT, OnAbort);
+#else
+    stack_t stack{};
+    stack.ss_sp = g_signal_stack;
+    stack.ss_size = sizeof(g_signal_stack);
+    sigaltstack(&stack, nullptr);
+    struct sigaction action {};
+    action.sa_handler = OnCrashSignal;
+    action.sa_flags = SA_RESETHAND | SA_ONSTACK;
+    sigemptyset(&action.sa_mask);
+    for (int signal_number : kCrashSignals) {
+        sigaction(signal_number, &action, nullptr);
+    }
+#endif
+}
+
+bool Dump(DumpReason reason, uint32_t reason_code) {
+    if (g_path[0] == '\0' || g_dumping.test_and_set(std::memory_order_acquire)) {
+        // A crash while dumping would only overwrite the first dump
+        return false;
+    }
+    DumpHeader header{};
+    header.magic = kMagic;
+    header.version = kFormatVersion;
+    header.capacity = static_cast<uint32_t>(kCapacity);
+    header.slot_size = sizeof(Slot);
+    header.next_sequence = g_next.load(std::memory_order_relaxed);
+    header.dump_reading = tsc::Now();
+    header.readings_per_second = g_readings_per_second;
+    header.reason = static_cast<uint32_t>(reason);
+    header.reason_code = reason_code;
+    header.install_unix_ms = g_install_unix_ms;
+    const bool written = WriteDump(header);
+    g_dumping.clear(std::memory_order_release);
+    return written;
+}
+
+const char* DumpPath() {
+    return g_path;
+}
+
+}  // namespace flight
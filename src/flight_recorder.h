@@ -0,0 +1,148 @@
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "input/wheel_input.h"
+#include "wheel_types.h"
+
+// Always-on record of the last few seconds of every seat: input frames, FFB
+// packets and forces, physics steps, reports and enable/neutral changes, as
+// 32-byte slots in one statically allocated ring. A recording thread claims
+// a slot with a relaxed fetch_add and fills it with relaxed stores; nothing
+// allocates, locks or waits. Install() hooks the crash handlers
+// (SetUnhandledExceptionFilter and SIGABRT on Windows, SIGSEGV/SIGBUS/SIGILL/
+// SIGFPE/SIGABRT elsewhere), which write the ring to a file with the raw OS
+// calls only; Dump() writes it on request (Ctrl+C). wheel-flight decodes it.
+//
+// File: DumpHeader, then kCapacity slots of four little-endian words:
+// sequence + 1 (0 = empty or being written), tsc::Now() reading,
+// kind | seat << 8 | small << 16 | value << 32, and a 64-bit payload.
+namespace flight {
+
+constexpr uint32_t kMagic = 0x544C4657;  // "WFLT"
+constexpr uint32_t kFormatVersion = 1;
+// About 10 s of one seat at 8 kHz mouse input with 1 kHz physics and reports
+constexpr size_t kCapacity = size_t{1} << 17;
+
+enum class EventKind : uint8_t {
+    // small: throttle, brake, clutch bits, dpad_x + 1 << 3, dpad_y + 1 << 5,
+    // edge count << 8; value: mouse_dx; payload: buttons 0-63
+    InputFrame = 1,
+    // Raw vJoy FFB packet; small: size, value: command, payload: first 8 bytes
+    FfbPacket = 2,
+    // value: force passed to ApplyFFBForce()
+    FfbForce = 3,
+    // A physics step; small: commanded force, value: steering (float bits),
+    // payload: ffb_offset | ffb_velocity << 32 (float bits)
+    Physics = 4,
+    // small: hat, value: buttons 0-31, payload: steering, clutch, throttle, brake
+    Report = 5,
+    // small: enable
+    Enable = 6,
+    // SendNeutral(); small: reset_ffb
+    Neutral = 7,
+};
+
+enum class DumpReason : uint32_t {
+    Requested = 0,
+    Signal = 1,     // reason_code: the signal number
+    Exception = 2,  // reason_code: the SEH exception code
+};
+
+struct DumpHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t capacity;
+    uint32_t slot_size;
+    // Sequence of the next event when the dump started
+    uint64_t next_sequence;
+    uint64_t dump_reading;
+    // tsc::Frequency() at Install()
+    double readings_per_second;
+    uint32_t reason;
+    uint32_t reason_code;
+    int64_t install_unix_ms;
+    uint32_t reserved[4];
+};
+static_assert(sizeof(DumpHeader) == 72, "DumpHeader layout is part of the file format");
+
+struct Slot {
+    uint64_t sequence;
+    uint64_t reading;
+    uint64_t head;
+    uint64_t payload;
+
+    EventKind Kind() const { return static_cast<EventKind>(head & 0xFF); }
+    unsigned VJoyId() const { return static_cast<unsigned>((head >> 8) & 0xFF) + 1; }
+    uint16_t Small() const { return static_cast<uint16_t>(head >> 16); }
+    uint32_t Value() const { return static_cast<uint32_t>(head >> 32); }
+};
+static_assert(sizeof(Slot) == 32, "Slot layout is part of the file format");
+
+namespace detail {
+void Write(EventKind kind, unsigned vjoy_id, uint16_t small, uint32_t value, uint64_t payload);
+
+inline uint32_t FloatBits(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+}
+
+// Remembers where Dump() writes (empty = never) and installs the crash
+// handlers. Call once at startup, after tsc::Init().
+void Install(const char* path);
+// Writes the ring; safe from a signal handler or another thread while the
+// recording threads keep going. False without a path or if the write failed.
+bool Dump(DumpReason reason = DumpReason::Requested, uint32_t reason_code = 0);
+const char* DumpPath();
+
+// `vjoy_id` (1-16) names the seat
+inline void RecordInputFrame(unsigned vjoy_id, const InputFrame& frame) {
+    const WheelInputState& logical = frame.logical;
+    const size_t edges = frame.edges.size() < 255 ? frame.edges.size() : 255;
+    const uint16_t small = static_cast<uint16_t>(
+        (logical.throttle ? 1u : 0u) | (logical.brake ? 2u : 0u) | (logical.clutch ? 4u : 0u) |
+        static_cast<unsigned>(logical.dpad_x + 1) << 3 | static_cast<unsigned>(logical.dpad_y + 1) << 5 |
+        edges << 8);
+    detail::Write(EventKind::InputFrame, vjoy_id, small, static_cast<uint32_t>(frame.mouse_dx),
+                  logical.buttons.words[0]);
+}
+
+inline void RecordFfbPacket(unsigned vjoy_id, uint32_t command, const uint8_t* data, size_t size) {
+    uint64_t payload = 0;
+    std::memcpy(&payload, data, size < sizeof(payload) ? size : sizeof(payload));
+    detail::Write(EventKind::FfbPacket, vjoy_id, static_cast<uint16_t>(size), command, payload);
+}
+
+inline void RecordFfbForce(unsigned vjoy_id, int16_t force) {
+    detail::Write(EventKind::FfbForce, vjoy_id, 0, static_cast<uint32_t>(static_cast<int32_t>(force)), 0);
+}
+
+inline void RecordPhysics(unsigned vjoy_id, int16_t force, float steering, float offset, float velocity) {
+    detail::Write(EventKind::Physics, vjoy_id, static_cast<uint16_t>(force), detail::FloatBits(steering),
+                  detail::FloatBits(offset) | uint64_t{detail::FloatBits(velocity)} << 32);
+}
+
+inline void RecordReport(unsigned vjoy_id, const HidReport& report) {
+    uint64_t axes;
+    uint32_t buttons;
+    std::memcpy(&axes, report.data(), sizeof(axes));
+    std::memcpy(&buttons, report.data() + kReportButtonOffset, sizeof(buttons));
+    detail::Write(EventKind::Report, vjoy_id, report[kReportButtonOffset - 1], buttons, axes);
+}
+
+inline void RecordEnable(unsigned vjoy_id, bool enable) {
+    detail::Write(EventKind::Enable, vjoy_id, enable ? 1 : 0, 0, 0);
+}
+
+inline void RecordNeutral(unsigned vjoy_id, bool reset_ffb) {
+    detail::Write(EventKind::Neutral, vjoy_id, reset_ffb ? 1 : 0, 0, 0);
+}
+
+}  // namespace flight
+
+#endif  // FLIGHT_RECORDER_H
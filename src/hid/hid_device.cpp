@@ -1,23 +1,76 @@
 #include "hid_device.h"
 #include "../logging/logger.h"
 #include <iostream>
+#ifdef _WIN32
 #include "vjoy_loader.h"
+#endif
 
 namespace hid {
 
 constexpr const char* kTag = "hid_device";
 
-HidDevice::HidDevice() : acquired_(false), vjoy_id_(1) {}
+namespace {
+constexpr unsigned int kMaxVJoyDevices = 16;
 
+#ifdef _WIN32
+
+struct FfbTarget {
+    std::atomic<FfbGenCB> callback{nullptr};
+    std::atomic<void*> user_data{nullptr};
+};
+
+// Indexed by vJoy device id; slot 0 is unused
+FfbTarget g_ffb_targets[kMaxVJoyDevices + 1];
+std::atomic<bool> g_ffb_dispatch_registered{false};
+
+void CALLBACK DispatchFFB(PVOID data, PVOID) {
+    int device_id = 1;
+    if (vJoy.Ffb_h_DeviceID &&
+        vJoy.Ffb_h_DeviceID(static_cast<FFB_DATA*>(data), &device_id) != ERROR_SUCCESS) {
+        return;
+    }
+    if (device_id < 1 || device_id > static_cast<int>(kMaxVJoyDevices)) {
+        return;
+    }
+    FfbTarget& target = g_ffb_targets[device_id];
+    FfbGenCB callback = target.callback.load(std::memory_order_acquire);
+    if (callback) {
+        callback(data, target.user_data.load(std::memory_order_relaxed));
+    }
+}
+#endif
+}  // namespace
+
+HidDevice::HidDevice() : acquired_(false), library_loaded_(false), vjoy_id_(1) {}
+
+void HidDevice::SetDeviceId(unsigned int vjoy_id) {
+    if (vjoy_id < 1) vjoy_id = 1;
+    if (vjoy_id > kMaxVJoyDevices) vjoy_id = kMaxVJoyDevices;
+    vjoy_id_ = vjoy_id;
+}
+
+#ifdef _WIN32
 HidDevice::~HidDevice() {
     Shutdown();
-    FreeVJoyLibrary();
+    if (vjoy_id_ <= kMaxVJoyDevices) {
+        g_ffb_targets[vjoy_id_].callback.store(nullptr, std::memory_order_release);
+    }
+    if (library_loaded_) {
+        FreeVJoyLibrary();
+    }
 }
 
 bool HidDevice::Initialize() {
-    if (!LoadVJoyLibrary()) {
-        LOG_ERROR(kTag, "Could not load vJoyInterface.dll");
-        return false;
+    if (headless_) {
+        acquired_ = true;
+        return true;
+    }
+    if (!library_loaded_) {
+        if (!LoadVJoyLibrary()) {
+            LOG_ERROR(kTag, "Could not load vJoyInterface.dll");
+            return false;
+        }
+        library_loaded_ = true;
     }
 
     if (!vJoy.vJoyEnabled()) {
@@ -39,10 +92,22 @@ bool HidDevice::Initialize() {
     
     acquired_ = true;
     vJoy.ResetVJD(vjoy_id_);
+
+    if (vJoy.GetVJDButtonNumber) {
+        int buttons = vJoy.GetVJDButtonNumber(vjoy_id_);
+        if (buttons < static_cast<int>(kMaxButtons)) {
+            LOG_INFO(kTag, "vJoy device " << vjoy_id_ << " exposes " << buttons << " of " << kMaxButtons
+                     << " buttons; raise it in vJoyConf to use higher bindings");
+        }
+    }
     return true;
 }
 
 void HidDevice::Shutdown() {
+    if (headless_) {
+        acquired_ = false;
+        return;
+    }
     if (acquired_ && vJoy.IsLoaded()) {
         vJoy.RelinquishVJD(vjoy_id_);
         acquired_ = false;
@@ -50,14 +115,20 @@ void HidDevice::Shutdown() {
 }
 
 bool HidDevice::IsReady() const {
+    if (headless_) return acquired_;
     if (!vJoy.IsLoaded()) return false;
     return vJoy.GetVJDStatus(vjoy_id_) == VJD_STAT_OWN;
 }
 
-bool HidDevice::WriteReportBlocking(const std::array<uint8_t, 13>& report) {
+bool HidDevice::WriteReportBlocking(const HidReport& report) {
+    if (headless_) {
+        if (!acquired_) return false;
+        if (report_sink_) report_sink_(report);
+        return true;
+    }
     if (!vJoy.IsLoaded()) return false;
 
-    // Convert internal 13-byte report to vJoy JOYSTICK_POSITION_V2
+    // Convert the internal kReportSize-byte report to vJoy JOYSTICK_POSITION_V2
     JOYSTICK_POSITION_V2 iReport;
     iReport.bDevice = (BYTE)vjoy_id_;
 
@@ -79,23 +150,70 @@ bool HidDevice::WriteReportBlocking(const std::array<uint8_t, 13>& report) {
     if (hat > 7) iReport.bHats = -1;
     else iReport.bHats = hat * 4500; 
 
-    // 4. Buttons
-    uint32_t buttons = static_cast<uint32_t>(report[9]) | 
-                       (static_cast<uint32_t>(report[10]) << 8) | 
-                       (static_cast<uint32_t>(report[11]) << 16) | 
-                       (static_cast<uint32_t>(report[12]) << 24);
-    iReport.lButtons = buttons;
-    iReport.lButtonsEx1 = 0;
-    iReport.lButtonsEx2 = 0;
-    iReport.lButtonsEx3 = 0;
-
-    return vJoy.UpdateVJD(vjoy_id_, (PVOID)&iReport);
+    // 4. Buttons (1-32, 33-64, 65-96, 97-128)
+    LONG* button_words[] = {&iReport.lButtons, &iReport.lButtonsEx1, &iReport.lButtonsEx2, &iReport.lButtonsEx3};
+    for (size_t i = 0; i < 4; ++i) {
+        const uint8_t* src = &report[kReportButtonOffset + i * 4];
+        uint32_t word = static_cast<uint32_t>(src[0]) |
+                        (static_cast<uint32_t>(src[1]) << 8) |
+                        (static_cast<uint32_t>(src[2]) << 16) |
+                        (static_cast<uint32_t>(src[3]) << 24);
+        *button_words[i] = static_cast<LONG>(word);
+    }
+
+    if (!vJoy.UpdateVJD(vjoy_id_, (PVOID)&iReport)) {
+        return false;
+    }
+    if (report_sink_) {
+        report_sink_(report);
+    }
+    return true;
 }
 
 void HidDevice::RegisterFFBCallback(void* callback, void* user_data) {
-     if (vJoy.IsLoaded()) {
-         vJoy.FfbRegisterGenCB((FfbGenCB)callback, user_data);
-     }
+    if (!vJoy.IsLoaded()) {
+        return;
+    }
+    FfbTarget& target = g_ffb_targets[vjoy_id_];
+    target.user_data.store(user_data, std::memory_order_relaxed);
+    target.callback.store((FfbGenCB)callback, std::memory_order_release);
+    if (!g_ffb_dispatch_registered.exchange(true)) {
+        vJoy.FfbRegisterGenCB(DispatchFFB, nullptr);
+    }
+}
+#else
+HidDevice::~HidDevice() {
+    Shutdown();
+}
+
+bool HidDevice::Initialize() {
+    if (!acquired_ && !headless_) {
+        LOG_INFO(kTag, "No vJoy on this platform; reports of device " << vjoy_id_ << " are discarded");
+    }
+    acquired_ = true;
+    return true;
 }
 
+void HidDevice::Shutdown() {
+    acquired_ = false;
+}
+
+bool HidDevice::IsReady() const {
+    return acquired_;
+}
+
+bool HidDevice::WriteReportBlocking(const HidReport& report) {
+    if (!acquired_) {
+        return false;
+    }
+    if (report_sink_) {
+        report_sink_(report);
+    }
+    return true;
+}
+
+// FFB packets are vJoy's; headless callers feed WheelDevice::ApplyFFBForce() directly
+void HidDevice::RegisterFFBCallback(void*, void*) {}
+#endif
+
 } // namespace hid
@@ -3,31 +3,55 @@
 
 #include <array>
 #include <atomic>
+#include <functional>
 #include <string>
+#include <utility>
+#include "../wheel_types.h"
+
+#ifdef _WIN32
 #include <windows.h>
 #include "../vjoy_sdk/inc/public.h"
 #include "../vjoy_sdk/inc/vjoyinterface.h"
+#endif
 
 namespace hid {
 
+// vJoy output device. Outside Windows there is no vJoy: Initialize() always
+// succeeds and reports are discarded, so the core runs headless.
 class HidDevice {
 public:
     HidDevice();
     ~HidDevice();
 
+    // vJoy device id (1-16); set before Initialize()
+    void SetDeviceId(unsigned int vjoy_id);
+    unsigned int DeviceId() const { return vjoy_id_; }
+    // Never touch vJoy, even on Windows: reports only reach the sink
+    // (wheel-replay); set before Initialize()
+    void SetHeadless() { headless_ = true; }
+
     bool Initialize();
     void Shutdown();
     bool IsReady() const;
 
     // The core output function
-    bool WriteReportBlocking(const std::array<uint8_t, 13>& report);
+    bool WriteReportBlocking(const HidReport& report);
+
+    // Called on the writing thread with every report that was submitted;
+    // set before the device is in use
+    using ReportSink = std::function<void(const HidReport&)>;
+    void SetReportSink(ReportSink sink) { report_sink_ = std::move(sink); }
 
-    // FFB Callback mechanism for WheelDevice to hook into
+    // FFB Callback mechanism for WheelDevice to hook into. vJoy has a single
+    // process-wide FFB callback, so packets are dispatched by device id.
     void RegisterFFBCallback(void* callback, void* user_data);
 
 private:
     std::atomic<bool> acquired_;
-    UINT vjoy_id_ = 1;
+    bool library_loaded_;
+    bool headless_ = false;
+    unsigned int vjoy_id_ = 1;
+    ReportSink report_sink_;
 };
 
 }  // namespace hid
@@ -5,8 +5,13 @@
 
 VJoyAPI vJoy = {0};
 
+static int g_vjoy_refs = 0;
+
 bool LoadVJoyLibrary() {
-    if (vJoy.hModule) return true;
+    if (vJoy.hModule) {
+        ++g_vjoy_refs;
+        return true;
+    }
 
     // 1. Try to load from current directory first
     vJoy.hModule = LoadLibraryA("vJoyInterface.dll");
@@ -45,8 +50,10 @@ bool LoadVJoyLibrary() {
     vJoy.RelinquishVJD = (Func_RelinquishVJD)GetProcAddress(vJoy.hModule, "RelinquishVJD");
     vJoy.ResetVJD = (Func_ResetVJD)GetProcAddress(vJoy.hModule, "ResetVJD");
     vJoy.UpdateVJD = (Func_UpdateVJD)GetProcAddress(vJoy.hModule, "UpdateVJD");
+    vJoy.GetVJDButtonNumber = (Func_GetVJDButtonNumber)GetProcAddress(vJoy.hModule, "GetVJDButtonNumber");
     vJoy.FfbRegisterGenCB = (Func_FfbRegisterGenCB)GetProcAddress(vJoy.hModule, "FfbRegisterGenCB");
     
+    vJoy.Ffb_h_DeviceID = (Func_Ffb_h_DeviceID)GetProcAddress(vJoy.hModule, "Ffb_h_DeviceID");
     vJoy.Ffb_h_Type = (Func_Ffb_h_Type)GetProcAddress(vJoy.hModule, "Ffb_h_Type");
     vJoy.Ffb_h_Eff_Constant = (Func_Ffb_h_Eff_Constant)GetProcAddress(vJoy.hModule, "Ffb_h_Eff_Constant");
     vJoy.Ffb_h_EffOp = (Func_Ffb_h_EffOp)GetProcAddress(vJoy.hModule, "Ffb_h_EffOp");
@@ -61,10 +68,14 @@ bool LoadVJoyLibrary() {
         return false;
     }
 
+    g_vjoy_refs = 1;
     return true;
 }
 
 void FreeVJoyLibrary() {
+    if (g_vjoy_refs > 0 && --g_vjoy_refs > 0) {
+        return;
+    }
     if (vJoy.hModule) {
         FreeLibrary(vJoy.hModule);
         vJoy.hModule = nullptr;
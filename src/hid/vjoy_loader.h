@@ -12,9 +12,11 @@ typedef BOOL (__cdecl *Func_AcquireVJD)(UINT rID);
 typedef VOID (__cdecl *Func_RelinquishVJD)(UINT rID);
 typedef BOOL (__cdecl *Func_ResetVJD)(UINT rID);
 typedef BOOL (__cdecl *Func_UpdateVJD)(UINT rID, PVOID pData);
+typedef int (__cdecl *Func_GetVJDButtonNumber)(UINT rID);
 typedef VOID (__cdecl *Func_FfbRegisterGenCB)(FfbGenCB cb, PVOID data);
 
 // FFB Helper functions
+typedef DWORD (__cdecl *Func_Ffb_h_DeviceID)(const FFB_DATA * Packet, int *DeviceID);
 typedef DWORD (__cdecl *Func_Ffb_h_Type)(const FFB_DATA * Packet, FFBPType *Type);
 typedef DWORD (__cdecl *Func_Ffb_h_Eff_Constant)(const FFB_DATA * Packet, FFB_EFF_CONSTANT * ConstantEffect);
 typedef DWORD (__cdecl *Func_Ffb_h_EffOp)(const FFB_DATA * Packet, FFB_EFF_OP* Operation);
@@ -28,8 +30,10 @@ struct VJoyAPI {
     Func_RelinquishVJD RelinquishVJD;
     Func_ResetVJD ResetVJD;
     Func_UpdateVJD UpdateVJD;
+    Func_GetVJDButtonNumber GetVJDButtonNumber;
     Func_FfbRegisterGenCB FfbRegisterGenCB;
     
+    Func_Ffb_h_DeviceID Ffb_h_DeviceID;
     Func_Ffb_h_Type Ffb_h_Type;
     Func_Ffb_h_Eff_Constant Ffb_h_Eff_Constant;
     Func_Ffb_h_EffOp Ffb_h_EffOp;
@@ -42,7 +46,8 @@ struct VJoyAPI {
 
 extern VJoyAPI vJoy;
 
-// Loads the DLL from embedded resource or disk
+// Loads the DLL from embedded resource or disk. Reference counted: every
+// successful load must be paired with one FreeVJoyLibrary().
 bool LoadVJoyLibrary();
 void FreeVJoyLibrary();
 
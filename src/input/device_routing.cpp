@@ -0,0 +1,209 @@
+#include "device_routing.h"
+
+#include <algorithm>
+#include <cctype>
+
+#include "../logging/logger.h"
+
+namespace {
+constexpr const char* kTag = "device_routing";
+
+std::string ToLower(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return text;
+}
+
+uint8_t PedalBit(AxisTarget target) {
+    switch (target) {
+        case AxisTarget::Throttle:
+            return 1u << static_cast<uint8_t>(Pedal::Throttle);
+        case AxisTarget::Brake:
+            return 1u << static_cast<uint8_t>(Pedal::Brake);
+        case AxisTarget::Clutch:
+            return 1u << static_cast<uint8_t>(Pedal::Clutch);
+        default:
+            return 0;
+    }
+}
+
+// False for a device another seat owns, or one with nothing routed
+bool Owns(const DeviceRoute& route) {
+    return route.keys || route.x != AxisTarget::None || route.y != AxisTarget::None ||
+           route.wheel != AxisTarget::None;
+}
+}  // namespace
+
+bool ParseAxisTarget(const std::string& name, AxisTarget& target) {
+    const std::string lower = ToLower(name);
+    if (lower == "none") target = AxisTarget::None;
+    else if (lower == "steering") target = AxisTarget::Steering;
+    else if (lower == "throttle") target = AxisTarget::Throttle;
+    else if (lower == "brake") target = AxisTarget::Brake;
+    else if (lower == "clutch") target = AxisTarget::Clutch;
+    else return false;
+    return true;
+}
+
+const char* AxisTargetName(AxisTarget target) {
+    switch (target) {
+        case AxisTarget::None:
+            return "none";
+        case AxisTarget::Steering:
+            return "steering";
+        case AxisTarget::Throttle:
+            return "throttle";
+        case AxisTarget::Brake:
+            return "brake";
+        case AxisTarget::Clutch:
+            return "clutch";
+    }
+    return "none";
+}
+
+DeviceRouter::DeviceRouter() : seat_(0), count_(0), analog_pedal_mask_(0) {
+    default_mouse_.x = AxisTarget::Steering;
+}
+
+void DeviceRouter::Configure(const std::vector<DeviceRouteConfig>& routes, size_t seat) {
+    routes_ = routes;
+    seat_ = seat;
+    for (DeviceRouteConfig& route : routes_) {
+        route.match = ToLower(route.match);
+    }
+
+    // Once a specific device owns steering, other mice stop steering by default
+    bool steering_claimed = false;
+    analog_pedal_mask_ = 0;
+    for (const DeviceRouteConfig& route : routes_) {
+        if (route.seat != seat_) {
+            continue;
+        }
+        for (AxisTarget target : {route.x, route.y, route.wheel}) {
+            steering_claimed |= (target == AxisTarget::Steering);
+            analog_pedal_mask_ |= PedalBit(target);
+        }
+    }
+    default_mouse_.x = (steering_claimed || seat_ != 0) ? AxisTarget::None : AxisTarget::Steering;
+    default_keyboard_.keys = (seat_ == 0);
+    default_mouse_.keys = (seat_ == 0);
+
+    count_ = 0;
+    slots_.fill(Slot{});
+    index_.fill(IndexEntry{});
+}
+
+size_t DeviceRouter::HashHandle(uintptr_t handle) {
+    // Fibonacci hashing; handles are pointer-like so the low bits carry little entropy
+    uint64_t h = static_cast<uint64_t>(handle) * 0x9E3779B97F4A7C15ull;
+    return static_cast<size_t>(h >> 32) & (kIndexSize - 1);
+}
+
+int DeviceRouter::Find(uintptr_t handle) const {
+    size_t pos = HashHandle(handle);
+    for (size_t probe = 0; probe < kIndexSize; ++probe) {
+        const IndexEntry& entry = index_[(pos + probe) & (kIndexSize - 1)];
+        if (entry.slot == kNoSlot) {
+            return kNoSlot;
+        }
+        if (entry.handle == handle) {
+            return entry.slot;
+        }
+    }
+    return kNoSlot;
+}
+
+int DeviceRouter::Register(uintptr_t handle, InputDeviceKind kind, const std::string& path) {
+    int existing = Find(handle);
+    if (existing != kNoSlot) {
+        return existing;
+    }
+    if (count_ >= kMaxDevices) {
+        LOG_WARN(kTag, "Too many input devices; " << path << " uses the default route");
+        return kNoSlot;
+    }
+
+    const auto free_slot = std::find_if(slots_.begin(), slots_.end(), [](const Slot& s) { return !s.in_use; });
+    const int slot_index = static_cast<int>(free_slot - slots_.begin());
+    Slot& slot = *free_slot;
+    slot.in_use = true;
+    slot.handle = handle;
+    slot.kind = kind;
+    slot.route = DefaultRoute(kind);
+    const char* source = "default";
+
+    const std::string lower_path = ToLower(path);
+    for (const DeviceRouteConfig& route : routes_) {
+        if (!route.match.empty() && lower_path.find(route.match) != std::string::npos) {
+            if (route.seat != seat_) {
+                // Owned by another seat: keep the slot so later events stay one probe
+                slot.route = DeviceRoute{};
+                slot.route.keys = false;
+            } else {
+                slot.route.x = route.x;
+                slot.route.y = route.y;
+                slot.route.wheel = route.wheel;
+                slot.route.scale = route.scale;
+                slot.route.keys = route.keys;
+            }
+            source = route.name.c_str();
+            break;
+        }
+    }
+    const bool owned = Owns(slot.route);
+
+    size_t pos = HashHandle(handle);
+    while (index_[pos].slot != kNoSlot) {
+        pos = (pos + 1) & (kIndexSize - 1);
+    }
+    index_[pos].handle = handle;
+    index_[pos].slot = static_cast<int8_t>(slot_index);
+    ++count_;
+
+    if (!owned) {
+        LOG_DEBUG(kTag, "Seat " << (seat_ + 1) << " ignores input device " << path);
+        return slot_index;
+    }
+    LOG_INFO(kTag, "Seat " << (seat_ + 1) << ": input device #" << slot_index << " (" << (kind == InputDeviceKind::Mouse ? "mouse" : "keyboard")
+                                    << ") " << path << " -> route " << source << " [x="
+                                    << AxisTargetName(slot.route.x) << " y=" << AxisTargetName(slot.route.y)
+                                    << " wheel=" << AxisTargetName(slot.route.wheel)
+                                    << " keys=" << (slot.route.keys ? "on" : "off") << "]");
+    return slot_index;
+}
+
+int DeviceRouter::Unregister(uintptr_t handle) {
+    size_t pos = HashHandle(handle);
+    while (index_[pos].slot != kNoSlot && index_[pos].handle != handle) {
+        pos = (pos + 1) & (kIndexSize - 1);
+    }
+    const int slot_index = index_[pos].slot;
+    if (slot_index == kNoSlot) {
+        return kNoSlot;
+    }
+    // Backward-shift deletion: pull later entries of the probe run into the
+    // hole unless that would move them before their home position, so Find()
+    // still stops at the first empty entry and needs no tombstones
+    size_t hole = pos;
+    for (size_t next = (hole + 1) & (kIndexSize - 1); index_[next].slot != kNoSlot;
+         next = (next + 1) & (kIndexSize - 1)) {
+        const size_t home = HashHandle(index_[next].handle);
+        if (((next - home) & (kIndexSize - 1)) >= ((next - hole) & (kIndexSize - 1))) {
+            index_[hole] = index_[next];
+            hole = next;
+        }
+    }
+    index_[hole] = IndexEntry{};
+
+    Slot& slot = slots_[static_cast<size_t>(slot_index)];
+    if (Owns(slot.route)) {
+        LOG_INFO(kTag, "Seat " << (seat_ + 1) << ": input device #" << slot_index << " removed");
+    }
+    slot = Slot{};
+    --count_;
+    return slot_index;
+}
+
+const DeviceRoute& DeviceRouter::DefaultRoute(InputDeviceKind kind) const {
+    return kind == InputDeviceKind::Mouse ? default_mouse_ : default_keyboard_;
+}
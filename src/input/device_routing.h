@@ -0,0 +1,105 @@
+#ifndef DEVICE_ROUTING_H
+#define DEVICE_ROUTING_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../wheel_types.h"
+#include "keymap.h"
+
+enum class InputDeviceKind : uint8_t {
+    Keyboard = 0,
+    Mouse
+};
+
+enum class AxisTarget : uint8_t {
+    None = 0,
+    Steering,
+    Throttle,
+    Brake,
+    Clutch
+};
+
+bool ParseAxisTarget(const std::string& name, AxisTarget& target);
+const char* AxisTargetName(AxisTarget target);
+
+// One [device.<name>] config section
+struct DeviceRouteConfig {
+    std::string name;
+    // Case-insensitive substring of the OS device path (Raw Input device name
+    // on Windows, /dev/input/by-id path for evdev)
+    std::string match;
+    AxisTarget x = AxisTarget::None;
+    AxisTarget y = AxisTarget::None;
+    AxisTarget wheel = AxisTarget::None;
+    // Pedal travel in percent per mouse count (wheel: per notch); negative inverts
+    float scale = 0.5f;
+    bool keys = true;
+    // Seat (0-based) whose wheel this device drives
+    size_t seat = 0;
+};
+
+struct DeviceRoute {
+    AxisTarget x = AxisTarget::None;
+    AxisTarget y = AxisTarget::None;
+    AxisTarget wheel = AxisTarget::None;
+    float scale = 0.5f;
+    bool keys = true;
+};
+
+// Physical input devices keyed by an opaque OS handle (Raw Input hDevice, or
+// an evdev fd). The hot path resolves a handle to a dense slot with one probe
+// of an open-addressed table; routes are resolved once, when a device is first
+// seen. A removed device frees its slot, so hot-plugging never runs out.
+class DeviceRouter {
+public:
+    static constexpr size_t kMaxDevices = 32;
+    static constexpr int kNoSlot = -1;
+
+    DeviceRouter();
+
+    // Routes for every seat; devices matched to another seat are ignored, and
+    // only seat 0 picks up devices no route matches.
+    void Configure(const std::vector<DeviceRouteConfig>& routes, size_t seat = 0);
+
+    int Find(uintptr_t handle) const;
+    // Assigns a slot and resolves its route; returns kNoSlot when the table is full
+    int Register(uintptr_t handle, InputDeviceKind kind, const std::string& path);
+    // Frees the device's slot (the device was unplugged); returns it, or kNoSlot if unknown
+    int Unregister(uintptr_t handle);
+
+    const DeviceRoute& Route(int slot) const { return slots_[static_cast<size_t>(slot)].route; }
+    const DeviceRoute& DefaultRoute(InputDeviceKind kind) const;
+    size_t DeviceCount() const { return count_; }
+    // Pedals that an analog route drives
+    uint8_t AnalogPedalMask() const { return analog_pedal_mask_; }
+
+private:
+    struct Slot {
+        uintptr_t handle = 0;
+        InputDeviceKind kind = InputDeviceKind::Keyboard;
+        bool in_use = false;
+        DeviceRoute route;
+    };
+    struct IndexEntry {
+        uintptr_t handle = 0;
+        int8_t slot = kNoSlot;
+    };
+    static constexpr size_t kIndexSize = kMaxDevices * 4;
+
+    static size_t HashHandle(uintptr_t handle);
+
+    std::vector<DeviceRouteConfig> routes_;
+    size_t seat_;
+    std::array<Slot, kMaxDevices> slots_;
+    std::array<IndexEntry, kIndexSize> index_;
+    size_t count_;
+    DeviceRoute default_keyboard_;
+    DeviceRoute default_mouse_;
+    uint8_t analog_pedal_mask_;
+};
+
+#endif  // DEVICE_ROUTING_H
@@ -1,10 +1,18 @@
-// Windows Implementation using Raw Input
+// Windows Implementation using Raw Input. Elsewhere there is no OS backend:
+// the key/route/pedal state below is fed by whoever calls UpdateKeyState()
+// and UpdateMouseState() (benchmarks, headless harnesses).
 #include "device_scanner.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
 #include <iostream>
 #include <vector>
 #include <atomic>
+#include <mutex>
 #include "../logging/logger.h"
+#ifdef _WIN32
 #include <windows.h>
+#endif
 
 extern std::atomic<bool> running;
 
@@ -12,11 +20,12 @@ namespace {
 constexpr const char* kTag = "device_scanner";
 }
 
+#ifdef _WIN32
 static LRESULT CALLBACK RawInputWindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
 
 class WindowsInputBackend {
 public:
-    WindowsInputBackend() : hwnd(NULL), initialized(false) {}
+    WindowsInputBackend() : hwnd(NULL), initialized(false), owner_thread(0) {}
     
     bool Initialize() {
         if (initialized) return true;
@@ -41,13 +50,14 @@ public:
         // Keyboard
         Rid[0].usUsagePage = 0x01; 
         Rid[0].usUsage = 0x06; 
-        Rid[0].dwFlags = RIDEV_INPUTSINK; // Receive input even when in background
+        // Receive input even when in background; WM_INPUT_DEVICE_CHANGE frees unplugged devices' routes
+        Rid[0].dwFlags = RIDEV_INPUTSINK | RIDEV_DEVNOTIFY;
         Rid[0].hwndTarget = hwnd;
 
         // Mouse
         Rid[1].usUsagePage = 0x01; 
         Rid[1].usUsage = 0x02; 
-        Rid[1].dwFlags = RIDEV_INPUTSINK; // Receive input even when in background (for steering)
+        Rid[1].dwFlags = RIDEV_INPUTSINK | RIDEV_DEVNOTIFY; // (for steering)
         Rid[1].hwndTarget = hwnd;
 
         if (RegisterRawInputDevices(Rid, 2, sizeof(Rid[0])) == FALSE) {
@@ -56,6 +66,7 @@ public:
         }
         
         initialized = true;
+        owner_thread = GetCurrentThreadId();
         return true;
     }
 
@@ -70,96 +81,153 @@ public:
 
     HWND GetHwnd() { return hwnd; }
     bool IsInitialized() const { return initialized; }
+    // WM_INPUT is only delivered to the thread that created the window
+    bool IsOwnerThread() const { return initialized && owner_thread == GetCurrentThreadId(); }
 
 private:
     HWND hwnd;
     bool initialized;
+    DWORD owner_thread;
 };
 
-// Singleton context for the window proc to access scanner
-static DeviceScanner* g_scanner = nullptr;
+// Raw Input can only target one window per process, so every seat's scanner
+// shares one backend. The reader thread that initializes it pumps WM_INPUT for
+// all seats; each event is offered to every scanner and its router decides
+// whether the device belongs to that seat.
+static std::mutex g_registry_mutex;
+static std::vector<DeviceScanner*> g_scanners;
 static WindowsInputBackend* g_backend = nullptr;
 
-// Mapping helper: VK code to Linux KEY_ code
-static int MapVirtualKeyToLinux(UINT vk, UINT scancode, UINT flags) {
-    switch (vk) {
-        case VK_ESCAPE: return KEY_ESC;
-        case '1': return KEY_1;
-        case '2': return KEY_2;
-        case '3': return KEY_3;
-        case '4': return KEY_4;
-        case '5': return KEY_5;
-        case '6': return KEY_6;
-        case '7': return KEY_7;
-        case '8': return KEY_8;
-        case '9': return KEY_9;
-        case '0': return KEY_0;
-        case VK_OEM_MINUS: return KEY_MINUS;
-        case VK_OEM_PLUS: return KEY_EQUAL;
-        case VK_BACK: return KEY_BACKSPACE;
-        case VK_TAB: return KEY_TAB;
-        case 'Q': return KEY_Q;
-        case 'W': return KEY_W;
-        case 'E': return KEY_E;
-        case 'R': return KEY_R;
-        case 'T': return KEY_T;
-        case 'Y': return KEY_Y;
-        case 'U': return KEY_U;
-        case 'I': return KEY_I;
-        case 'O': return KEY_O;
-        case 'P': return KEY_P;
-        case VK_OEM_4: return KEY_LEFTBRACE;
-        case VK_OEM_6: return KEY_RIGHTBRACE;
-        case VK_RETURN: return KEY_ENTER;
-        case VK_CONTROL: return (flags & RI_KEY_E0) ? KEY_RIGHTCTRL : KEY_LEFTCTRL;
-        case 'A': return KEY_A;
-        case 'S': return KEY_S;
-        case 'D': return KEY_D;
-        case 'F': return KEY_F;
-        case 'G': return KEY_G;
-        case 'H': return KEY_H;
-        case 'J': return KEY_J;
-        case 'K': return KEY_K;
-        case 'L': return KEY_L;
-        case VK_OEM_1: return KEY_SEMICOLON;
-        case VK_OEM_7: return KEY_APOSTROPHE;
-        case VK_OEM_3: return KEY_GRAVE;
-        case VK_SHIFT: return (scancode == 0x36) ? KEY_RIGHTSHIFT : KEY_LEFTSHIFT;
-        case VK_OEM_5: return KEY_BACKSLASH;
-        case 'Z': return KEY_Z;
-        case 'X': return KEY_X;
-        case 'C': return KEY_C;
-        case 'V': return KEY_V;
-        case 'B': return KEY_B;
-        case 'N': return KEY_N;
-        case 'M': return KEY_M;
-        case VK_OEM_COMMA: return KEY_COMMA;
-        case VK_OEM_PERIOD: return KEY_DOT;
-        case VK_OEM_2: return KEY_SLASH;
-        case VK_MULTIPLY: return KEY_KPASTERISK;
-        case VK_MENU: return (flags & RI_KEY_E0) ? KEY_RIGHTALT : KEY_LEFTALT;
-        case VK_SPACE: return KEY_SPACE;
-        case VK_CAPITAL: return KEY_CAPSLOCK;
-        case VK_F1: return KEY_F1;
-        case VK_F2: return KEY_F2;
-        case VK_F3: return KEY_F3;
-        case VK_F4: return KEY_F4;
-        case VK_F5: return KEY_F5;
-        case VK_F6: return KEY_F6;
-        case VK_F7: return KEY_F7;
-        case VK_F8: return KEY_F8;
-        case VK_F9: return KEY_F9;
-        case VK_F10: return KEY_F10;
-        case VK_F11: return KEY_F11;
-        case VK_F12: return KEY_F12;
-        case VK_UP: return KEY_UP;
-        case VK_DOWN: return KEY_DOWN;
-        case VK_LEFT: return KEY_LEFT;
-        case VK_RIGHT: return KEY_RIGHT;
-        case VK_LWIN: return KEY_LEFTMETA;
-        case VK_RWIN: return KEY_RIGHTMETA;
-        default: return KEY_RESERVED;
+// VK code -> Linux KEY_ code, expanded at compile time into a dense table
+struct VirtualKeyMapping {
+    UINT vk;
+    uint16_t key;
+};
+
+constexpr VirtualKeyMapping kVirtualKeyMap[] = {
+    {VK_ESCAPE, KEY_ESC},
+    {'1', KEY_1},
+    {'2', KEY_2},
+    {'3', KEY_3},
+    {'4', KEY_4},
+    {'5', KEY_5},
+    {'6', KEY_6},
+    {'7', KEY_7},
+    {'8', KEY_8},
+    {'9', KEY_9},
+    {'0', KEY_0},
+    {VK_OEM_MINUS, KEY_MINUS},
+    {VK_OEM_PLUS, KEY_EQUAL},
+    {VK_BACK, KEY_BACKSPACE},
+    {VK_TAB, KEY_TAB},
+    {'Q', KEY_Q},
+    {'W', KEY_W},
+    {'E', KEY_E},
+    {'R', KEY_R},
+    {'T', KEY_T},
+    {'Y', KEY_Y},
+    {'U', KEY_U},
+    {'I', KEY_I},
+    {'O', KEY_O},
+    {'P', KEY_P},
+    {VK_OEM_4, KEY_LEFTBRACE},
+    {VK_OEM_6, KEY_RIGHTBRACE},
+    {VK_RETURN, KEY_ENTER},
+    {'A', KEY_A},
+    {'S', KEY_S},
+    {'D', KEY_D},
+    {'F', KEY_F},
+    {'G', KEY_G},
+    {'H', KEY_H},
+    {'J', KEY_J},
+    {'K', KEY_K},
+    {'L', KEY_L},
+    {VK_OEM_1, KEY_SEMICOLON},
+    {VK_OEM_7, KEY_APOSTROPHE},
+    {VK_OEM_3, KEY_GRAVE},
+    {VK_OEM_5, KEY_BACKSLASH},
+    {'Z', KEY_Z},
+    {'X', KEY_X},
+    {'C', KEY_C},
+    {'V', KEY_V},
+    {'B', KEY_B},
+    {'N', KEY_N},
+    {'M', KEY_M},
+    {VK_OEM_COMMA, KEY_COMMA},
+    {VK_OEM_PERIOD, KEY_DOT},
+    {VK_OEM_2, KEY_SLASH},
+    {VK_MULTIPLY, KEY_KPASTERISK},
+    {VK_SPACE, KEY_SPACE},
+    {VK_CAPITAL, KEY_CAPSLOCK},
+    {VK_F1, KEY_F1},
+    {VK_F2, KEY_F2},
+    {VK_F3, KEY_F3},
+    {VK_F4, KEY_F4},
+    {VK_F5, KEY_F5},
+    {VK_F6, KEY_F6},
+    {VK_F7, KEY_F7},
+    {VK_F8, KEY_F8},
+    {VK_F9, KEY_F9},
+    {VK_F10, KEY_F10},
+    {VK_F11, KEY_F11},
+    {VK_F12, KEY_F12},
+    {VK_UP, KEY_UP},
+    {VK_DOWN, KEY_DOWN},
+    {VK_LEFT, KEY_LEFT},
+    {VK_RIGHT, KEY_RIGHT},
+    {VK_LWIN, KEY_LEFTMETA},
+    {VK_RWIN, KEY_RIGHTMETA},
+    {VK_CONTROL, KEY_LEFTCTRL},
+    {VK_MENU, KEY_LEFTALT},
+    {VK_SHIFT, KEY_LEFTSHIFT},
+};
+
+// Keys whose meaning changes with the E0 prefix; everything else maps the same
+constexpr VirtualKeyMapping kExtendedVirtualKeyMap[] = {
+    {VK_CONTROL, KEY_RIGHTCTRL},
+    {VK_MENU, KEY_RIGHTALT},
+};
+
+constexpr size_t kVirtualKeyCount = 256;
+// Index: VK | (E0 ? 256 : 0)
+using VirtualKeyTable = std::array<uint16_t, kVirtualKeyCount * 2>;
+
+constexpr VirtualKeyTable BuildVirtualKeyTable() {
+    VirtualKeyTable table{};
+    for (const VirtualKeyMapping& mapping : kVirtualKeyMap) {
+        table[mapping.vk] = mapping.key;
+        table[kVirtualKeyCount + mapping.vk] = mapping.key;
+    }
+    for (const VirtualKeyMapping& mapping : kExtendedVirtualKeyMap) {
+        table[kVirtualKeyCount + mapping.vk] = mapping.key;
+    }
+    return table;
+}
+
+constexpr VirtualKeyTable kVirtualKeyTable = BuildVirtualKeyTable();
+constexpr UINT kRightShiftScancode = 0x36;
+
+inline int MapVirtualKeyToLinux(UINT vk, UINT scancode, UINT flags) {
+    size_t index = (vk & 0xFF) | ((flags & RI_KEY_E0) ? kVirtualKeyCount : 0);
+    int key = kVirtualKeyTable[index];
+    // Both shifts report VK_SHIFT; only the scancode tells them apart
+    if (key == KEY_LEFTSHIFT && scancode == kRightShiftScancode) {
+        key = KEY_RIGHTSHIFT;
     }
+    return key;
+}
+
+static std::string QueryRawInputDeviceName(HANDLE device) {
+    UINT size = 0;
+    if (!device || GetRawInputDeviceInfoA(device, RIDI_DEVICENAME, NULL, &size) != 0 || size == 0) {
+        return "<unnamed>";
+    }
+    std::string name(size, '\0');
+    if (GetRawInputDeviceInfoA(device, RIDI_DEVICENAME, &name[0], &size) == static_cast<UINT>(-1)) {
+        return "<unnamed>";
+    }
+    name.resize(std::strlen(name.c_str()));
+    return name;
 }
 
 // Raw Input Handler
@@ -175,7 +243,10 @@ void ProcessRawInput(HRAWINPUT hRawInput) {
 
     RAWINPUT* raw = (RAWINPUT*)lpb.data();
 
-    if (!g_scanner) return;
+    std::lock_guard<std::mutex> registry_lock(g_registry_mutex);
+    if (g_scanners.empty()) return;
+
+    const uintptr_t device = reinterpret_cast<uintptr_t>(raw->header.hDevice);
 
     if (raw->header.dwType == RIM_TYPEKEYBOARD) {
         UINT vk = raw->data.keyboard.VKey;
@@ -186,24 +257,41 @@ void ProcessRawInput(HRAWINPUT hRawInput) {
         int linux_code = MapVirtualKeyToLinux(vk, scancode, flags);
         
         if (linux_code != KEY_RESERVED) {
-            g_scanner->UpdateKeyState(linux_code, is_pressed);
+            for (DeviceScanner* scanner : g_scanners) {
+                scanner->UpdateKeyState(device, InputDeviceKind::Keyboard, linux_code, is_pressed);
+            }
         }
     }
     else if (raw->header.dwType == RIM_TYPEMOUSE) {
         int dx = raw->data.mouse.lLastX;
+        int dy = raw->data.mouse.lLastY;
+        USHORT btn_flags = raw->data.mouse.usButtonFlags;
+        int wheel = (btn_flags & RI_MOUSE_WHEEL) ? static_cast<SHORT>(raw->data.mouse.usButtonData) : 0;
         
-        if (dx != 0) {
-            g_scanner->UpdateMouseState(dx);
+        if (dx != 0 || dy != 0 || wheel != 0) {
+            for (DeviceScanner* scanner : g_scanners) {
+                scanner->UpdateMouseState(device, dx, dy, wheel);
+            }
         }
         
         // Mouse buttons
-        USHORT btn_flags = raw->data.mouse.usButtonFlags;
-        if (btn_flags & RI_MOUSE_LEFT_BUTTON_DOWN) g_scanner->UpdateKeyState(BTN_LEFT, true);
-        if (btn_flags & RI_MOUSE_LEFT_BUTTON_UP) g_scanner->UpdateKeyState(BTN_LEFT, false);
-        if (btn_flags & RI_MOUSE_RIGHT_BUTTON_DOWN) g_scanner->UpdateKeyState(BTN_RIGHT, true);
-        if (btn_flags & RI_MOUSE_RIGHT_BUTTON_UP) g_scanner->UpdateKeyState(BTN_RIGHT, false);
-        if (btn_flags & RI_MOUSE_MIDDLE_BUTTON_DOWN) g_scanner->UpdateKeyState(BTN_MIDDLE, true);
-        if (btn_flags & RI_MOUSE_MIDDLE_BUTTON_UP) g_scanner->UpdateKeyState(BTN_MIDDLE, false);
+        static constexpr struct {
+            USHORT down;
+            USHORT up;
+            int key;
+        } kMouseButtons[] = {
+            {RI_MOUSE_LEFT_BUTTON_DOWN, RI_MOUSE_LEFT_BUTTON_UP, BTN_LEFT},
+            {RI_MOUSE_RIGHT_BUTTON_DOWN, RI_MOUSE_RIGHT_BUTTON_UP, BTN_RIGHT},
+            {RI_MOUSE_MIDDLE_BUTTON_DOWN, RI_MOUSE_MIDDLE_BUTTON_UP, BTN_MIDDLE},
+        };
+        const InputDeviceKind kind = InputDeviceKind::Mouse;
+        for (const auto& button : kMouseButtons) {
+            if (!(btn_flags & (button.down | button.up))) continue;
+            for (DeviceScanner* scanner : g_scanners) {
+                if (btn_flags & button.down) scanner->UpdateKeyState(device, kind, button.key, true);
+                if (btn_flags & button.up) scanner->UpdateKeyState(device, kind, button.key, false);
+            }
+        }
     }
 }
 
@@ -212,36 +300,77 @@ LRESULT CALLBACK RawInputWindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM l
         case WM_INPUT: 
             ProcessRawInput((HRAWINPUT)lParam);
             return 0;
+        case WM_INPUT_DEVICE_CHANGE:
+            if (wParam == GIDC_REMOVAL) {
+                std::lock_guard<std::mutex> registry_lock(g_registry_mutex);
+                for (DeviceScanner* scanner : g_scanners) {
+                    scanner->RemoveDevice(reinterpret_cast<uintptr_t>(reinterpret_cast<HANDLE>(lParam)));
+                }
+            }
+            return 0;
     }
     return DefWindowProc(hwnd, msg, wParam, lParam);
 }
+#else
+static std::string QueryRawInputDeviceName(void*) {
+    return "<unnamed>";
+}
+#endif
 
 // DeviceScanner Implementation
 
-DeviceScanner::DeviceScanner() {
-    g_scanner = this;
-    g_backend = new WindowsInputBackend();
+#ifdef _WIN32
+DeviceScanner::DeviceScanner() : seat_(0) {
+    wake_event_ = CreateEvent(NULL, FALSE, FALSE, NULL);
+    std::lock_guard<std::mutex> lock(g_registry_mutex);
+    if (g_scanners.empty()) {
+        g_backend = new WindowsInputBackend();
+    }
+    g_scanners.push_back(this);
 }
 
 DeviceScanner::~DeviceScanner() {
     UnlockCursor();
-    if (g_backend) {
-        delete g_backend;
-        g_backend = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(g_registry_mutex);
+        g_scanners.erase(std::remove(g_scanners.begin(), g_scanners.end(), this), g_scanners.end());
+        if (g_scanners.empty() && g_backend) {
+            delete g_backend;
+            g_backend = nullptr;
+        }
+    }
+    if (wake_event_) {
+        CloseHandle(wake_event_);
     }
-    g_scanner = nullptr;
 }
 
+void* DeviceScanner::WakeEvent() const {
+    return wake_event_;
+}
+#else
+DeviceScanner::DeviceScanner() : seat_(0) {}
+
+DeviceScanner::~DeviceScanner() {
+    UnlockCursor();
+}
+
+void* DeviceScanner::WakeEvent() const {
+    return nullptr;
+}
+#endif
+
 // On Windows we don't need explicit discovery as we use RIDEV_INPUTSINK
 bool DeviceScanner::DiscoverKeyboard(const std::string& device_path) { return true; }
 bool DeviceScanner::DiscoverMouse(const std::string& device_path) { return true; }
 
 void DeviceScanner::Read(int& mouse_dx) {
     mouse_dx = 0;
+#ifdef _WIN32
     // Process Windows messages
-    if (g_backend) {
+    if (g_backend && g_backend->IsOwnerThread()) {
         g_backend->PumpMessages();
     }
+#endif
     
     // Consume accumulated mouse delta
     {
@@ -250,16 +379,18 @@ void DeviceScanner::Read(int& mouse_dx) {
         accumulated_mouse_dx = 0;
     }
 
+#ifdef _WIN32
     // Re-apply cursor lock every frame — ClipCursor can be reset by Windows
     if (cursor_locked_) {
         RECT clip;
-        clip.left   = saved_cursor_pos_.x;
-        clip.top    = saved_cursor_pos_.y;
-        clip.right  = saved_cursor_pos_.x + 1;
-        clip.bottom = saved_cursor_pos_.y + 1;
+        clip.left   = saved_cursor_x_;
+        clip.top    = saved_cursor_y_;
+        clip.right  = saved_cursor_x_ + 1;
+        clip.bottom = saved_cursor_y_ + 1;
         ClipCursor(&clip);
-        SetCursorPos(saved_cursor_pos_.x, saved_cursor_pos_.y);
+        SetCursorPos(saved_cursor_x_, saved_cursor_y_);
     }
+#endif
 }
 
 void DeviceScanner::Read() {
@@ -267,51 +398,195 @@ void DeviceScanner::Read() {
     Read(dummy);
 }
 
-void DeviceScanner::UpdateKeyState(int linux_code, bool pressed) {
+void DeviceScanner::ConfigureRoutes(const std::vector<DeviceRouteConfig>& routes, size_t seat) {
     std::lock_guard<std::mutex> lock(input_mutex);
+    seat_ = seat;
+    router_.Configure(routes, seat);
+    for (KeyBits& keys : device_keys_) {
+        keys = KeyBits{};
+    }
+    key_hold_count_.fill(0);
+    key_states_ = KeyBits{};
+    analog_pedals_.fill(0.0f);
+}
+
+int DeviceScanner::ResolveDeviceLocked(uintptr_t device, InputDeviceKind kind) {
+    int slot = router_.Find(device);
+    if (slot != DeviceRouter::kNoSlot || router_.DeviceCount() >= DeviceRouter::kMaxDevices) {
+        return slot;
+    }
+    // First event from this device: resolve its route once
+    return router_.Register(device, kind, QueryRawInputDeviceName(reinterpret_cast<void*>(device)));
+}
+
+void DeviceScanner::UpdateKeyState(uintptr_t device, InputDeviceKind kind, int linux_code, bool pressed) {
+    if (linux_code < 0 || static_cast<size_t>(linux_code) >= kKeyCodeCount) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(input_mutex);
+    const int slot = ResolveDeviceLocked(device, kind);
+    const DeviceRoute& route = (slot == DeviceRouter::kNoSlot) ? router_.DefaultRoute(kind) : router_.Route(slot);
+    if (!route.keys) {
+        return;
+    }
+
+    const size_t key = static_cast<size_t>(linux_code);
+    KeyBits& keys = device_keys_[slot == DeviceRouter::kNoSlot ? DeviceRouter::kMaxDevices : static_cast<size_t>(slot)];
+    if (keys.Test(key) == pressed) {
+        return;  // Auto-repeat
+    }
+    keys.Set(key, pressed);
     if (pressed) {
-        active_keys.insert(linux_code);
+        if (key_hold_count_[key]++ != 0) return;
     } else {
-        active_keys.erase(linux_code);
+        if (key_hold_count_[key] == 0 || --key_hold_count_[key] != 0) return;
     }
+
+    key_states_.Set(key, pressed);
+    key_edges_.push_back({static_cast<uint16_t>(linux_code), pressed, std::chrono::steady_clock::now()});
     NotifyInputChanged();
 }
 
-void DeviceScanner::UpdateMouseState(int dx) {
+void DeviceScanner::UpdateMouseState(uintptr_t device, int dx, int dy, int wheel) {
     std::lock_guard<std::mutex> lock(input_mutex);
-    accumulated_mouse_dx += dx;
-    NotifyInputChanged();
+    const int slot = ResolveDeviceLocked(device, InputDeviceKind::Mouse);
+    const DeviceRoute& route =
+        (slot == DeviceRouter::kNoSlot) ? router_.DefaultRoute(InputDeviceKind::Mouse) : router_.Route(slot);
+    bool applied = ApplyAxisLocked(route.x, static_cast<float>(dx), route.scale);
+    applied |= ApplyAxisLocked(route.y, static_cast<float>(dy), route.scale);
+    // WHEEL_DELTA (120) per notch
+    applied |= ApplyAxisLocked(route.wheel, static_cast<float>(wheel) / 120.0f, route.scale);
+    if (applied) {
+        NotifyInputChanged();
+    }
+}
+
+void DeviceScanner::RemoveDevice(uintptr_t device) {
+    std::lock_guard<std::mutex> lock(input_mutex);
+    const int slot = router_.Unregister(device);
+    if (slot == DeviceRouter::kNoSlot) {
+        return;
+    }
+    // Keys held while unplugging would otherwise stay down, and the next
+    // device to take the slot would inherit them
+    KeyBits& keys = device_keys_[static_cast<size_t>(slot)];
+    const auto now = std::chrono::steady_clock::now();
+    bool released = false;
+    for (size_t key = 0; key < kKeyCodeCount; ++key) {
+        if (!keys.Test(key) || key_hold_count_[key] == 0 || --key_hold_count_[key] != 0) {
+            continue;
+        }
+        key_states_.Set(key, false);
+        key_edges_.push_back({static_cast<uint16_t>(key), false, now});
+        released = true;
+    }
+    keys = KeyBits{};
+    if (released) {
+        NotifyInputChanged();
+    }
+}
+
+bool DeviceScanner::ApplyAxisLocked(AxisTarget target, float counts, float scale) {
+    if (counts == 0.0f) {
+        return false;
+    }
+    switch (target) {
+        case AxisTarget::None:
+            return false;
+        case AxisTarget::Steering:
+            accumulated_mouse_dx += static_cast<int>(counts);
+            return true;
+        case AxisTarget::Throttle:
+        case AxisTarget::Brake:
+        case AxisTarget::Clutch: {
+            size_t pedal = static_cast<size_t>(target) - static_cast<size_t>(AxisTarget::Throttle);
+            float next = analog_pedals_[pedal] + counts * scale / 100.0f;
+            analog_pedals_[pedal] = std::clamp(next, 0.0f, 1.0f);
+            return true;
+        }
+    }
+    return false;
 }
 
+void DeviceScanner::SnapshotAnalogPedals(std::array<float, kPedalCount>& pedals, uint8_t& mask) const {
+    std::lock_guard<std::mutex> lock(const_cast<std::mutex&>(input_mutex));
+    pedals = analog_pedals_;
+    mask = router_.AnalogPedalMask();
+}
+
+#ifdef _WIN32
 void DeviceScanner::NotifyInputChanged() {
-    // CV not used — Windows message loop drives input via MsgWaitForMultipleObjects
+    // Wakes this seat's reader when another seat's reader pumped the event
+    if (wake_event_) {
+        SetEvent(wake_event_);
+    }
 }
 
-bool DeviceScanner::WaitForEvents(int timeout_ms) {
+bool DeviceScanner::AttachBackend() {
+    std::lock_guard<std::mutex> lock(g_registry_mutex);
     if (g_backend && !g_backend->IsInitialized()) {
         if (!g_backend->Initialize()) {
             LOG_ERROR(kTag, "Failed to initialize backend on reader thread");
             return false;
         }
+        LOG_DEBUG(kTag, "Seat " << (seat_ + 1) << " reader pumps Raw Input");
     }
+    return g_backend && g_backend->IsOwnerThread();
+}
 
-    if (g_backend) g_backend->PumpMessages();
+bool DeviceScanner::WaitForEvents(int timeout_ms) {
+    const bool owns_backend = AttachBackend();
 
     DWORD loop_timeout = (timeout_ms < 0) ? INFINITE : static_cast<DWORD>(timeout_ms);
+
+    if (!owns_backend) {
+        return WaitForSingleObject(wake_event_, loop_timeout) == WAIT_OBJECT_0;
+    }
+
+    g_backend->PumpMessages();
+
+    DWORD result = MsgWaitForMultipleObjects(1, &wake_event_, FALSE, loop_timeout, QS_ALLINPUT);
     
-    DWORD result = MsgWaitForMultipleObjects(0, NULL, FALSE, loop_timeout, QS_ALLINPUT);
-    
-    if (result == WAIT_OBJECT_0) {
-        if (g_backend) g_backend->PumpMessages();
+    if (result == WAIT_OBJECT_0 + 1) {
+        g_backend->PumpMessages();
+        // Our own updates set the event too; it is consumed by this pass
+        ResetEvent(wake_event_);
         return true;
     }
     
-    return false; // Timeout
+    return result == WAIT_OBJECT_0;
+}
+#else
+void DeviceScanner::NotifyInputChanged() {
+    wake_.Signal(1);
+}
+
+bool DeviceScanner::AttachBackend() {
+    return false;
+}
+
+bool DeviceScanner::WaitForEvents(int timeout_ms) {
+    const auto deadline = (timeout_ms < 0)
+                              ? WakeSignal::Clock::time_point::max()
+                              : WakeSignal::Clock::now() + std::chrono::milliseconds(timeout_ms);
+    return wake_.WaitUntil(deadline) != 0;
 }
+#endif
 
 bool DeviceScanner::IsKeyPressed(int keycode) const {
     std::lock_guard<std::mutex> lock(const_cast<std::mutex&>(input_mutex));
-    return active_keys.find(keycode) != active_keys.end();
+    return keycode >= 0 && key_states_.Test(static_cast<size_t>(keycode));
+}
+
+KeyBits DeviceScanner::SnapshotKeys() const {
+    std::lock_guard<std::mutex> lock(const_cast<std::mutex&>(input_mutex));
+    return key_states_;
+}
+
+void DeviceScanner::DrainKeyEdges(std::vector<KeyEdge>& out) {
+    out.clear();
+    std::lock_guard<std::mutex> lock(input_mutex);
+    out.swap(key_edges_);
 }
 
 bool DeviceScanner::Grab(bool enable) {
@@ -323,30 +598,38 @@ bool DeviceScanner::Grab(bool enable) {
     return true;
 }
 
+// Without Windows there is no cursor to hold; only the flag is kept
 void DeviceScanner::LockCursor() {
     if (cursor_locked_) return;
 
-    GetCursorPos(&saved_cursor_pos_);
+#ifdef _WIN32
+    POINT pos = {0, 0};
+    GetCursorPos(&pos);
+    saved_cursor_x_ = pos.x;
+    saved_cursor_y_ = pos.y;
 
     RECT clip;
-    clip.left   = saved_cursor_pos_.x;
-    clip.top    = saved_cursor_pos_.y;
-    clip.right  = saved_cursor_pos_.x + 1;
-    clip.bottom = saved_cursor_pos_.y + 1;
+    clip.left   = saved_cursor_x_;
+    clip.top    = saved_cursor_y_;
+    clip.right  = saved_cursor_x_ + 1;
+    clip.bottom = saved_cursor_y_ + 1;
     ClipCursor(&clip);
 
     while (ShowCursor(FALSE) >= 0) {}
+#endif
 
     cursor_locked_ = true;
-    LOG_INFO(kTag, "Cursor locked at (" << saved_cursor_pos_.x << ", " << saved_cursor_pos_.y << ")");
+    LOG_INFO(kTag, "Cursor locked at (" << saved_cursor_x_ << ", " << saved_cursor_y_ << ")");
 }
 
 void DeviceScanner::UnlockCursor() {
     if (!cursor_locked_) return;
 
+#ifdef _WIN32
     ClipCursor(NULL);
-    SetCursorPos(saved_cursor_pos_.x, saved_cursor_pos_.y);
+    SetCursorPos(saved_cursor_x_, saved_cursor_y_);
     while (ShowCursor(TRUE) < 0) {}
+#endif
 
     cursor_locked_ = false;
     LOG_INFO(kTag, "Cursor unlocked");
@@ -2,12 +2,23 @@
 #ifndef DEVICE_SCANNER_H
 #define DEVICE_SCANNER_H
 
-#include <windows.h>
 #include "../input_defs.h"
+#include "../wake_signal.h"
+#include "device_routing.h"
+#include "keymap.h"
 
+#include <array>
+#include <chrono>
+#include <cstdint>
 #include <string>
 #include <mutex>
-#include <unordered_set>
+#include <vector>
+
+struct KeyEdge {
+    uint16_t key;
+    bool pressed;
+    std::chrono::steady_clock::time_point timestamp;
+};
 
 class DeviceScanner {
 public:
@@ -18,7 +29,10 @@ public:
     bool DiscoverKeyboard(const std::string& device_path = "");
     bool DiscoverMouse(const std::string& device_path = "");
     
-    // Read events from keyboard and mouse
+    // Per-device routing, applied to devices as they are first seen
+    void ConfigureRoutes(const std::vector<DeviceRouteConfig>& routes, size_t seat = 0);
+
+    // Read events from keyboard and mouse; mouse_dx is the steering delta
     void Read(int& mouse_dx);
     void Read();
     
@@ -33,6 +47,12 @@ public:
 
     // Check if a key is currently pressed
     bool IsKeyPressed(int keycode) const;
+    // Copy of all key states under a single lock
+    KeyBits SnapshotKeys() const;
+    // Pedal positions driven by analog device routes
+    void SnapshotAnalogPedals(std::array<float, kPedalCount>& pedals, uint8_t& mask) const;
+    // Moves key transitions recorded since the last call into out (in arrival order)
+    void DrainKeyEdges(std::vector<KeyEdge>& out);
     bool HasGrabbedKeyboard() const;
     bool HasGrabbedMouse() const;
     bool AllRequiredGrabbed() const;
@@ -42,17 +62,46 @@ public:
     std::mutex input_mutex;
     void NotifyInputChanged();
     bool WaitForEvents(int timeout_ms);
+    // Creates the Raw Input window on the calling thread if no reader owns it
+    // yet; true if the calling thread pumps it. Always false outside Windows.
+    bool AttachBackend();
+    // Win32 event HANDLE; null outside Windows
+    void* WakeEvent() const;
 
-    // Raw Input state updates (called from window proc)
-    void UpdateKeyState(int linux_code, bool pressed);
-    void UpdateMouseState(int dx);
+    // Raw Input state updates (called from window proc). device is the OS
+    // handle of the source device. Outside Windows nothing calls these but
+    // whoever injects input, with any nonzero id per device.
+    void UpdateKeyState(uintptr_t device, InputDeviceKind kind, int linux_code, bool pressed);
+    void UpdateMouseState(uintptr_t device, int dx, int dy, int wheel);
+    // The device was unplugged: releases the keys it held and frees its route slot
+    void RemoveDevice(uintptr_t device);
 
 private:
-    std::unordered_set<int> active_keys;
+    int ResolveDeviceLocked(uintptr_t device, InputDeviceKind kind);
+    bool ApplyAxisLocked(AxisTarget target, float counts, float scale);
+
+    DeviceRouter router_;
+    size_t seat_;
+#ifdef _WIN32
+    // Auto-reset event signalled on every state change routed to this seat
+    void* wake_event_;
+#else
+    WakeSignal wake_;
+#endif
+    // Merged view over all devices routed to bindings
+    KeyBits key_states_;
+    // Per-device key bits (last entry: devices without a slot) and the number
+    // of devices holding each key, so one keyboard releasing a key does not
+    // release it for another.
+    std::array<KeyBits, DeviceRouter::kMaxDevices + 1> device_keys_;
+    std::array<uint8_t, kKeyCodeCount> key_hold_count_{};
+    std::vector<KeyEdge> key_edges_;
     int accumulated_mouse_dx = 0;
+    std::array<float, kPedalCount> analog_pedals_{};
     bool toggle_latch_ = false;
     bool cursor_locked_ = false;
-    POINT saved_cursor_pos_ = {0, 0};
+    long saved_cursor_x_ = 0;
+    long saved_cursor_y_ = 0;
     void LockCursor();
     void UnlockCursor();
 };
@@ -1,11 +1,14 @@
 #include "input_manager.h"
 
+#include "../bit_util.h"
 #include "../input_defs.h"
 
 #include <atomic>
 #include <chrono>
 
 #include "../logging/logger.h"
+#include "../metrics.h"
+#include "../trace.h"
 
 extern std::atomic<bool> running;
 
@@ -13,7 +16,8 @@ namespace {
 constexpr const char* kTag = "input_manager";
 }
 
-InputManager::InputManager() : reader_running_(false), frame_sequence_(0), consumed_sequence_(0) {
+InputManager::InputManager()
+    : reader_running_(false), external_pump_(false), frame_sequence_(0), consumed_sequence_(0), dropped_edges_(0) {
     pending_frame_.timestamp = std::chrono::steady_clock::now();
 }
 
@@ -21,6 +25,14 @@ InputManager::~InputManager() {
     Shutdown();
 }
 
+void InputManager::SetBindings(const std::vector<KeyBinding>& bindings) {
+    keymap_.Rebuild(bindings);
+}
+
+void InputManager::SetDeviceRoutes(const std::vector<DeviceRouteConfig>& routes, size_t seat) {
+    device_scanner_.ConfigureRoutes(routes, seat);
+}
+
 bool InputManager::Initialize(const std::string& keyboard_override, const std::string& mouse_override) {
     if (!device_scanner_.DiscoverKeyboard(keyboard_override)) {
         LOG_ERROR(kTag, "Failed to discover keyboard " << keyboard_override);
@@ -36,7 +48,9 @@ bool InputManager::Initialize(const std::string& keyboard_override, const std::s
     pending_frame_.timestamp = std::chrono::steady_clock::now();
 
     reader_running_.store(true, std::memory_order_relaxed);
-    reader_thread_ = std::thread(&InputManager::ReaderLoop, this);
+    if (!external_pump_) {
+        reader_thread_ = std::thread(&InputManager::ReaderLoop, this);
+    }
     LOG_INFO(kTag, "Input manager initialized");
     return true;
 }
@@ -46,26 +60,36 @@ void InputManager::Shutdown() {
     if (was_running) {
         device_scanner_.NotifyInputChanged();
     }
-    frame_cv_.notify_all();
+    frame_wake_.Signal(kFrameStop);
     if (reader_thread_.joinable()) {
         reader_thread_.join();
     }
 }
 
 bool InputManager::WaitForFrame(InputFrame& frame) {
-    std::unique_lock<std::mutex> lock(frame_mutex_);
-    frame_cv_.wait(lock, [this]() {
-        return consumed_sequence_ != frame_sequence_ || !reader_running_.load(std::memory_order_relaxed) ||
-               !running.load(std::memory_order_relaxed);
-    });
-    if (consumed_sequence_ == frame_sequence_) {
-        return false;
+    bool woken = false;
+    for (;;) {
+        bool ready = false;
+        {
+            std::lock_guard<std::mutex> lock(frame_mutex_);
+            if (consumed_sequence_ != frame_sequence_) {
+                TakeFrameLocked(frame);
+                ready = true;
+            }
+        }
+        if (woken) {
+            // Idle: the frame behind this wake was already taken on an earlier pass
+            frame_wake_.CountOutcome(ready);
+        }
+        if (ready) {
+            return true;
+        }
+        if (!reader_running_.load(std::memory_order_relaxed) || !running.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        frame_wake_.Wait();
+        woken = true;
     }
-    frame = pending_frame_;
-    pending_frame_.mouse_dx = 0;
-    pending_frame_.toggle_pressed = false;
-    consumed_sequence_ = frame_sequence_;
-    return true;
 }
 
 bool InputManager::TryGetFrame(InputFrame& frame) {
@@ -73,11 +97,24 @@ bool InputManager::TryGetFrame(InputFrame& frame) {
     if (consumed_sequence_ == frame_sequence_) {
         return false;
     }
-    frame = pending_frame_;
+    TakeFrameLocked(frame);
+    return true;
+}
+
+void InputManager::TakeFrameLocked(InputFrame& frame) {
+    frame.logical = pending_frame_.logical;
+    frame.mouse_dx = pending_frame_.mouse_dx;
+    frame.timestamp = pending_frame_.timestamp;
+    frame.toggle_pressed = pending_frame_.toggle_pressed;
+    frame.trace_flow = pending_frame_.trace_flow;
+    // Frames published since the last take were merged into this one
+    metrics::Increment(metrics::Counter::FramesCoalesced, frame_sequence_ - consumed_sequence_ - 1);
+    // Reuses the caller's capacity; the ring is only ever drained here
+    frame.edges.clear();
+    edge_ring_.PopAll([&](const ButtonEdge& edge) { frame.edges.push_back(edge); });
     pending_frame_.mouse_dx = 0;
     pending_frame_.toggle_pressed = false;
     consumed_sequence_ = frame_sequence_;
-    return true;
 }
 
 bool InputManager::GrabDevices(bool enable) {
@@ -105,77 +142,125 @@ WheelInputState InputManager::LatestLogicalState() const {
 
 void InputManager::ReaderLoop() {
     LOG_DEBUG(kTag, "Reader loop started");
+    trace::SetThreadName("input reader");
     while (reader_running_.load(std::memory_order_relaxed) && running.load(std::memory_order_relaxed)) {
-        device_scanner_.WaitForEvents(-1);
-        int mouse_dx = 0;
-        device_scanner_.Read(mouse_dx);
-        bool toggle = device_scanner_.CheckToggle();
-        WheelInputState next_state = BuildLogicalState();
-        bool emit_frame = false;
         {
-            std::lock_guard<std::mutex> lock(frame_mutex_);
-            emit_frame = ShouldEmitFrameLocked(mouse_dx, toggle, next_state);
-            if (emit_frame) {
-                current_state_ = next_state;
-                pending_frame_.logical = next_state;
-                pending_frame_.mouse_dx += mouse_dx;
-                pending_frame_.toggle_pressed = pending_frame_.toggle_pressed || toggle;
-                pending_frame_.timestamp = std::chrono::steady_clock::now();
-                ++frame_sequence_;
-            }
+            TRACE_SCOPE("DeviceScanner::WaitForEvents");
+            device_scanner_.WaitForEvents(-1);
         }
-        if (!emit_frame) {
-            continue;
+        if (PumpOnce()) {
+            frame_wake_.Signal(kFrameReady);
         }
-        frame_cv_.notify_all();
     }
-    frame_cv_.notify_all();
+    frame_wake_.Signal(kFrameStop);
     LOG_DEBUG(kTag, "Reader loop stopped");
 }
 
+bool InputManager::PumpOnce() {
+    TRACE_SCOPE("InputManager::PumpOnce");
+    int mouse_dx = 0;
+    device_scanner_.Read(mouse_dx);
+    bool has_edges = PublishButtonEdges();
+    bool toggle = device_scanner_.CheckToggle();
+    WheelInputState next_state = BuildLogicalState();
+    std::lock_guard<std::mutex> lock(frame_mutex_);
+    if (!has_edges && !ShouldEmitFrameLocked(mouse_dx, toggle, next_state)) {
+        return false;
+    }
+    current_state_ = next_state;
+    pending_frame_.logical = next_state;
+    pending_frame_.mouse_dx += mouse_dx;
+    pending_frame_.toggle_pressed = pending_frame_.toggle_pressed || toggle;
+    pending_frame_.timestamp = std::chrono::steady_clock::now();
+    ++frame_sequence_;
+    metrics::Increment(metrics::Counter::FramesEmitted);
+    pending_frame_.trace_flow = trace::NewFlowId();
+    trace::FlowStart("input frame", pending_frame_.trace_flow);
+    return true;
+}
+
+void InputManager::UseExternalPump() {
+    external_pump_ = true;
+}
+
+bool InputManager::AttachPump() {
+    return device_scanner_.AttachBackend();
+}
+
+void* InputManager::WakeHandle() const {
+    return device_scanner_.WakeEvent();
+}
+
+bool InputManager::PublishButtonEdges() {
+    device_scanner_.DrainKeyEdges(key_edge_scratch_);
+    bool published = false;
+    for (const KeyEdge& key_edge : key_edge_scratch_) {
+        InputAction action = keymap_.ActionForKey(key_edge.key);
+        if (action < InputAction::FirstButton) {
+            continue;
+        }
+        ButtonEdge edge;
+        edge.button = static_cast<uint8_t>(static_cast<size_t>(action) - static_cast<size_t>(InputAction::FirstButton));
+        edge.pressed = key_edge.pressed;
+        edge.timestamp = key_edge.timestamp;
+        if (!edge_ring_.TryPush(edge)) {
+            // Level state still carries the key; only sub-frame taps can be lost here
+            ++dropped_edges_;
+            LOG_RATE_LIMITED(logging::LogLevel::Warn, kTag, 1000,
+                             "Button edge queue full; dropped " << dropped_edges_ << " edges so far");
+            continue;
+        }
+        published = true;
+    }
+    return published;
+}
+
 WheelInputState InputManager::BuildLogicalState() {
+    TRACE_SCOPE("InputManager::BuildLogicalState");
     WheelInputState snapshot;
-    snapshot.throttle = device_scanner_.IsKeyPressed(KEY_W);
-    snapshot.brake = device_scanner_.IsKeyPressed(KEY_S);
-    snapshot.clutch = device_scanner_.IsKeyPressed(KEY_A);
-
-    int right = device_scanner_.IsKeyPressed(KEY_RIGHT) ? 1 : 0;
-    int left = device_scanner_.IsKeyPressed(KEY_LEFT) ? 1 : 0;
-    int down = device_scanner_.IsKeyPressed(KEY_DOWN) ? 1 : 0;
-    int up = device_scanner_.IsKeyPressed(KEY_UP) ? 1 : 0;
+    const KeyBits keys = device_scanner_.SnapshotKeys();
+    int right = 0;
+    int left = 0;
+    int down = 0;
+    int up = 0;
+
+    ForEachSetBit(keys.words, [&](size_t key) {
+        InputAction action = keymap_.ActionForKey(key);
+        switch (action) {
+            case InputAction::None:
+                break;
+            case InputAction::Throttle:
+                snapshot.throttle = true;
+                break;
+            case InputAction::Brake:
+                snapshot.brake = true;
+                break;
+            case InputAction::Clutch:
+                snapshot.clutch = true;
+                break;
+            case InputAction::DpadUp:
+                up = 1;
+                break;
+            case InputAction::DpadDown:
+                down = 1;
+                break;
+            case InputAction::DpadLeft:
+                left = 1;
+                break;
+            case InputAction::DpadRight:
+                right = 1;
+                break;
+            default: {
+                size_t button = static_cast<size_t>(action) - static_cast<size_t>(InputAction::FirstButton);
+                snapshot.buttons.Set(button);
+                break;
+            }
+        }
+    });
+
     snapshot.dpad_x = static_cast<int8_t>(right - left);
     snapshot.dpad_y = static_cast<int8_t>(down - up);
-
-    auto set_button = [&](WheelButton button, bool pressed) {
-        snapshot.buttons[static_cast<size_t>(button)] = pressed ? 1 : 0;
-    };
-
-    set_button(WheelButton::South, device_scanner_.IsKeyPressed(KEY_Q));
-    set_button(WheelButton::East, device_scanner_.IsKeyPressed(KEY_E));
-    set_button(WheelButton::West, device_scanner_.IsKeyPressed(KEY_F));
-    set_button(WheelButton::North, device_scanner_.IsKeyPressed(KEY_G));
-    set_button(WheelButton::TL, device_scanner_.IsKeyPressed(KEY_H));
-    set_button(WheelButton::TR, device_scanner_.IsKeyPressed(KEY_R));
-    set_button(WheelButton::TL2, device_scanner_.IsKeyPressed(KEY_T));
-    set_button(WheelButton::TR2, device_scanner_.IsKeyPressed(KEY_Y));
-    set_button(WheelButton::Select, device_scanner_.IsKeyPressed(KEY_U));
-    set_button(WheelButton::Start, device_scanner_.IsKeyPressed(KEY_I));
-    set_button(WheelButton::ThumbL, device_scanner_.IsKeyPressed(KEY_O));
-    set_button(WheelButton::ThumbR, device_scanner_.IsKeyPressed(KEY_P));
-    set_button(WheelButton::Mode, device_scanner_.IsKeyPressed(KEY_1));
-    set_button(WheelButton::Dead, device_scanner_.IsKeyPressed(KEY_2));
-    set_button(WheelButton::TriggerHappy1, device_scanner_.IsKeyPressed(KEY_3));
-    set_button(WheelButton::TriggerHappy2, device_scanner_.IsKeyPressed(KEY_4));
-    set_button(WheelButton::TriggerHappy3, device_scanner_.IsKeyPressed(KEY_5));
-    set_button(WheelButton::TriggerHappy4, device_scanner_.IsKeyPressed(KEY_6));
-    set_button(WheelButton::TriggerHappy5, device_scanner_.IsKeyPressed(KEY_7));
-    set_button(WheelButton::TriggerHappy6, device_scanner_.IsKeyPressed(KEY_8));
-    set_button(WheelButton::TriggerHappy7, device_scanner_.IsKeyPressed(KEY_9));
-    set_button(WheelButton::TriggerHappy8, device_scanner_.IsKeyPressed(KEY_0));
-    set_button(WheelButton::TriggerHappy9, device_scanner_.IsKeyPressed(KEY_LEFTSHIFT));
-    set_button(WheelButton::TriggerHappy10, device_scanner_.IsKeyPressed(KEY_SPACE));
-    set_button(WheelButton::TriggerHappy11, device_scanner_.IsKeyPressed(KEY_TAB));
-    set_button(WheelButton::TriggerHappy12, device_scanner_.IsKeyPressed(KEY_ENTER));
+    device_scanner_.SnapshotAnalogPedals(snapshot.analog_pedals, snapshot.analog_mask);
     return snapshot;
 }
 
@@ -194,5 +279,9 @@ bool InputManager::ShouldEmitFrameLocked(int mouse_dx, bool toggle, const WheelI
     if (next_state.dpad_x != current_state_.dpad_x || next_state.dpad_y != current_state_.dpad_y) {
         return true;
     }
+    if (next_state.analog_mask != current_state_.analog_mask ||
+        next_state.analog_pedals != current_state_.analog_pedals) {
+        return true;
+    }
     return false;
 }
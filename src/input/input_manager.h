@@ -1,48 +1,89 @@
 #ifndef INPUT_MANAGER_H
 #define INPUT_MANAGER_H
 
+#include <array>
 #include <atomic>
-#include <condition_variable>
 #include <cstdint>
 #include <mutex>
 #include <string>
 #include <thread>
+#include <vector>
 
+#include "../spsc_ring.h"
+#include "../wake_signal.h"
 #include "device_scanner.h"
+#include "keymap.h"
 #include "wheel_input.h"
 
 class InputManager {
 public:
+    // Why WaitForFrame() was woken (WakeSignal reason bits)
+    enum FrameWake : uint32_t {
+        kFrameReady = 1u << 0,
+        kFrameStop = 1u << 1,
+    };
+    static constexpr std::array<const char*, WakeSignal::kMaxReasons> kFrameWakeNames = {"frame", "stop"};
+
     InputManager();
     ~InputManager();
 
+    // Must be called before Initialize(); the reader thread reads the keymap unlocked
+    void SetBindings(const std::vector<KeyBinding>& bindings);
+    void SetDeviceRoutes(const std::vector<DeviceRouteConfig>& routes, size_t seat = 0);
     bool Initialize(const std::string& keyboard_override, const std::string& mouse_override);
     void Shutdown();
 
     bool WaitForFrame(InputFrame& frame);
     bool TryGetFrame(InputFrame& frame);
 
+    // Event-loop runtime: no reader thread is started (call before Initialize());
+    // the owner waits on WakeHandle() and the Raw Input queue and calls PumpOnce()
+    void UseExternalPump();
+    // Makes the calling thread pump Raw Input for every seat
+    bool AttachPump();
+    // Signalled when input routed to this seat changed (a Win32 event HANDLE)
+    void* WakeHandle() const;
+    // One reader pass without waiting; true if a new frame is ready for TryGetFrame()
+    bool PumpOnce();
+
     bool GrabDevices(bool enable);
     bool AllRequiredGrabbed() const;
     void ResyncKeyStates();
     bool DevicesReady() const;
 
     WheelInputState LatestLogicalState() const;
+    // Headless runs inject input here, as the Raw Input backend does
+    DeviceScanner& Scanner() { return device_scanner_; }
+    WakeSignal::Stats FrameWakeStats() const { return frame_wake_.GetStats(); }
 
 private:
+    // bench/wheel.cpp times BuildLogicalState() directly
+    friend struct WheelBench;
+
     void ReaderLoop();
     WheelInputState BuildLogicalState();
     bool ShouldEmitFrameLocked(int mouse_dx, bool toggle, const WheelInputState& next_state) const;
+    bool PublishButtonEdges();
+    void TakeFrameLocked(InputFrame& frame);
+
+    static constexpr size_t kEdgeRingSize = 1024;
 
     DeviceScanner device_scanner_;
+    Keymap keymap_;
     std::thread reader_thread_;
     std::atomic<bool> reader_running_;
+    bool external_pump_;
     mutable std::mutex frame_mutex_;
-    std::condition_variable frame_cv_;
+    // Reader thread -> WaitForFrame(); frames published before the consumer runs share one wake
+    WakeSignal frame_wake_;
     InputFrame pending_frame_;
     WheelInputState current_state_;
     uint64_t frame_sequence_;
     uint64_t consumed_sequence_;
+    // Reader thread -> frame consumer
+    SpscRing<ButtonEdge, kEdgeRingSize> edge_ring_;
+    std::vector<KeyEdge> key_edge_scratch_;
+    uint64_t dropped_edges_;
 };
 
 #endif  // INPUT_MANAGER_H
@@ -0,0 +1,120 @@
+#include "keymap.h"
+
+#include <algorithm>
+#include <cctype>
+
+namespace {
+
+struct KeyNameEntry {
+    const char* name;
+    uint16_t key;
+};
+
+constexpr KeyNameEntry kKeyNames[] = {
+    {"ESC", KEY_ESC}, {"1", KEY_1}, {"2", KEY_2}, {"3", KEY_3}, {"4", KEY_4},
+    {"5", KEY_5}, {"6", KEY_6}, {"7", KEY_7}, {"8", KEY_8}, {"9", KEY_9},
+    {"0", KEY_0}, {"MINUS", KEY_MINUS}, {"EQUAL", KEY_EQUAL}, {"BACKSPACE", KEY_BACKSPACE},
+    {"TAB", KEY_TAB}, {"Q", KEY_Q}, {"W", KEY_W}, {"E", KEY_E}, {"R", KEY_R},
+    {"T", KEY_T}, {"Y", KEY_Y}, {"U", KEY_U}, {"I", KEY_I}, {"O", KEY_O},
+    {"P", KEY_P}, {"LEFTBRACE", KEY_LEFTBRACE}, {"RIGHTBRACE", KEY_RIGHTBRACE},
+    {"ENTER", KEY_ENTER}, {"LEFTCTRL", KEY_LEFTCTRL}, {"A", KEY_A}, {"S", KEY_S},
+    {"D", KEY_D}, {"F", KEY_F}, {"G", KEY_G}, {"H", KEY_H}, {"J", KEY_J},
+    {"K", KEY_K}, {"L", KEY_L}, {"SEMICOLON", KEY_SEMICOLON}, {"APOSTROPHE", KEY_APOSTROPHE},
+    {"GRAVE", KEY_GRAVE}, {"LEFTSHIFT", KEY_LEFTSHIFT}, {"BACKSLASH", KEY_BACKSLASH},
+    {"Z", KEY_Z}, {"X", KEY_X}, {"C", KEY_C}, {"V", KEY_V}, {"B", KEY_B},
+    {"N", KEY_N}, {"M", KEY_M}, {"COMMA", KEY_COMMA}, {"DOT", KEY_DOT},
+    {"SLASH", KEY_SLASH}, {"RIGHTSHIFT", KEY_RIGHTSHIFT}, {"KPASTERISK", KEY_KPASTERISK},
+    {"LEFTALT", KEY_LEFTALT}, {"SPACE", KEY_SPACE}, {"CAPSLOCK", KEY_CAPSLOCK},
+    {"F1", KEY_F1}, {"F2", KEY_F2}, {"F3", KEY_F3}, {"F4", KEY_F4}, {"F5", KEY_F5},
+    {"F6", KEY_F6}, {"F7", KEY_F7}, {"F8", KEY_F8}, {"F9", KEY_F9}, {"F10", KEY_F10},
+    {"F11", KEY_F11}, {"F12", KEY_F12}, {"RIGHTCTRL", KEY_RIGHTCTRL}, {"RIGHTALT", KEY_RIGHTALT},
+    {"UP", KEY_UP}, {"LEFT", KEY_LEFT}, {"RIGHT", KEY_RIGHT}, {"DOWN", KEY_DOWN},
+    {"LEFTMETA", KEY_LEFTMETA}, {"RIGHTMETA", KEY_RIGHTMETA},
+    {"MOUSE_LEFT", BTN_LEFT}, {"MOUSE_RIGHT", BTN_RIGHT}, {"MOUSE_MIDDLE", BTN_MIDDLE},
+};
+
+constexpr const char* kButtonPrefix = "button";
+
+std::string ToUpper(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+    return text;
+}
+
+}  // namespace
+
+std::vector<KeyBinding> DefaultKeyBindings() {
+    std::vector<KeyBinding> bindings;
+    for (const BindingSchemaEntry& entry : kBindingSchema) {
+        bindings.push_back({entry.action, entry.default_key});
+    }
+    return bindings;
+}
+
+bool ParseKeyName(const std::string& name, uint16_t& key) {
+    const std::string upper = ToUpper(name);
+    for (const KeyNameEntry& entry : kKeyNames) {
+        if (upper == entry.name) {
+            key = entry.key;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* KeyName(uint16_t key) {
+    for (const KeyNameEntry& entry : kKeyNames) {
+        if (entry.key == key) {
+            return entry.name;
+        }
+    }
+    return "NONE";
+}
+
+bool ParseActionName(const std::string& name, InputAction& action) {
+    for (const BindingSchemaEntry& entry : kBindingSchema) {
+        if (name == entry.name) {
+            action = entry.action;
+            return true;
+        }
+    }
+    // Any "buttonN" within the supported button count, bound or not by default
+    const std::string prefix = kButtonPrefix;
+    if (name.rfind(prefix, 0) != 0 || name.size() == prefix.size()) {
+        return false;
+    }
+    int number = 0;
+    for (size_t i = prefix.size(); i < name.size(); ++i) {
+        if (!std::isdigit(static_cast<unsigned char>(name[i])) || number > 1000) {
+            return false;
+        }
+        number = number * 10 + (name[i] - '0');
+    }
+    if (number < 1 || number > static_cast<int>(kMaxButtons)) {
+        return false;
+    }
+    action = ButtonAction(static_cast<size_t>(number - 1));
+    return true;
+}
+
+std::string ActionName(InputAction action) {
+    for (const BindingSchemaEntry& entry : kBindingSchema) {
+        if (entry.action == action) {
+            return entry.name;
+        }
+    }
+    if (action >= InputAction::FirstButton) {
+        int number = static_cast<int>(action) - static_cast<int>(InputAction::FirstButton) + 1;
+        return kButtonPrefix + std::to_string(number);
+    }
+    return "none";
+}
+
+void Keymap::Rebuild(const std::vector<KeyBinding>& bindings) {
+    actions_.fill(InputAction::None);
+    for (const KeyBinding& binding : bindings) {
+        if (binding.key < kKeyCodeCount) {
+            actions_[binding.key] = binding.action;
+        }
+    }
+}
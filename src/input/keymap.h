@@ -0,0 +1,136 @@
+#ifndef KEYMAP_H
+#define KEYMAP_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../input_defs.h"
+#include "../wheel_types.h"
+
+constexpr size_t kKeyCodeCount = KEY_MAX + 1;
+
+// Pressed state of every Linux keycode, one bit per key.
+struct KeyBits {
+    static constexpr size_t kWords = (kKeyCodeCount + 63) / 64;
+    std::array<uint64_t, kWords> words{};
+
+    bool Test(size_t key) const {
+        return key < kKeyCodeCount && ((words[key / 64] >> (key % 64)) & 1u);
+    }
+    void Set(size_t key, bool pressed) {
+        if (key >= kKeyCodeCount) return;
+        const uint64_t bit = uint64_t{1} << (key % 64);
+        if (pressed) words[key / 64] |= bit;
+        else words[key / 64] &= ~bit;
+    }
+};
+
+enum class InputAction : uint8_t {
+    None = 0,
+    Throttle,
+    Brake,
+    Clutch,
+    DpadUp,
+    DpadDown,
+    DpadLeft,
+    DpadRight,
+    FirstButton
+};
+
+constexpr InputAction ButtonAction(size_t index) {
+    return static_cast<InputAction>(static_cast<size_t>(InputAction::FirstButton) + index);
+}
+
+constexpr InputAction ButtonAction(WheelButton button) {
+    return ButtonAction(static_cast<size_t>(button));
+}
+
+static_assert(static_cast<size_t>(InputAction::FirstButton) + kMaxButtons <= 0xFF,
+              "button actions must fit in InputAction");
+
+struct KeyBinding {
+    InputAction action;
+    uint16_t key;
+};
+
+struct BindingSchemaEntry {
+    InputAction action;
+    const char* name;
+    uint16_t default_key;
+};
+
+// Config schema for [bindings]: action name and its default key.
+inline constexpr BindingSchemaEntry kBindingSchema[] = {
+    {InputAction::Throttle, "throttle", KEY_W},
+    {InputAction::Brake, "brake", KEY_S},
+    {InputAction::Clutch, "clutch", KEY_A},
+    {InputAction::DpadUp, "dpad_up", KEY_UP},
+    {InputAction::DpadDown, "dpad_down", KEY_DOWN},
+    {InputAction::DpadLeft, "dpad_left", KEY_LEFT},
+    {InputAction::DpadRight, "dpad_right", KEY_RIGHT},
+    {ButtonAction(WheelButton::South), "button1", KEY_Q},
+    {ButtonAction(WheelButton::East), "button2", KEY_E},
+    {ButtonAction(WheelButton::West), "button3", KEY_F},
+    {ButtonAction(WheelButton::North), "button4", KEY_G},
+    {ButtonAction(WheelButton::TL), "button5", KEY_H},
+    {ButtonAction(WheelButton::TR), "button6", KEY_R},
+    {ButtonAction(WheelButton::TL2), "button7", KEY_T},
+    {ButtonAction(WheelButton::TR2), "button8", KEY_Y},
+    {ButtonAction(WheelButton::Select), "button9", KEY_U},
+    {ButtonAction(WheelButton::Start), "button10", KEY_I},
+    {ButtonAction(WheelButton::ThumbL), "button11", KEY_O},
+    {ButtonAction(WheelButton::ThumbR), "button12", KEY_P},
+    {ButtonAction(WheelButton::Mode), "button13", KEY_1},
+    {ButtonAction(WheelButton::Dead), "button14", KEY_2},
+    {ButtonAction(WheelButton::TriggerHappy1), "button15", KEY_3},
+    {ButtonAction(WheelButton::TriggerHappy2), "button16", KEY_4},
+    {ButtonAction(WheelButton::TriggerHappy3), "button17", KEY_5},
+    {ButtonAction(WheelButton::TriggerHappy4), "button18", KEY_6},
+    {ButtonAction(WheelButton::TriggerHappy5), "button19", KEY_7},
+    {ButtonAction(WheelButton::TriggerHappy6), "button20", KEY_8},
+    {ButtonAction(WheelButton::TriggerHappy7), "button21", KEY_9},
+    {ButtonAction(WheelButton::TriggerHappy8), "button22", KEY_0},
+    {ButtonAction(WheelButton::TriggerHappy9), "button23", KEY_LEFTSHIFT},
+    {ButtonAction(WheelButton::TriggerHappy10), "button24", KEY_SPACE},
+    {ButtonAction(WheelButton::TriggerHappy11), "button25", KEY_TAB},
+    {ButtonAction(WheelButton::TriggerHappy12), "button26", KEY_ENTER},
+};
+
+using ActionTable = std::array<InputAction, kKeyCodeCount>;
+
+constexpr ActionTable BuildDefaultActionTable() {
+    ActionTable table{};
+    for (const BindingSchemaEntry& entry : kBindingSchema) {
+        table[entry.default_key] = entry.action;
+    }
+    return table;
+}
+
+inline constexpr ActionTable kDefaultActionTable = BuildDefaultActionTable();
+
+std::vector<KeyBinding> DefaultKeyBindings();
+bool ParseKeyName(const std::string& name, uint16_t& key);
+const char* KeyName(uint16_t key);
+bool ParseActionName(const std::string& name, InputAction& action);
+std::string ActionName(InputAction action);
+
+// Dense keycode -> action lookup. Starts from the constexpr defaults and is
+// rebuilt once at load time when the config overrides bindings.
+class Keymap {
+public:
+    Keymap() : actions_(kDefaultActionTable) {}
+
+    void Rebuild(const std::vector<KeyBinding>& bindings);
+
+    InputAction ActionForKey(size_t key) const {
+        return key < kKeyCodeCount ? actions_[key] : InputAction::None;
+    }
+
+private:
+    ActionTable actions_;
+};
+
+#endif  // KEYMAP_H
@@ -4,6 +4,7 @@
 #include <array>
 #include <chrono>
 #include <cstdint>
+#include <vector>
 
 #include "../wheel_types.h"
 
@@ -13,7 +14,18 @@ struct WheelInputState {
     bool clutch = false;
     int8_t dpad_x = 0;
     int8_t dpad_y = 0;
-    std::array<uint8_t, static_cast<size_t>(WheelButton::Count)> buttons{};
+    ButtonMask buttons;
+    // Pedal positions (0..1) from analog device routes; only pedals whose bit
+    // is set in analog_mask are routed.
+    std::array<float, kPedalCount> analog_pedals{};
+    uint8_t analog_mask = 0;
+};
+
+// Button transition captured at key-event time, independent of frame pacing
+struct ButtonEdge {
+    uint8_t button;
+    bool pressed;
+    std::chrono::steady_clock::time_point timestamp;
 };
 
 struct InputFrame {
@@ -21,6 +33,11 @@ struct InputFrame {
     int mouse_dx = 0;
     std::chrono::steady_clock::time_point timestamp;
     bool toggle_pressed = false;
+    // Trace flow from the reader to the report carrying this frame (0 = not traced)
+    uint64_t trace_flow = 0;
+    // Ordered button edges since the previous frame, so taps that begin and
+    // end between two frames still reach WheelDevice.
+    std::vector<ButtonEdge> edges;
 };
 
 #endif  // WHEEL_INPUT_H
@@ -2,16 +2,83 @@
 
 #include <algorithm>
 #include <atomic>
-#include <ctime>
-#include <iomanip>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../spsc_ring.h"
+#include "../thread_rings.h"
+#include "../tsc_clock.h"
+#include "../wake_signal.h"
 
 namespace logging {
 namespace {
+// Per-thread ring of encoded records; a power of two
+constexpr size_t kRingSize = size_t{1} << 16;
+// Per-thread staging for the record being built; a longer message is truncated
+constexpr size_t kStageSize = 4096;
+// After a batch the writer lets messages pile up this long, so a burst costs
+// the producers one atomic OR each instead of a wake per message
+constexpr auto kBatchInterval = std::chrono::milliseconds(2);
+constexpr uint32_t kWakeRecords = 1u << 0;
+constexpr const char* kTag = "logging";
+
+enum ArgType : uint8_t {
+    kArgBool,
+    kArgChar,
+    kArgSigned,
+    kArgUnsigned,
+    kArgDouble,
+    kArgString,
+    kArgPointer,
+    kArgTruncated
+};
+
+struct RecordHeader {
+    uint32_t size;  // header and arguments, rounded up to 8
+    uint32_t reserved;
+    const LogSite* site;
+    const char* tag;
+    uint64_t ticks;  // tsc::Now(), converted when drained
+};
+
+struct LogRing : SpscByteRing<kRingSize> {};
+
+struct PendingRecord {
+    int64_t time_ns;
+    size_t offset;
+};
+
+int64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
 std::atomic<int> g_log_level{0};
-std::mutex g_log_mutex;
-auto g_start_time = std::chrono::steady_clock::now();
+std::atomic<int64_t> g_start_ns{NowNs()};
+
+std::mutex g_mutex;  // thread rings, draining and output
+ThreadRings<LogRing> g_rings(g_mutex);
+std::vector<char> g_batch;
+std::vector<PendingRecord> g_pending;
+std::ostringstream g_line;
+uint64_t g_dropped_reported = 0;
+std::atomic<uint64_t> g_written{0};
+
+WakeSignal g_wake;
+std::thread g_writer;
+std::atomic<bool> g_writer_running{false};
+std::atomic<bool> g_stopping{false};
+bool g_atexit_registered = false;
+
+thread_local char t_stage[kStageSize];
+// Records under construction; one logged from inside another's arguments
+// gets a heap buffer
+thread_local int t_record_depth = 0;
 
 const char* LevelName(LogLevel level) {
     switch (level) {
@@ -26,11 +93,165 @@ const char* LevelName(LogLevel level) {
     }
     return "UNKNOWN";
 }
+
+template <typename T>
+T Load(const char* data) {
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
 }
 
+void FormatArgs(std::ostream& out, const char* data, const char* end) {
+    while (data < end) {
+        const uint8_t type = static_cast<uint8_t>(*data++);
+        switch (type) {
+            case kArgBool:
+                out << (*data++ != 0);
+                break;
+            case kArgChar:
+                out << *data++;
+                break;
+            case kArgSigned:
+                out << Load<long long>(data);
+                data += sizeof(long long);
+                break;
+            case kArgUnsigned:
+                out << Load<unsigned long long>(data);
+                data += sizeof(unsigned long long);
+                break;
+            case kArgDouble:
+                out << Load<double>(data);
+                data += sizeof(double);
+                break;
+            case kArgString: {
+                const uint32_t size = Load<uint32_t>(data);
+                data += sizeof(uint32_t);
+                out.write(data, size);
+                data += size;
+                break;
+            }
+            case kArgPointer:
+                out << reinterpret_cast<const void*>(Load<uintptr_t>(data));
+                data += sizeof(uintptr_t);
+                break;
+            case kArgTruncated:
+                out << "...";
+                return;
+            default:
+                return;
+        }
+    }
+}
+
+std::ostream& BeginLine(LogLevel level, int64_t time_ns, const char* tag) {
+    const int64_t since_start = (time_ns - g_start_ns.load(std::memory_order_relaxed)) / 1000000;
+    g_line.str(std::string());
+    g_line << '[' << since_start << "ms] " << LevelName(level) << ' ' << tag << ": ";
+    return g_line;
+}
+
+// `last` is the stream written before, flushed when output switches streams
+void EndLine(LogLevel level, std::ostream*& last) {
+    g_line << '\n';
+    std::ostream& out = (level == LogLevel::Error) ? std::cerr : std::cout;
+    if (last && last != &out) {
+        last->flush();
+    }
+    last = &out;
+    const std::string& line = g_line.str();
+    out.write(line.data(), static_cast<std::streamsize>(line.size()));
+    g_written.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Caller holds g_mutex. Prints every committed record in timestamp order.
+void DrainLocked() {
+    g_batch.clear();
+    g_pending.clear();
+    g_rings.DrainLocked([](LogRing& ring) {
+        size_t offset = g_batch.size();
+        ring.ReadAll(g_batch);
+        while (offset < g_batch.size()) {
+            const RecordHeader header = Load<RecordHeader>(g_batch.data() + offset);
+            g_pending.push_back({tsc::ToSteadyNanos(header.ticks), offset});
+            offset += header.size;
+        }
+    });
+    const uint64_t dropped = g_rings.DroppedLocked();
+    if (g_pending.empty() && dropped == g_dropped_reported) {
+        return;
+    }
+
+    // Each ring is already in order; this interleaves the threads
+    std::stable_sort(g_pending.begin(), g_pending.end(),
+                     [](const PendingRecord& a, const PendingRecord& b) { return a.time_ns < b.time_ns; });
+    std::ostream* last = nullptr;
+    for (const PendingRecord& pending : g_pending) {
+        const char* record = g_batch.data() + pending.offset;
+        const RecordHeader header = Load<RecordHeader>(record);
+        const LogLevel level = header.site->level;
+        FormatArgs(BeginLine(level, pending.time_ns, header.tag), record + sizeof(RecordHeader),
+                   record + header.size);
+        EndLine(level, last);
+    }
+    if (dropped != g_dropped_reported) {
+        BeginLine(LogLevel::Warn, NowNs(), kTag)
+            << (dropped - g_dropped_reported) << " log message(s) dropped, log ring full";
+        EndLine(LogLevel::Warn, last);
+        g_dropped_reported = dropped;
+    }
+    std::cout.flush();
+    std::cerr.flush();
+}
+
+void WriterLoop() {
+    while (true) {
+        g_wake.Wait();
+        const bool stopping = g_stopping.load(std::memory_order_acquire);
+        {
+            std::lock_guard<std::mutex> lock(g_mutex);
+            DrainLocked();
+        }
+        if (stopping) {
+            return;
+        }
+        std::this_thread::sleep_for(kBatchInterval);
+    }
+}
+
+void Commit(const char* record, size_t size) {
+    auto* local = g_rings.Local();
+    if (!local || !local->ring.TryWrite(record, size)) {
+        g_rings.CountDrop(local);
+    }
+    if (g_writer_running.load(std::memory_order_acquire)) {
+        g_wake.Signal(kWakeRecords);
+    } else {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        DrainLocked();
+    }
+}
+
+constexpr LogSite kMessageSites[] = {
+    {LogLevel::Error, __FILE__, __LINE__},
+    {LogLevel::Warn, __FILE__, __LINE__},
+    {LogLevel::Info, __FILE__, __LINE__},
+    {LogLevel::Debug, __FILE__, __LINE__},
+};
+}  // namespace
+
 void InitLogger(int level) {
-    g_start_time = std::chrono::steady_clock::now();
+    g_start_ns.store(NowNs(), std::memory_order_relaxed);
     SetLogLevel(level);
+    if (g_writer_running.load(std::memory_order_acquire)) {
+        return;
+    }
+    g_stopping.store(false, std::memory_order_relaxed);
+    g_writer = std::thread(WriterLoop);
+    g_writer_running.store(true, std::memory_order_release);
+    if (!g_atexit_registered) {
+        g_atexit_registered = true;
+        std::atexit(ShutdownLogger);
+    }
 }
 
 void SetLogLevel(int level) {
@@ -50,12 +271,187 @@ void LogMessage(LogLevel level, const char* tag, const std::string& message) {
     if (!ShouldLog(level)) {
         return;
     }
-    auto now = std::chrono::steady_clock::now();
-    auto since_start = std::chrono::duration_cast<std::chrono::milliseconds>(now - g_start_time).count();
+    LogRecord(kMessageSites[static_cast<int>(level)], tag) << message;
+}
 
-    std::lock_guard<std::mutex> lock(g_log_mutex);
-    std::ostream& out = (level == LogLevel::Error) ? std::cerr : std::cout;
-    out << '[' << since_start << "ms] " << LevelName(level) << ' ' << tag << ": " << message << std::endl;
+void FlushLogs() {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    DrainLocked();
+}
+
+void ShutdownLogger() {
+    if (!g_writer_running.exchange(false, std::memory_order_acq_rel)) {
+        return;
+    }
+    g_stopping.store(true, std::memory_order_release);
+    g_wake.Signal(kWakeRecords);
+    g_writer.join();
+    FlushLogs();
+}
+
+LogStats GetLogStats() {
+    LogStats stats;
+    std::lock_guard<std::mutex> lock(g_mutex);
+    stats.written = g_written.load(std::memory_order_relaxed);
+    stats.dropped = g_rings.DroppedLocked();
+    return stats;
+}
+
+LogRecord::LogRecord(const LogSite& site, const char* tag)
+    : buffer_(t_record_depth++ == 0 ? t_stage : new char[kStageSize]),
+      size_(sizeof(RecordHeader)),
+      capacity_(kStageSize),
+      formatting_(false) {
+    RecordHeader header{};
+    header.site = &site;
+    header.tag = tag;
+    header.ticks = tsc::Now();
+    std::memcpy(buffer_, &header, sizeof(header));
+}
+
+LogRecord::~LogRecord() {
+    // Rounded up so headers in the ring stay 8-byte aligned; kStageSize is
+    // a multiple of 8 and padding bytes end the argument list
+    const size_t size = (size_ + 7) & ~size_t{7};
+    std::memset(buffer_ + size_, 0xFF, size - size_);
+    const uint32_t stored = static_cast<uint32_t>(size);
+    std::memcpy(buffer_, &stored, sizeof(stored));
+    Commit(buffer_, size);
+    if (--t_record_depth != 0) {
+        delete[] buffer_;
+    }
+}
+
+void LogRecord::Truncate() {
+    // Every Put leaves the byte for this free
+    if (size_ < capacity_) {
+        buffer_[size_++] = static_cast<char>(kArgTruncated);
+    }
+    capacity_ = size_;
+}
+
+void LogRecord::Put(uint8_t type, const void* data, size_t size) {
+    if (size_ + 1 + size + 1 > capacity_) {
+        Truncate();
+        return;
+    }
+    buffer_[size_++] = static_cast<char>(type);
+    std::memcpy(buffer_ + size_, data, size);
+    size_ += size;
+}
+
+std::ostringstream& LogRecord::FormatStream() {
+    if (!format_) {
+        format_ = std::make_unique<std::ostringstream>();
+    }
+    return *format_;
+}
+
+LogRecord& LogRecord::PutFormatted() {
+    const std::string text = format_->str();
+    // Clears the text only; flags, precision and fill stay for the next argument
+    format_->str(std::string());
+    if (!text.empty()) {
+        PutString(text.data(), text.size());
+    }
+    return *this;
+}
+
+LogRecord& LogRecord::PutSigned(long long value) {
+    Put(kArgSigned, &value, sizeof(value));
+    return *this;
+}
+
+LogRecord& LogRecord::PutUnsigned(unsigned long long value) {
+    Put(kArgUnsigned, &value, sizeof(value));
+    return *this;
+}
+
+LogRecord& LogRecord::PutString(const char* data, size_t size) {
+    const size_t overhead = 1 + sizeof(uint32_t) + 1;
+    const size_t room = capacity_ > size_ + overhead ? capacity_ - size_ - overhead : 0;
+    const uint32_t kept = static_cast<uint32_t>(std::min(size, room));
+    if (kept > 0 || size == 0) {
+        buffer_[size_++] = static_cast<char>(kArgString);
+        std::memcpy(buffer_ + size_, &kept, sizeof(kept));
+        size_ += sizeof(kept);
+        std::memcpy(buffer_ + size_, data, kept);
+        size_ += kept;
+    }
+    if (kept < size) {
+        Truncate();
+    }
+    return *this;
+}
+
+LogRecord& LogRecord::operator<<(bool value) {
+    if (formatting_) {
+        return Format(value);
+    }
+    const char byte = value ? 1 : 0;
+    Put(kArgBool, &byte, 1);
+    return *this;
+}
+
+LogRecord& LogRecord::operator<<(char value) {
+    if (formatting_) {
+        return Format(value);
+    }
+    Put(kArgChar, &value, 1);
+    return *this;
+}
+
+LogRecord& LogRecord::operator<<(double value) {
+    if (formatting_) {
+        return Format(value);
+    }
+    Put(kArgDouble, &value, sizeof(value));
+    return *this;
+}
+
+LogRecord& LogRecord::operator<<(const char* value) {
+    if (!value) {
+        return formatting_ ? Format("(null)") : PutString("(null)", 6);
+    }
+    return formatting_ ? Format(value) : PutString(value, std::strlen(value));
+}
+
+LogRecord& LogRecord::operator<<(const std::string& value) {
+    return formatting_ ? Format(value) : PutString(value.data(), value.size());
+}
+
+LogRecord& LogRecord::operator<<(const void* value) {
+    if (formatting_) {
+        return Format(value);
+    }
+    const uintptr_t address = reinterpret_cast<uintptr_t>(value);
+    Put(kArgPointer, &address, sizeof(address));
+    return *this;
+}
+
+LogRecord& LogRecord::operator<<(std::ios_base& (*manipulator)(std::ios_base&)) {
+    formatting_ = true;
+    manipulator(FormatStream());
+    return *this;
+}
+
+LogRecord& LogRecord::operator<<(std::ostream& (*manipulator)(std::ostream&)) {
+    formatting_ = true;
+    manipulator(FormatStream());
+    return PutFormatted();
+}
+
+bool RateLimit::Allow(std::chrono::milliseconds interval, uint64_t& suppressed) {
+    const int64_t now = NowNs();
+    int64_t next = next_ns_.load(std::memory_order_relaxed);
+    if (now < next || !next_ns_.compare_exchange_strong(
+                          next, now + std::chrono::duration_cast<std::chrono::nanoseconds>(interval).count(),
+                          std::memory_order_relaxed)) {
+        suppressed_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    suppressed = suppressed_.exchange(0, std::memory_order_relaxed);
+    return true;
 }
 
 ScopedLogTimer::ScopedLogTimer(const char* tag, const char* label, LogLevel level)
@@ -67,7 +463,7 @@ ScopedLogTimer::~ScopedLogTimer() {
     }
     auto end = std::chrono::steady_clock::now();
     auto duration_us = std::chrono::duration_cast<std::chrono::microseconds>(end - start_).count();
-    LogMessage(level_, tag_, std::string(label_) + " took " + std::to_string(duration_us) + "us");
+    LogRecord(kMessageSites[static_cast<int>(level_)], tag_) << label_ << " took " << duration_us << "us";
 }
 
 }  // namespace logging
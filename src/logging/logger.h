@@ -1,10 +1,27 @@
 #ifndef LOGGER_H
 #define LOGGER_H
 
+#include <atomic>
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ios>
+#include <memory>
+#include <ostream>
 #include <sstream>
 #include <string>
 
+// Most verbose level compiled in: 0 errors, 1 warnings, 2 info, 3 debug.
+// LOG_* calls above it are discarded at compile time.
+#ifndef WHEEL_LOG_COMPILED_LEVEL
+#define WHEEL_LOG_COMPILED_LEVEL 3
+#endif
+
+// LOG_* calls do no formatting and take no lock: the arguments are encoded
+// in binary next to a pointer to the call site and pushed into the calling
+// thread's ring. A writer thread (started by InitLogger) formats and prints
+// them in timestamp order. A full ring drops the message and counts it
+// rather than blocking the caller. Without a writer thread the caller prints.
 namespace logging {
 
 enum class LogLevel : int {
@@ -14,11 +31,121 @@ enum class LogLevel : int {
     Debug = 3
 };
 
+constexpr bool Compiled(LogLevel level) {
+    return static_cast<int>(level) <= WHEEL_LOG_COMPILED_LEVEL;
+}
+
+// Also starts the writer thread; messages still queued at exit are printed
 void InitLogger(int level);
 void SetLogLevel(int level);
 int GetLogLevel();
 bool ShouldLog(LogLevel level);
 void LogMessage(LogLevel level, const char* tag, const std::string& message);
+// Prints everything queued so far before returning
+void FlushLogs();
+// Flushes and stops the writer thread; later messages are printed by the caller
+void ShutdownLogger();
+
+struct LogStats {
+    uint64_t written = 0;
+    // Ring full when the message was logged
+    uint64_t dropped = 0;
+};
+LogStats GetLogStats();
+
+// One per LOG_* call site, static
+struct LogSite {
+    LogLevel level;
+    const char* file;
+    int line;
+};
+
+// Encodes one message; pushed to the thread's ring when destroyed. `tag`
+// must have static storage (a literal or a kTag constant).
+class LogRecord {
+public:
+    LogRecord(const LogSite& site, const char* tag);
+    ~LogRecord();
+    LogRecord(const LogRecord&) = delete;
+    LogRecord& operator=(const LogRecord&) = delete;
+
+    LogRecord& operator<<(bool value);
+    LogRecord& operator<<(char value);
+    LogRecord& operator<<(signed char value) { return *this << static_cast<char>(value); }
+    LogRecord& operator<<(unsigned char value) { return *this << static_cast<char>(value); }
+    LogRecord& operator<<(short value) { return formatting_ ? Format(value) : PutSigned(value); }
+    LogRecord& operator<<(int value) { return formatting_ ? Format(value) : PutSigned(value); }
+    LogRecord& operator<<(long value) { return formatting_ ? Format(value) : PutSigned(value); }
+    LogRecord& operator<<(long long value) { return formatting_ ? Format(value) : PutSigned(value); }
+    LogRecord& operator<<(unsigned short value) { return formatting_ ? Format(value) : PutUnsigned(value); }
+    LogRecord& operator<<(unsigned int value) { return formatting_ ? Format(value) : PutUnsigned(value); }
+    LogRecord& operator<<(unsigned long value) { return formatting_ ? Format(value) : PutUnsigned(value); }
+    LogRecord& operator<<(unsigned long long value) { return formatting_ ? Format(value) : PutUnsigned(value); }
+    LogRecord& operator<<(float value) { return formatting_ ? Format(value) : *this << static_cast<double>(value); }
+    LogRecord& operator<<(double value);
+    LogRecord& operator<<(long double value) {
+        return formatting_ ? Format(value) : *this << static_cast<double>(value);
+    }
+    LogRecord& operator<<(const char* value);
+    LogRecord& operator<<(char* value) { return *this << static_cast<const char*>(value); }
+    LogRecord& operator<<(const std::string& value);
+    LogRecord& operator<<(const void* value);
+
+    // Manipulators (std::hex, std::fixed, std::endl, ...) switch the rest of
+    // the message to formatting on the caller, through one ostringstream, so
+    // they apply as they would on an ostream
+    LogRecord& operator<<(std::ios_base& (*manipulator)(std::ios_base&));
+    LogRecord& operator<<(std::ostream& (*manipulator)(std::ostream&));
+
+    // Anything else an ostream prints is formatted here, on the caller. A
+    // value that prints nothing is taken for a manipulator (std::setprecision,
+    // std::setw, ...) and switches the rest of the message over as above.
+    template <typename T>
+    LogRecord& operator<<(const T& value) {
+        std::ostringstream& out = FormatStream();
+        out << value;
+        if (out.tellp() == 0) {
+            formatting_ = true;
+        }
+        return PutFormatted();
+    }
+
+private:
+    LogRecord& PutSigned(long long value);
+    LogRecord& PutUnsigned(unsigned long long value);
+    LogRecord& PutString(const char* data, size_t size);
+    void Put(uint8_t type, const void* data, size_t size);
+    // Ends the message with "..."; later arguments are ignored
+    void Truncate();
+    // Created on first use; keeps the manipulators' state across arguments
+    std::ostringstream& FormatStream();
+    // Moves what FormatStream() holds into the record as a string
+    LogRecord& PutFormatted();
+    template <typename T>
+    LogRecord& Format(const T& value) {
+        FormatStream() << value;
+        return PutFormatted();
+    }
+
+    char* buffer_;
+    size_t size_;
+    size_t capacity_;
+    std::unique_ptr<std::ostringstream> format_;
+    // A manipulator was applied: every later argument goes through format_
+    bool formatting_;
+};
+
+// Lets one message through per interval; the next one that passes reports
+// how many were suppressed in between
+class RateLimit {
+public:
+    // True if the caller may log now; `suppressed` is the count since the last pass
+    bool Allow(std::chrono::milliseconds interval, uint64_t& suppressed);
+
+private:
+    std::atomic<int64_t> next_ns_{0};
+    std::atomic<uint64_t> suppressed_{0};
+};
 
 class ScopedLogTimer {
 public:
@@ -35,12 +162,33 @@ private:
 
 }  // namespace logging
 
+// `tag` is kept as a pointer and read later by the writer thread, so it must
+// have static storage: a literal or a kTag constant, never a c_str().
 #define LOG_STREAM(level, tag, stream_expr)                                      \
     do {                                                                         \
-        if (::logging::ShouldLog(level)) {                                       \
-            std::ostringstream log_stream__;                                     \
-            log_stream__ << stream_expr;                                         \
-            ::logging::LogMessage(level, tag, log_stream__.str());               \
+        if constexpr (::logging::Compiled(level)) {                              \
+            if (::logging::ShouldLog(level)) {                                   \
+                static constexpr ::logging::LogSite log_site__{level, __FILE__, __LINE__}; \
+                ::logging::LogRecord(log_site__, tag) << stream_expr;            \
+            }                                                                    \
+        }                                                                        \
+    } while (0)
+
+// For messages a hot path can repeat: at most one per `interval_ms` per call site
+#define LOG_RATE_LIMITED(level, tag, interval_ms, stream_expr)                   \
+    do {                                                                         \
+        if constexpr (::logging::Compiled(level)) {                              \
+            static ::logging::RateLimit log_limit__;                             \
+            uint64_t log_suppressed__ = 0;                                       \
+            if (::logging::ShouldLog(level) &&                                   \
+                log_limit__.Allow(std::chrono::milliseconds(interval_ms), log_suppressed__)) { \
+                static constexpr ::logging::LogSite log_site__{level, __FILE__, __LINE__}; \
+                ::logging::LogRecord log_record__(log_site__, tag);              \
+                log_record__ << stream_expr;                                     \
+                if (log_suppressed__ != 0) {                                     \
+                    log_record__ << " (" << log_suppressed__ << " similar suppressed)"; \
+                }                                                                \
+            }                                                                    \
         }                                                                        \
     } while (0)
 
@@ -1,12 +1,26 @@
 #include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <cstring>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <thread>
 #include <vector>
 
 #include "config.h"
+#include "event_loop.h"
+#include "flight_recorder.h"
+#include "metrics.h"
+#include "physics_scheduler.h"
+#include "precise_timer.h"
+#include "session_recorder.h"
+#include "shared_stats.h"
+#include "signal_scope.h"
+#include "thread_tuning.h"
+#include "trace.h"
+#include "tsc_clock.h"
+#include "wake_signal.h"
 #include "wheel_device.h"
 #include "input/input_manager.h"
 #include "logging/logger.h"
@@ -15,16 +29,41 @@
 #include <windows.h>
 #include <mmsystem.h>
 
+struct Seat {
+    size_t index = 0;
+    WheelDevice wheel_device;
+    InputManager input_manager;
+};
+
 int ParseLogLevelFromArgs(int argc, char* argv[]);
+void RunSeatLoop(Seat& seat, const Config& config);
+void HandleSeatFrame(Seat& seat, const InputFrame& frame, const Config& config);
+void RunEventLoop(std::vector<std::unique_ptr<Seat>>& seats, const Config& config,
+                  std::chrono::microseconds period, const PreciseTimer& timer);
+void LogWakeStats(const std::vector<std::unique_ptr<Seat>>& seats, const PhysicsScheduler::Stats& physics);
+void LogMetrics(const metrics::Snapshot& snapshot, std::chrono::steady_clock::duration window);
+void RunMetricsThread(WakeSignal& stop, std::chrono::seconds log_interval, shared_stats::SharedStats& shared);
 
 std::atomic<bool> running{true};
 
 // Windows Console Control Handler
 BOOL WINAPI CtrlHandler(DWORD fdwCtrlType) {
     switch (fdwCtrlType) {
+    case CTRL_BREAK_EVENT:
+        if (trace::Enabled()) {
+            // Snapshot the trace and keep running
+            trace::Flush();
+            return TRUE;
+        }
+        running.store(false, std::memory_order_relaxed);
+        return TRUE;
     case CTRL_C_EVENT:
+        if (flight::Dump()) {
+            LOG_INFO("main", "Flight recorder written to " << flight::DumpPath());
+        }
+        running.store(false, std::memory_order_relaxed);
+        return TRUE;
     case CTRL_CLOSE_EVENT:
-    case CTRL_BREAK_EVENT:
     case CTRL_LOGOFF_EVENT:
     case CTRL_SHUTDOWN_EVENT:
         running.store(false, std::memory_order_relaxed);
@@ -35,12 +74,13 @@ BOOL WINAPI CtrlHandler(DWORD fdwCtrlType) {
 }
 
 int main(int argc, char* argv[]) {
-    // CRITICAL: Set timer resolution to 1ms for Physics Loop
-    timeBeginPeriod(1);
-
+    const auto start_time = std::chrono::steady_clock::now();
+    // Before any thread takes a timestamp
+    tsc::Init();
     int log_level = ParseLogLevelFromArgs(argc, argv);
     logging::InitLogger(log_level);
     LOG_INFO("main", "Starting wheel emulator (Windows vJoy version) (log level=" << log_level << ")");
+    LOG_INFO("main", tsc::Describe());
 
     if (!SetConsoleCtrlHandler(CtrlHandler, TRUE)) {
         LOG_ERROR("main", "Could not set control handler"); 
@@ -50,59 +90,315 @@ int main(int argc, char* argv[]) {
     // Load configuration
     Config config;
     config.Load();
+    flight::Install(config.flight_file.c_str());
 
-    WheelDevice wheel_device;
-    wheel_device.SetFFBGain(config.ffb_gain);
-    if (!wheel_device.Create()) {
-        std::cerr << "Failed to create virtual wheel device (vJoy issue?)" << std::endl;
+    // Deadline timer shared by the physics pool and the report threads
+    const std::chrono::microseconds physics_period(1000000 / config.threading.physics_hz);
+    PreciseTimer timer;
+    timer.Configure(config.threading.timer_mode, std::chrono::microseconds(config.threading.spin_margin_us),
+                    physics_period);
+    if (config.threading.timer_mode == PreciseTimer::Mode::Hybrid && config.threading.spin_margin_us == 0) {
+        // Measured at the 1 ms resolution each WheelDevice holds while enabled
+        timeBeginPeriod(1);
+        timer.Calibrate(physics_period);
         timeEndPeriod(1);
-        return 1;
     }
+    LOG_INFO("main", "Timer: " << timer.Describe() << ", physics at " << config.threading.physics_hz << " Hz");
 
-    InputManager input_manager;
-    if (!input_manager.Initialize("", "")) {
-        std::cerr << "Failed to initialize input manager" << std::endl;
-        timeEndPeriod(1);
-        return 1;
+    if (!config.trace_file.empty()) {
+        trace::Start(config.trace_file);
+    }
+    if (!config.record_file.empty()) {
+        session::Start(config.record_file, physics_period, config.seats.size());
+    }
+    if (!config.scope_file.empty()) {
+        scope::Start(config.scope_file);
+    }
+    shared_stats::SharedStats shared;
+    if (config.shared_stats) {
+        shared.Create(config.shared_stats_name.empty() ? shared_stats::kDefaultName : config.shared_stats_name,
+                      config.seats.size());
     }
 
+    // One pipeline per seat: input routing, wheel state and vJoy output.
+    // Physics for every seat shares one worker pool, or everything runs on
+    // the main thread with [threading] runtime=eventloop.
+    const bool event_loop = config.threading.event_loop;
+    PhysicsScheduler physics;
+    std::vector<std::unique_ptr<Seat>> seats;
+    for (size_t i = 0; i < config.seats.size(); ++i) {
+        auto seat = std::make_unique<Seat>();
+        seat->index = i;
+        WheelDevice& wheel_device = seat->wheel_device;
+        wheel_device.SetVJoyId(static_cast<unsigned int>(config.seats[i].vjoy_id));
+        wheel_device.SetFFBGain(config.ffb_gain);
+        wheel_device.SetPedalRamps(config.throttle_ramp, config.brake_ramp, config.clutch_ramp);
+        wheel_device.SetMinButtonPulse(config.button_min_pulse_ms);
+        wheel_device.SetThreading(config.threading);
+        wheel_device.SetTimer(timer);
+        wheel_device.SetStateExport(shared.SeatSlot(i));
+        if (!wheel_device.Create()) {
+            logging::FlushLogs();
+            std::cerr << "Failed to create virtual wheel device for seat " << (i + 1) << " (vJoy issue?)"
+                      << std::endl;
+            return 1;
+        }
+        if (event_loop) {
+            wheel_device.UseExternalReportLoop();
+        } else {
+            wheel_device.AttachPhysics(physics);
+        }
+        seats.push_back(std::move(seat));
+    }
+
+    for (auto& seat : seats) {
+        InputManager& input_manager = seat->input_manager;
+        input_manager.SetBindings(config.bindings);
+        input_manager.SetDeviceRoutes(config.device_routes, seat->index);
+        if (event_loop) {
+            input_manager.UseExternalPump();
+        }
+        if (!input_manager.Initialize("", "")) {
+            logging::FlushLogs();
+            std::cerr << "Failed to initialize input manager" << std::endl;
+            running.store(false, std::memory_order_relaxed);
+            for (auto& other : seats) {
+                other->input_manager.Shutdown();
+            }
+            return 1;
+        }
+    }
+
+    if (!event_loop) {
+        physics.SetThreading(config.threading);
+        physics.SetTimer(timer);
+        physics.Start(static_cast<size_t>(config.physics_workers), physics_period);
+        if (seats.size() > 1) {
+            LOG_INFO("main", seats.size() << " seats, physics on " << physics.WorkerCount() << " worker(s)");
+        }
+    }
+
+    logging::FlushLogs();
     std::cout << "All systems ready. Press Ctrl+M to enable." << std::endl;
     // Force enable on start for testing if desired? No, stick to toggle.
 
+    WakeSignal metrics_stop;
+    std::thread metrics_thread;
+    if (config.metrics_interval_s > 0 || shared.IsOpen()) {
+        metrics_thread = std::thread(RunMetricsThread, std::ref(metrics_stop),
+                                     std::chrono::seconds(config.metrics_interval_s), std::ref(shared));
+    }
+
+    std::vector<std::thread> seat_threads;
+    if (event_loop) {
+        RunEventLoop(seats, config, physics_period, timer);
+    } else {
+        // Seat 1 runs on the main thread, the others on their own
+        for (size_t i = 1; i < seats.size(); ++i) {
+            seat_threads.emplace_back(RunSeatLoop, std::ref(*seats[i]), std::cref(config));
+        }
+        RunSeatLoop(*seats[0], config);
+    }
+
+    running.store(false, std::memory_order_relaxed);
+    for (auto& seat : seats) {
+        seat->wheel_device.SetEnabled(false, seat->input_manager);
+        if (event_loop) {
+            // No report thread: send the final neutral report here
+            seat->wheel_device.ServiceReports(std::chrono::steady_clock::now());
+        }
+        seat->wheel_device.WakeForShutdown();
+        seat->input_manager.Shutdown();
+    }
+    for (std::thread& thread : seat_threads) {
+        thread.join();
+    }
+    physics.Stop();
+    for (auto& seat : seats) {
+        seat->wheel_device.ShutdownThreads();
+    }
+
+    const PhysicsScheduler::Stats stats = physics.TotalStats();
+    if (stats.ticks > 0) {
+        LOG_INFO("main", "Physics: " << seats.size() << " seat(s) on " << physics.WorkerCount() << " worker(s), "
+                 << stats.ticks << " ticks (" << stats.early_ticks << " early), avg "
+                 << (stats.busy_ns / stats.ticks) << " ns/tick, parked at rest " << stats.rest_parks << " times");
+    }
+    if (config.threading.jitter_report && stats.ticks > 0) {
+        LOG_INFO("main", PhysicsScheduler::FormatJitter(stats, physics_period));
+    }
+    LogWakeStats(seats, stats);
+    if (metrics_thread.joinable()) {
+        metrics_stop.Signal(1);
+        metrics_thread.join();
+    }
+    LogMetrics(metrics::Collect(), std::chrono::steady_clock::now() - start_time);
+    trace::Stop();
+    session::Stop();
+    scope::Stop();
+
+    return 0;
+}
+
+void RunSeatLoop(Seat& seat, const Config& config) {
+    InputManager& input_manager = seat.input_manager;
+    // Only takes frames: Raw Input for every seat is pumped by whichever
+    // seat's reader thread first called DeviceScanner::AttachBackend()
+    ScopedThreadTuning tuning(config.threading, ThreadRole::Input);
+    trace::SetThreadName("seat loop");
     InputFrame frame;
     while (running) {
         if (!input_manager.WaitForFrame(frame)) {
             if (!running) break;
             continue;
         }
+        HandleSeatFrame(seat, frame, config);
+    }
+}
 
-        if (wheel_device.IsEnabled() && !input_manager.AllRequiredGrabbed()) {
-             // On Windows, losing focus might not mean losing device, but strict grab logic applies
-            std::cerr << "Required input device lost; disabling emulator" << std::endl;
-            wheel_device.SetEnabled(false, input_manager);
-            continue;
+void HandleSeatFrame(Seat& seat, const InputFrame& frame, const Config& config) {
+    WheelDevice& wheel_device = seat.wheel_device;
+    InputManager& input_manager = seat.input_manager;
+
+    if (wheel_device.IsEnabled() && !input_manager.AllRequiredGrabbed()) {
+         // On Windows, losing focus might not mean losing device, but strict grab logic applies
+        std::cerr << "Required input device lost; disabling emulator" << std::endl;
+        wheel_device.SetEnabled(false, input_manager);
+        return;
+    }
+
+    if (frame.toggle_pressed) {
+        if (!input_manager.DevicesReady()) {
+            LOG_WARN("main", "Toggle pressed before devices ready; ignoring request");
+        } else {
+            wheel_device.ToggleEnabled(input_manager);
         }
+    }
+
+    if (wheel_device.IsEnabled()) {
+        wheel_device.ProcessInputFrame(frame, config.sensitivity);
+    }
+}
+
+// Every seat's Raw Input pump, physics tick and vJoy reports on the calling
+// thread: no reader, seat, report or physics threads and no hand-offs
+// between them. Only the vJoy FFB callback still arrives on the driver's
+// thread; it signals the loop for an early physics tick.
+void RunEventLoop(std::vector<std::unique_ptr<Seat>>& seats, const Config& config,
+                  std::chrono::microseconds period, const PreciseTimer& timer) {
+    using Clock = EventLoop::Clock;
+    ScopedThreadTuning tuning(config.threading, ThreadRole::Physics);
+    trace::SetThreadName("event loop");
+    EventLoop loop;
+    if (!loop.Init() || !seats[0]->input_manager.AttachPump()) {
+        LOG_ERROR("main", "Event loop: failed to set up timers or the Raw Input window");
+        return;
+    }
+    loop.SetTimer(timer);
 
-        if (frame.toggle_pressed) {
-            if (!input_manager.DevicesReady()) {
-                LOG_WARN("main", "Toggle pressed before devices ready; ignoring request");
-            } else {
-                wheel_device.ToggleEnabled(input_manager);
+    const Clock::time_point start = loop.Now();
+    std::vector<size_t> report_timers;
+    for (auto& seat : seats) {
+        WheelDevice& wheel_device = seat->wheel_device;
+        const size_t physics_timer = loop.AddTimer(
+            start + period, [&wheel_device, period, next = start + period](Clock::time_point now) mutable {
+                if (!wheel_device.PhysicsTick(now)) {
+                    return Clock::time_point::max();  // at rest: parked until the physics wake
+                }
+                next += period;
+                if (next <= now) {
+                    next = now + period;
+                }
+                return next;
+            });
+        // FFB packets, and input reaching a wheel at rest, tick now and resume the period
+        size_t ffb_signal = loop.AddSignal([&loop, &wheel_device, physics_timer, period] {
+            const Clock::time_point now = loop.Now();
+            if (wheel_device.PhysicsTick(now) && !loop.TimerArmed(physics_timer)) {
+                loop.ArmTimer(physics_timer, now + period);
             }
-        }
+        });
+        wheel_device.SetPhysicsWake([&loop, ffb_signal] { loop.Signal(ffb_signal); });
+        report_timers.push_back(loop.AddTimer(Clock::time_point::max(), [&wheel_device](Clock::time_point now) {
+            return wheel_device.ServiceReports(now);
+        }));
+    }
 
-        if (wheel_device.IsEnabled()) {
-            wheel_device.ProcessInputFrame(frame, config.sensitivity);
+    // Raw Input for all seats lands in this thread's queue
+    InputFrame frame;
+    loop.SetMessageHandler([&] {
+        for (auto& seat : seats) {
+            seat->input_manager.PumpOnce();
+            // Our own updates signal the seat's wake event; nobody waits on it here
+            ResetEvent(static_cast<HANDLE>(seat->input_manager.WakeHandle()));
+            if (seat->input_manager.TryGetFrame(frame)) {
+                HandleSeatFrame(*seat, frame, config);
+            }
+        }
+    });
+    // Input or physics changed a seat: report now, then at its next pulse deadline
+    loop.SetIdleHandler([&] {
+        const Clock::time_point now = loop.Now();
+        for (size_t i = 0; i < seats.size(); ++i) {
+            loop.ArmTimer(report_timers[i], seats[i]->wheel_device.ServiceReports(now));
         }
+    });
+
+    LOG_INFO("main", "Event loop runtime: " << seats.size() << " seat(s) on one thread");
+    loop.Run(running);
+
+    const EventLoop::Stats stats = loop.GetStats();
+    LOG_INFO("main", "Event loop: " << stats.waits << " waits, " << stats.timer_fires << " timer fires, "
+             << stats.signals << " FFB wakes, " << stats.handle_events << " input events, "
+             << stats.spin_ns / 1000000 << " ms spinning");
+}
+
+// Signals vs kernel wakes per consumer, and how many wakes found work
+void LogWakeStats(const std::vector<std::unique_ptr<Seat>>& seats, const PhysicsScheduler::Stats& physics) {
+    WakeSignal::Stats frames;
+    WakeSignal::Stats reports;
+    for (const auto& seat : seats) {
+        frames.Add(seat->input_manager.FrameWakeStats());
+        reports.Add(seat->wheel_device.ReportWakeStats());
+    }
+    if (frames.signals > 0) {
+        LOG_INFO("main", WakeSignal::Format("Frame wakes", frames, InputManager::kFrameWakeNames.data()));
     }
+    if (reports.signals > 0) {
+        LOG_INFO("main", WakeSignal::Format("Report wakes", reports, WheelDevice::kReportWakeNames.data()));
+    }
+    if (physics.wake.signals > 0) {
+        LOG_INFO("main", WakeSignal::Format("Physics wakes", physics.wake, PhysicsScheduler::kWakeNames.data()));
+    }
+}
 
-    wheel_device.SetEnabled(false, input_manager);
-    wheel_device.NotifyAllShutdownCVs();
-    input_manager.Shutdown();
-    wheel_device.ShutdownThreads();
-    
-    timeEndPeriod(1);
-    return 0;
+void LogMetrics(const metrics::Snapshot& snapshot, std::chrono::steady_clock::duration window) {
+    for (const std::string& line : metrics::FormatLines(snapshot, std::chrono::duration<double>(window).count())) {
+        LOG_INFO("main", line);
+    }
+}
+
+// [diagnostics] Logs what was recorded in each metrics_interval_s (0 = never)
+// and refreshes the shared-memory metrics block at 10 Hz while it is open
+void RunMetricsThread(WakeSignal& stop, std::chrono::seconds log_interval, shared_stats::SharedStats& shared) {
+    using clock = std::chrono::steady_clock;
+    constexpr auto kPublishPeriod = std::chrono::milliseconds(100);
+    metrics::Snapshot logged = metrics::Collect();
+    auto next_log = log_interval.count() > 0 ? logged.taken + log_interval : clock::time_point::max();
+    auto next_publish = shared.IsOpen() ? logged.taken : clock::time_point::max();
+    while (stop.WaitUntil(std::min(next_log, next_publish)) == 0) {
+        metrics::Snapshot now = metrics::Collect();
+        if (now.taken >= next_publish) {
+            shared.PublishMetrics(now);
+            next_publish += kPublishPeriod;
+            if (next_publish <= now.taken) next_publish = now.taken + kPublishPeriod;
+        }
+        if (now.taken >= next_log) {
+            LogMetrics(now.Since(logged), now.taken - logged.taken);
+            logged = std::move(now);
+            next_log += log_interval;
+        }
+    }
 }
 
 int ParseLogLevelFromArgs(int argc, char* argv[]) {
@@ -0,0 +1,167 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <sstream>
+
+namespace metrics {
+
+namespace {
+// Shards outlive their threads, so counts of exited threads stay in the totals.
+// There is one per thread that ever recorded, a handful per seat.
+std::mutex g_shards_mutex;
+std::vector<std::unique_ptr<Shard>>& Shards() {
+    static std::vector<std::unique_ptr<Shard>> shards;
+    return shards;
+}
+
+constexpr const char* kCounterNames[kCounterCount] = {
+    "reports_sent",    "ffb_constant",   "ffb_effect_op", "ffb_control",          "ffb_other",
+    "frames_emitted",  "frames_coalesced", "state_locks", "state_lock_contended",
+};
+
+constexpr const char* kGaugeNames[kGaugeCount] = {
+    "enabled_seats",
+};
+
+std::array<std::atomic<int64_t>, kGaugeCount> g_gauges{};
+
+constexpr const char* kHistogramNames[kHistogramCount] = {
+    "tick_duration",
+    "tick_lateness",
+    "state_lock_wait",
+    "report_write",
+};
+
+double PerSecond(uint64_t count, double seconds) {
+    return seconds > 0.0 ? static_cast<double>(count) / seconds : 0.0;
+}
+}  // namespace
+
+Shard* RegisterShard() {
+    auto shard = std::make_unique<Shard>();
+    Shard* raw = shard.get();
+    std::lock_guard<std::mutex> lock(g_shards_mutex);
+    Shards().push_back(std::move(shard));
+    return raw;
+}
+
+std::atomic<int64_t>& GaugeCell(Gauge gauge) {
+    return g_gauges[static_cast<size_t>(gauge)];
+}
+
+uint64_t HistogramSnapshot::Quantile(double quantile) const {
+    if (count == 0) {
+        return 0;
+    }
+    const double target = std::clamp(quantile, 0.0, 1.0) * static_cast<double>(count);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        seen += buckets[i];
+        if (seen > 0 && static_cast<double>(seen) >= target) {
+            return std::min(BucketUpperBound(i), max);
+        }
+    }
+    return max;
+}
+
+Snapshot Snapshot::Since(const Snapshot& earlier) const {
+    Snapshot delta = *this;
+    for (size_t i = 0; i < kCounterCount; ++i) {
+        delta.counters[i] -= earlier.counters[i];
+    }
+    for (size_t h = 0; h < kHistogramCount; ++h) {
+        HistogramSnapshot& out = delta.histograms[h];
+        const HistogramSnapshot& before = earlier.histograms[h];
+        out.count -= before.count;
+        out.sum -= before.sum;
+        for (size_t i = 0; i < kBuckets; ++i) {
+            out.buckets[i] -= before.buckets[i];
+        }
+        // The cells only keep the lifetime max; an old spike would show in
+        // every later interval. The interval's own highest bucket bounds it.
+        const uint64_t lifetime_max = out.max;
+        out.max = 0;
+        for (size_t i = kBuckets; i-- > 0;) {
+            if (out.buckets[i] != 0) {
+                out.max = std::min(BucketUpperBound(i), lifetime_max);
+                break;
+            }
+        }
+    }
+    return delta;
+}
+
+Snapshot Collect() {
+    Snapshot snapshot;
+    snapshot.taken = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < kGaugeCount; ++i) {
+        snapshot.gauges[i] = g_gauges[i].load(std::memory_order_relaxed);
+    }
+    std::lock_guard<std::mutex> lock(g_shards_mutex);
+    for (const auto& shard : Shards()) {
+        for (size_t i = 0; i < kCounterCount; ++i) {
+            snapshot.counters[i] += shard->counters[i].load(std::memory_order_relaxed);
+        }
+        for (size_t h = 0; h < kHistogramCount; ++h) {
+            const HistogramCells& cells = shard->histograms[h];
+            HistogramSnapshot& out = snapshot.histograms[h];
+            out.count += cells.count.load(std::memory_order_relaxed);
+            out.sum += cells.sum.load(std::memory_order_relaxed);
+            out.max = std::max(out.max, cells.max.load(std::memory_order_relaxed));
+            for (size_t i = 0; i < kBuckets; ++i) {
+                out.buckets[i] += cells.buckets[i].load(std::memory_order_relaxed);
+            }
+        }
+    }
+    return snapshot;
+}
+
+const char* CounterName(Counter counter) {
+    const size_t index = static_cast<size_t>(counter);
+    return index < kCounterCount ? kCounterNames[index] : "unknown";
+}
+
+const char* GaugeName(Gauge gauge) {
+    const size_t index = static_cast<size_t>(gauge);
+    return index < kGaugeCount ? kGaugeNames[index] : "unknown";
+}
+
+const char* HistogramName(Histogram histogram) {
+    const size_t index = static_cast<size_t>(histogram);
+    return index < kHistogramCount ? kHistogramNames[index] : "unknown";
+}
+
+std::vector<std::string> FormatLines(const Snapshot& snapshot, double seconds) {
+    std::vector<std::string> lines;
+    std::ostringstream out;
+    out.setf(std::ios::fixed);
+    out.precision(1);
+
+    const uint64_t locks = snapshot.Get(Counter::StateLocks);
+    const uint64_t contended = snapshot.Get(Counter::StateLockContended);
+    out << "Metrics over " << seconds << " s: reports " << PerSecond(snapshot.Get(Counter::ReportsSent), seconds)
+        << "/s, frames " << snapshot.Get(Counter::FramesEmitted) << " emitted / "
+        << snapshot.Get(Counter::FramesCoalesced) << " coalesced, FFB packets constant "
+        << snapshot.Get(Counter::FfbConstant) << " effect_op " << snapshot.Get(Counter::FfbEffectOp) << " control "
+        << snapshot.Get(Counter::FfbControl) << " other " << snapshot.Get(Counter::FfbOther) << ", state_mutex "
+        << locks << " locks (" << (locks ? 100.0 * static_cast<double>(contended) / static_cast<double>(locks) : 0.0)
+        << "% contended), " << snapshot.Get(Gauge::EnabledSeats) << " seat(s) enabled";
+    lines.push_back(out.str());
+
+    for (size_t h = 0; h < kHistogramCount; ++h) {
+        const HistogramSnapshot& histogram = snapshot.histograms[h];
+        if (histogram.count == 0) {
+            continue;
+        }
+        std::ostringstream line;
+        line << "  " << kHistogramNames[h] << ": " << histogram.count << " samples, mean " << histogram.Mean()
+             << " ns, p50 " << histogram.Quantile(0.5) << " ns, p99 " << histogram.Quantile(0.99) << " ns, p99.9 "
+             << histogram.Quantile(0.999) << " ns, max " << histogram.max << " ns";
+        lines.push_back(line.str());
+    }
+    return lines;
+}
+
+}  // namespace metrics
@@ -0,0 +1,190 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "bit_util.h"
+#include "cache_line.h"
+
+// Process-wide counters and latency histograms for the hot paths. Each thread
+// records into its own shard with plain relaxed loads and stores (no locked
+// RMW, no shared cache line), so a recording site costs a few nanoseconds.
+// Collect() sums the shards from any thread; aggregation never touches the
+// recording threads.
+namespace metrics {
+
+enum class Counter : uint8_t {
+    ReportsSent = 0,
+    // vJoy FFB packets by type
+    FfbConstant,
+    FfbEffectOp,
+    FfbControl,
+    FfbOther,
+    // Input frames published by the reader, and those folded into a later
+    // frame because the seat loop had not taken the previous one yet
+    FramesEmitted,
+    FramesCoalesced,
+    StateLocks,
+    StateLockContended,
+    kCount
+};
+
+enum class Histogram : uint8_t {
+    // All tasks of one physics worker pass
+    TickDuration = 0,
+    // Periodic tick start after its deadline
+    TickLateness,
+    // Blocked on WheelDevice::state_mutex (contended acquisitions only)
+    StateLockWait,
+    // HidDevice::WriteReportBlocking, i.e. UpdateVJD
+    ReportWrite,
+    kCount
+};
+
+// Current levels rather than totals; set from control paths, so they are
+// shared atomics instead of per-thread shards
+enum class Gauge : uint8_t {
+    EnabledSeats = 0,
+    kCount
+};
+
+constexpr size_t kCounterCount = static_cast<size_t>(Counter::kCount);
+constexpr size_t kGaugeCount = static_cast<size_t>(Gauge::kCount);
+constexpr size_t kHistogramCount = static_cast<size_t>(Histogram::kCount);
+
+// HDR-style log-linear buckets over nanoseconds: exact below 32, then 32
+// buckets per power of two (3% resolution) up to 2^40 ns (18 minutes)
+constexpr int kSubBucketBits = 5;
+constexpr uint64_t kSubBuckets = uint64_t{1} << kSubBucketBits;
+constexpr int kMaxValueBits = 40;
+constexpr size_t kBuckets = static_cast<size_t>((kMaxValueBits - kSubBucketBits + 1) * kSubBuckets);
+
+inline size_t BucketIndex(uint64_t value) {
+    if (value < kSubBuckets) {
+        return static_cast<size_t>(value);
+    }
+    if (value >= (uint64_t{1} << kMaxValueBits)) {
+        value = (uint64_t{1} << kMaxValueBits) - 1;
+    }
+    const int msb = 63 - CountLeadingZeros64(value);
+    const int shift = msb - kSubBucketBits;
+    return static_cast<size_t>((shift + 1) * kSubBuckets + ((value >> shift) - kSubBuckets));
+}
+
+// Smallest value that lands in the bucket
+inline uint64_t BucketLowerBound(size_t index) {
+    if (index < kSubBuckets) {
+        return index;
+    }
+    const int shift = static_cast<int>(index / kSubBuckets) - 1;
+    return (kSubBuckets + index % kSubBuckets) << shift;
+}
+
+// Largest value that lands in the bucket
+inline uint64_t BucketUpperBound(size_t index) {
+    return index + 1 < kBuckets ? BucketLowerBound(index + 1) - 1 : (uint64_t{1} << kMaxValueBits) - 1;
+}
+
+struct HistogramCells {
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> max{0};
+    std::array<std::atomic<uint64_t>, kBuckets> buckets{};
+};
+
+// One per recording thread; written only by that thread
+struct alignas(kCacheLineSize) Shard {
+    std::array<std::atomic<uint64_t>, kCounterCount> counters{};
+    std::array<HistogramCells, kHistogramCount> histograms{};
+};
+
+// Registers the calling thread's shard (once per thread, under a mutex)
+Shard* RegisterShard();
+
+inline Shard& LocalShard() {
+    thread_local Shard* shard = nullptr;
+    if (!shard) {
+        shard = RegisterShard();
+    }
+    return *shard;
+}
+
+// Single writer: a load and a store, not a locked add
+inline void Bump(std::atomic<uint64_t>& cell, uint64_t n) {
+    cell.store(cell.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+inline void Increment(Counter counter, uint64_t n = 1) {
+    Bump(LocalShard().counters[static_cast<size_t>(counter)], n);
+}
+
+inline void Record(Histogram histogram, uint64_t value_ns) {
+    HistogramCells& cells = LocalShard().histograms[static_cast<size_t>(histogram)];
+    Bump(cells.count, 1);
+    Bump(cells.sum, value_ns);
+    if (value_ns > cells.max.load(std::memory_order_relaxed)) {
+        cells.max.store(value_ns, std::memory_order_relaxed);
+    }
+    Bump(cells.buckets[BucketIndex(value_ns)], 1);
+}
+
+inline void Record(Histogram histogram, std::chrono::steady_clock::duration elapsed) {
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    Record(histogram, ns > 0 ? static_cast<uint64_t>(ns) : 0);
+}
+
+std::atomic<int64_t>& GaugeCell(Gauge gauge);
+
+inline void Set(Gauge gauge, int64_t value) {
+    GaugeCell(gauge).store(value, std::memory_order_relaxed);
+}
+
+inline void Adjust(Gauge gauge, int64_t delta) {
+    GaugeCell(gauge).fetch_add(delta, std::memory_order_relaxed);
+}
+
+struct HistogramSnapshot {
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t max = 0;
+    std::vector<uint64_t> buckets = std::vector<uint64_t>(kBuckets);
+
+    // Upper bound of the bucket holding the quantile (0..1), capped at max, so
+    // it overstates by at most the bucket width (3%); 0 with no samples
+    uint64_t Quantile(double quantile) const;
+    uint64_t Mean() const { return count ? sum / count : 0; }
+};
+
+struct Snapshot {
+    std::chrono::steady_clock::time_point taken;
+    std::array<uint64_t, kCounterCount> counters{};
+    std::array<int64_t, kGaugeCount> gauges{};
+    std::array<HistogramSnapshot, kHistogramCount> histograms;
+
+    uint64_t Get(Counter counter) const { return counters[static_cast<size_t>(counter)]; }
+    int64_t Get(Gauge gauge) const { return gauges[static_cast<size_t>(gauge)]; }
+    const HistogramSnapshot& Get(Histogram histogram) const { return histograms[static_cast<size_t>(histogram)]; }
+    // What was recorded after `earlier`. Gauges keep their current values; a
+    // histogram's max is that of the interval, to its bucket's resolution.
+    Snapshot Since(const Snapshot& earlier) const;
+};
+
+// Sums every thread's shard; safe while the threads keep recording
+Snapshot Collect();
+
+const char* CounterName(Counter counter);
+const char* GaugeName(Gauge gauge);
+const char* HistogramName(Histogram histogram);
+
+// Log lines for a snapshot covering `seconds`
+std::vector<std::string> FormatLines(const Snapshot& snapshot, double seconds);
+
+}  // namespace metrics
+
+#endif  // METRICS_H
@@ -0,0 +1,167 @@
+#include "pedal_ramp.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+constexpr float kMinExponent = 0.001f;
+}
+
+bool ParsePedalCurve(const std::string& name, PedalCurve& out) {
+    if (name == "linear") {
+        out = PedalCurve::Linear;
+    } else if (name == "exponential" || name == "exp") {
+        out = PedalCurve::Exponential;
+    } else if (name == "lut") {
+        out = PedalCurve::Lut;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* PedalCurveName(PedalCurve curve) {
+    switch (curve) {
+        case PedalCurve::Linear:
+            return "linear";
+        case PedalCurve::Exponential:
+            return "exponential";
+        case PedalCurve::Lut:
+            return "lut";
+    }
+    return "linear";
+}
+
+PedalRamp::PedalRamp() : pressed_(false), ramping_(false), progress_(0.0f), output_(0.0f) {}
+
+void PedalRamp::Configure(const PedalRampConfig& config) {
+    config_ = config;
+    for (PedalCurveConfig* curve : {&config_.attack_curve, &config_.release_curve}) {
+        if (curve->type != PedalCurve::Lut) {
+            continue;
+        }
+        if (curve->lut.size() < 2) {
+            curve->type = PedalCurve::Linear;
+            continue;
+        }
+        // Inversion on direction change needs a monotonic table
+        float prev = 0.0f;
+        for (float& point : curve->lut) {
+            point = std::clamp(point, prev, 1.0f);
+            prev = point;
+        }
+        curve->lut.front() = 0.0f;
+        curve->lut.back() = 1.0f;
+    }
+    Reset();
+}
+
+bool PedalRamp::SetPressed(bool pressed) {
+    if (pressed == pressed_) {
+        return false;
+    }
+    pressed_ = pressed;
+
+    const float duration_ms = pressed ? config_.attack_ms : config_.release_ms;
+    const PedalCurveConfig& curve = pressed ? config_.attack_curve : config_.release_curve;
+    if (duration_ms <= 0.0f) {
+        float next = pressed ? 1.0f : 0.0f;
+        bool changed = next != output_;
+        progress_ = next;
+        output_ = next;
+        ramping_ = false;
+        return changed;
+    }
+
+    // Continue from the current pedal position on the new curve so a reversal
+    // mid-travel never jumps.
+    progress_ = Invert(curve, output_);
+    ramping_ = pressed ? progress_ < 1.0f : progress_ > 0.0f;
+    return false;
+}
+
+bool PedalRamp::Advance(float dt) {
+    if (!ramping_) {
+        return false;
+    }
+
+    if (pressed_) {
+        progress_ += (dt * 1000.0f) / config_.attack_ms;
+        if (progress_ >= 1.0f) {
+            progress_ = 1.0f;
+            ramping_ = false;
+        }
+    } else {
+        progress_ -= (dt * 1000.0f) / config_.release_ms;
+        if (progress_ <= 0.0f) {
+            progress_ = 0.0f;
+            ramping_ = false;
+        }
+    }
+
+    float next = Evaluate(pressed_ ? config_.attack_curve : config_.release_curve, progress_);
+    if (next == output_) {
+        return false;
+    }
+    output_ = next;
+    return true;
+}
+
+void PedalRamp::Reset() {
+    pressed_ = false;
+    ramping_ = false;
+    progress_ = 0.0f;
+    output_ = 0.0f;
+}
+
+float PedalRamp::Evaluate(const PedalCurveConfig& curve, float progress) const {
+    progress = std::clamp(progress, 0.0f, 1.0f);
+    switch (curve.type) {
+        case PedalCurve::Linear:
+            return progress;
+        case PedalCurve::Exponential: {
+            float k = curve.exponent;
+            if (std::fabs(k) < kMinExponent) {
+                return progress;
+            }
+            return std::expm1(k * progress) / std::expm1(k);
+        }
+        case PedalCurve::Lut: {
+            const size_t segments = curve.lut.size() - 1;
+            float pos = progress * static_cast<float>(segments);
+            size_t index = std::min(static_cast<size_t>(pos), segments - 1);
+            float frac = pos - static_cast<float>(index);
+            return curve.lut[index] + (curve.lut[index + 1] - curve.lut[index]) * frac;
+        }
+    }
+    return progress;
+}
+
+float PedalRamp::Invert(const PedalCurveConfig& curve, float output) const {
+    output = std::clamp(output, 0.0f, 1.0f);
+    switch (curve.type) {
+        case PedalCurve::Linear:
+            return output;
+        case PedalCurve::Exponential: {
+            float k = curve.exponent;
+            if (std::fabs(k) < kMinExponent) {
+                return output;
+            }
+            return std::log1p(output * std::expm1(k)) / k;
+        }
+        case PedalCurve::Lut: {
+            const size_t segments = curve.lut.size() - 1;
+            for (size_t i = 0; i < segments; ++i) {
+                float lo = curve.lut[i];
+                float hi = curve.lut[i + 1];
+                if (output > hi) {
+                    continue;
+                }
+                float frac = (hi > lo) ? (output - lo) / (hi - lo) : 0.0f;
+                return (static_cast<float>(i) + frac) / static_cast<float>(segments);
+            }
+            return 1.0f;
+        }
+    }
+    return output;
+}
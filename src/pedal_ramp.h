@@ -0,0 +1,61 @@
+#ifndef PEDAL_RAMP_H
+#define PEDAL_RAMP_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class PedalCurve : uint8_t {
+    Linear = 0,
+    Exponential,
+    Lut
+};
+
+struct PedalCurveConfig {
+    PedalCurve type = PedalCurve::Linear;
+    // Shape factor for Exponential (>0 eases in, <0 eases out)
+    float exponent = 2.0f;
+    // Evenly spaced output points (0..1) for Lut, first=0 and last=1
+    std::vector<float> lut;
+};
+
+struct PedalRampConfig {
+    // Time for a full 0 -> 100% (attack) and 100 -> 0% (release) sweep. 0 = instant.
+    float attack_ms = 0.0f;
+    float release_ms = 0.0f;
+    PedalCurveConfig attack_curve;
+    PedalCurveConfig release_curve;
+};
+
+bool ParsePedalCurve(const std::string& name, PedalCurve& out);
+const char* PedalCurveName(PedalCurve curve);
+
+// Keyboard pedal travel model. Time progress (0..1) is advanced on the physics
+// tick and mapped through the attack or release curve to the pedal output.
+class PedalRamp {
+public:
+    PedalRamp();
+
+    void Configure(const PedalRampConfig& config);
+
+    // Returns true if the output changed immediately (instant ramps)
+    bool SetPressed(bool pressed);
+    // Returns true if the output changed during this step
+    bool Advance(float dt);
+    void Reset();
+
+    bool IsRamping() const { return ramping_; }
+    float Output() const { return output_; }
+
+private:
+    float Evaluate(const PedalCurveConfig& curve, float progress) const;
+    float Invert(const PedalCurveConfig& curve, float output) const;
+
+    PedalRampConfig config_;
+    bool pressed_;
+    bool ramping_;
+    float progress_;
+    float output_;
+};
+
+#endif  // PEDAL_RAMP_H
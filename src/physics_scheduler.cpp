@@ -0,0 +1,204 @@
+#include "physics_scheduler.h"
+
+#include <algorithm>
+#include <sstream>
+
+#include "metrics.h"
+#include "trace.h"
+
+PhysicsScheduler::PhysicsScheduler() : period_(1000), running_(false) {}
+
+PhysicsScheduler::~PhysicsScheduler() {
+    Stop();
+}
+
+size_t PhysicsScheduler::AddTask(TickFn tick) {
+    tasks_.push_back(std::move(tick));
+    return tasks_.size() - 1;
+}
+
+bool PhysicsScheduler::Start(size_t workers, std::chrono::microseconds period) {
+    if (running_.load(std::memory_order_relaxed) || tasks_.empty()) {
+        return false;
+    }
+    if (workers == 0) {
+        const size_t hardware = std::max<size_t>(1, std::thread::hardware_concurrency());
+        workers = std::min((tasks_.size() + kTasksPerWorker - 1) / kTasksPerWorker, hardware);
+    }
+    workers = std::min(workers, tasks_.size());
+    period_ = std::max(period, std::chrono::microseconds(100));
+
+    workers_.clear();
+    for (size_t i = 0; i < workers; ++i) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+    for (size_t task = 0; task < tasks_.size(); ++task) {
+        workers_[task % workers]->tasks.push_back(task);
+    }
+
+    running_.store(true, std::memory_order_release);
+    for (auto& worker : workers_) {
+        worker->thread = std::thread(&PhysicsScheduler::WorkerLoop, this, std::ref(*worker));
+    }
+    return true;
+}
+
+void PhysicsScheduler::Stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    for (auto& worker : workers_) {
+        worker->wake.Signal(kWakeStop);
+    }
+    for (auto& worker : workers_) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+}
+
+void PhysicsScheduler::Wake(size_t task) {
+    if (workers_.empty() || !running_.load(std::memory_order_acquire)) {
+        return;
+    }
+    // A burst of FFB packets before the worker runs costs one kernel wake
+    workers_[task % workers_.size()]->wake.Signal(kWakeTask);
+}
+
+PhysicsScheduler::Stats PhysicsScheduler::TotalStats() const {
+    Stats total;
+    for (const auto& worker : workers_) {
+        total.ticks += worker->ticks.load(std::memory_order_relaxed);
+        total.early_ticks += worker->early_ticks.load(std::memory_order_relaxed);
+        total.busy_ns += worker->busy_ns.load(std::memory_order_relaxed);
+        total.spin_ns += worker->spin_ns.load(std::memory_order_relaxed);
+        total.rest_parks += worker->rest_parks.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < kJitterBuckets; ++i) {
+            total.late_histogram[i] += worker->late_histogram[i].load(std::memory_order_relaxed);
+        }
+        total.late_max_ns = std::max(total.late_max_ns, worker->late_max_ns.load(std::memory_order_relaxed));
+        total.wake.Add(worker->wake.GetStats());
+    }
+    return total;
+}
+
+uint32_t PhysicsScheduler::Stats::LateQuantileUs(double quantile) const {
+    uint64_t samples = 0;
+    for (uint64_t count : late_histogram) {
+        samples += count;
+    }
+    if (samples == 0) {
+        return 0;
+    }
+    const double target = quantile * static_cast<double>(samples);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kJitterBoundsUs.size(); ++i) {
+        seen += late_histogram[i];
+        if (static_cast<double>(seen) >= target) {
+            return kJitterBoundsUs[i];
+        }
+    }
+    // Open bucket: the worst observed lateness bounds it
+    return static_cast<uint32_t>(late_max_ns / 1000);
+}
+
+std::string PhysicsScheduler::FormatJitter(const Stats& stats, std::chrono::microseconds period) {
+    uint64_t samples = 0;
+    for (uint64_t count : stats.late_histogram) {
+        samples += count;
+    }
+    std::ostringstream out;
+    out << "Tick jitter over " << samples << " periodic ticks (period " << period.count() << " us): p50 <= "
+        << stats.LateQuantileUs(0.5) << " us, p99 <= " << stats.LateQuantileUs(0.99) << " us, max "
+        << stats.late_max_ns / 1000 << " us, " << stats.spin_ns / 1000000 << " ms spinning";
+    if (samples == 0) {
+        return out.str();
+    }
+    uint32_t lower = 0;
+    for (size_t i = 0; i < kJitterBuckets; ++i) {
+        out << "\n  ";
+        if (i < kJitterBoundsUs.size()) {
+            out << lower << "-" << kJitterBoundsUs[i] << " us: ";
+            lower = kJitterBoundsUs[i];
+        } else {
+            out << ">" << lower << " us: ";
+        }
+        out << stats.late_histogram[i] << " ("
+            << (100.0 * static_cast<double>(stats.late_histogram[i]) / static_cast<double>(samples)) << "%)";
+    }
+    return out.str();
+}
+
+void PhysicsScheduler::RecordLateness(Worker& worker, Clock::duration late) {
+    const uint64_t late_ns =
+        static_cast<uint64_t>(std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::nanoseconds>(late).count()));
+    size_t bucket = 0;
+    while (bucket < kJitterBoundsUs.size() && late_ns > static_cast<uint64_t>(kJitterBoundsUs[bucket]) * 1000) {
+        ++bucket;
+    }
+    worker.late_histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+    metrics::Record(metrics::Histogram::TickLateness, late_ns);
+    if (late_ns > worker.late_max_ns.load(std::memory_order_relaxed)) {
+        worker.late_max_ns.store(late_ns, std::memory_order_relaxed);
+    }
+}
+
+void PhysicsScheduler::WorkerLoop(Worker& worker) {
+    ScopedThreadTuning tuning(threading_, ThreadRole::Physics);
+    trace::SetThreadName("physics worker");
+    // max() = every task at rest: no timer, only Wake() or Stop() resume the worker
+    constexpr Clock::time_point kParked = Clock::time_point::max();
+    auto next_tick = Clock::now() + period_;
+    while (running_.load(std::memory_order_acquire)) {
+        const bool parked = next_tick == kParked;
+        const bool woken = worker.wake.WaitUntil(parked ? kParked : timer_.SleepDeadline(next_tick)) != 0;
+        if (!running_.load(std::memory_order_acquire)) {
+            break;
+        }
+        if (!woken && timer_.SpinMargin().count() > 0) {
+            // A wake arriving now waits at most the margin, for the periodic tick
+            const auto spun = PreciseTimer::SpinUntil(next_tick);
+            worker.spin_ns.fetch_add(static_cast<uint64_t>(spun.count()), std::memory_order_relaxed);
+        }
+
+        const auto now = Clock::now();
+        bool active = false;
+        for (size_t task : worker.tasks) {
+            active |= tasks_[task](now);
+        }
+        const auto done = Clock::now();
+        metrics::Record(metrics::Histogram::TickDuration, done - now);
+
+        worker.ticks.fetch_add(1, std::memory_order_relaxed);
+        worker.busy_ns.fetch_add(
+            static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(done - now).count()),
+            std::memory_order_relaxed);
+
+        if (!active) {
+            if (!parked) {
+                worker.rest_parks.fetch_add(1, std::memory_order_relaxed);
+            }
+            next_tick = kParked;
+            continue;
+        }
+        if (parked) {
+            // Resumed by a wake: the period restarts from this tick
+            worker.early_ticks.fetch_add(1, std::memory_order_relaxed);
+            next_tick = done + period_;
+            continue;
+        }
+        if (now < next_tick) {
+            // Early tick for a wake; keep the periodic schedule
+            if (woken) {
+                worker.early_ticks.fetch_add(1, std::memory_order_relaxed);
+            }
+            continue;
+        }
+        RecordLateness(worker, now - next_tick);
+        next_tick += period_;
+        if (next_tick <= done) {
+            // Fell behind (suspend, debugger); skip missed periods instead of bursting
+            next_tick = done + period_;
+        }
+    }
+}
@@ -0,0 +1,116 @@
+#ifndef PHYSICS_SCHEDULER_H
+#define PHYSICS_SCHEDULER_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cache_line.h"
+#include "precise_timer.h"
+#include "thread_tuning.h"
+#include "wake_signal.h"
+
+// Runs every seat's physics tick on a small shared pool instead of one
+// thread per seat. Tasks are split round-robin over the workers; each worker
+// ticks its tasks once per period, or immediately when one of them is woken.
+// Periodic deadlines are met with a PreciseTimer (sleep, then spin). A worker
+// whose tasks all report rest parks with no timer until one is woken.
+class PhysicsScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+    // Returns false when the task is at rest and needs no tick until woken
+    using TickFn = std::function<bool(Clock::time_point)>;
+
+    // A seat tick costs about a microsecond; wakeups dominate, so a few seats share a worker
+    static constexpr size_t kTasksPerWorker = 4;
+
+    // Upper bounds (us) of the lateness buckets of periodic ticks; the last bucket is open
+    static constexpr size_t kJitterBuckets = 10;
+    static constexpr std::array<uint32_t, kJitterBuckets - 1> kJitterBoundsUs = {10,  25,   50,   100, 250,
+                                                                                500, 1000, 2000, 5000};
+
+    // Why a worker was woken before its period (WakeSignal reason bits)
+    enum WorkerWake : uint32_t {
+        kWakeTask = 1u << 0,
+        kWakeStop = 1u << 1,
+    };
+    static constexpr std::array<const char*, WakeSignal::kMaxReasons> kWakeNames = {"task", "stop"};
+
+    struct Stats {
+        uint64_t ticks = 0;
+        // Ticks started by Wake() rather than the period
+        uint64_t early_ticks = 0;
+        uint64_t busy_ns = 0;
+        // Time spent spinning out the last part of a wait (hybrid timer)
+        uint64_t spin_ns = 0;
+        // Times a worker parked because all its tasks were at rest
+        uint64_t rest_parks = 0;
+        // How late periodic ticks started relative to their deadline
+        std::array<uint64_t, kJitterBuckets> late_histogram{};
+        uint64_t late_max_ns = 0;
+        // Early wakes (FFB packets) of all workers
+        WakeSignal::Stats wake;
+
+        // Upper bound (us) of the bucket holding the given quantile (0..1); 0 with no samples
+        uint32_t LateQuantileUs(double quantile) const;
+    };
+
+    PhysicsScheduler();
+    ~PhysicsScheduler();
+
+    PhysicsScheduler(const PhysicsScheduler&) = delete;
+    PhysicsScheduler& operator=(const PhysicsScheduler&) = delete;
+
+    // Tasks must be added before Start(); returns the id passed to Wake()
+    size_t AddTask(TickFn tick);
+    // Priority and CPU set applied to each worker; call before Start()
+    void SetThreading(const ThreadingConfig& threading) { threading_ = threading; }
+    // Deadline waits; defaults to a hybrid timer with an uncalibrated margin
+    void SetTimer(const PreciseTimer& timer) { timer_ = timer; }
+    // workers = 0 picks one per kTasksPerWorker tasks, capped at the hardware threads
+    bool Start(size_t workers, std::chrono::microseconds period);
+    void Stop();
+
+    // Ticks the task's worker now instead of at its next period
+    void Wake(size_t task);
+
+    size_t TaskCount() const { return tasks_.size(); }
+    size_t WorkerCount() const { return workers_.size(); }
+    Stats TotalStats() const;
+    // One line per bucket, for the shutdown log
+    static std::string FormatJitter(const Stats& stats, std::chrono::microseconds period);
+
+private:
+    struct alignas(kCacheLineSize) Worker {
+        std::thread thread;
+        WakeSignal wake;
+        std::vector<size_t> tasks;
+        std::atomic<uint64_t> ticks{0};
+        std::atomic<uint64_t> early_ticks{0};
+        std::atomic<uint64_t> busy_ns{0};
+        std::atomic<uint64_t> spin_ns{0};
+        std::atomic<uint64_t> rest_parks{0};
+        std::array<std::atomic<uint64_t>, kJitterBuckets> late_histogram{};
+        // Written by the worker only
+        std::atomic<uint64_t> late_max_ns{0};
+    };
+
+    void WorkerLoop(Worker& worker);
+    static void RecordLateness(Worker& worker, Clock::duration late);
+
+    std::vector<TickFn> tasks_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    ThreadingConfig threading_;
+    PreciseTimer timer_;
+    std::chrono::microseconds period_;
+    std::atomic<bool> running_;
+};
+
+#endif  // PHYSICS_SCHEDULER_H
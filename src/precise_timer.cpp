@@ -0,0 +1,113 @@
+#include "precise_timer.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "logging/logger.h"
+
+namespace {
+constexpr const char* kTag = "timer";
+constexpr int kCalibrationSamples = 64;
+// A yield rarely takes longer than this to come back when another thread runs
+constexpr std::chrono::microseconds kYieldThreshold{100};
+// Added on top of the measured p99 so an occasional slower wake still spins
+constexpr std::chrono::microseconds kMarginSlack{50};
+}
+
+void PreciseTimer::Configure(Mode mode, std::chrono::microseconds spin_margin, std::chrono::microseconds period) {
+    mode_ = mode;
+    if (spin_margin.count() > 0) {
+        const std::chrono::nanoseconds limit = MaxSpinMargin(period);
+        if (mode_ == Mode::Hybrid && spin_margin > limit) {
+            LOG_WARN(kTag, "spin margin " << spin_margin.count() << " us capped at "
+                                          << std::chrono::duration_cast<std::chrono::microseconds>(limit).count()
+                                          << " us for a " << period.count() << " us period");
+        }
+        spin_margin_ = std::min<std::chrono::nanoseconds>(spin_margin, limit);
+    }
+}
+
+void PreciseTimer::Calibrate(std::chrono::microseconds period) {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<Clock::duration> overshoot;
+    overshoot.reserve(kCalibrationSamples);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    for (int i = 0; i < kCalibrationSamples; ++i) {
+        const auto deadline = Clock::now() + period;
+        // Same wait the scheduler uses; nothing notifies it
+        cv.wait_until(lock, deadline, [] { return false; });
+        overshoot.push_back(std::max(Clock::now() - deadline, Clock::duration::zero()));
+    }
+    std::sort(overshoot.begin(), overshoot.end());
+
+    calibration_.samples = static_cast<uint32_t>(overshoot.size());
+    calibration_.overshoot_p50 = overshoot[overshoot.size() / 2];
+    calibration_.overshoot_p99 = overshoot[((overshoot.size() - 1) * 99) / 100];
+    calibration_.overshoot_max = overshoot.back();
+
+    const std::chrono::nanoseconds wanted = calibration_.overshoot_p99 + kMarginSlack;
+    const std::chrono::nanoseconds limit = MaxSpinMargin(period);
+    if (wanted > limit) {
+        // Sleeps here are too coarse for the period; spinning through them would burn the core
+        LOG_WARN(kTag, "sleep overshoot p99 "
+                           << std::chrono::duration_cast<std::chrono::microseconds>(calibration_.overshoot_p99).count()
+                           << " us; spin margin capped at "
+                           << std::chrono::duration_cast<std::chrono::microseconds>(limit).count() << " us for a "
+                           << period.count() << " us period, ticks may run late");
+    }
+    spin_margin_ = std::min(wanted, limit);
+}
+
+std::chrono::nanoseconds PreciseTimer::SpinUntil(Clock::time_point deadline) {
+    const auto start = Clock::now();
+    auto now = start;
+    while (now < deadline) {
+        // Far from the deadline, give the core to other runnable threads (another
+        // spinning worker on a small machine); yield returns at once if there are none
+        if (deadline - now > kYieldThreshold) {
+            std::this_thread::yield();
+        } else {
+            CpuRelax();
+        }
+        now = Clock::now();
+    }
+    return now - start;
+}
+
+std::string PreciseTimer::Describe() const {
+    std::ostringstream out;
+    out << ModeName(mode_);
+    if (mode_ == Mode::Hybrid) {
+        out << ", spin margin " << std::chrono::duration_cast<std::chrono::microseconds>(spin_margin_).count()
+            << " us";
+    }
+    if (calibration_.samples > 0) {
+        auto us = [](std::chrono::nanoseconds ns) {
+            return std::chrono::duration_cast<std::chrono::microseconds>(ns).count();
+        };
+        out << " (sleep overshoot p50 " << us(calibration_.overshoot_p50) << " us, p99 "
+            << us(calibration_.overshoot_p99) << " us, max " << us(calibration_.overshoot_max) << " us)";
+    }
+    return out.str();
+}
+
+const char* PreciseTimer::ModeName(Mode mode) {
+    return mode == Mode::Hybrid ? "hybrid" : "powersave";
+}
+
+bool PreciseTimer::ParseMode(const std::string& value, Mode& mode) {
+    if (value == "hybrid") {
+        mode = Mode::Hybrid;
+    } else if (value == "powersave" || value == "sleep") {
+        mode = Mode::PowerSave;
+    } else {
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,87 @@
+#ifndef PRECISE_TIMER_H
+#define PRECISE_TIMER_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// Busy-wait hint: lets the sibling hyperthread run and saves power while spinning
+inline void CpuRelax() {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    _mm_pause();
+#elif defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+// Deadline waits that do not oversleep. OS sleeps (condition variable,
+// Sleep, nanosleep) wake 0.5-1 ms late, so a hybrid wait sleeps until
+// spin_margin before the deadline and spins on steady_clock for the rest.
+// The margin comes from measuring the sleep overshoot at startup.
+class PreciseTimer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Mode {
+        // Sleep to deadline - margin, then spin
+        Hybrid,
+        // Sleep only; never spins, accepts the OS wake latency
+        PowerSave
+    };
+
+    struct Calibration {
+        uint32_t samples = 0;
+        std::chrono::nanoseconds overshoot_p50{0};
+        std::chrono::nanoseconds overshoot_p99{0};
+        std::chrono::nanoseconds overshoot_max{0};
+    };
+
+    PreciseTimer() = default;
+
+    // margin = 0 in Hybrid mode means "calibrate"; a margin is capped at
+    // MaxSpinMargin(period) of the deadlines it will serve
+    void Configure(Mode mode, std::chrono::microseconds spin_margin, std::chrono::microseconds period);
+    // Measures how late a condition-variable sleep of `period` wakes and sets the
+    // spin margin to cover its p99, capped at MaxSpinMargin(period). Blocks for
+    // about 64 periods.
+    void Calibrate(std::chrono::microseconds period);
+
+    Mode GetMode() const { return mode_; }
+    std::chrono::nanoseconds SpinMargin() const { return mode_ == Mode::Hybrid ? spin_margin_ : std::chrono::nanoseconds(0); }
+    const Calibration& LastCalibration() const { return calibration_; }
+
+    // When a sleep aimed at `deadline` should return
+    Clock::time_point SleepDeadline(Clock::time_point deadline) const { return deadline - SpinMargin(); }
+    // Spins until `deadline`; returns the time spent spinning
+    static std::chrono::nanoseconds SpinUntil(Clock::time_point deadline);
+
+    // One-line summary for the startup log
+    std::string Describe() const;
+
+    static const char* ModeName(Mode mode);
+    static bool ParseMode(const std::string& value, Mode& mode);
+
+    // Spinning past this would cost more CPU than the accuracy is worth
+    static constexpr std::chrono::microseconds kMaxSpinMargin{2000};
+    // A margin near the period puts every sleep deadline in the past and the
+    // thread spins through whole periods; half the period at most
+    static std::chrono::nanoseconds MaxSpinMargin(std::chrono::microseconds period) {
+        return std::min<std::chrono::nanoseconds>(kMaxSpinMargin, period / 2);
+    }
+
+private:
+    Mode mode_ = Mode::Hybrid;
+    std::chrono::nanoseconds spin_margin_{std::chrono::microseconds(200)};
+    Calibration calibration_;
+};
+
+#endif  // PRECISE_TIMER_H
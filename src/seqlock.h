@@ -0,0 +1,71 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Single-writer sequence lock over a trivially copyable value, usable in
+// memory shared between processes. The writer never waits: it makes the
+// sequence odd, stores the value word by word and makes it even again. A
+// reader copies the words and retries if the sequence was odd or moved.
+// Words are relaxed atomics so torn reads are detected, never undefined.
+template <typename T>
+class Seqlock {
+    static_assert(std::is_trivially_copyable<T>::value, "Seqlock value must be trivially copyable");
+    static_assert(std::atomic<uint32_t>::is_always_lock_free, "shared memory needs lock-free 32-bit atomics");
+
+public:
+    static constexpr size_t kWords = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+    // One writer only
+    void Write(const T& value) {
+        uint32_t words[kWords] = {};
+        std::memcpy(words, &value, sizeof(T));
+        const uint32_t sequence = sequence_.load(std::memory_order_relaxed);
+        sequence_.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < kWords; ++i) {
+            words_[i].store(words[i], std::memory_order_relaxed);
+        }
+        sequence_.store(sequence + 2, std::memory_order_release);
+    }
+
+    // False if a write was in progress; callers retry or keep their last copy
+    bool TryRead(T& out) const {
+        const uint32_t before = sequence_.load(std::memory_order_acquire);
+        if (before & 1u) {
+            return false;
+        }
+        uint32_t words[kWords];
+        for (size_t i = 0; i < kWords; ++i) {
+            words[i] = words_[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence_.load(std::memory_order_relaxed) != before) {
+            return false;
+        }
+        std::memcpy(&out, words, sizeof(T));
+        return true;
+    }
+
+    bool Read(T& out, int attempts = 64) const {
+        for (int i = 0; i < attempts; ++i) {
+            if (TryRead(out)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Completed writes; 0 until the first one
+    uint32_t Version() const { return sequence_.load(std::memory_order_acquire) / 2; }
+
+private:
+    std::atomic<uint32_t> sequence_{0};
+    std::atomic<uint32_t> words_[kWords] = {};
+};
+
+#endif  // SEQLOCK_H
@@ -0,0 +1,804 @@
+#include "session_recorder.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <thread>
+
+#include "logging/logger.h"
+#include "spsc_ring.h"
+#include "thread_rings.h"
+#include "tsc_clock.h"
+#include "wake_signal.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace session {
+
+namespace detail {
+std::atomic<bool> recording{false};
+}
+
+namespace {
+constexpr const char* kTag = "session";
+
+// Per-thread ring of raw records; a power of two
+constexpr size_t kRingSize = size_t{1} << 17;
+// The writer drains the rings this often; producers never wake it
+constexpr auto kDrainInterval = std::chrono::milliseconds(20);
+constexpr uint32_t kWakeStop = 1u << 0;
+constexpr size_t kInitialFileSize = size_t{4} << 20;
+// Longer edge lists and FFB packets are cut to fit one record
+constexpr size_t kMaxEdges = 128;
+constexpr size_t kMaxFfbPacket = 64;
+
+// Input frame payload bits: which fields differ from the seat's previous frame
+enum FrameField : uint8_t {
+    kFrameSensitivity = 1u << 0,
+    kFramePedalsDpad = 1u << 1,
+    kFrameButtons = 1u << 2,
+    kFrameAnalog = 1u << 3,
+    kFrameMouse = 1u << 4,
+    kFrameToggle = 1u << 5,
+    kFrameEdges = 1u << 6,
+    kFrameTimestamp = 1u << 7,
+};
+
+// What the hot threads copy into their ring; encoded by the writer
+struct RawHeader {
+    uint16_t size;  // header and payload, rounded up to 8
+    uint8_t kind;
+    uint8_t seat;
+    uint32_t payload_size;
+    uint64_t ticks;  // tsc::Now(), converted when drained
+};
+
+struct RawFrame {
+    int64_t timestamp_ns;
+    int32_t sensitivity;
+    int32_t mouse_dx;
+    uint64_t buttons[ButtonMask::kWords];
+    float analog[kPedalCount];
+    uint8_t pedals;  // throttle, brake, clutch bits
+    uint8_t analog_mask;
+    int8_t dpad_x;
+    int8_t dpad_y;
+    uint8_t toggle;
+    uint8_t reserved;
+    uint16_t edge_count;
+};
+
+struct RawEdge {
+    int64_t timestamp_ns;
+    uint8_t button;
+    uint8_t pressed;
+    uint8_t reserved[6];
+};
+
+constexpr size_t kMaxRecordSize = sizeof(RawHeader) + sizeof(RawFrame) + kMaxEdges * sizeof(RawEdge);
+
+struct RecordRing : SpscByteRing<kRingSize> {};
+
+// Grows by remapping; Close() trims the file to what was written
+class MappedFile {
+public:
+    bool Create(const std::string& path, size_t size);
+    bool Grow(size_t size);
+    void Close(size_t final_size);
+    uint8_t* Data() const { return data_; }
+    size_t Size() const { return size_; }
+
+private:
+    bool Map(size_t size);
+    void Unmap();
+
+    uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+    HANDLE mapping_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+};
+
+bool MappedFile::Create(const std::string& path, size_t size) {
+#ifdef _WIN32
+    file_ = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS,
+                        FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_ == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+#else
+    fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0) {
+        return false;
+    }
+#endif
+    if (!Map(size)) {
+        Close(0);
+        return false;
+    }
+    return true;
+}
+
+bool MappedFile::Map(size_t size) {
+#ifdef _WIN32
+    // Mapping past the end of the file extends it
+    const uint64_t size64 = size;
+    mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READWRITE, static_cast<DWORD>(size64 >> 32),
+                                  static_cast<DWORD>(size64 & 0xFFFFFFFFu), nullptr);
+    if (!mapping_) {
+        return false;
+    }
+    void* view = MapViewOfFile(mapping_, FILE_MAP_WRITE, 0, 0, size);
+    if (!view) {
+        CloseHandle(mapping_);
+        mapping_ = nullptr;
+        return false;
+    }
+#else
+    if (ftruncate(fd_, static_cast<off_t>(size)) != 0) {
+        return false;
+    }
+    void* view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (view == MAP_FAILED) {
+        return false;
+    }
+#endif
+    data_ = static_cast<uint8_t*>(view);
+    size_ = size;
+    return true;
+}
+
+void MappedFile::Unmap() {
+    if (!data_) {
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(data_);
+    CloseHandle(mapping_);
+    mapping_ = nullptr;
+#else
+    munmap(data_, size_);
+#endif
+    data_ = nullptr;
+    size_ = 0;
+}
+
+bool MappedFile::Grow(size_t size) {
+    Unmap();
+    return Map(size);
+}
+
+void MappedFile::Close(size_t final_size) {
+    Unmap();
+#ifdef _WIN32
+    if (file_ != INVALID_HANDLE_VALUE) {
+        LARGE_INTEGER end;
+        end.QuadPart = static_cast<LONGLONG>(final_size);
+        if (SetFilePointerEx(file_, end, nullptr, FILE_BEGIN)) {
+            SetEndOfFile(file_);
+        }
+        CloseHandle(file_);
+        file_ = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (fd_ >= 0) {
+        if (ftruncate(fd_, static_cast<off_t>(final_size)) != 0) {
+            LOG_WARN(kTag, "Could not trim the session file");
+        }
+        close(fd_);
+        fd_ = -1;
+    }
+#endif
+}
+
+struct SeatEncoder {
+    int sensitivity = 0;
+    WheelInputState logical;
+    HidReport report{};
+};
+
+struct PendingRecord {
+    int64_t time_ns;
+    size_t offset;
+};
+
+std::mutex g_mutex;  // rings, encoder state and the file
+ThreadRings<RecordRing> g_rings(g_mutex);
+std::vector<char> g_batch;
+std::vector<PendingRecord> g_pending;
+std::vector<uint8_t> g_encoded;
+MappedFile g_file;
+std::string g_path;
+bool g_file_open = false;
+uint64_t g_data_size = 0;
+int64_t g_start_ns = 0;
+int64_t g_last_time_us = 0;
+SeatEncoder g_seats[kMaxSeats];
+std::atomic<uint64_t> g_events{0};
+
+WakeSignal g_wake;
+std::thread g_writer;
+
+thread_local char t_stage[kMaxRecordSize];
+
+int64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+int64_t ToNs(Clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+uint8_t SeatIndex(unsigned vjoy_id) {
+    return static_cast<uint8_t>(vjoy_id == 0 ? 0 : std::min<size_t>(vjoy_id - 1, kMaxSeats - 1));
+}
+
+// Returns the payload area of a record staged for the calling thread
+char* BeginRecord(EventKind kind, unsigned vjoy_id, size_t payload_size) {
+    RawHeader header{};
+    header.size = static_cast<uint16_t>((sizeof(RawHeader) + payload_size + 7) & ~size_t{7});
+    header.kind = static_cast<uint8_t>(kind);
+    header.seat = SeatIndex(vjoy_id);
+    header.payload_size = static_cast<uint32_t>(payload_size);
+    header.ticks = tsc::Now();
+    std::memcpy(t_stage, &header, sizeof(header));
+    return t_stage + sizeof(RawHeader);
+}
+
+void CommitRecord() {
+    auto* local = g_rings.Local();
+    RawHeader header;
+    std::memcpy(&header, t_stage, sizeof(header));
+    if (!local || !local->ring.TryWrite(t_stage, header.size)) {
+        g_rings.CountDrop(local);
+    }
+}
+
+void PutVarint(uint64_t value) {
+    while (value >= 0x80) {
+        g_encoded.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    g_encoded.push_back(static_cast<uint8_t>(value));
+}
+
+void PutSigned(int64_t value) {
+    PutVarint((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+}
+
+void PutBytes(const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    g_encoded.insert(g_encoded.end(), bytes, bytes + size);
+}
+
+int64_t ToSessionUs(int64_t time_ns) {
+    return (time_ns - g_start_ns) / 1000;
+}
+
+uint8_t PackPedalsDpad(uint8_t pedals, int8_t dpad_x, int8_t dpad_y) {
+    return static_cast<uint8_t>(pedals | ((dpad_x + 1) & 3) << 3 | ((dpad_y + 1) & 3) << 5);
+}
+
+void EncodeFrame(const RawFrame& raw, const RawEdge* edges, int64_t event_us, SeatEncoder& seat) {
+    WheelInputState logical;
+    logical.throttle = (raw.pedals & 1u) != 0;
+    logical.brake = (raw.pedals & 2u) != 0;
+    logical.clutch = (raw.pedals & 4u) != 0;
+    logical.dpad_x = raw.dpad_x;
+    logical.dpad_y = raw.dpad_y;
+    for (size_t w = 0; w < ButtonMask::kWords; ++w) {
+        logical.buttons.words[w] = raw.buttons[w];
+    }
+    logical.analog_mask = raw.analog_mask;
+    for (size_t p = 0; p < kPedalCount; ++p) {
+        logical.analog_pedals[p] = (raw.analog_mask >> p) & 1u ? raw.analog[p] : 0.0f;
+    }
+    const WheelInputState& prev = seat.logical;
+    const uint8_t pedals_dpad = PackPedalsDpad(raw.pedals, raw.dpad_x, raw.dpad_y);
+    const uint8_t prev_pedals_dpad = PackPedalsDpad(
+        static_cast<uint8_t>(prev.throttle | prev.brake << 1 | prev.clutch << 2), prev.dpad_x, prev.dpad_y);
+    const int64_t frame_us = ToSessionUs(raw.timestamp_ns);
+    const int64_t frame_offset_us = frame_us - event_us;
+
+    uint8_t fields = 0;
+    if (raw.sensitivity != seat.sensitivity) fields |= kFrameSensitivity;
+    if (pedals_dpad != prev_pedals_dpad) fields |= kFramePedalsDpad;
+    if (logical.buttons != prev.buttons) fields |= kFrameButtons;
+    if (logical.analog_mask != prev.analog_mask ||
+        std::memcmp(logical.analog_pedals.data(), prev.analog_pedals.data(), sizeof(float) * kPedalCount) != 0) {
+        fields |= kFrameAnalog;
+    }
+    if (raw.mouse_dx != 0) fields |= kFrameMouse;
+    if (raw.toggle) fields |= kFrameToggle;
+    if (raw.edge_count != 0) fields |= kFrameEdges;
+    if (frame_offset_us != 0) fields |= kFrameTimestamp;
+    g_encoded.push_back(fields);
+
+    if (fields & kFrameSensitivity) PutSigned(raw.sensitivity);
+    if (fields & kFramePedalsDpad) g_encoded.push_back(pedals_dpad);
+    if (fields & kFrameButtons) {
+        for (size_t w = 0; w < ButtonMask::kWords; ++w) {
+            PutVarint(logical.buttons.words[w] ^ prev.buttons.words[w]);
+        }
+    }
+    if (fields & kFrameAnalog) {
+        g_encoded.push_back(logical.analog_mask);
+        for (size_t p = 0; p < kPedalCount; ++p) {
+            if ((logical.analog_mask >> p) & 1u) {
+                PutBytes(&logical.analog_pedals[p], sizeof(float));
+            }
+        }
+    }
+    if (fields & kFrameMouse) PutSigned(raw.mouse_dx);
+    if (fields & kFrameEdges) {
+        PutVarint(raw.edge_count);
+        for (size_t i = 0; i < raw.edge_count; ++i) {
+            PutVarint(static_cast<uint64_t>(edges[i].button) << 1 | edges[i].pressed);
+            PutSigned(ToSessionUs(edges[i].timestamp_ns) - frame_us);
+        }
+    }
+    if (fields & kFrameTimestamp) PutSigned(frame_offset_us);
+
+    seat.sensitivity = raw.sensitivity;
+    seat.logical = logical;
+}
+
+void EncodeRecord(const char* record, int64_t time_ns) {
+    RawHeader header;
+    std::memcpy(&header, record, sizeof(header));
+    const char* payload = record + sizeof(RawHeader);
+    SeatEncoder& seat = g_seats[header.seat];
+    const int64_t time_us = ToSessionUs(time_ns);
+    g_encoded.push_back(static_cast<uint8_t>(header.kind | header.seat << 4));
+    // Threads are merged by timestamp within a batch; a record committed
+    // just after a drain can still be older than the last one written
+    PutSigned(time_us - g_last_time_us);
+    g_last_time_us = time_us;
+
+    switch (static_cast<EventKind>(header.kind)) {
+        case EventKind::InputFrame: {
+            RawFrame raw;
+            std::memcpy(&raw, payload, sizeof(raw));
+            RawEdge edges[kMaxEdges];
+            std::memcpy(edges, payload + sizeof(RawFrame), raw.edge_count * sizeof(RawEdge));
+            EncodeFrame(raw, edges, time_us, seat);
+            break;
+        }
+        case EventKind::FfbPacket: {
+            uint32_t command;
+            std::memcpy(&command, payload, sizeof(command));
+            const size_t size = header.payload_size - sizeof(command);
+            PutVarint(command);
+            PutVarint(size);
+            PutBytes(payload + sizeof(command), size);
+            break;
+        }
+        case EventKind::FfbForce: {
+            int16_t force;
+            std::memcpy(&force, payload, sizeof(force));
+            PutSigned(force);
+            break;
+        }
+        case EventKind::Report: {
+            HidReport report;
+            std::memcpy(report.data(), payload, kReportSize);
+            uint32_t changed = 0;
+            for (size_t i = 0; i < kReportSize; ++i) {
+                if (report[i] != seat.report[i]) changed |= 1u << i;
+            }
+            PutVarint(changed);
+            for (size_t i = 0; i < kReportSize; ++i) {
+                if ((changed >> i) & 1u) g_encoded.push_back(report[i]);
+            }
+            seat.report = report;
+            break;
+        }
+        case EventKind::Enable:
+        case EventKind::Neutral:
+            g_encoded.push_back(static_cast<uint8_t>(payload[0]));
+            break;
+    }
+}
+
+Header* FileHeader() {
+    return reinterpret_cast<Header*>(g_file.Data());
+}
+
+// Caller holds g_mutex. Encodes every committed record in timestamp order
+// and appends them to the file.
+void DrainLocked() {
+    g_batch.clear();
+    g_pending.clear();
+    g_rings.DrainLocked([](RecordRing& ring) {
+        size_t offset = g_batch.size();
+        ring.ReadAll(g_batch);
+        while (offset < g_batch.size()) {
+            RawHeader header;
+            std::memcpy(&header, g_batch.data() + offset, sizeof(header));
+            g_pending.push_back({tsc::ToSteadyNanos(header.ticks), offset});
+            offset += header.size;
+        }
+    });
+    if (g_pending.empty() || !g_file_open) {
+        return;
+    }
+
+    std::stable_sort(g_pending.begin(), g_pending.end(),
+                     [](const PendingRecord& a, const PendingRecord& b) { return a.time_ns < b.time_ns; });
+    g_encoded.clear();
+    for (const PendingRecord& pending : g_pending) {
+        EncodeRecord(g_batch.data() + pending.offset, pending.time_ns);
+    }
+    const size_t end = sizeof(Header) + static_cast<size_t>(g_data_size) + g_encoded.size();
+    if (end > g_file.Size() && !g_file.Grow(std::max(end, g_file.Size() * 2))) {
+        LOG_ERROR(kTag, "Could not grow " << g_path << "; recording stopped");
+        detail::recording.store(false, std::memory_order_relaxed);
+        g_file_open = false;
+        return;
+    }
+    std::memcpy(g_file.Data() + sizeof(Header) + g_data_size, g_encoded.data(), g_encoded.size());
+    g_data_size += g_encoded.size();
+    // Events before the size that covers them
+    std::atomic_thread_fence(std::memory_order_release);
+    FileHeader()->data_size = g_data_size;
+    g_events.fetch_add(g_pending.size(), std::memory_order_relaxed);
+}
+
+// Caller holds g_mutex
+Stats StatsLocked() {
+    Stats stats;
+    stats.events = g_events.load(std::memory_order_relaxed);
+    stats.bytes = sizeof(Header) + g_data_size;
+    stats.dropped = g_rings.DroppedLocked();
+    return stats;
+}
+
+void WriterLoop() {
+    while (true) {
+        const uint32_t reasons = g_wake.WaitUntil(Clock::now() + kDrainInterval);
+        {
+            std::lock_guard<std::mutex> lock(g_mutex);
+            DrainLocked();
+        }
+        if (reasons & kWakeStop) {
+            return;
+        }
+    }
+}
+
+RawEdge ToRawEdge(const ButtonEdge& edge) {
+    RawEdge raw{};
+    raw.timestamp_ns = ToNs(edge.timestamp);
+    raw.button = edge.button;
+    raw.pressed = edge.pressed ? 1 : 0;
+    return raw;
+}
+}  // namespace
+
+namespace detail {
+void WriteInputFrame(unsigned vjoy_id, const InputFrame& frame, int sensitivity) {
+    const size_t edge_count = std::min(frame.edges.size(), kMaxEdges);
+    char* payload = BeginRecord(EventKind::InputFrame, vjoy_id, sizeof(RawFrame) + edge_count * sizeof(RawEdge));
+    RawFrame raw{};
+    const WheelInputState& logical = frame.logical;
+    raw.timestamp_ns = ToNs(frame.timestamp);
+    raw.sensitivity = sensitivity;
+    raw.mouse_dx = frame.mouse_dx;
+    for (size_t w = 0; w < ButtonMask::kWords; ++w) {
+        raw.buttons[w] = logical.buttons.words[w];
+    }
+    for (size_t p = 0; p < kPedalCount; ++p) {
+        raw.analog[p] = logical.analog_pedals[p];
+    }
+    raw.pedals = static_cast<uint8_t>(logical.throttle | logical.brake << 1 | logical.clutch << 2);
+    raw.analog_mask = logical.analog_mask;
+    raw.dpad_x = logical.dpad_x;
+    raw.dpad_y = logical.dpad_y;
+    raw.toggle = frame.toggle_pressed ? 1 : 0;
+    raw.edge_count = static_cast<uint16_t>(edge_count);
+    std::memcpy(payload, &raw, sizeof(raw));
+    for (size_t i = 0; i < edge_count; ++i) {
+        const RawEdge edge = ToRawEdge(frame.edges[i]);
+        std::memcpy(payload + sizeof(RawFrame) + i * sizeof(RawEdge), &edge, sizeof(edge));
+    }
+    CommitRecord();
+}
+
+void WriteFfbPacket(unsigned vjoy_id, uint32_t command, const uint8_t* data, size_t size) {
+    size = data ? std::min(size, kMaxFfbPacket) : 0;
+    char* payload = BeginRecord(EventKind::FfbPacket, vjoy_id, sizeof(command) + size);
+    std::memcpy(payload, &command, sizeof(command));
+    if (size != 0) {
+        std::memcpy(payload + sizeof(command), data, size);
+    }
+    CommitRecord();
+}
+
+void WriteFfbForce(unsigned vjoy_id, int16_t force) {
+    char* payload = BeginRecord(EventKind::FfbForce, vjoy_id, sizeof(force));
+    std::memcpy(payload, &force, sizeof(force));
+    CommitRecord();
+}
+
+void WriteReport(unsigned vjoy_id, const HidReport& report) {
+    char* payload = BeginRecord(EventKind::Report, vjoy_id, kReportSize);
+    std::memcpy(payload, report.data(), kReportSize);
+    CommitRecord();
+}
+
+void WriteFlag(EventKind kind, unsigned vjoy_id, bool value) {
+    char* payload = BeginRecord(kind, vjoy_id, 1);
+    payload[0] = value ? 1 : 0;
+    CommitRecord();
+}
+}  // namespace detail
+
+bool Start(const std::string& path, std::chrono::nanoseconds physics_period, size_t seat_count) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (g_file_open) {
+        return false;
+    }
+    if (!g_file.Create(path, kInitialFileSize)) {
+        LOG_ERROR(kTag, "Cannot create session file " << path);
+        return false;
+    }
+    g_path = path;
+    g_file_open = true;
+    g_data_size = 0;
+    g_start_ns = NowNs();
+    g_last_time_us = 0;
+    for (SeatEncoder& seat : g_seats) {
+        seat = SeatEncoder();
+    }
+
+    Header header{};
+    header.magic = kMagic;
+    header.version = kFormatVersion;
+    header.start_unix_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                               std::chrono::system_clock::now().time_since_epoch())
+                               .count();
+    header.physics_period_ns = physics_period.count();
+    header.seat_count = static_cast<uint32_t>(seat_count);
+    std::memcpy(g_file.Data(), &header, sizeof(header));
+
+    g_writer = std::thread(WriterLoop);
+    detail::recording.store(true, std::memory_order_release);
+    LOG_INFO(kTag, "Recording session to " << path);
+    return true;
+}
+
+void Stop() {
+    if (!g_writer.joinable()) {
+        return;
+    }
+    detail::recording.store(false, std::memory_order_release);
+    // A thread that saw recording on just before this copies one record in
+    // well under a microsecond; let it commit before the last drain
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    g_wake.Signal(kWakeStop);
+    g_writer.join();
+
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_file.Close(sizeof(Header) + g_data_size);
+    g_file_open = false;
+    const Stats stats = StatsLocked();
+    LOG_INFO(kTag, "Recorded " << stats.events << " events (" << stats.bytes / 1024 << " KB) to " << g_path
+             << (stats.dropped ? ", " + std::to_string(stats.dropped) + " dropped (ring full)" : std::string()));
+}
+
+Stats GetStats() {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    return StatsLocked();
+}
+
+bool SessionReader::Open(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return Fail("cannot open file");
+    }
+    std::vector<uint8_t> file((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (file.size() < sizeof(Header)) {
+        return Fail("file shorter than the header");
+    }
+    std::memcpy(&header_, file.data(), sizeof(Header));
+    if (header_.magic != kMagic) {
+        return Fail("not a session recording");
+    }
+    if (header_.version != kFormatVersion) {
+        return Fail("unsupported format version");
+    }
+    // A file whose writer crashed is longer than data_size: the mapping's spare room
+    const size_t size = static_cast<size_t>(std::min<uint64_t>(header_.data_size, file.size() - sizeof(Header)));
+    data_.assign(file.begin() + sizeof(Header), file.begin() + sizeof(Header) + size);
+    offset_ = 0;
+    time_us_ = 0;
+    for (SeatState& seat : seats_) {
+        seat = SeatState();
+    }
+    error_.clear();
+    return true;
+}
+
+bool SessionReader::Fail(const char* what) {
+    error_ = what;
+    return false;
+}
+
+bool SessionReader::ReadVarint(uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (offset_ >= data_.size()) {
+            return false;
+        }
+        const uint8_t byte = data_[offset_++];
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool SessionReader::ReadSigned(int64_t& value) {
+    uint64_t raw;
+    if (!ReadVarint(raw)) {
+        return false;
+    }
+    value = static_cast<int64_t>(raw >> 1) ^ -static_cast<int64_t>(raw & 1);
+    return true;
+}
+
+bool SessionReader::ReadBytes(void* out, size_t size) {
+    if (data_.size() - offset_ < size) {
+        return false;
+    }
+    std::memcpy(out, data_.data() + offset_, size);
+    offset_ += size;
+    return true;
+}
+
+bool SessionReader::Next(Event& event) {
+    if (offset_ >= data_.size()) {
+        return false;
+    }
+    const uint8_t tag = data_[offset_++];
+    int64_t delta_us;
+    if (!ReadSigned(delta_us)) {
+        return Fail("truncated event");
+    }
+    time_us_ += delta_us;
+    event.kind = static_cast<EventKind>(tag & 0x0F);
+    event.vjoy_id = (tag >> 4) + 1u;
+    event.time = Clock::time_point(std::chrono::microseconds(time_us_));
+    SeatState& seat = seats_[tag >> 4];
+
+    switch (event.kind) {
+        case EventKind::InputFrame: {
+            uint8_t fields;
+            if (!ReadBytes(&fields, 1)) {
+                return Fail("truncated input frame");
+            }
+            WheelInputState& logical = seat.logical;
+            int64_t value = 0;
+            uint64_t bits = 0;
+            if (fields & kFrameSensitivity) {
+                if (!ReadSigned(value)) return Fail("truncated input frame");
+                seat.sensitivity = static_cast<int>(value);
+            }
+            if (fields & kFramePedalsDpad) {
+                uint8_t packed;
+                if (!ReadBytes(&packed, 1)) return Fail("truncated input frame");
+                logical.throttle = (packed & 1u) != 0;
+                logical.brake = (packed & 2u) != 0;
+                logical.clutch = (packed & 4u) != 0;
+                logical.dpad_x = static_cast<int8_t>(((packed >> 3) & 3) - 1);
+                logical.dpad_y = static_cast<int8_t>(((packed >> 5) & 3) - 1);
+            }
+            if (fields & kFrameButtons) {
+                for (size_t w = 0; w < ButtonMask::kWords; ++w) {
+                    if (!ReadVarint(bits)) return Fail("truncated input frame");
+                    logical.buttons.words[w] ^= bits;
+                }
+            }
+            if (fields & kFrameAnalog) {
+                if (!ReadBytes(&logical.analog_mask, 1)) return Fail("truncated input frame");
+                for (size_t p = 0; p < kPedalCount; ++p) {
+                    logical.analog_pedals[p] = 0.0f;
+                    if (((logical.analog_mask >> p) & 1u) && !ReadBytes(&logical.analog_pedals[p], sizeof(float))) {
+                        return Fail("truncated input frame");
+                    }
+                }
+            }
+            InputFrame& frame = event.frame;
+            frame.logical = logical;
+            frame.mouse_dx = 0;
+            frame.toggle_pressed = (fields & kFrameToggle) != 0;
+            frame.trace_flow = 0;
+            frame.edges.clear();
+            if (fields & kFrameMouse) {
+                if (!ReadSigned(value)) return Fail("truncated input frame");
+                frame.mouse_dx = static_cast<int>(value);
+            }
+            std::vector<std::pair<uint64_t, int64_t>> edges;
+            if (fields & kFrameEdges) {
+                uint64_t count;
+                if (!ReadVarint(count) || count > kMaxEdges) return Fail("bad edge list");
+                for (uint64_t i = 0; i < count; ++i) {
+                    if (!ReadVarint(bits) || !ReadSigned(value)) return Fail("truncated input frame");
+                    edges.emplace_back(bits, value);
+                }
+            }
+            int64_t frame_offset_us = 0;
+            if ((fields & kFrameTimestamp) && !ReadSigned(frame_offset_us)) {
+                return Fail("truncated input frame");
+            }
+            frame.timestamp = event.time + std::chrono::microseconds(frame_offset_us);
+            for (const auto& edge : edges) {
+                ButtonEdge decoded;
+                decoded.button = static_cast<uint8_t>(edge.first >> 1);
+                decoded.pressed = (edge.first & 1u) != 0;
+                decoded.timestamp = frame.timestamp + std::chrono::microseconds(edge.second);
+                frame.edges.push_back(decoded);
+            }
+            event.sensitivity = seat.sensitivity;
+            return true;
+        }
+        case EventKind::FfbPacket: {
+            uint64_t command;
+            uint64_t size;
+            if (!ReadVarint(command) || !ReadVarint(size) || size > kMaxFfbPacket) {
+                return Fail("bad FFB packet");
+            }
+            event.ffb_command = static_cast<uint32_t>(command);
+            event.ffb_data.resize(static_cast<size_t>(size));
+            if (!ReadBytes(event.ffb_data.data(), event.ffb_data.size())) {
+                return Fail("truncated FFB packet");
+            }
+            return true;
+        }
+        case EventKind::FfbForce: {
+            int64_t force;
+            if (!ReadSigned(force)) {
+                return Fail("truncated FFB force");
+            }
+            event.force = static_cast<int16_t>(force);
+            return true;
+        }
+        case EventKind::Report: {
+            uint64_t changed;
+            if (!ReadVarint(changed)) {
+                return Fail("truncated report");
+            }
+            for (size_t i = 0; i < kReportSize; ++i) {
+                if (((changed >> i) & 1u) && !ReadBytes(&seat.report[i], 1)) {
+                    return Fail("truncated report");
+                }
+            }
+            event.report = seat.report;
+            return true;
+        }
+        case EventKind::Enable:
+        case EventKind::Neutral: {
+            uint8_t enable;
+            if (!ReadBytes(&enable, 1)) {
+                return Fail("truncated flag event");
+            }
+            event.enable = enable != 0;
+            return true;
+        }
+    }
+    return Fail("unknown event kind");
+}
+
+}  // namespace session
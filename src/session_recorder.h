@@ -0,0 +1,158 @@
+#ifndef SESSION_RECORDER_H
+#define SESSION_RECORDER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "input/wheel_input.h"
+#include "wheel_types.h"
+
+// Records what a session fed into and got out of each WheelDevice: input
+// frames, raw FFB packets and the forces decoded from them, enable/disable,
+// neutral resets and every submitted report. The hot threads copy a fixed-layout record
+// into their own SPSC ring and never block or allocate; a writer thread
+// merges the rings by timestamp, delta/varint encodes the records and appends
+// them to a memory-mapped file. The header's data size is updated after each
+// batch, so the file of a crashed emulator is readable up to the last batch.
+//
+// File: Header, then events. Each event is a tag byte (kind | seat << 4),
+// the zigzag varint time since the previous event in microseconds and the
+// kind's payload, most fields as changes from the seat's previous event of
+// that kind.
+namespace session {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr uint32_t kMagic = 0x43455257;  // "WREC"
+constexpr uint32_t kFormatVersion = 1;
+
+enum class EventKind : uint8_t {
+    InputFrame = 1,
+    // Raw vJoy FFB packet (Windows only)
+    FfbPacket = 2,
+    // Constant force passed to ApplyFFBForce()
+    FfbForce = 3,
+    Report = 4,
+    Enable = 5,
+    // SendNeutral(); `enable` holds reset_ffb
+    Neutral = 6,
+};
+
+struct Header {
+    uint32_t magic;
+    uint32_t version;
+    // Event bytes following the header; the last complete batch
+    uint64_t data_size;
+    int64_t start_unix_ms;
+    int64_t physics_period_ns;
+    uint32_t seat_count;
+    uint32_t reserved[7];
+};
+static_assert(sizeof(Header) == 64, "Header layout is part of the file format");
+
+namespace detail {
+extern std::atomic<bool> recording;
+void WriteInputFrame(unsigned vjoy_id, const InputFrame& frame, int sensitivity);
+void WriteFfbPacket(unsigned vjoy_id, uint32_t command, const uint8_t* data, size_t size);
+void WriteFfbForce(unsigned vjoy_id, int16_t force);
+void WriteReport(unsigned vjoy_id, const HidReport& report);
+void WriteFlag(EventKind kind, unsigned vjoy_id, bool value);
+}
+
+inline bool Recording() {
+    return detail::recording.load(std::memory_order_relaxed);
+}
+
+// Creates `path` and starts the writer thread
+bool Start(const std::string& path, std::chrono::nanoseconds physics_period, size_t seat_count);
+// Writes what the rings still hold, trims the file and logs the totals
+void Stop();
+
+struct Stats {
+    uint64_t events = 0;
+    uint64_t bytes = 0;
+    // A thread's ring was full
+    uint64_t dropped = 0;
+};
+Stats GetStats();
+
+// Each is one relaxed load while not recording. `vjoy_id` (1-16) names the seat.
+inline void RecordInputFrame(unsigned vjoy_id, const InputFrame& frame, int sensitivity) {
+    if (Recording()) detail::WriteInputFrame(vjoy_id, frame, sensitivity);
+}
+
+inline void RecordFfbPacket(unsigned vjoy_id, uint32_t command, const uint8_t* data, size_t size) {
+    if (Recording()) detail::WriteFfbPacket(vjoy_id, command, data, size);
+}
+
+inline void RecordFfbForce(unsigned vjoy_id, int16_t force) {
+    if (Recording()) detail::WriteFfbForce(vjoy_id, force);
+}
+
+inline void RecordReport(unsigned vjoy_id, const HidReport& report) {
+    if (Recording()) detail::WriteReport(vjoy_id, report);
+}
+
+inline void RecordEnable(unsigned vjoy_id, bool enable) {
+    if (Recording()) detail::WriteFlag(EventKind::Enable, vjoy_id, enable);
+}
+
+inline void RecordNeutral(unsigned vjoy_id, bool reset_ffb) {
+    if (Recording()) detail::WriteFlag(EventKind::Neutral, vjoy_id, reset_ffb);
+}
+
+// One decoded event. Times are on the session clock: Clock::time_point{}
+// is the start of the recording, for frame and edge timestamps too.
+struct Event {
+    EventKind kind = EventKind::InputFrame;
+    unsigned vjoy_id = 1;
+    Clock::time_point time;
+    // InputFrame
+    InputFrame frame;
+    int sensitivity = 0;
+    // FfbForce
+    int16_t force = 0;
+    // Report
+    HidReport report{};
+    // Enable, Neutral (reset_ffb)
+    bool enable = false;
+    // FfbPacket
+    uint32_t ffb_command = 0;
+    std::vector<uint8_t> ffb_data;
+};
+
+class SessionReader {
+public:
+    bool Open(const std::string& path);
+    const Header& GetHeader() const { return header_; }
+    // False at the end of the data or at a malformed event (see Error())
+    bool Next(Event& event);
+    const std::string& Error() const { return error_; }
+
+private:
+    struct SeatState {
+        int sensitivity = 0;
+        WheelInputState logical;
+        HidReport report{};
+    };
+
+    bool ReadVarint(uint64_t& value);
+    bool ReadSigned(int64_t& value);
+    bool ReadBytes(void* out, size_t size);
+    bool Fail(const char* what);
+
+    Header header_{};
+    std::vector<uint8_t> data_;
+    size_t offset_ = 0;
+    int64_t time_us_ = 0;
+    SeatState seats_[kMaxSeats];
+    std::string error_;
+};
+
+}  // namespace session
+
+#endif  // SESSION_RECORDER_H
@@ -0,0 +1,266 @@
+#include "shared_stats.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <new>
+
+#include "logging/logger.h"
+#include "metrics.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace shared_stats {
+
+namespace {
+constexpr const char* kTag = "shared_stats";
+
+static_assert(metrics::kCounterCount <= kMaxCounters, "raise kMaxCounters (and kLayoutVersion)");
+static_assert(metrics::kGaugeCount <= kMaxGauges, "raise kMaxGauges (and kLayoutVersion)");
+static_assert(metrics::kHistogramCount <= kMaxHistograms, "raise kMaxHistograms (and kLayoutVersion)");
+
+void CopyName(char (&out)[kNameLength], const char* name) {
+    std::strncpy(out, name, kNameLength - 1);
+    out[kNameLength - 1] = '\0';
+}
+
+uint32_t CurrentProcessId() {
+#ifdef _WIN32
+    return static_cast<uint32_t>(GetCurrentProcessId());
+#else
+    return static_cast<uint32_t>(getpid());
+#endif
+}
+
+// True if the emulator that published `header` still runs. A reused pid reads
+// as alive; the user then sees the warning and can pick another name.
+bool WriterAlive(const Header& header) {
+    if (header.magic != kMagic || header.writer_pid == 0 || header.writer_pid == CurrentProcessId()) {
+        return false;
+    }
+#ifdef _WIN32
+    HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, static_cast<DWORD>(header.writer_pid));
+    if (!process) {
+        // Gone, or running as another user: only the former is common
+        return GetLastError() == ERROR_ACCESS_DENIED;
+    }
+    const bool alive = WaitForSingleObject(process, 0) == WAIT_TIMEOUT;
+    CloseHandle(process);
+    return alive;
+#else
+    return kill(static_cast<pid_t>(header.writer_pid), 0) == 0 || errno == EPERM;
+#endif
+}
+
+#ifndef _WIN32
+// The writer of an existing segment, read through a header-only mapping
+bool ExistingWriterAlive(const std::string& os_name) {
+    const int fd = shm_open(os_name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info {};
+    bool alive = false;
+    if (fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= sizeof(Header)) {
+        void* view = mmap(nullptr, sizeof(Header), PROT_READ, MAP_SHARED, fd, 0);
+        if (view != MAP_FAILED) {
+            alive = WriterAlive(*static_cast<const Header*>(view));
+            munmap(view, sizeof(Header));
+        }
+    }
+    close(fd);
+    return alive;
+}
+#endif
+}  // namespace
+
+SharedStats::~SharedStats() {
+    Close();
+}
+
+bool SharedStats::Map(const std::string& name, bool create) {
+    const size_t size = sizeof(Segment);
+#ifdef _WIN32
+    os_name_ = "Local\\" + name;
+    HANDLE mapping = create ? CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0,
+                                                 static_cast<DWORD>(size), os_name_.c_str())
+                            : OpenFileMappingA(FILE_MAP_READ, FALSE, os_name_.c_str());
+    if (!mapping) {
+        return false;
+    }
+    const bool existed = create && GetLastError() == ERROR_ALREADY_EXISTS;
+    // An existing mapping keeps its size; an older, smaller layout fails here
+    void* view = MapViewOfFile(mapping, create ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, size);
+    if (!view) {
+        if (existed) {
+            LOG_WARN(kTag, "Shared memory " << os_name_ << " already exists with another layout");
+        }
+        CloseHandle(mapping);
+        return false;
+    }
+    // The mapping outlives its emulator while a reader holds it open. Unless
+    // that emulator still runs, it is reused: the reader then follows this one.
+    if (existed && WriterAlive(static_cast<const Segment*>(view)->header)) {
+        LOG_WARN(kTag, "Shared memory " << os_name_ << " is in use by a running emulator (pid "
+                       << static_cast<const Segment*>(view)->header.writer_pid << ")");
+        UnmapViewOfFile(view);
+        CloseHandle(mapping);
+        return false;
+    }
+    mapping_ = mapping;
+#else
+    os_name_ = "/" + name;
+    if (create) {
+        if (ExistingWriterAlive(os_name_)) {
+            LOG_WARN(kTag, "Shared memory " << os_name_ << " is in use by a running emulator");
+            return false;
+        }
+        // A segment left behind by a crashed emulator is replaced
+        shm_unlink(os_name_.c_str());
+    }
+    const int fd = create ? shm_open(os_name_.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644)
+                          : shm_open(os_name_.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        return false;
+    }
+    if (create && ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        close(fd);
+        shm_unlink(os_name_.c_str());
+        return false;
+    }
+    struct stat info {};
+    if (!create && (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < size)) {
+        close(fd);
+        return false;
+    }
+    void* view = mmap(nullptr, size, create ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    if (view == MAP_FAILED) {
+        close(fd);
+        if (create) {
+            shm_unlink(os_name_.c_str());
+        }
+        return false;
+    }
+    fd_ = fd;
+#endif
+    segment_ = static_cast<Segment*>(view);
+    owner_ = create;
+    return true;
+}
+
+bool SharedStats::Create(const std::string& name, size_t seat_count) {
+    Close();
+    if (!Map(name, true)) {
+        LOG_WARN(kTag, "Could not create shared memory " << name);
+        return false;
+    }
+    // A fresh mapping starts zeroed, a reused one (Windows) holds the last
+    // emulator's data: hide it, construct the seqlocks, then describe the
+    // layout, then publish the magic so readers never see half a header
+    segment_->header.magic = 0;
+    std::atomic_thread_fence(std::memory_order_release);
+    new (segment_) Segment();
+    Header& header = segment_->header;
+    header.version = kLayoutVersion;
+    header.header_size = sizeof(Header);
+    header.total_size = sizeof(Segment);
+    header.seat_count = static_cast<uint32_t>(std::min(seat_count, kMaxSeats));
+    header.seat_state_size = sizeof(SeatState);
+    header.metrics_state_size = sizeof(MetricsState);
+    header.counter_count = static_cast<uint32_t>(metrics::kCounterCount);
+    header.gauge_count = static_cast<uint32_t>(metrics::kGaugeCount);
+    header.histogram_count = static_cast<uint32_t>(metrics::kHistogramCount);
+    header.writer_pid = CurrentProcessId();
+    header.start_ns = SteadyNanos(std::chrono::steady_clock::now());
+    for (size_t i = 0; i < metrics::kCounterCount; ++i) {
+        CopyName(header.counter_names[i], metrics::CounterName(static_cast<metrics::Counter>(i)));
+    }
+    for (size_t i = 0; i < metrics::kGaugeCount; ++i) {
+        CopyName(header.gauge_names[i], metrics::GaugeName(static_cast<metrics::Gauge>(i)));
+    }
+    for (size_t i = 0; i < metrics::kHistogramCount; ++i) {
+        CopyName(header.histogram_names[i], metrics::HistogramName(static_cast<metrics::Histogram>(i)));
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    header.magic = kMagic;
+    LOG_INFO(kTag, "Publishing wheel state and metrics in shared memory " << os_name_ << " ("
+                   << sizeof(Segment) << " bytes, layout v" << kLayoutVersion << ")");
+    return true;
+}
+
+bool SharedStats::Open(const std::string& name) {
+    Close();
+    if (!Map(name, false)) {
+        return false;
+    }
+    const Header& header = segment_->header;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (header.magic != kMagic || header.version != kLayoutVersion || header.total_size > sizeof(Segment)) {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void SharedStats::Close() {
+    if (!segment_) {
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(segment_);
+    CloseHandle(static_cast<HANDLE>(mapping_));
+    mapping_ = nullptr;
+#else
+    munmap(segment_, sizeof(Segment));
+    close(fd_);
+    fd_ = -1;
+    if (owner_) {
+        shm_unlink(os_name_.c_str());
+    }
+#endif
+    segment_ = nullptr;
+    owner_ = false;
+}
+
+Seqlock<SeatState>* SharedStats::SeatSlot(size_t seat) {
+    if (!segment_ || !owner_ || seat >= segment_->header.seat_count) {
+        return nullptr;
+    }
+    return &segment_->seats[seat].state;
+}
+
+void SharedStats::PublishMetrics(const metrics::Snapshot& snapshot) {
+    if (!segment_ || !owner_) {
+        return;
+    }
+    MetricsState state{};
+    state.taken_ns = SteadyNanos(snapshot.taken);
+    for (size_t i = 0; i < metrics::kCounterCount; ++i) {
+        state.counters[i] = snapshot.counters[i];
+    }
+    for (size_t i = 0; i < metrics::kGaugeCount; ++i) {
+        state.gauges[i] = snapshot.gauges[i];
+    }
+    for (size_t i = 0; i < metrics::kHistogramCount; ++i) {
+        const metrics::HistogramSnapshot& histogram = snapshot.histograms[i];
+        HistogramSummary& summary = state.histograms[i];
+        summary.count = histogram.count;
+        summary.mean_ns = histogram.Mean();
+        summary.p50_ns = histogram.Quantile(0.5);
+        summary.p99_ns = histogram.Quantile(0.99);
+        summary.p999_ns = histogram.Quantile(0.999);
+        summary.max_ns = histogram.max;
+    }
+    segment_->metrics.Write(state);
+}
+
+}  // namespace shared_stats
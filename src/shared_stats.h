@@ -0,0 +1,149 @@
+#ifndef SHARED_STATS_H
+#define SHARED_STATS_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "cache_line.h"
+#include "seqlock.h"
+#include "wheel_types.h"
+
+namespace metrics {
+struct Snapshot;
+}
+
+// Live wheel state and the metrics snapshot in a named shared-memory segment
+// (CreateFileMapping "Local\<name>" on Windows, shm_open "/<name>" elsewhere)
+// for overlays and logging rigs. Every block is a seqlock, so readers poll at
+// any rate without a syscall and never block the emulator: each seat's block
+// is written by the thread running its physics tick, the metrics block by a
+// 10 Hz publisher thread.
+//
+// Layout rules for readers in other languages: all fields are little-endian,
+// naturally aligned and fixed-size. kLayoutVersion changes whenever an existing
+// field moves or changes meaning; new fields are only appended to a block and
+// readers check the *_size fields. A seqlock block is a uint32 sequence (odd
+// while being written) followed by the payload, which readers copy and accept
+// only if the sequence was even and unchanged.
+namespace shared_stats {
+
+constexpr const char* kDefaultName = "wheel-emulator-stats";
+constexpr uint32_t kMagic = 0x53484C57;  // "WLHS" in memory
+constexpr uint32_t kLayoutVersion = 1;
+constexpr size_t kNameLength = 32;
+constexpr size_t kMaxCounters = 32;
+constexpr size_t kMaxGauges = 8;
+constexpr size_t kMaxHistograms = 8;
+
+// Published by every physics tick that ran (parked seats publish nothing new)
+struct SeatState {
+    // steady_clock of the publishing tick (QueryPerformanceCounter / CLOCK_MONOTONIC ns)
+    uint64_t tick_ns;
+    // LifecycleState
+    uint32_t lifecycle;
+    // Game force after the vJoy scaling, internal sign (+-6096)
+    int32_t ffb_force;
+    // Reported axis, -32768..32767
+    float steering;
+    // Mouse steering and the FFB spring/damper offset it is summed with
+    float user_steering;
+    float ffb_offset;
+    float ffb_velocity;
+    float ffb_gain;
+    // Percent, 0..100
+    float throttle;
+    float brake;
+    float clutch;
+};
+
+struct HistogramSummary {
+    uint64_t count;
+    uint64_t mean_ns;
+    uint64_t p50_ns;
+    uint64_t p99_ns;
+    uint64_t p999_ns;
+    uint64_t max_ns;
+};
+
+// Totals since start, as metrics::Collect() returns them
+struct MetricsState {
+    uint64_t taken_ns;
+    uint64_t counters[kMaxCounters];
+    int64_t gauges[kMaxGauges];
+    HistogramSummary histograms[kMaxHistograms];
+};
+
+struct Header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t total_size;
+    uint32_t seat_count;
+    uint32_t seat_state_size;
+    uint32_t metrics_state_size;
+    uint32_t counter_count;
+    uint32_t gauge_count;
+    uint32_t histogram_count;
+    uint32_t writer_pid;
+    uint32_t reserved;
+    // steady_clock when the emulator started, same clock as tick_ns
+    uint64_t start_ns;
+    char counter_names[kMaxCounters][kNameLength];
+    char gauge_names[kMaxGauges][kNameLength];
+    char histogram_names[kMaxHistograms][kNameLength];
+};
+
+// The whole segment; seat blocks and the metrics block each own a cache line
+// so seats ticking on different workers do not share one
+struct Segment {
+    Header header;
+    alignas(kCacheLineSize) Seqlock<MetricsState> metrics;
+    struct alignas(kCacheLineSize) SeatBlock {
+        Seqlock<SeatState> state;
+    };
+    SeatBlock seats[kMaxSeats];
+};
+
+inline uint64_t SteadyNanos(std::chrono::steady_clock::time_point time) {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count());
+}
+
+// Owns the mapping. The emulator creates the segment; readers open it read-only.
+class SharedStats {
+public:
+    SharedStats() = default;
+    ~SharedStats();
+    SharedStats(const SharedStats&) = delete;
+    SharedStats& operator=(const SharedStats&) = delete;
+
+    bool Create(const std::string& name, size_t seat_count);
+    // Fails if the segment is missing or its magic/version do not match
+    bool Open(const std::string& name);
+    void Close();
+    bool IsOpen() const { return segment_ != nullptr; }
+
+    // Writer side: one thread per seat block
+    Seqlock<SeatState>* SeatSlot(size_t seat);
+    void PublishMetrics(const metrics::Snapshot& snapshot);
+
+    const Segment* View() const { return segment_; }
+
+private:
+    bool Map(const std::string& name, bool create);
+
+    Segment* segment_ = nullptr;
+    bool owner_ = false;
+    std::string os_name_;
+#ifdef _WIN32
+    void* mapping_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+};
+
+}  // namespace shared_stats
+
+#endif  // SHARED_STATS_H
@@ -0,0 +1,602 @@
+#include "signal_scope.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <thread>
+
+#include "bit_util.h"
+#include "logging/logger.h"
+#include "spsc_ring.h"
+#include "thread_rings.h"
+#include "wake_signal.h"
+#include "wheel_types.h"
+
+namespace scope {
+
+namespace detail {
+std::atomic<bool> enabled{false};
+}
+
+namespace {
+constexpr const char* kTag = "scope";
+
+// Per-thread ring of rows; a power of two. 16 s of one seat at 1 kHz.
+constexpr size_t kRingRows = size_t{1} << 14;
+// The writer drains the rings this often, or when a ring reaches half full
+constexpr auto kDrainInterval = std::chrono::milliseconds(50);
+constexpr uint32_t kWakeStop = 1u << 0;
+constexpr uint32_t kWakeDrain = 1u << 1;
+
+struct Row {
+    int64_t time_ns;
+    Signals signals;
+    uint8_t seat;
+};
+
+struct RowRing : SpscRing<Row, kRingRows> {};
+
+std::mutex g_mutex;  // rings, block builders and the file
+ThreadRings<RowRing> g_rings(g_mutex);
+std::vector<Row> g_seat_rows[kMaxSeats];
+std::vector<uint8_t> g_block;
+std::vector<uint8_t> g_column;
+std::vector<int64_t> g_ints;
+std::vector<uint64_t> g_residuals;
+std::vector<float> g_floats;
+std::FILE* g_file = nullptr;
+std::string g_path;
+bool g_write_failed = false;
+int64_t g_start_ns = 0;
+uint64_t g_rows = 0;
+uint64_t g_bytes = 0;
+
+WakeSignal g_wake;
+std::thread g_writer;
+
+int64_t ToNs(Clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+uint64_t ZigZag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t UnZigZag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+void PutVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+bool GetVarint(const uint8_t* data, size_t size, size_t& offset, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (offset >= size) {
+            return false;
+        }
+        const uint8_t byte = data[offset++];
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int BitWidth(uint64_t value) {
+    return value == 0 ? 0 : 64 - CountLeadingZeros64(value);
+}
+
+uint32_t FloatBits(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+float BitsFloat(uint32_t bits) {
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Appends bits least significant first
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<uint8_t>& out) : out_(out) {}
+
+    void Put(uint64_t value, int bits) {
+        for (int done = 0; done < bits;) {
+            if (used_ == 0) {
+                out_.push_back(0);
+            }
+            const int take = std::min(8 - used_, bits - done);
+            out_.back() |= static_cast<uint8_t>(((value >> done) & ((1u << take) - 1)) << used_);
+            used_ = (used_ + take) & 7;
+            done += take;
+        }
+    }
+
+private:
+    std::vector<uint8_t>& out_;
+    int used_ = 0;
+};
+
+class BitReader {
+public:
+    BitReader(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+    bool Get(int bits, uint64_t& value) {
+        value = 0;
+        for (int done = 0; done < bits;) {
+            const size_t byte = position_ / 8;
+            if (byte >= size_) {
+                return false;
+            }
+            const int used = static_cast<int>(position_ % 8);
+            const int take = std::min(8 - used, bits - done);
+            value |= static_cast<uint64_t>((data_[byte] >> used) & ((1u << take) - 1)) << done;
+            position_ += static_cast<size_t>(take);
+            done += take;
+        }
+        return true;
+    }
+
+private:
+    const uint8_t* data_;
+    size_t size_;
+    size_t position_ = 0;
+};
+
+// The first value (and first delta) as varints, the remaining residuals
+// bit-packed at the width of the largest
+void EncodeInts(const std::vector<int64_t>& values, Codec codec, std::vector<uint8_t>& out) {
+    const size_t leading = codec == Codec::DeltaOfDelta ? 2 : 1;
+    int64_t previous = 0;
+    int64_t previous_delta = 0;
+    g_residuals.clear();
+    for (size_t i = 0; i < values.size(); ++i) {
+        const int64_t delta = values[i] - previous;
+        const int64_t residual = (codec == Codec::DeltaOfDelta && i >= leading) ? delta - previous_delta : delta;
+        previous = values[i];
+        previous_delta = delta;
+        if (i < leading) {
+            PutVarint(out, ZigZag(residual));
+        } else {
+            g_residuals.push_back(ZigZag(residual));
+        }
+    }
+    int width = 0;
+    for (uint64_t residual : g_residuals) {
+        width = std::max(width, BitWidth(residual));
+    }
+    out.push_back(static_cast<uint8_t>(width));
+    BitWriter bits(out);
+    for (uint64_t residual : g_residuals) {
+        bits.Put(residual, width);
+    }
+}
+
+// Gorilla: '0' repeats the previous value; '10' and the meaningful bits of
+// the XOR when they fit the previous window; '11', 5 bits of leading zeros,
+// 5 bits of length - 1 and the meaningful bits otherwise
+void EncodeFloats(const std::vector<float>& values, std::vector<uint8_t>& out) {
+    BitWriter bits(out);
+    uint32_t previous = 0;
+    int window_lead = 0;
+    int window_trail = 0;
+    bool window = false;
+    for (float value : values) {
+        const uint32_t current = FloatBits(value);
+        const uint32_t x = current ^ previous;
+        previous = current;
+        if (x == 0) {
+            bits.Put(0, 1);
+            continue;
+        }
+        const int lead = std::min(CountLeadingZeros64(x) - 32, 31);
+        const int trail = CountTrailingZeros64(x);
+        if (window && lead >= window_lead && trail >= window_trail) {
+            bits.Put(1, 2);
+            bits.Put(x >> window_trail, 32 - window_lead - window_trail);
+            continue;
+        }
+        const int length = 32 - lead - trail;
+        bits.Put(3, 2);
+        bits.Put(static_cast<uint64_t>(lead), 5);
+        bits.Put(static_cast<uint64_t>(length - 1), 5);
+        bits.Put(x >> trail, length);
+        window = true;
+        window_lead = lead;
+        window_trail = trail;
+    }
+}
+
+bool DecodeInts(const uint8_t* data, size_t size, Codec codec, size_t count, std::vector<int64_t>& values) {
+    values.clear();
+    const size_t leading = codec == Codec::DeltaOfDelta ? 2 : 1;
+    size_t offset = 0;
+    int64_t previous = 0;
+    int64_t delta = 0;
+    for (size_t i = 0; i < std::min(count, leading); ++i) {
+        uint64_t raw;
+        if (!GetVarint(data, size, offset, raw)) {
+            return false;
+        }
+        delta = UnZigZag(raw);
+        previous += delta;
+        values.push_back(previous);
+    }
+    if (count <= leading) {
+        return true;
+    }
+    if (offset >= size) {
+        return false;
+    }
+    const int width = data[offset++];
+    if (width > 64) {
+        return false;
+    }
+    BitReader bits(data + offset, size - offset);
+    for (size_t i = leading; i < count; ++i) {
+        uint64_t raw;
+        if (!bits.Get(width, raw)) {
+            return false;
+        }
+        const int64_t residual = UnZigZag(raw);
+        delta = codec == Codec::DeltaOfDelta ? delta + residual : residual;
+        previous += delta;
+        values.push_back(previous);
+    }
+    return true;
+}
+
+bool DecodeFloats(const uint8_t* data, size_t size, size_t count, std::vector<float>& values) {
+    values.clear();
+    BitReader bits(data, size);
+    uint32_t previous = 0;
+    int window_lead = 0;
+    int window_trail = 0;
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t control;
+        if (!bits.Get(1, control)) {
+            return false;
+        }
+        if (control != 0) {
+            uint64_t new_window;
+            if (!bits.Get(1, new_window)) {
+                return false;
+            }
+            if (new_window != 0) {
+                uint64_t lead, length;
+                if (!bits.Get(5, lead) || !bits.Get(5, length)) {
+                    return false;
+                }
+                window_lead = static_cast<int>(lead);
+                window_trail = 32 - window_lead - static_cast<int>(length + 1);
+                if (window_trail < 0) {
+                    return false;
+                }
+            }
+            uint64_t meaningful;
+            if (!bits.Get(32 - window_lead - window_trail, meaningful)) {
+                return false;
+            }
+            previous ^= static_cast<uint32_t>(meaningful << window_trail);
+        }
+        values.push_back(BitsFloat(previous));
+    }
+    return true;
+}
+
+float SignalColumn(const Signals& signals, size_t column) {
+    switch (column) {
+        case 2:
+            return signals.commanded_force;
+        case 3:
+            return signals.filtered_force;
+        case 4:
+            return signals.spring;
+        case 5:
+            return signals.target_offset;
+        case 6:
+            return signals.offset;
+        case 7:
+            return signals.velocity;
+        case 8:
+            return signals.dt;
+        default:
+            return signals.steering;
+    }
+}
+
+void SetSignalColumn(Signals& signals, size_t column, float value) {
+    switch (column) {
+        case 2:
+            signals.commanded_force = value;
+            break;
+        case 3:
+            signals.filtered_force = value;
+            break;
+        case 4:
+            signals.spring = value;
+            break;
+        case 5:
+            signals.target_offset = value;
+            break;
+        case 6:
+            signals.offset = value;
+            break;
+        case 7:
+            signals.velocity = value;
+            break;
+        case 8:
+            signals.dt = value;
+            break;
+        default:
+            signals.steering = value;
+            break;
+    }
+}
+
+// Caller holds g_mutex. Encodes one seat's rows as a block and appends it.
+void WriteBlockLocked(size_t seat) {
+    std::vector<Row>& rows = g_seat_rows[seat];
+    if (rows.empty() || g_write_failed) {
+        rows.clear();
+        return;
+    }
+    g_block.clear();
+    for (size_t column = 0; column < kColumnCount; ++column) {
+        g_column.clear();
+        if (kColumns[column].codec == Codec::FloatXor) {
+            g_floats.clear();
+            for (const Row& row : rows) {
+                g_floats.push_back(SignalColumn(row.signals, column));
+            }
+            EncodeFloats(g_floats, g_column);
+        } else {
+            g_ints.clear();
+            for (const Row& row : rows) {
+                g_ints.push_back(column == 0 ? row.time_ns : row.signals.force);
+            }
+            EncodeInts(g_ints, kColumns[column].codec, g_column);
+        }
+        PutVarint(g_block, g_column.size());
+        g_block.insert(g_block.end(), g_column.begin(), g_column.end());
+    }
+
+    BlockHeader header{};
+    header.rows = static_cast<uint32_t>(rows.size());
+    header.seat = static_cast<uint8_t>(seat);
+    header.column_count = static_cast<uint8_t>(kColumnCount);
+    header.size = static_cast<uint32_t>(g_block.size());
+    if (std::fwrite(&header, sizeof(header), 1, g_file) != 1 ||
+        std::fwrite(g_block.data(), 1, g_block.size(), g_file) != g_block.size()) {
+        LOG_ERROR(kTag, "Could not write " << g_path << "; scope stopped");
+        detail::enabled.store(false, std::memory_order_relaxed);
+        g_write_failed = true;
+    } else {
+        g_rows += rows.size();
+        g_bytes += sizeof(header) + g_block.size();
+    }
+    rows.clear();
+}
+
+// Caller holds g_mutex. Moves every committed row to its seat's block,
+// writing the blocks that fill up.
+void DrainLocked() {
+    g_rings.DrainLocked([](RowRing& ring) {
+        ring.PopAll([](const Row& row) {
+            std::vector<Row>& rows = g_seat_rows[row.seat];
+            rows.push_back(row);
+            if (rows.size() == kBlockRows) {
+                WriteBlockLocked(row.seat);
+            }
+        });
+    });
+    std::fflush(g_file);
+}
+
+// Caller holds g_mutex
+Stats StatsLocked() {
+    Stats stats;
+    stats.rows = g_rows;
+    stats.bytes = sizeof(Header) + g_bytes;
+    stats.dropped = g_rings.DroppedLocked();
+    return stats;
+}
+
+void WriterLoop() {
+    while (true) {
+        const uint32_t reasons = g_wake.WaitUntil(Clock::now() + kDrainInterval);
+        std::lock_guard<std::mutex> lock(g_mutex);
+        DrainLocked();
+        if (reasons & kWakeStop) {
+            for (size_t seat = 0; seat < kMaxSeats; ++seat) {
+                WriteBlockLocked(seat);
+            }
+            return;
+        }
+    }
+}
+}  // namespace
+
+namespace detail {
+void Write(unsigned vjoy_id, Clock::time_point tick, const Signals& signals) {
+    auto* local = g_rings.Local();
+    Row row;
+    row.time_ns = ToNs(tick) - g_start_ns;
+    row.signals = signals;
+    row.seat = static_cast<uint8_t>(vjoy_id == 0 ? 0 : std::min<size_t>(vjoy_id - 1, kMaxSeats - 1));
+    if (!local || !local->ring.TryPush(row)) {
+        g_rings.CountDrop(local);
+        return;
+    }
+    if (local->ring.Size() == kRingRows / 2) {
+        g_wake.Signal(kWakeDrain);
+    }
+}
+}  // namespace detail
+
+bool Start(const std::string& path) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (g_file) {
+        return false;
+    }
+    g_file = std::fopen(path.c_str(), "wb");
+    if (!g_file) {
+        LOG_ERROR(kTag, "Cannot create scope file " << path);
+        return false;
+    }
+    g_path = path;
+    g_write_failed = false;
+    g_start_ns = ToNs(Clock::now());
+    g_rows = 0;
+    g_bytes = 0;
+
+    Header header{};
+    header.magic = kMagic;
+    header.version = kFormatVersion;
+    header.column_count = static_cast<uint32_t>(kColumnCount);
+    header.block_rows = kBlockRows;
+    header.start_unix_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                               std::chrono::system_clock::now().time_since_epoch())
+                               .count();
+    std::fwrite(&header, sizeof(header), 1, g_file);
+
+    g_writer = std::thread(WriterLoop);
+    detail::enabled.store(true, std::memory_order_release);
+    LOG_INFO(kTag, "Scoping FFB physics to " << path);
+    return true;
+}
+
+void Stop() {
+    if (!g_writer.joinable()) {
+        return;
+    }
+    detail::enabled.store(false, std::memory_order_release);
+    // A tick that saw the scope on just before this copies one row; let it
+    // commit before the last drain
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    g_wake.Signal(kWakeStop);
+    g_writer.join();
+
+    std::lock_guard<std::mutex> lock(g_mutex);
+    std::fclose(g_file);
+    g_file = nullptr;
+    const Stats stats = StatsLocked();
+    LOG_INFO(kTag, "Scoped " << stats.rows << " physics steps (" << stats.bytes / 1024 << " KB, "
+             << (stats.rows ? static_cast<double>(stats.bytes) / static_cast<double>(stats.rows) : 0.0)
+             << " bytes/step) to " << g_path
+             << (stats.dropped ? ", " + std::to_string(stats.dropped) + " dropped (ring full)" : std::string()));
+}
+
+Stats GetStats() {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    return StatsLocked();
+}
+
+bool ScopeReader::Open(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return Fail("cannot open file");
+    }
+    data_.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    if (data_.size() < sizeof(Header)) {
+        return Fail("file shorter than the header");
+    }
+    std::memcpy(&header_, data_.data(), sizeof(Header));
+    if (header_.magic != kMagic) {
+        return Fail("not a scope file");
+    }
+    if (header_.version != kFormatVersion || header_.column_count != kColumnCount) {
+        return Fail("unsupported format version");
+    }
+    offset_ = sizeof(Header);
+    block_.clear();
+    next_ = 0;
+    error_.clear();
+    return true;
+}
+
+bool ScopeReader::Fail(const char* what) {
+    error_ = what;
+    return false;
+}
+
+bool ScopeReader::Next(Sample& sample) {
+    while (next_ == block_.size()) {
+        if (offset_ == data_.size()) {
+            return false;
+        }
+        if (!ReadBlock()) {
+            return false;
+        }
+    }
+    sample = block_[next_++];
+    return true;
+}
+
+bool ScopeReader::ReadBlock() {
+    BlockHeader header;
+    if (data_.size() - offset_ < sizeof(header)) {
+        // The writer was killed mid-block
+        return Fail("truncated block");
+    }
+    std::memcpy(&header, data_.data() + offset_, sizeof(header));
+    offset_ += sizeof(header);
+    if (header.column_count != kColumnCount || header.seat >= kMaxSeats || header.rows > kBlockRows ||
+        data_.size() - offset_ < header.size) {
+        return Fail("malformed block");
+    }
+    const uint8_t* block = data_.data() + offset_;
+    offset_ += header.size;
+
+    block_.assign(header.rows, Sample());
+    next_ = 0;
+    std::vector<int64_t> ints;
+    std::vector<float> floats;
+    size_t position = 0;
+    for (size_t column = 0; column < kColumnCount; ++column) {
+        uint64_t size;
+        if (!GetVarint(block, header.size, position, size) || header.size - position < size) {
+            return Fail("malformed block");
+        }
+        const uint8_t* data = block + position;
+        position += static_cast<size_t>(size);
+        if (kColumns[column].codec == Codec::FloatXor) {
+            if (!DecodeFloats(data, static_cast<size_t>(size), header.rows, floats)) {
+                return Fail("malformed column");
+            }
+            for (size_t row = 0; row < header.rows; ++row) {
+                SetSignalColumn(block_[row].signals, column, floats[row]);
+            }
+        } else {
+            if (!DecodeInts(data, static_cast<size_t>(size), kColumns[column].codec, header.rows, ints)) {
+                return Fail("malformed column");
+            }
+            for (size_t row = 0; row < header.rows; ++row) {
+                if (column == 0) {
+                    block_[row].time_ns = ints[row];
+                } else {
+                    block_[row].signals.force = static_cast<int16_t>(ints[row]);
+                }
+            }
+        }
+    }
+    for (Sample& sample : block_) {
+        sample.vjoy_id = header.seat + 1u;
+    }
+    return true;
+}
+
+}  // namespace scope
@@ -0,0 +1,145 @@
+#ifndef SIGNAL_SCOPE_H
+#define SIGNAL_SCOPE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Opt-in scope of the FFB physics: every physics step of every seat (the raw
+// and shaped force, the filtered force, autocenter spring, target offset,
+// offset, velocity, dt and the resulting steering) for tuning. Physics
+// threads copy a fixed-size row into their own SPSC ring; a writer thread
+// gathers each seat's rows into blocks of kBlockRows and stores them column
+// by column, so every column compresses against its own history: tick times
+// as delta-of-delta, the raw force as deltas, both bit-packed at the block's
+// widest value, and floats XORed with their predecessor (Gorilla encoding).
+// While off, a tick pays one relaxed load.
+//
+// File: Header, then blocks. A block is a BlockHeader and, per column in
+// kColumns order, a varint byte count and the encoded values.
+namespace scope {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr uint32_t kMagic = 0x50435357;  // "WSCP"
+constexpr uint32_t kFormatVersion = 1;
+constexpr uint32_t kBlockRows = 1024;
+
+// One physics step of one seat
+struct Signals {
+    int16_t force = 0;  // from the game, before shaping
+    float commanded_force = 0.0f;
+    float filtered_force = 0.0f;
+    float spring = 0.0f;
+    float target_offset = 0.0f;
+    float offset = 0.0f;
+    float velocity = 0.0f;
+    float dt = 0.0f;
+    float steering = 0.0f;
+};
+
+enum class Codec : uint8_t {
+    // Zigzag delta-of-delta, bit-packed: steady tick times pack to nothing
+    DeltaOfDelta = 0,
+    // Zigzag delta, bit-packed
+    Delta = 1,
+    // IEEE float bits XOR the previous value, leading/trailing zeros elided
+    FloatXor = 2,
+};
+
+struct Column {
+    const char* name;
+    Codec codec;
+};
+
+// time_ns is the tick time since Start(); the rest are Signals in order
+constexpr Column kColumns[] = {
+    {"time_ns", Codec::DeltaOfDelta},   {"force", Codec::Delta},
+    {"commanded_force", Codec::FloatXor}, {"filtered_force", Codec::FloatXor},
+    {"spring", Codec::FloatXor},        {"target_offset", Codec::FloatXor},
+    {"offset", Codec::FloatXor},        {"velocity", Codec::FloatXor},
+    {"dt", Codec::FloatXor},            {"steering", Codec::FloatXor},
+};
+constexpr size_t kColumnCount = sizeof(kColumns) / sizeof(kColumns[0]);
+
+struct Header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t column_count;
+    uint32_t block_rows;
+    int64_t start_unix_ms;
+    uint32_t reserved[2];
+};
+static_assert(sizeof(Header) == 32, "Header layout is part of the file format");
+
+struct BlockHeader {
+    uint32_t rows;
+    uint8_t seat;  // vJoy id - 1
+    uint8_t column_count;
+    uint16_t reserved;
+    // Encoded columns following this header
+    uint32_t size;
+};
+static_assert(sizeof(BlockHeader) == 12, "BlockHeader layout is part of the file format");
+
+namespace detail {
+extern std::atomic<bool> enabled;
+void Write(unsigned vjoy_id, Clock::time_point tick, const Signals& signals);
+}
+
+inline bool Enabled() {
+    return detail::enabled.load(std::memory_order_relaxed);
+}
+
+// Creates `path` and starts the writer thread
+bool Start(const std::string& path);
+// Writes what the rings hold and every partial block, and logs the totals
+void Stop();
+
+struct Stats {
+    uint64_t rows = 0;
+    uint64_t bytes = 0;
+    // A physics thread's ring was full
+    uint64_t dropped = 0;
+};
+Stats GetStats();
+
+// `vjoy_id` (1-16) names the seat
+inline void RecordTick(unsigned vjoy_id, Clock::time_point tick, const Signals& signals) {
+    if (Enabled()) detail::Write(vjoy_id, tick, signals);
+}
+
+struct Sample {
+    unsigned vjoy_id = 1;
+    int64_t time_ns = 0;  // since Start()
+    Signals signals;
+};
+
+class ScopeReader {
+public:
+    bool Open(const std::string& path);
+    const Header& GetHeader() const { return header_; }
+    // Samples come block by block: one seat's run of rows, then the next block
+    bool Next(Sample& sample);
+    // Empty at the end of the file; otherwise why Next() stopped
+    const std::string& Error() const { return error_; }
+    uint64_t FileSize() const { return data_.size(); }
+
+private:
+    bool ReadBlock();
+    bool Fail(const char* what);
+
+    Header header_{};
+    std::vector<uint8_t> data_;
+    size_t offset_ = 0;
+    std::vector<Sample> block_;
+    size_t next_ = 0;
+    std::string error_;
+};
+
+}  // namespace scope
+
+#endif  // SIGNAL_SCOPE_H
@@ -0,0 +1,29 @@
+#ifndef SIMULATED_CLOCK_H
+#define SIMULATED_CLOCK_H
+
+#include <chrono>
+
+// Manually advanced stand-in for steady_clock. An EventLoop given one
+// (EventLoop::SetSimulatedClock) never sleeps: it jumps the clock to the next
+// timer deadline, so a simulated hour of 1 kHz physics takes only as long as
+// the ticks themselves, and runs the same way every time. Owned by the loop
+// thread; time never goes backwards.
+class SimulatedClock {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit SimulatedClock(Clock::time_point start = Clock::time_point()) : now_(start) {}
+
+    Clock::time_point Now() const { return now_; }
+    void AdvanceTo(Clock::time_point time) {
+        if (time > now_) {
+            now_ = time;
+        }
+    }
+    void Advance(Clock::duration duration) { AdvanceTo(now_ + duration); }
+
+private:
+    Clock::time_point now_;
+};
+
+#endif  // SIMULATED_CLOCK_H
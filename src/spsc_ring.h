@@ -0,0 +1,131 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#include "cache_line.h"
+
+// Bounded lock-free single-producer/single-consumer ring. Push only from one
+// thread and pop only from one other thread; neither side ever blocks.
+template <typename T, size_t Capacity>
+class SpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    bool TryPush(const T& item) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - cached_head_ == Capacity) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            if (tail - cached_head_ == Capacity) {
+                return false;
+            }
+        }
+        slots_[tail & (Capacity - 1)] = item;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool TryPop(T& item) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head == cached_tail_) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            if (head == cached_tail_) {
+                return false;
+            }
+        }
+        item = slots_[head & (Capacity - 1)];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side: hands every queued item to fn in order, returns the count.
+    template <typename Fn>
+    size_t PopAll(Fn&& fn) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        const size_t tail = tail_.load(std::memory_order_acquire);
+        if (head == tail) {
+            return 0;
+        }
+        for (size_t i = head; i != tail; ++i) {
+            fn(slots_[i & (Capacity - 1)]);
+        }
+        head_.store(tail, std::memory_order_release);
+        cached_tail_ = tail;
+        return tail - head;
+    }
+
+    bool Empty() const {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+    // Items queued; exact on either side, a snapshot anywhere else
+    size_t Size() const {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+
+private:
+    // Consumer-owned
+    alignas(kCacheLineSize) std::atomic<size_t> head_{0};
+    size_t cached_tail_ = 0;
+    // Producer-owned
+    alignas(kCacheLineSize) std::atomic<size_t> tail_{0};
+    size_t cached_head_ = 0;
+    alignas(kCacheLineSize) std::array<T, Capacity> slots_{};
+};
+
+// The same ring over bytes, for variable-size records: a record is written
+// whole or not at all, and the consumer takes every committed byte at once.
+template <size_t Capacity>
+class SpscByteRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    bool TryWrite(const void* data, size_t size) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (Capacity - (tail - cached_head_) < size) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            if (Capacity - (tail - cached_head_) < size) {
+                return false;
+            }
+        }
+        const size_t start = tail & (Capacity - 1);
+        const size_t first = std::min(size, Capacity - start);
+        std::memcpy(bytes_.data() + start, data, first);
+        std::memcpy(bytes_.data(), static_cast<const char*>(data) + first, size - first);
+        tail_.store(tail + size, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side: appends every committed byte to `out`, returns the count.
+    size_t ReadAll(std::vector<char>& out) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        const size_t tail = tail_.load(std::memory_order_acquire);
+        const size_t size = tail - head;
+        if (size == 0) {
+            return 0;
+        }
+        const size_t base = out.size();
+        out.resize(base + size);
+        const size_t start = head & (Capacity - 1);
+        const size_t first = std::min(size, Capacity - start);
+        std::memcpy(out.data() + base, bytes_.data() + start, first);
+        std::memcpy(out.data() + base + first, bytes_.data(), size - first);
+        head_.store(tail, std::memory_order_release);
+        return size;
+    }
+
+private:
+    // Consumer-owned
+    alignas(kCacheLineSize) std::atomic<size_t> head_{0};
+    // Producer-owned
+    alignas(kCacheLineSize) std::atomic<size_t> tail_{0};
+    size_t cached_head_ = 0;
+    alignas(kCacheLineSize) std::array<char, Capacity> bytes_;
+};
+
+#endif  // SPSC_RING_H
@@ -0,0 +1,109 @@
+#ifndef THREAD_RINGS_H
+#define THREAD_RINGS_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "cache_line.h"
+
+// One SPSC ring per producing thread, for a facility whose hot threads
+// never share a line or take a lock: each thread allocates and registers its
+// ring on first use and writes it alone; a single drainer reads every ring
+// under the owner's mutex. A thread that exits hands its ring over, and the
+// drainer frees it after reading what is left.
+//
+// The calling thread's ring is found through thread_locals of this class, so
+// each facility needs its own Ring type (derive an empty struct from the ring
+// it uses) and exactly one ThreadRings of it.
+template <typename Ring>
+class ThreadRings {
+public:
+    struct Entry {
+        Ring ring;
+        // Written by the owning thread only
+        alignas(kCacheLineSize) std::atomic<uint64_t> dropped{0};
+        std::atomic<bool> retired{false};
+    };
+
+    // `mutex` guards the ring list; the owner holds it while draining
+    explicit ThreadRings(std::mutex& mutex) : mutex_(mutex) {}
+    ThreadRings(const ThreadRings&) = delete;
+    ThreadRings& operator=(const ThreadRings&) = delete;
+
+    // The calling thread's ring, allocated on its first use: the one
+    // allocation a thread makes for the facility. Null while the thread exits.
+    Entry* Local() {
+        if (t_entry || t_exited) {
+            return t_entry;
+        }
+        auto entry = std::make_unique<Entry>();
+        (void)&t_retirer;
+        std::lock_guard<std::mutex> lock(mutex_);
+        t_entry = entry.get();
+        entries_.push_back(std::move(entry));
+        return t_entry;
+    }
+
+    // A record that found no room; `entry` is Local()'s result
+    void CountDrop(Entry* entry) {
+        if (entry) {
+            entry->dropped.store(entry->dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        } else {
+            dropped_exited_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // Caller holds the mutex. Hands every ring to `read` and frees the rings
+    // of exited threads once read.
+    template <typename Fn>
+    void DrainLocked(Fn&& read) {
+        for (auto it = entries_.begin(); it != entries_.end();) {
+            Entry& entry = **it;
+            // Read retired first: a retired thread has committed its last record
+            const bool retired = entry.retired.load(std::memory_order_acquire);
+            read(entry.ring);
+            if (retired) {
+                dropped_exited_.fetch_add(entry.dropped.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                it = entries_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    // Caller holds the mutex
+    uint64_t DroppedLocked() const {
+        uint64_t dropped = dropped_exited_.load(std::memory_order_relaxed);
+        for (const auto& entry : entries_) {
+            dropped += entry->dropped.load(std::memory_order_relaxed);
+        }
+        return dropped;
+    }
+
+private:
+    // Hands the thread's ring to the drainer for freeing once it is read
+    struct Retirer {
+        ~Retirer() {
+            if (t_entry) {
+                t_entry->retired.store(true, std::memory_order_release);
+            }
+            t_entry = nullptr;
+            t_exited = true;
+        }
+    };
+
+    // Kept trivially destructible so they stay readable after t_retirer ran
+    static inline thread_local Entry* t_entry = nullptr;
+    static inline thread_local bool t_exited = false;
+    static inline thread_local Retirer t_retirer;
+
+    std::mutex& mutex_;
+    std::vector<std::unique_ptr<Entry>> entries_;
+    // Records from threads already torn down
+    std::atomic<uint64_t> dropped_exited_{0};
+};
+
+#endif  // THREAD_RINGS_H
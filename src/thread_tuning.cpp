@@ -0,0 +1,285 @@
+#include "thread_tuning.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <sstream>
+
+#include "logging/logger.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+constexpr const char* kTag = "threading";
+
+std::string JoinCpus(const std::vector<int>& cpus) {
+    std::ostringstream out;
+    for (size_t i = 0; i < cpus.size(); ++i) {
+        out << (i ? "," : "") << cpus[i];
+    }
+    return out.str();
+}
+
+#ifdef _WIN32
+// avrt.dll is loaded at runtime so a missing MMCSS service only costs the boost
+using AvSetMmThreadCharacteristicsFn = HANDLE(WINAPI*)(LPCSTR, LPDWORD);
+using AvSetMmThreadPriorityFn = BOOL(WINAPI*)(HANDLE, int);
+using AvRevertMmThreadCharacteristicsFn = BOOL(WINAPI*)(HANDLE);
+
+struct AvrtApi {
+    AvSetMmThreadCharacteristicsFn set_characteristics = nullptr;
+    AvSetMmThreadPriorityFn set_priority = nullptr;
+    AvRevertMmThreadCharacteristicsFn revert = nullptr;
+};
+
+const AvrtApi& Avrt() {
+    static AvrtApi api;
+    static std::once_flag once;
+    std::call_once(once, [] {
+        HMODULE module = LoadLibraryA("avrt.dll");
+        if (!module) {
+            return;
+        }
+        api.set_characteristics = reinterpret_cast<AvSetMmThreadCharacteristicsFn>(
+            GetProcAddress(module, "AvSetMmThreadCharacteristicsA"));
+        api.set_priority = reinterpret_cast<AvSetMmThreadPriorityFn>(GetProcAddress(module, "AvSetMmThreadPriority"));
+        api.revert = reinterpret_cast<AvRevertMmThreadCharacteristicsFn>(
+            GetProcAddress(module, "AvRevertMmThreadCharacteristics"));
+    });
+    return api;
+}
+
+constexpr int kAvrtPriorityHigh = 1;
+#else
+void LockMemoryOnce() {
+    static std::once_flag once;
+    std::call_once(once, [] {
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+            LOG_WARN(kTag, "mlockall failed (" << std::strerror(errno) << "); page faults may stall ticks");
+        } else {
+            LOG_INFO(kTag, "Process memory locked");
+        }
+    });
+}
+
+bool SetNice(int nice) {
+#ifdef __linux__
+    // Linux applies setpriority() to a thread when given its tid
+    pid_t tid = static_cast<pid_t>(syscall(SYS_gettid));
+    return setpriority(PRIO_PROCESS, static_cast<id_t>(tid), nice) == 0;
+#else
+    (void)nice;
+    return false;
+#endif
+}
+#endif
+}  // namespace
+
+ThreadTuning& ThreadingConfig::For(ThreadRole role) {
+    switch (role) {
+        case ThreadRole::Physics:
+            return physics;
+        case ThreadRole::Report:
+            return report;
+        case ThreadRole::Input:
+            return input;
+    }
+    return physics;
+}
+
+const ThreadTuning& ThreadingConfig::For(ThreadRole role) const {
+    return const_cast<ThreadingConfig*>(this)->For(role);
+}
+
+const char* ThreadRoleName(ThreadRole role) {
+    switch (role) {
+        case ThreadRole::Physics:
+            return "physics";
+        case ThreadRole::Report:
+            return "report";
+        case ThreadRole::Input:
+            return "input";
+    }
+    return "unknown";
+}
+
+const char* ThreadPriorityName(ThreadPriority priority) {
+    switch (priority) {
+        case ThreadPriority::Normal:
+            return "normal";
+        case ThreadPriority::High:
+            return "high";
+        case ThreadPriority::Realtime:
+            return "realtime";
+    }
+    return "normal";
+}
+
+bool ParseThreadPriority(const std::string& value, ThreadPriority& priority) {
+    if (value == "normal") {
+        priority = ThreadPriority::Normal;
+    } else if (value == "high") {
+        priority = ThreadPriority::High;
+    } else if (value == "realtime" || value == "rt") {
+        priority = ThreadPriority::Realtime;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool ParseCpuList(const std::string& value, std::vector<int>& cpus) {
+    std::vector<int> parsed;
+    if (!value.empty() && value != "any") {
+        std::istringstream items(value);
+        std::string item;
+        while (std::getline(items, item, ',')) {
+            item.erase(0, item.find_first_not_of(" \t"));
+            item.erase(item.find_last_not_of(" \t") + 1);
+            if (item.empty()) {
+                continue;
+            }
+            size_t dash = item.find('-');
+            int first = 0;
+            int last = 0;
+            try {
+                first = std::stoi(item.substr(0, dash));
+                last = (dash == std::string::npos) ? first : std::stoi(item.substr(dash + 1));
+            } catch (...) {
+                return false;
+            }
+            if (first < 0 || last < first || last > 1023) {
+                return false;
+            }
+            for (int cpu = first; cpu <= last; ++cpu) {
+                parsed.push_back(cpu);
+            }
+        }
+        std::sort(parsed.begin(), parsed.end());
+        parsed.erase(std::unique(parsed.begin(), parsed.end()), parsed.end());
+    }
+    cpus = std::move(parsed);
+    return true;
+}
+
+ScopedThreadTuning::ScopedThreadTuning(const ThreadingConfig& config, ThreadRole role) {
+    const ThreadTuning& tuning = config.For(role);
+    const char* name = ThreadRoleName(role);
+    std::string priority_applied = "normal";
+    std::string cpus_applied;
+
+    if (!tuning.cpus.empty()) {
+#ifdef _WIN32
+        DWORD_PTR mask = 0;
+        for (int cpu : tuning.cpus) {
+            if (cpu < static_cast<int>(sizeof(DWORD_PTR) * 8)) {
+                mask |= static_cast<DWORD_PTR>(1) << cpu;
+            }
+        }
+        if (mask != 0 && SetThreadAffinityMask(GetCurrentThread(), mask) != 0) {
+            cpus_applied = JoinCpus(tuning.cpus);
+        } else {
+            LOG_WARN(kTag, name << " thread: could not pin to cpus " << JoinCpus(tuning.cpus) << " (error "
+                                << GetLastError() << ")");
+        }
+#elif defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : tuning.cpus) {
+            if (cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+        }
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (err == 0) {
+            cpus_applied = JoinCpus(tuning.cpus);
+        } else {
+            LOG_WARN(kTag, name << " thread: could not pin to cpus " << JoinCpus(tuning.cpus) << " ("
+                                << std::strerror(err) << ")");
+        }
+#else
+        LOG_WARN(kTag, name << " thread: CPU pinning not supported on this platform");
+#endif
+    }
+
+#ifdef _WIN32
+    if (tuning.priority == ThreadPriority::Realtime) {
+        const AvrtApi& avrt = Avrt();
+        DWORD task_index = 0;
+        HANDLE handle = nullptr;
+        if (avrt.set_characteristics && !config.mmcss_task.empty()) {
+            handle = avrt.set_characteristics(config.mmcss_task.c_str(), &task_index);
+        }
+        if (handle) {
+            if (avrt.set_priority) {
+                avrt.set_priority(handle, kAvrtPriorityHigh);
+            }
+            mmcss_handle_ = handle;
+            priority_applied = "realtime (MMCSS " + config.mmcss_task + ")";
+        } else if (SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL)) {
+            LOG_WARN(kTag, name << " thread: MMCSS task '" << config.mmcss_task
+                                << "' unavailable; using TIME_CRITICAL priority");
+            priority_applied = "time-critical";
+        } else {
+            LOG_WARN(kTag, name << " thread: could not raise priority (error " << GetLastError() << ")");
+        }
+    } else if (tuning.priority == ThreadPriority::High) {
+        if (SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST)) {
+            priority_applied = "high";
+        } else {
+            LOG_WARN(kTag, name << " thread: could not raise priority (error " << GetLastError() << ")");
+        }
+    }
+#else
+    if (tuning.priority == ThreadPriority::Realtime) {
+        if (config.lock_memory) {
+            LockMemoryOnce();
+        }
+        const int policy = config.round_robin ? SCHED_RR : SCHED_FIFO;
+        sched_param param{};
+        param.sched_priority =
+            std::clamp(config.rt_priority, sched_get_priority_min(policy), sched_get_priority_max(policy));
+        int err = pthread_setschedparam(pthread_self(), policy, &param);
+        if (err == 0) {
+            priority_applied = std::string("realtime (") + (config.round_robin ? "SCHED_RR " : "SCHED_FIFO ") +
+                               std::to_string(param.sched_priority) + ")";
+        } else if (SetNice(-10)) {
+            LOG_WARN(kTag, name << " thread: realtime scheduling refused (" << std::strerror(err)
+                                << "; needs CAP_SYS_NICE or an rtprio limit); using nice -10");
+            priority_applied = "high";
+        } else {
+            LOG_WARN(kTag, name << " thread: could not raise priority (" << std::strerror(err) << ")");
+        }
+    } else if (tuning.priority == ThreadPriority::High) {
+        if (SetNice(-10)) {
+            priority_applied = "high";
+        } else {
+            LOG_WARN(kTag, name << " thread: could not lower nice value (" << std::strerror(errno) << ")");
+        }
+    }
+#endif
+
+    applied_ = priority_applied;
+    if (!cpus_applied.empty()) {
+        applied_ += ", cpus " + cpus_applied;
+    }
+    if (tuning.priority != ThreadPriority::Normal || !tuning.cpus.empty()) {
+        LOG_INFO(kTag, name << " thread: " << applied_);
+    }
+}
+
+ScopedThreadTuning::~ScopedThreadTuning() {
+#ifdef _WIN32
+    if (mmcss_handle_ && Avrt().revert) {
+        Avrt().revert(static_cast<HANDLE>(mmcss_handle_));
+    }
+#endif
+}
@@ -0,0 +1,85 @@
+#ifndef THREAD_TUNING_H
+#define THREAD_TUNING_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "precise_timer.h"
+
+// Scheduling of the emulator's timing-sensitive threads: priority class and
+// the CPUs each may run on. Everything here is best effort; a setting the OS
+// refuses is logged and the thread keeps running with what it has.
+
+enum class ThreadRole {
+    Physics,  // PhysicsScheduler workers (1 kHz FFB/pedal tick)
+    Report,   // WheelDevice::VJoyPollingThread
+    Input     // Seat loops, including the Raw Input pump
+};
+
+enum class ThreadPriority {
+    Normal,
+    // Windows: THREAD_PRIORITY_HIGHEST. Linux: nice -10.
+    High,
+    // Windows: MMCSS task (falls back to TIME_CRITICAL). Linux: SCHED_FIFO/RR.
+    Realtime
+};
+
+struct ThreadTuning {
+    ThreadPriority priority = ThreadPriority::Normal;
+    // Empty = any CPU
+    std::vector<int> cpus;
+};
+
+// [threading] section
+struct ThreadingConfig {
+    ThreadTuning physics;
+    ThreadTuning report;
+    ThreadTuning input;
+    // Windows realtime: MMCSS task from HKLM\...\Multimedia\SystemProfile\Tasks
+    std::string mmcss_task = "Games";
+    // Linux realtime: SCHED_RR instead of SCHED_FIFO
+    bool round_robin = false;
+    int rt_priority = 10;
+    // Linux realtime: mlockall() so page faults cannot stall a tick
+    bool lock_memory = true;
+    // Log the physics tick jitter histogram at shutdown
+    bool jitter_report = true;
+    // Physics tick rate (250 - 4000 Hz)
+    int physics_hz = 1000;
+    // How the physics and report threads wait for deadlines
+    PreciseTimer::Mode timer_mode = PreciseTimer::Mode::Hybrid;
+    // 0 = calibrate at startup
+    int spin_margin_us = 0;
+    // runtime=eventloop: input, physics and reports of every seat on one thread
+    bool event_loop = false;
+
+    ThreadTuning& For(ThreadRole role);
+    const ThreadTuning& For(ThreadRole role) const;
+};
+
+const char* ThreadRoleName(ThreadRole role);
+const char* ThreadPriorityName(ThreadPriority priority);
+bool ParseThreadPriority(const std::string& value, ThreadPriority& priority);
+// "2,3" or "2-5" or a mix; empty or "any" clears the set
+bool ParseCpuList(const std::string& value, std::vector<int>& cpus);
+
+// Applies the role's tuning to the calling thread for the object's lifetime
+// (the MMCSS registration is reverted on destruction).
+class ScopedThreadTuning {
+public:
+    ScopedThreadTuning(const ThreadingConfig& config, ThreadRole role);
+    ~ScopedThreadTuning();
+
+    ScopedThreadTuning(const ScopedThreadTuning&) = delete;
+    ScopedThreadTuning& operator=(const ScopedThreadTuning&) = delete;
+
+    // What was actually applied, e.g. "realtime (MMCSS Games), cpus 2,3"
+    const std::string& Applied() const { return applied_; }
+
+private:
+    void* mmcss_handle_ = nullptr;
+    std::string applied_;
+};
+
+#endif  // THREAD_TUNING_H
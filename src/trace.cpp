@@ -0,0 +1,225 @@
+#include "trace.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "logging/logger.h"
+
+namespace trace {
+
+namespace detail {
+std::atomic<bool> enabled{false};
+}
+
+namespace {
+constexpr const char* kTag = "trace";
+
+struct Event {
+    uint64_t start;       // tsc::Now() reading
+    uint64_t duration;    // spans only, in readings
+    const char* name;
+    uint64_t flow_id;     // flows only
+    char phase;           // 'X' span, 's'/'t'/'f' flow
+};
+
+// Written only by its thread; read by Flush() while recording is paused.
+// `appending` is set around each append so Flush() can wait out one that saw
+// tracing on before it was paused.
+struct ThreadBuffer {
+    uint32_t tid = 0;
+    const char* thread_name = nullptr;
+    std::unique_ptr<Event[]> events;
+    size_t capacity = 0;
+    std::atomic<uint64_t> written{0};
+    std::atomic<bool> appending{false};
+};
+
+std::mutex g_mutex;  // buffers, settings and file output
+std::vector<std::unique_ptr<ThreadBuffer>> g_buffers;
+std::string g_path;
+size_t g_events_per_thread = kDefaultEventsPerThread;
+int g_flushes = 0;
+uint64_t g_epoch = 0;
+std::atomic<uint64_t> g_next_flow{1};
+
+thread_local ThreadBuffer* t_buffer = nullptr;
+thread_local const char* t_thread_name = nullptr;
+
+ThreadBuffer* LocalBuffer() {
+    if (t_buffer) {
+        return t_buffer;
+    }
+    // First event of this thread: the one allocation it makes for tracing
+    auto buffer = std::make_unique<ThreadBuffer>();
+    std::lock_guard<std::mutex> lock(g_mutex);
+    buffer->capacity = g_events_per_thread;
+    buffer->events.reset(new Event[buffer->capacity]);
+    buffer->tid = static_cast<uint32_t>(g_buffers.size() + 1);
+    buffer->thread_name = t_thread_name;
+    t_buffer = buffer.get();
+    g_buffers.push_back(std::move(buffer));
+    return t_buffer;
+}
+
+void Append(const Event& event) {
+    ThreadBuffer* buffer = LocalBuffer();
+    // Pairs with the pause in FlushLocked(): either this sees tracing off, or
+    // the flush sees `appending` and waits for the store below to finish
+    buffer->appending.store(true, std::memory_order_seq_cst);
+    if (!detail::enabled.load(std::memory_order_seq_cst)) {
+        buffer->appending.store(false, std::memory_order_release);
+        return;
+    }
+    const uint64_t index = buffer->written.load(std::memory_order_relaxed);
+    buffer->events[index % buffer->capacity] = event;
+    buffer->written.store(index + 1, std::memory_order_release);
+    buffer->appending.store(false, std::memory_order_release);
+}
+
+std::string FlushPath() {
+    if (g_flushes == 0) {
+        return g_path;
+    }
+    const size_t dot = g_path.find_last_of('.');
+    const size_t slash = g_path.find_last_of("/\\");
+    const std::string suffix = "." + std::to_string(g_flushes);
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        return g_path + suffix;
+    }
+    return g_path.substr(0, dot) + suffix + g_path.substr(dot);
+}
+
+void WriteEvent(std::FILE* out, const ThreadBuffer& buffer, const Event& event, int64_t epoch_ns, bool& first) {
+    const double ts_us = static_cast<double>(tsc::ToSteadyNanos(event.start) - epoch_ns) / 1000.0;
+    std::fprintf(out, "%s\n{\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"ph\":\"%c\",\"cat\":\"wheel\",\"name\":\"%s\"",
+                 first ? "" : ",", buffer.tid, ts_us, event.phase, event.name);
+    if (event.phase == 'X') {
+        std::fprintf(out, ",\"dur\":%.3f}", static_cast<double>(tsc::ToNanos(static_cast<int64_t>(event.duration))) / 1000.0);
+    } else {
+        // Bound to the span that encloses the flow event on its thread
+        std::fprintf(out, ",\"id\":%llu,\"bp\":\"e\"}", static_cast<unsigned long long>(event.flow_id));
+    }
+    first = false;
+}
+
+// Caller holds g_mutex with recording paused
+bool WriteFile(const std::string& path) {
+    std::FILE* out = std::fopen(path.c_str(), "w");
+    if (!out) {
+        LOG_ERROR(kTag, "Cannot write trace file " << path);
+        return false;
+    }
+    std::fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    bool first = true;
+    const int64_t epoch_ns = tsc::ToSteadyNanos(g_epoch);
+    size_t total = 0;
+    size_t dropped = 0;
+    for (const auto& buffer : g_buffers) {
+        if (buffer->thread_name) {
+            std::fprintf(out, "%s\n{\"pid\":1,\"tid\":%u,\"ph\":\"M\",\"name\":\"thread_name\","
+                         "\"args\":{\"name\":\"%s\"}}",
+                         first ? "" : ",", buffer->tid, buffer->thread_name);
+            first = false;
+        }
+        const uint64_t written = buffer->written.load(std::memory_order_acquire);
+        const uint64_t kept = std::min<uint64_t>(written, buffer->capacity);
+        for (uint64_t i = written - kept; i < written; ++i) {
+            WriteEvent(out, *buffer, buffer->events[i % buffer->capacity], epoch_ns, first);
+        }
+        total += static_cast<size_t>(kept);
+        dropped += static_cast<size_t>(written - kept);
+    }
+    std::fprintf(out, "\n]}\n");
+    const bool ok = std::fclose(out) == 0;
+    LOG_INFO(kTag, "Wrote " << total << " trace events from " << g_buffers.size() << " thread(s) to " << path
+             << (dropped ? " (" + std::to_string(dropped) + " older events overwritten)" : std::string()));
+    return ok;
+}
+
+// Caller holds g_mutex. Pauses recording, waits for appends already past the
+// Enabled() check, writes and clears the rings, then resumes if `resume`.
+bool FlushLocked(bool resume) {
+    if (g_path.empty()) {
+        return false;
+    }
+    const bool was_enabled = detail::enabled.exchange(false, std::memory_order_seq_cst);
+    for (const auto& buffer : g_buffers) {
+        while (buffer->appending.load(std::memory_order_seq_cst)) {
+            std::this_thread::yield();
+        }
+    }
+    const bool ok = WriteFile(FlushPath());
+    ++g_flushes;
+    for (const auto& buffer : g_buffers) {
+        buffer->written.store(0, std::memory_order_relaxed);
+    }
+    if (was_enabled && resume) {
+        detail::enabled.store(true, std::memory_order_seq_cst);
+    }
+    return ok;
+}
+}  // namespace
+
+void Start(const std::string& path, size_t events_per_thread) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_path = path;
+    g_events_per_thread = std::max<size_t>(1024, events_per_thread);
+    g_flushes = 0;
+    g_epoch = tsc::Now();
+    detail::enabled.store(true, std::memory_order_release);
+    LOG_INFO(kTag, "Tracing to " << path << " (" << g_events_per_thread << " events per thread)");
+}
+
+bool Flush() {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    return FlushLocked(true);
+}
+
+void Stop() {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (!Enabled()) {
+        return;
+    }
+    FlushLocked(false);
+}
+
+void SetThreadName(const char* name) {
+    if (t_thread_name == name) {
+        return;
+    }
+    t_thread_name = name;
+    if (t_buffer) {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        t_buffer->thread_name = name;
+    }
+}
+
+void RecordSpan(const char* name, uint64_t start, uint64_t end) {
+    Event event;
+    event.start = start;
+    event.duration = end - start;
+    event.name = name;
+    event.flow_id = 0;
+    event.phase = 'X';
+    Append(event);
+}
+
+void RecordFlow(const char* name, char phase, uint64_t id) {
+    Event event;
+    event.start = tsc::Now();
+    event.duration = 0;
+    event.name = name;
+    event.flow_id = id;
+    event.phase = phase;
+    Append(event);
+}
+
+uint64_t NewFlowId() {
+    return Enabled() ? g_next_flow.fetch_add(1, std::memory_order_relaxed) : 0;
+}
+
+}  // namespace trace
@@ -0,0 +1,84 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "tsc_clock.h"
+
+// Opt-in timeline of what every thread was doing, written as Chrome trace
+// JSON (chrome://tracing, ui.perfetto.dev). Each thread records into its own
+// ring of the most recent events with plain stores; nothing is shared between
+// recording threads. While tracing is off a TRACE_SCOPE is one relaxed load
+// and a branch.
+//
+// Spans are recorded as complete events (start + duration) when the scope
+// ends, so a ring that wrapped never holds half a span. Times are raw
+// tsc::Now() readings, converted when the file is written. Flow events link an
+// input frame from the reader through the seat loop to the report it ended up in.
+namespace trace {
+
+namespace detail {
+extern std::atomic<bool> enabled;
+}
+
+constexpr size_t kDefaultEventsPerThread = size_t{1} << 16;
+
+inline bool Enabled() {
+    return detail::enabled.load(std::memory_order_relaxed);
+}
+
+// Starts recording; Flush() writes `path`, then `path` with .1, .2, ... inserted
+void Start(const std::string& path, size_t events_per_thread = kDefaultEventsPerThread);
+// Writes what the rings hold and clears them; recording resumes afterwards.
+// Recording pauses briefly while the rings are read.
+bool Flush();
+// Flush() and stop recording
+void Stop();
+
+// Names the calling thread in the trace; cheap, call once at thread start
+void SetThreadName(const char* name);
+
+// `name` must outlive the trace (string literals); `start` and `end` are tsc::Now() readings
+void RecordSpan(const char* name, uint64_t start, uint64_t end);
+void RecordFlow(const char* name, char phase, uint64_t id);
+// Unique id for a new flow; 0 while tracing is off
+uint64_t NewFlowId();
+
+inline void FlowStart(const char* name, uint64_t id) {
+    if (id != 0 && Enabled()) RecordFlow(name, 's', id);
+}
+
+inline void FlowStep(const char* name, uint64_t id) {
+    if (id != 0 && Enabled()) RecordFlow(name, 't', id);
+}
+
+inline void FlowEnd(const char* name, uint64_t id) {
+    if (id != 0 && Enabled()) RecordFlow(name, 'f', id);
+}
+
+class Scope {
+public:
+    explicit Scope(const char* name) : name_(Enabled() ? name : nullptr) {
+        if (name_) start_ = tsc::Now();
+    }
+    ~Scope() {
+        if (name_ && Enabled()) RecordSpan(name_, start_, tsc::Now());
+    }
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    const char* name_;
+    uint64_t start_ = 0;
+};
+
+}  // namespace trace
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) ::trace::Scope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+
+#endif  // TRACE_H
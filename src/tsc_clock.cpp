@@ -0,0 +1,229 @@
+#include "tsc_clock.h"
+
+#include <algorithm>
+#include <climits>
+#include <sstream>
+#include <thread>
+
+#include "seqlock.h"
+
+#if defined(WHEEL_HAVE_RDTSC) && !defined(_MSC_VER)
+#include <cpuid.h>
+#endif
+
+namespace tsc {
+
+namespace detail {
+std::atomic<bool> use_tsc{false};
+
+int64_t SteadyNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+}  // namespace detail
+
+namespace {
+// First rate measurement; later ones use the whole time since Init()
+constexpr std::chrono::milliseconds kInitialBaseline{10};
+// Conversions re-anchor at most this often
+constexpr int64_t kRecalibrateNs = 1000000000;
+// Outside this, the counter is not a usable clock (some VMs trap or scale it)
+constexpr double kMinHz = 1e8;
+constexpr double kMaxHz = 2e10;
+
+// reading -> base_ns + (reading - base_reading) * ns_per_tick
+struct Conversion {
+    uint64_t base_reading;
+    int64_t base_ns;
+    double ns_per_tick;
+};
+
+struct Pair {
+    uint64_t reading;
+    int64_t ns;
+};
+
+// Written by Init() and then by whichever conversion holds g_recalibrating
+Seqlock<Conversion> g_conversion;
+Pair g_origin{};
+std::atomic<int64_t> g_next_recalibration_ns{LLONG_MAX};
+std::atomic_flag g_recalibrating = ATOMIC_FLAG_INIT;
+std::atomic<uint64_t> g_recalibrations{0};
+const char* g_fallback_reason = "not initialized";
+// Cost of a timed span's end (a reading plus its conversion) on each source,
+// measured by Init(); 0 when not measured
+double g_tsc_span_ns = 0.0;
+double g_steady_span_ns = 0.0;
+// Keeps the timed calls from being optimized away
+volatile int64_t g_cost_sink = 0;
+
+bool InvariantTsc() {
+#if defined(WHEEL_HAVE_RDTSC) && defined(_MSC_VER)
+    int regs[4];
+    __cpuid(regs, 0x80000000);
+    if (static_cast<unsigned>(regs[0]) < 0x80000007u) {
+        return false;
+    }
+    __cpuid(regs, 0x80000007);
+    return (regs[3] & (1 << 8)) != 0;
+#elif defined(WHEEL_HAVE_RDTSC)
+    if (__get_cpuid_max(0x80000000, nullptr) < 0x80000007u) {
+        return false;
+    }
+    unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+    __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+    return (edx & (1u << 8)) != 0;
+#else
+    return false;
+#endif
+}
+
+// The TSC and steady_clock read as close together as possible: the
+// tightest bracket of a few tries, credited to its midpoint
+Pair ReadPair() {
+    Pair best{0, detail::SteadyNanos()};
+#ifdef WHEEL_HAVE_RDTSC
+    uint64_t best_window = ULLONG_MAX;
+    for (int i = 0; i < 8; ++i) {
+        _mm_lfence();
+        const uint64_t before = __rdtsc();
+        const int64_t ns = detail::SteadyNanos();
+        _mm_lfence();
+        const uint64_t after = __rdtsc();
+        if (after - before < best_window) {
+            best_window = after - before;
+            best = {before + (after - before) / 2, ns};
+        }
+    }
+#endif
+    return best;
+}
+
+Conversion LoadConversion() {
+    Conversion conversion;
+    while (!g_conversion.Read(conversion)) {
+        // A recalibration is mid-write; it is a handful of stores
+    }
+    return conversion;
+}
+
+void Recalibrate() {
+    const Pair now = ReadPair();
+    if (now.reading <= g_origin.reading || now.ns <= g_origin.ns) {
+        return;
+    }
+    const double ns_per_tick =
+        static_cast<double>(now.ns - g_origin.ns) / static_cast<double>(now.reading - g_origin.reading);
+    g_conversion.Write({now.reading, now.ns, ns_per_tick});
+    g_next_recalibration_ns.store(now.ns + kRecalibrateNs, std::memory_order_relaxed);
+    g_recalibrations.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Nanoseconds per call of `read`: the fastest of a few batches, so a
+// preemption in one batch does not count
+template <typename Read>
+double CostNs(Read read) {
+    constexpr int kBatches = 8;
+    constexpr int kCalls = 256;
+    double best = 1e18;
+    for (int batch = 0; batch < kBatches; ++batch) {
+        int64_t sink = 0;
+        const int64_t start = detail::SteadyNanos();
+        for (int i = 0; i < kCalls; ++i) {
+            sink += read();
+        }
+        const int64_t elapsed = detail::SteadyNanos() - start;
+        g_cost_sink = sink;
+        best = std::min(best, static_cast<double>(elapsed) / kCalls);
+    }
+    return best;
+}
+
+int64_t Convert(const Conversion& conversion, uint64_t reading) {
+    const int64_t ticks = static_cast<int64_t>(reading - conversion.base_reading);
+    return conversion.base_ns + static_cast<int64_t>(static_cast<double>(ticks) * conversion.ns_per_tick);
+}
+}  // namespace
+
+void Init(bool allow_tsc) {
+    if (UsingTsc()) {
+        return;
+    }
+    if (!allow_tsc) {
+        g_fallback_reason = "TSC disabled";
+        return;
+    }
+    if (!InvariantTsc()) {
+        g_fallback_reason = "no invariant TSC";
+        return;
+    }
+    const Pair first = ReadPair();
+    std::this_thread::sleep_for(kInitialBaseline);
+    const Pair second = ReadPair();
+    const double ticks = static_cast<double>(second.reading - first.reading);
+    const double ns = static_cast<double>(second.ns - first.ns);
+    const double hz = ns > 0.0 ? ticks / ns * 1e9 : 0.0;
+    if (!(hz > kMinHz && hz < kMaxHz)) {
+        g_fallback_reason = "TSC rate implausible";
+        return;
+    }
+    g_origin = first;
+    g_conversion.Write({second.reading, second.ns, ns / ticks});
+    g_next_recalibration_ns.store(second.ns + kRecalibrateNs, std::memory_order_relaxed);
+#ifdef WHEEL_HAVE_RDTSC
+    // Under some hypervisors rdtsc traps and costs more than the vDSO or QPC
+    // read behind steady_clock; a span on the TSC also pays the conversion
+    g_tsc_span_ns = CostNs([] {
+        return static_cast<int64_t>(static_cast<double>(__rdtsc()) * LoadConversion().ns_per_tick);
+    });
+#endif
+    g_steady_span_ns = CostNs([] { return detail::SteadyNanos(); });
+    if (g_tsc_span_ns >= g_steady_span_ns) {
+        g_fallback_reason = "rdtsc not cheaper";
+        return;
+    }
+    detail::use_tsc.store(true, std::memory_order_release);
+}
+
+int64_t ToNanos(int64_t ticks) {
+    if (!UsingTsc()) {
+        return ticks;
+    }
+    return static_cast<int64_t>(static_cast<double>(ticks) * LoadConversion().ns_per_tick);
+}
+
+int64_t ToSteadyNanos(uint64_t reading) {
+    if (!UsingTsc()) {
+        return static_cast<int64_t>(reading);
+    }
+    Conversion conversion = LoadConversion();
+    int64_t ns = Convert(conversion, reading);
+    if (ns >= g_next_recalibration_ns.load(std::memory_order_relaxed) &&
+        !g_recalibrating.test_and_set(std::memory_order_acquire)) {
+        Recalibrate();
+        g_recalibrating.clear(std::memory_order_release);
+        conversion = LoadConversion();
+        ns = Convert(conversion, reading);
+    }
+    return ns;
+}
+
+double Frequency() {
+    return UsingTsc() ? 1.0 / LoadConversion().ns_per_tick * 1e9 : 1e9;
+}
+
+std::string Describe() {
+    std::ostringstream out;
+    if (UsingTsc()) {
+        out << "Timestamps: invariant TSC at " << Frequency() / 1e9 << " GHz, "
+            << g_recalibrations.load(std::memory_order_relaxed) << " recalibrations";
+    } else {
+        out << "Timestamps: steady_clock (" << g_fallback_reason << ")";
+    }
+    if (g_steady_span_ns > 0.0) {
+        out << "; a timed span costs " << static_cast<int>(g_tsc_span_ns) << " ns on the TSC, "
+            << static_cast<int>(g_steady_span_ns) << " ns on steady_clock";
+    }
+    return out.str();
+}
+
+}  // namespace tsc
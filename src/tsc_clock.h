@@ -0,0 +1,80 @@
+#ifndef TSC_CLOCK_H
+#define TSC_CLOCK_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define WHEEL_HAVE_RDTSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define WHEEL_HAVE_RDTSC 1
+#endif
+
+// Timestamps for instrumentation (trace spans, session records, log lines,
+// latency histograms). Now() is a single rdtsc when the CPU has an invariant
+// TSC (constant rate, not stopped in sleep states) that is cheaper to read
+// than steady_clock, and steady_clock otherwise;
+// readings are kept raw on the hot path and converted to steady_clock time by
+// whoever reads them later. The TSC rate is measured against steady_clock at
+// Init() and refined by the conversions, at most once a second, over an
+// ever longer baseline.
+//
+// Not for scheduling: deadlines and physics ticks stay on steady_clock.
+namespace tsc {
+
+using Clock = std::chrono::steady_clock;
+
+namespace detail {
+extern std::atomic<bool> use_tsc;
+int64_t SteadyNanos();
+}
+
+// Checks for an invariant TSC, calibrates it (about 10 ms) and times a span on
+// it against steady_clock, keeping the cheaper of the two. Call at startup
+// before any thread takes a reading: readings taken before are steady_clock
+// values and would be misread. Without it, or with `allow_tsc` false,
+// everything runs on steady_clock.
+void Init(bool allow_tsc = true);
+
+inline bool UsingTsc() {
+    return detail::use_tsc.load(std::memory_order_relaxed);
+}
+
+// A raw reading: TSC cycles, or steady_clock nanoseconds in the fallback
+inline uint64_t Now() {
+#ifdef WHEEL_HAVE_RDTSC
+    if (UsingTsc()) {
+        return __rdtsc();
+    }
+#endif
+    return static_cast<uint64_t>(detail::SteadyNanos());
+}
+
+// Nanoseconds in a span of `ticks` (a difference of two readings)
+int64_t ToNanos(int64_t ticks);
+// The steady_clock time of a reading, as nanoseconds since its epoch
+int64_t ToSteadyNanos(uint64_t reading);
+
+inline Clock::time_point ToTimePoint(uint64_t reading) {
+    return Clock::time_point(
+        std::chrono::duration_cast<Clock::duration>(std::chrono::nanoseconds(ToSteadyNanos(reading))));
+}
+
+// Nanoseconds since `start` (a reading), never negative; for latency histograms
+inline uint64_t NanosSince(uint64_t start) {
+    const int64_t ns = ToNanos(static_cast<int64_t>(Now() - start));
+    return ns > 0 ? static_cast<uint64_t>(ns) : 0;
+}
+
+// Readings per second
+double Frequency();
+// One-line summary for the startup log
+std::string Describe();
+
+}  // namespace tsc
+
+#endif  // TSC_CLOCK_H
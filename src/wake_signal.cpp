@@ -0,0 +1,215 @@
+#include "wake_signal.h"
+
+#include <mutex>
+#include <sstream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <ctime>
+#endif
+
+namespace {
+// Consumer-side counters have one writer; a plain load/store avoids the locked RMW
+void Bump(std::atomic<uint64_t>& counter) {
+    counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+#ifdef _WIN32
+// WaitOnAddress is Windows 8+; it is loaded at runtime and older systems park
+// on a per-signal auto-reset event instead
+using WaitOnAddressFn = BOOL(WINAPI*)(volatile VOID*, PVOID, SIZE_T, DWORD);
+using WakeByAddressSingleFn = VOID(WINAPI*)(PVOID);
+
+struct SynchApi {
+    WaitOnAddressFn wait = nullptr;
+    WakeByAddressSingleFn wake = nullptr;
+};
+
+const SynchApi& Synch() {
+    static SynchApi api;
+    static std::once_flag once;
+    std::call_once(once, [] {
+        HMODULE module = LoadLibraryA("api-ms-win-core-synch-l1-2-0.dll");
+        if (!module) {
+            return;
+        }
+        api.wait = reinterpret_cast<WaitOnAddressFn>(GetProcAddress(module, "WaitOnAddress"));
+        api.wake = reinterpret_cast<WakeByAddressSingleFn>(GetProcAddress(module, "WakeByAddressSingle"));
+        if (!api.wait || !api.wake) {
+            api = SynchApi();
+        }
+    });
+    return api;
+}
+#endif
+}  // namespace
+
+WakeSignal::WakeSignal() {
+#ifdef _WIN32
+    if (!Synch().wait) {
+        fallback_event_ = CreateEvent(NULL, FALSE, FALSE, NULL);
+    }
+#endif
+}
+
+WakeSignal::~WakeSignal() {
+#ifdef _WIN32
+    if (fallback_event_) {
+        CloseHandle(static_cast<HANDLE>(fallback_event_));
+    }
+#endif
+}
+
+void WakeSignal::Stats::Add(const Stats& other) {
+    signals += other.signals;
+    kernel_wakes += other.kernel_wakes;
+    parks += other.parks;
+    timeouts += other.timeouts;
+    spurious += other.spurious;
+    useful += other.useful;
+    idle += other.idle;
+    for (size_t i = 0; i < kMaxReasons; ++i) {
+        reasons[i] += other.reasons[i];
+    }
+}
+
+void WakeSignal::Signal(uint32_t reasons) {
+    signals_.fetch_add(1, std::memory_order_relaxed);
+    // seq_cst pairs with the consumer's parked_ store and pending_ re-check:
+    // either it sees this bit before parking, or this sees parked_ set.
+    if (pending_.fetch_or(reasons, std::memory_order_seq_cst) != 0) {
+        return;  // an earlier signal is still undelivered and covers this one
+    }
+    if (!parked_.load(std::memory_order_seq_cst)) {
+        return;  // consumer is running and will Take() the bit
+    }
+    kernel_wakes_.fetch_add(1, std::memory_order_relaxed);
+    WakeParked();
+}
+
+uint32_t WakeSignal::Take() {
+    if (pending_.load(std::memory_order_relaxed) == 0) {
+        return 0;
+    }
+    return Deliver(pending_.exchange(0, std::memory_order_acquire));
+}
+
+uint32_t WakeSignal::WaitUntil(Clock::time_point deadline) {
+    for (;;) {
+        const uint32_t reasons = Take();
+        if (reasons != 0) {
+            return reasons;
+        }
+        if (Clock::now() >= deadline) {
+            Bump(timeouts_);
+            return 0;
+        }
+        parked_.store(true, std::memory_order_seq_cst);
+        if (pending_.load(std::memory_order_seq_cst) == 0) {
+            Bump(parks_);
+            Park(deadline);
+            if (pending_.load(std::memory_order_relaxed) == 0 && Clock::now() < deadline) {
+                Bump(spurious_);
+            }
+        }
+        parked_.store(false, std::memory_order_relaxed);
+    }
+}
+
+void WakeSignal::CountOutcome(bool useful) {
+    Bump(useful ? useful_ : idle_);
+}
+
+uint32_t WakeSignal::Deliver(uint32_t reasons) {
+    for (size_t i = 0; i < kMaxReasons; ++i) {
+        if (reasons & (1u << i)) {
+            Bump(reasons_[i]);
+        }
+    }
+    return reasons;
+}
+
+void WakeSignal::Park(Clock::time_point deadline) {
+#ifdef _WIN32
+    DWORD timeout_ms = INFINITE;
+    if (deadline != Clock::time_point::max()) {
+        // Round up: returning before the deadline only costs another pass
+        const auto remaining = std::chrono::ceil<std::chrono::milliseconds>(deadline - Clock::now()).count();
+        timeout_ms = static_cast<DWORD>(remaining < 0 ? 0 : remaining);
+    }
+    if (fallback_event_) {
+        WaitForSingleObject(static_cast<HANDLE>(fallback_event_), timeout_ms);
+        return;
+    }
+    uint32_t expected = 0;
+    Synch().wait(&pending_, &expected, sizeof(expected), timeout_ms);
+#else
+    // steady_clock is CLOCK_MONOTONIC, which FUTEX_WAIT_BITSET takes as an absolute deadline
+    timespec abs_deadline{};
+    timespec* timeout = nullptr;
+    if (deadline != Clock::time_point::max()) {
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count();
+        abs_deadline.tv_sec = static_cast<time_t>(ns / 1000000000);
+        abs_deadline.tv_nsec = static_cast<long>(ns % 1000000000);
+        timeout = &abs_deadline;
+    }
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&pending_), FUTEX_WAIT_BITSET_PRIVATE, 0u, timeout, nullptr,
+            FUTEX_BITSET_MATCH_ANY);
+#endif
+}
+
+void WakeSignal::WakeParked() {
+#ifdef _WIN32
+    if (fallback_event_) {
+        SetEvent(static_cast<HANDLE>(fallback_event_));
+    } else {
+        Synch().wake(&pending_);
+    }
+#else
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&pending_), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#endif
+}
+
+WakeSignal::Stats WakeSignal::GetStats() const {
+    Stats stats;
+    stats.signals = signals_.load(std::memory_order_relaxed);
+    stats.kernel_wakes = kernel_wakes_.load(std::memory_order_relaxed);
+    stats.parks = parks_.load(std::memory_order_relaxed);
+    stats.timeouts = timeouts_.load(std::memory_order_relaxed);
+    stats.spurious = spurious_.load(std::memory_order_relaxed);
+    stats.useful = useful_.load(std::memory_order_relaxed);
+    stats.idle = idle_.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < kMaxReasons; ++i) {
+        stats.reasons[i] = reasons_[i].load(std::memory_order_relaxed);
+    }
+    return stats;
+}
+
+std::string WakeSignal::Format(const char* name, const Stats& stats, const char* const* reason_names) {
+    std::ostringstream out;
+    out << name << ": " << stats.signals << " signals, " << stats.kernel_wakes << " kernel wakes";
+    if (stats.signals > 0) {
+        out << " (" << (100 * stats.Coalesced() / stats.signals) << "% coalesced)";
+    }
+    out << ", " << stats.parks << " parks, " << stats.timeouts << " timeouts, " << stats.spurious << " spurious";
+    if (stats.useful + stats.idle > 0) {
+        out << "; wakes useful " << stats.useful << ", idle " << stats.idle;
+    }
+    bool first = true;
+    for (size_t i = 0; i < kMaxReasons; ++i) {
+        if (reason_names[i] == nullptr || stats.reasons[i] == 0) {
+            continue;
+        }
+        out << (first ? " [" : ", ") << reason_names[i] << " " << stats.reasons[i];
+        first = false;
+    }
+    if (!first) {
+        out << "]";
+    }
+    return out.str();
+}
@@ -0,0 +1,91 @@
+#ifndef WAKE_SIGNAL_H
+#define WAKE_SIGNAL_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "cache_line.h"
+
+// Wakeup for a single consumer thread with coalesced signalling. Producers OR
+// a reason bit into one pending word; only a signal that finds the word empty
+// while the consumer is parked makes a kernel call (WakeByAddressSingle on
+// Windows 8+, futex on Linux). Every other signal is a single atomic OR. The
+// consumer receives all reasons raised since it last looked, in one wake.
+class WakeSignal {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Reason bits are defined by each consumer, bit 0 up to bit kMaxReasons - 1
+    static constexpr size_t kMaxReasons = 8;
+
+    struct Stats {
+        uint64_t signals = 0;
+        // Signals that had to wake a parked consumer; the rest were coalesced
+        uint64_t kernel_wakes = 0;
+        // Times the consumer parked in the kernel
+        uint64_t parks = 0;
+        uint64_t timeouts = 0;
+        // Kernel returns with nothing pending and the deadline not reached
+        uint64_t spurious = 0;
+        // Reported by the consumer: wakes after which it found work / found none
+        uint64_t useful = 0;
+        uint64_t idle = 0;
+        // Delivered wakes per reason bit (after coalescing)
+        std::array<uint64_t, kMaxReasons> reasons{};
+
+        uint64_t Coalesced() const { return signals - kernel_wakes; }
+        void Add(const Stats& other);
+    };
+
+    WakeSignal();
+    ~WakeSignal();
+    WakeSignal(const WakeSignal&) = delete;
+    WakeSignal& operator=(const WakeSignal&) = delete;
+
+    // Any thread
+    void Signal(uint32_t reasons);
+
+    // Consumer only. Take() never blocks; WaitUntil() returns the pending
+    // reasons, or 0 once `deadline` has passed with none raised.
+    uint32_t Take();
+    uint32_t WaitUntil(Clock::time_point deadline);
+    uint32_t Wait() { return WaitUntil(Clock::time_point::max()); }
+    void CountOutcome(bool useful);
+
+    Stats GetStats() const;
+    // "<name>: N signals, N kernel wakes (N% coalesced), ..." for the shutdown log;
+    // reason_names has kMaxReasons entries, unused ones null
+    static std::string Format(const char* name, const Stats& stats, const char* const* reason_names);
+
+private:
+    uint32_t Deliver(uint32_t reasons);
+    // Parks while pending_ is still 0; may return early
+    void Park(Clock::time_point deadline);
+    void WakeParked();
+
+    // Shared by producers and the consumer
+    alignas(kCacheLineSize) std::atomic<uint32_t> pending_{0};
+    std::atomic<bool> parked_{false};
+
+    // Producer counters
+    alignas(kCacheLineSize) std::atomic<uint64_t> signals_{0};
+    std::atomic<uint64_t> kernel_wakes_{0};
+
+    // Consumer counters; atomic only so GetStats() can read them from another thread
+    alignas(kCacheLineSize) std::atomic<uint64_t> parks_{0};
+    std::atomic<uint64_t> timeouts_{0};
+    std::atomic<uint64_t> spurious_{0};
+    std::atomic<uint64_t> useful_{0};
+    std::atomic<uint64_t> idle_{0};
+    std::array<std::atomic<uint64_t>, kMaxReasons> reasons_{};
+#ifdef _WIN32
+    // Set when WaitOnAddress is unavailable
+    void* fallback_event_ = nullptr;
+#endif
+};
+
+#endif  // WAKE_SIGNAL_H
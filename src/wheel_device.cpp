@@ -1,6 +1,5 @@
 #include "wheel_device.h"
 #include "input/input_manager.h"
-#include "hid/vjoy_loader.h"
 
 #include <algorithm>
 #include <chrono>
@@ -8,58 +7,115 @@
 #include <iostream>
 #include <thread>
 
+#include "bit_util.h"
+#include "flight_recorder.h"
 #include "logging/logger.h"
+#include "metrics.h"
+#include "session_recorder.h"
+#include "signal_scope.h"
+#include "trace.h"
+#include "tsc_clock.h"
+#ifdef _WIN32
+#include "hid/vjoy_loader.h"
 #include <windows.h>
+#include <mmsystem.h>
+#endif
 
 namespace {
 constexpr size_t kFFBPacketSize = 7;
 constexpr const char* kTag = "wheel_device";
+// Neutral reports sent while arming, before input is reported
+constexpr int kArmingReports = 5;
+// Wakes that mean the reported state may have changed
+constexpr uint32_t kReportDirty =
+    WheelDevice::kReportInput | WheelDevice::kReportPhysics | WheelDevice::kReportControl;
+
+// 1 ms timer resolution for sleeps and waits; other platforms already have it
+void RaiseTimerResolution() {
+#ifdef _WIN32
+    timeBeginPeriod(1);
+#endif
+}
+
+void RestoreTimerResolution() {
+#ifdef _WIN32
+    timeEndPeriod(1);
+#endif
+}
 }
 
+#ifdef _WIN32
 // vJoy FFB Callback Wrapper
 static void CALLBACK FFB_Callback(PVOID data, PVOID user_data) {
     if (user_data) {
         static_cast<WheelDevice*>(user_data)->OnFFBPacket(data);
     }
 }
+#endif
 
-void WheelDevice::NotifyAllShutdownCVs() {
-    state_cv.notify_all();
-    ffb_cv.notify_all();
+void WheelDevice::WakeForShutdown() {
+    report_wake_.Signal(kReportStop);
 }
 
 WheelDevice::WheelDevice()
-        : polling_running_(false),
-          enabled(false), steering(0.0f), user_steering(0.0f), ffb_offset(0.0f),
-          ffb_velocity(0.0f), ffb_gain(1.0f), throttle(0.0f), brake(0.0f),
-          clutch(0.0f), dpad_x(0), dpad_y(0), ffb_force(0),
-          ffb_autocenter(0) {
-    ffb_running = false;
-    state_dirty = false;
-    warmup_frames.store(0, std::memory_order_relaxed);
-    output_enabled.store(false, std::memory_order_relaxed);
-    button_states.fill(0);
+        : polling_running_(false), external_reports_(false), timer_resolution_held_(false), state_export_(nullptr),
+          ffb_gain(1.0f),
+          min_button_pulse(std::chrono::milliseconds(25)), physics_parked_(false), user_steering(0.0f),
+          dpad_x(0), dpad_y(0), report_trace_flow_(0), arming_reports_(0), steering(0.0f), ffb_offset(0.0f),
+          ffb_velocity(0.0f), ffb_filtered(0.0f), physics_resting_(false), throttle(0.0f), brake(0.0f),
+          clutch(0.0f), ffb_force(0), ffb_autocenter(0) {
+    button_states.Clear();
+    pedal_analog.fill(0.0f);
 }
 
 WheelDevice::~WheelDevice() {
     ShutdownThreads();
 }
 
+// The physics tick is owned by the scheduler, which must be stopped first
 void WheelDevice::ShutdownThreads() {
-    ffb_running = false;
     polling_running_ = false;
-    warmup_frames.store(0, std::memory_order_relaxed);
-    output_enabled.store(false, std::memory_order_relaxed);
+    lifecycle_.ForceDisabled();
 
-    state_cv.notify_all();
-    ffb_cv.notify_all();
+    report_wake_.Signal(kReportStop);
 
     StopPollingThread();
-    if (ffb_thread.joinable()) {
-        ffb_thread.join();
+
+    if (timer_resolution_held_) {
+        RestoreTimerResolution();
+        timer_resolution_held_ = false;
     }
 }
 
+void WheelDevice::SetVJoyId(unsigned int vjoy_id) {
+    hid_device_.SetDeviceId(vjoy_id);
+}
+
+void WheelDevice::SetReportSink(hid::HidDevice::ReportSink sink) {
+    hid_device_.SetReportSink(std::move(sink));
+}
+
+void WheelDevice::SetHeadless() {
+    hid_device_.SetHeadless();
+}
+
+void WheelDevice::SetStateExport(Seqlock<shared_stats::SeatState>* slot) {
+    state_export_ = slot;
+}
+
+void WheelDevice::AttachPhysics(PhysicsScheduler& scheduler) {
+    size_t task = scheduler.AddTask([this](std::chrono::steady_clock::time_point now) { return PhysicsTick(now); });
+    physics_wake_ = [&scheduler, task] { scheduler.Wake(task); };
+}
+
+void WheelDevice::SetPhysicsWake(std::function<void()> wake) {
+    physics_wake_ = std::move(wake);
+}
+
+void WheelDevice::UseExternalReportLoop() {
+    external_reports_ = true;
+}
+
 bool WheelDevice::Create() {
     LOG_DEBUG(kTag, "Attempting to create device using vJoy...");
     
@@ -69,17 +125,19 @@ bool WheelDevice::Create() {
         return false;
     }
 
+#ifdef _WIN32
     // Register FFB Callback
     hid_device_.RegisterFFBCallback((void*)FFB_Callback, this);
+#endif
 
     SendNeutral(true);
-
-    ffb_running = true;
-    ffb_thread = std::thread(&WheelDevice::FFBUpdateThread, this);
     return true;
 }
 
 void WheelDevice::EnsurePollingThreadStarted() {
+    if (external_reports_) {
+        return;
+    }
     if (!polling_running_) {
         polling_running_ = true;
         polling_thread_ = std::thread(&WheelDevice::VJoyPollingThread, this);
@@ -89,29 +147,22 @@ void WheelDevice::EnsurePollingThreadStarted() {
 void WheelDevice::StopPollingThread() {
     if (polling_running_) {
         polling_running_ = false;
-        state_cv.notify_all();
+        report_wake_.Signal(kReportStop);
     }
     if (polling_thread_.joinable()) {
         polling_thread_.join();
     }
 }
 
-bool WheelDevice::IsEnabled() {
-    std::lock_guard<std::mutex> lock(state_mutex);
-    return enabled;
+bool WheelDevice::IsEnabled() const {
+    return lifecycle_.IsLive();
 }
 
+// Control path: serialized by enable_mutex. The report thread finishes the
+// Arming and Draining phases once their neutral reports have gone out.
 void WheelDevice::SetEnabled(bool enable, InputManager& input_manager) {
     std::unique_lock<std::mutex> enable_lock(enable_mutex);
-    bool changed = false;
-    {
-        std::lock_guard<std::mutex> lock(state_mutex);
-        if (enabled != enable) {
-            enabled = enable;
-            changed = true;
-        }
-    }
-    if (!changed) {
+    if (enable == lifecycle_.IsLive()) {
         if (!enable) {
             input_manager.GrabDevices(false);
         }
@@ -120,71 +171,56 @@ void WheelDevice::SetEnabled(bool enable, InputManager& input_manager) {
 
     if (enable) {
         if (!input_manager.GrabDevices(true)) {
-            {
-                std::lock_guard<std::mutex> lock(state_mutex);
-                enabled = false;
-            }
             std::cerr << "Enable aborted: unable to grab input" << std::endl;
             return;
         }
         
         input_manager.ResyncKeyStates();
 
-        output_enabled.store(false, std::memory_order_release);
-        warmup_frames.store(0, std::memory_order_release);
-        state_dirty.store(false, std::memory_order_release);
-
         // Windows: Check vJoy ready
         if (!hid_device_.IsReady() && !hid_device_.Initialize()) {
-             {
-                std::lock_guard<std::mutex> lock(state_mutex);
-                enabled = false;
-            }
             input_manager.GrabDevices(false);
             return;
         }
 
         EnsurePollingThreadStarted();
 
-        output_enabled.store(true, std::memory_order_release);
-        warmup_frames.store(0, std::memory_order_release);
-        state_dirty.store(false, std::memory_order_release);
-
         {
             std::lock_guard<std::mutex> lock(state_mutex);
             ApplyNeutralLocked(false);
+            lifecycle_.BeginArming();
+        }
+        metrics::Adjust(metrics::Gauge::EnabledSeats, 1);
+        if (!timer_resolution_held_) {
+            RaiseTimerResolution();
+            timer_resolution_held_ = true;
         }
-        state_dirty.store(true, std::memory_order_release);
-        state_cv.notify_all();
-        
-        warmup_frames.store(5, std::memory_order_release);
-        state_cv.notify_all();
     } else {
-        warmup_frames.store(0, std::memory_order_release);
-        
+        // Draining is published together with the neutral state: writers
+        // re-check the phase under state_mutex, so once the report thread
+        // sees Draining nothing but the neutral state is left to report.
         {
             std::lock_guard<std::mutex> lock(state_mutex);
+            lifecycle_.BeginDraining();
             ApplyNeutralLocked(true);
         }
-        state_dirty.store(true, std::memory_order_release);
-        state_cv.notify_all();
-
-        output_enabled.store(false, std::memory_order_release);
-        state_dirty.store(false, std::memory_order_release);
+        metrics::Adjust(metrics::Gauge::EnabledSeats, -1);
 
         input_manager.ResyncKeyStates();
         input_manager.GrabDevices(false);
+        if (timer_resolution_held_) {
+            RestoreTimerResolution();
+            timer_resolution_held_ = false;
+        }
     }
+    session::RecordEnable(hid_device_.DeviceId(), enable);
+    flight::RecordEnable(hid_device_.DeviceId(), enable);
+    report_wake_.Signal(kReportControl);
     LOG_INFO(kTag, (enable ? "Emulation ENABLED" : "Emulation DISABLED"));
 }
 
 void WheelDevice::ToggleEnabled(InputManager& input_manager) {
-    bool next_state;
-    {
-        std::lock_guard<std::mutex> lock(state_mutex);
-        next_state = !enabled;
-    }
-    SetEnabled(next_state, input_manager);
+    SetEnabled(!lifecycle_.IsLive(), input_manager);
 }
 
 void WheelDevice::SetFFBGain(float gain) {
@@ -194,33 +230,80 @@ void WheelDevice::SetFFBGain(float gain) {
     ffb_gain = gain;
 }
 
+void WheelDevice::SetPedalRamps(const PedalRampConfig& throttle_cfg, const PedalRampConfig& brake_cfg,
+                                const PedalRampConfig& clutch_cfg) {
+    std::lock_guard<std::mutex> lock(state_mutex);
+    throttle_ramp.Configure(throttle_cfg);
+    brake_ramp.Configure(brake_cfg);
+    clutch_ramp.Configure(clutch_cfg);
+    throttle = 0.0f;
+    brake = 0.0f;
+    clutch = 0.0f;
+}
+
+void WheelDevice::SetMinButtonPulse(int pulse_ms) {
+    if (pulse_ms < 0) pulse_ms = 0;
+    std::lock_guard<std::mutex> lock(state_mutex);
+    min_button_pulse = std::chrono::milliseconds(pulse_ms);
+}
+
+void WheelDevice::SetThreading(const ThreadingConfig& threading) {
+    threading_ = threading;
+}
+
+void WheelDevice::SetTimer(const PreciseTimer& timer) {
+    timer_ = timer;
+}
+
 void WheelDevice::ProcessInputFrame(const InputFrame& frame, int sensitivity) {
-    if (!enabled || !output_enabled.load(std::memory_order_acquire)) {
+    TRACE_SCOPE("WheelDevice::ProcessInputFrame");
+    if (!lifecycle_.IsLive()) {
         return;
     }
+    trace::FlowStep("input frame", frame.trace_flow);
+    session::RecordInputFrame(hid_device_.DeviceId(), frame, sensitivity);
+    flight::RecordInputFrame(hid_device_.DeviceId(), frame);
     bool changed = false;
+    bool ramp_started = false;
     {
-        std::lock_guard<std::mutex> lock(state_mutex);
+        auto lock = LockState();
+        // Disable resets the state under this lock after publishing Draining
+        if (!lifecycle_.IsLive()) {
+            return;
+        }
         changed |= ApplySteeringDeltaLocked(frame.mouse_dx, sensitivity);
-        changed |= ApplySnapshotLocked(frame.logical);
+        changed |= ApplySnapshotLocked(frame.logical, ramp_started);
+        changed |= ApplyButtonEdgesLocked(frame.edges);
+        if (frame.trace_flow != 0) {
+            report_trace_flow_ = frame.trace_flow;
+        }
     }
     if (changed) {
         NotifyStateChanged();
     }
+    if (changed || ramp_started) {
+        WakePhysicsIfParked();
+    }
 }
 
 void WheelDevice::ApplySnapshot(const WheelInputState& snapshot) {
     bool changed = false;
+    bool ramp_started = false;
     {
-        std::lock_guard<std::mutex> lock(state_mutex);
-        changed = ApplySnapshotLocked(snapshot);
+        auto lock = LockState();
+        changed = ApplySnapshotLocked(snapshot, ramp_started);
     }
     if (changed) {
         NotifyStateChanged();
     }
+    if (changed || ramp_started) {
+        WakePhysicsIfParked();
+    }
 }
 
 void WheelDevice::SendNeutral(bool reset_ffb) {
+    session::RecordNeutral(hid_device_.DeviceId(), reset_ffb);
+    flight::RecordNeutral(hid_device_.DeviceId(), reset_ffb);
     {
         std::lock_guard<std::mutex> lock(state_mutex);
         ApplyNeutralLocked(reset_ffb);
@@ -229,9 +312,35 @@ void WheelDevice::SendNeutral(bool reset_ffb) {
 }
 
 void WheelDevice::NotifyStateChanged() {
-    state_dirty.store(true, std::memory_order_release);
-    state_cv.notify_all();
-    ffb_cv.notify_all();
+    report_wake_.Signal(kReportInput);
+}
+
+// Pairs with the tick that parked: it set the flag under state_mutex after
+// seeing the old state, so a change made after that lock is seen here.
+// While the tick is running the flag is clear and this is a single load.
+void WheelDevice::WakePhysicsIfParked() {
+    if (physics_parked_.load(std::memory_order_relaxed) && physics_parked_.exchange(false) && physics_wake_) {
+        physics_wake_();
+    }
+}
+
+std::unique_lock<std::mutex> WheelDevice::LockState() {
+    std::unique_lock<std::mutex> lock(state_mutex, std::defer_lock);
+    RelockState(lock);
+    return lock;
+}
+
+// Uncontended acquisitions only bump a counter; the wait is timed only when
+// another thread holds the lock
+void WheelDevice::RelockState(std::unique_lock<std::mutex>& lock) {
+    metrics::Increment(metrics::Counter::StateLocks);
+    if (lock.try_lock()) {
+        return;
+    }
+    const uint64_t start = tsc::Now();
+    lock.lock();
+    metrics::Record(metrics::Histogram::StateLockWait, tsc::NanosSince(start));
+    metrics::Increment(metrics::Counter::StateLockContended);
 }
 
 bool WheelDevice::ApplySteeringDeltaLocked(int delta, int sensitivity) {
@@ -248,19 +357,31 @@ bool WheelDevice::ApplySteeringDeltaLocked(int delta, int sensitivity) {
     return ApplySteeringLocked();
 }
 
-bool WheelDevice::ApplySnapshotLocked(const WheelInputState& snapshot) {
+bool WheelDevice::ApplySnapshotLocked(const WheelInputState& snapshot, bool& ramp_started) {
     bool changed = false;
-    auto set_axis = [&](float& axis, bool pressed) {
-        float next = pressed ? 100.0f : 0.0f;
-        if (axis != next) {
+    // Pedals only retarget here; ramped travel is advanced on the physics tick,
+    // which may be parked: a ramp that starts must wake it even though the
+    // output has not moved yet.
+    auto set_axis = [&](Pedal pedal, PedalRamp& ramp, float& axis, bool pressed) {
+        const size_t index = static_cast<size_t>(pedal);
+        const bool was_ramping = ramp.IsRamping();
+        bool ramp_changed = ramp.SetPressed(pressed);
+        ramp_started |= !was_ramping && ramp.IsRamping();
+        float analog = (snapshot.analog_mask & (1u << index)) ? snapshot.analog_pedals[index] : 0.0f;
+        if (!ramp_changed && analog == pedal_analog[index]) {
+            return;
+        }
+        pedal_analog[index] = analog;
+        float next = std::max(ramp.Output(), analog) * 100.0f;
+        if (next != axis) {
             axis = next;
             changed = true;
         }
     };
 
-    set_axis(throttle, snapshot.throttle);
-    set_axis(brake, snapshot.brake);
-    set_axis(clutch, snapshot.clutch);
+    set_axis(Pedal::Throttle, throttle_ramp, throttle, snapshot.throttle);
+    set_axis(Pedal::Brake, brake_ramp, brake, snapshot.brake);
+    set_axis(Pedal::Clutch, clutch_ramp, clutch, snapshot.clutch);
 
     if (dpad_x != snapshot.dpad_x) {
         dpad_x = snapshot.dpad_x;
@@ -279,6 +400,74 @@ bool WheelDevice::ApplySnapshotLocked(const WheelInputState& snapshot) {
     return changed;
 }
 
+bool WheelDevice::AdvancePedalsLocked(float dt) {
+    bool changed = false;
+    auto advance = [&](Pedal pedal, PedalRamp& ramp, float& axis) {
+        if (ramp.Advance(dt)) {
+            axis = std::max(ramp.Output(), pedal_analog[static_cast<size_t>(pedal)]) * 100.0f;
+            changed = true;
+        }
+    };
+
+    advance(Pedal::Throttle, throttle_ramp, throttle);
+    advance(Pedal::Brake, brake_ramp, brake);
+    advance(Pedal::Clutch, clutch_ramp, clutch);
+    return changed;
+}
+
+bool WheelDevice::ApplyButtonEdgesLocked(const std::vector<ButtonEdge>& edges) {
+    bool changed = false;
+    for (const ButtonEdge& edge : edges) {
+        // Releases are carried by the level state; only presses start a pulse.
+        // A press landing on a pulse no report has shown yet just extends it.
+        if (!edge.pressed || edge.button >= kMaxButtons) {
+            continue;
+        }
+        auto release_at = edge.timestamp + min_button_pulse;
+        if (pulse_buttons.Test(edge.button)) {
+            if (reported_pulses.Test(edge.button)) {
+                // The game has seen the held press: the next report shows the
+                // button released and the one after it pressed again
+                pulse_gaps.Set(edge.button);
+                reported_pulses.Reset(edge.button);
+                pulse_release_at[edge.button] = release_at;
+                changed = true;
+            } else {
+                pulse_release_at[edge.button] = std::max(pulse_release_at[edge.button], release_at);
+            }
+            continue;
+        }
+        if (!pulse_buttons.Any() || release_at < next_pulse_release) {
+            next_pulse_release = release_at;
+        }
+        pulse_buttons.Set(edge.button);
+        reported_pulses.Reset(edge.button);
+        pulse_release_at[edge.button] = release_at;
+        changed = true;
+    }
+    return changed;
+}
+
+// Only pulses that have been part of a submitted report may expire, so every
+// press is visible to the game at least once regardless of timing.
+bool WheelDevice::ReleaseExpiredPulsesLocked(std::chrono::steady_clock::time_point now) {
+    bool released = false;
+    bool have_next = false;
+    const ButtonMask active = pulse_buttons;
+    ForEachSetBit(active.words, [&](size_t button) {
+        if (reported_pulses.Test(button) && now >= pulse_release_at[button]) {
+            pulse_buttons.Reset(button);
+            released = true;
+            return;
+        }
+        if (!have_next || pulse_release_at[button] < next_pulse_release) {
+            next_pulse_release = pulse_release_at[button];
+            have_next = true;
+        }
+    });
+    return released;
+}
+
 void WheelDevice::ApplyNeutralLocked(bool reset_ffb) {
     steering = 0.0f;
     user_steering = 0.0f;
@@ -289,18 +478,34 @@ void WheelDevice::ApplyNeutralLocked(bool reset_ffb) {
     throttle = 0.0f;
     brake = 0.0f;
     clutch = 0.0f;
+    throttle_ramp.Reset();
+    brake_ramp.Reset();
+    clutch_ramp.Reset();
+    pedal_analog.fill(0.0f);
     dpad_x = 0;
     dpad_y = 0;
-    button_states.fill(0);
+    button_states.Clear();
+    pulse_buttons.Clear();
+    pulse_gaps.Clear();
+    reported_pulses.Clear();
+    pulse_represses.Clear();
 }
 
-std::array<uint8_t, 13> WheelDevice::BuildHIDReport() {
-    std::lock_guard<std::mutex> lock(state_mutex);
-    return BuildHIDReportLocked();
+HidReport WheelDevice::BuildHIDReport(uint64_t& trace_flow) {
+    auto lock = LockState();
+    trace_flow = report_trace_flow_;
+    report_trace_flow_ = 0;
+    const HidReport report = BuildHIDReportLocked();
+    // Gapped pulses went out released; they count as shown once the next
+    // report carries them pressed again
+    reported_pulses = pulse_buttons & ~pulse_gaps;
+    pulse_represses = pulse_gaps;
+    pulse_gaps.Clear();
+    return report;
 }
 
-std::array<uint8_t, 13> WheelDevice::BuildHIDReportLocked() const {
-    std::array<uint8_t, 13> report{};
+HidReport WheelDevice::BuildHIDReportLocked() const {
+    HidReport report{};
 
     uint16_t steering_u = static_cast<uint16_t>(static_cast<int16_t>(steering) + 32768);
     report[0] = steering_u & 0xFF;
@@ -330,208 +535,289 @@ std::array<uint8_t, 13> WheelDevice::BuildHIDReportLocked() const {
 
     report[8] = hat & 0x0F;
 
-    uint32_t button_bits = BuildButtonBitsLocked();
-    report[9] = button_bits & 0xFF;
-    report[10] = (button_bits >> 8) & 0xFF;
-    report[11] = (button_bits >> 16) & 0xFF;
-    report[12] = (button_bits >> 24) & 0xFF;
+    const ButtonMask buttons = (button_states | pulse_buttons) & ~pulse_gaps;
+    for (size_t w = 0; w < ButtonMask::kWords; ++w) {
+        uint64_t word = buttons.words[w];
+        for (size_t b = 0; b < 8; ++b) {
+            report[kReportButtonOffset + w * 8 + b] = static_cast<uint8_t>(word >> (b * 8));
+        }
+    }
 
     return report;
 }
 
 bool WheelDevice::SendReport() {
-    auto report_data = BuildHIDReport();
-    return hid_device_.WriteReportBlocking(report_data);
+    TRACE_SCOPE("WheelDevice::SendReport");
+    uint64_t trace_flow = 0;
+    auto report_data = BuildHIDReport(trace_flow);
+    session::RecordReport(hid_device_.DeviceId(), report_data);
+    flight::RecordReport(hid_device_.DeviceId(), report_data);
+    const uint64_t start = tsc::Now();
+    const bool written = hid_device_.WriteReportBlocking(report_data);
+    metrics::Record(metrics::Histogram::ReportWrite, tsc::NanosSince(start));
+    metrics::Increment(metrics::Counter::ReportsSent);
+    trace::FlowEnd("input frame", trace_flow);
+    return written;
 }
 
 void WheelDevice::VJoyPollingThread() {
-    std::unique_lock<std::mutex> lock(state_mutex);
+    using clock = std::chrono::steady_clock;
+    ScopedThreadTuning tuning(threading_, ThreadRole::Report);
+    trace::SetThreadName("vJoy reports");
+    // Nothing polls: the thread sleeps until a change is signalled or the
+    // deadline the last step returned (arming, draining, a pulse release)
+    clock::time_point next = clock::time_point::max();
     while (polling_running_ && running) {
-        state_cv.wait_for(lock, std::chrono::milliseconds(2), [&] {
-            return !polling_running_ || !running ||
-                   state_dirty.load(std::memory_order_acquire) ||
-                   warmup_frames.load(std::memory_order_acquire) > 0;
-        });
+        uint32_t reasons = report_wake_.Take();
+        if (reasons == 0 && next > clock::now()) {
+            const bool spin = next != clock::time_point::max() && timer_.SpinMargin().count() > 0;
+            reasons = report_wake_.WaitUntil(spin ? timer_.SleepDeadline(next) : next);
+            if (reasons == 0 && spin) {
+                // Release the pulse on time rather than one OS wake late
+                PreciseTimer::SpinUntil(next);
+            }
+        }
         if (!polling_running_ || !running) break;
+        bool sent = false;
+        auto lock = LockState();
+        next = ReportStepLocked(lock, clock::now(), reasons, sent);
+        report_wake_.CountOutcome(sent);
+    }
+}
 
-        bool should_send = state_dirty.exchange(false, std::memory_order_acq_rel);
-        int pending = warmup_frames.load(std::memory_order_acquire);
-        if (pending > 0) {
-            warmup_frames.fetch_sub(1, std::memory_order_acq_rel);
-            should_send = true;
-        }
-        
-        bool allow_output = output_enabled.load(std::memory_order_acquire);
-        lock.unlock();
-        
-        if (allow_output && should_send) {
-            SendReport(); 
-        }
-        lock.lock();
+std::chrono::steady_clock::time_point WheelDevice::ServiceReports(std::chrono::steady_clock::time_point now) {
+    const uint32_t reasons = report_wake_.Take();
+    bool sent = false;
+    auto lock = LockState();
+    const auto next = ReportStepLocked(lock, now, reasons, sent);
+    if (reasons != 0) {
+        report_wake_.CountOutcome(sent);
+    }
+    return next;
+}
+
+std::chrono::steady_clock::time_point WheelDevice::ReportStepLocked(std::unique_lock<std::mutex>& lock,
+                                                                     std::chrono::steady_clock::time_point now,
+                                                                     uint32_t reasons, bool& sent) {
+    const LifecycleState state = lifecycle_.Load();
+    bool should_send = (reasons & kReportDirty) != 0;
+    // Arming and Draining both end with reports of the neutral state the
+    // control path left behind; each report goes out before the phase ends.
+    if (state == LifecycleState::Arming || state == LifecycleState::Draining) {
+        should_send = true;
+    }
+    if (state != LifecycleState::Arming) {
+        arming_reports_ = 0;
+    }
+    if (pulse_buttons.Any() && ReleaseExpiredPulsesLocked(now)) {
+        should_send = true;
+    }
+    // The last report released a re-pressed pulse; this one presses it again
+    if (pulse_represses.Any()) {
+        should_send = true;
+    }
+
+    lock.unlock();
+
+    if (state != LifecycleState::Disabled && should_send) {
+        SendReport();
+        sent = true;
+    }
+    if (state == LifecycleState::Arming && ++arming_reports_ >= kArmingReports) {
+        lifecycle_.FinishArming();
+    } else if (state == LifecycleState::Draining && lifecycle_.FinishDraining()) {
+        LOG_DEBUG(kTag, "Final neutral report sent");
+    }
+    RelockState(lock);
+
+    const LifecycleState next = lifecycle_.Load();
+    if (next == LifecycleState::Arming || next == LifecycleState::Draining || pulse_represses.Any()) {
+        return now;
     }
+    if (pulse_buttons.Any()) {
+        return next_pulse_release;
+    }
+    return std::chrono::steady_clock::time_point::max();
 }
 
+#ifdef _WIN32
 void WheelDevice::OnFFBPacket(void* data) {
-    if (!enabled || !data) return;
+    trace::SetThreadName("vJoy FFB callback");
+    TRACE_SCOPE("WheelDevice::OnFFBPacket");
+    if (!data || !lifecycle_.IsLive()) return;
 
     FFB_DATA* packet = static_cast<FFB_DATA*>(data);
+    session::RecordFfbPacket(hid_device_.DeviceId(), packet->cmd, packet->data, packet->size);
+    flight::RecordFfbPacket(hid_device_.DeviceId(), packet->cmd, packet->data, packet->size);
     FFBPType type = PT_CONSTREP; 
     
     // Using dynamic loader pointer
     if (vJoy.Ffb_h_Type(packet, &type) != ERROR_SUCCESS) {
         return;
     }
-    
-    std::lock_guard<std::mutex> lock(state_mutex);
-    bool state_changed = false;
 
     switch (type) {
         case PT_CONSTREP: {
+            metrics::Increment(metrics::Counter::FfbConstant);
             FFB_EFF_CONSTANT effect;
             if (vJoy.Ffb_h_Eff_Constant(packet, &effect) == ERROR_SUCCESS) {
                 // vJoy/Game sends 16-bit signed data in a 32-bit field.
                 int16_t raw_mag = static_cast<int16_t>(effect.Magnitude & 0xFFFF);
 
                 // Linux Logic: Positive USB Input (Right) -> Negative Internal Force.
-                ffb_force = -static_cast<int16_t>((static_cast<int32_t>(raw_mag) * 6096) / 10000);
-                
-                state_changed = true;
+                ApplyFFBForce(-static_cast<int16_t>((static_cast<int32_t>(raw_mag) * 6096) / 10000));
             }
             break;
         }
 
         case PT_EFOPREP: {
+            metrics::Increment(metrics::Counter::FfbEffectOp);
             FFB_EFF_OP op;
             if (vJoy.Ffb_h_EffOp(packet, &op) == ERROR_SUCCESS) {
                 if (op.EffectOp == EFF_STOP) {
-                    ffb_force = 0;
-                    state_changed = true;
+                    ApplyFFBForce(0);
                 }
             }
             break;
         }
         case PT_CTRLREP: {
+            metrics::Increment(metrics::Counter::FfbControl);
             FFB_CTRL control;
             if (vJoy.Ffb_h_DevCtrl(packet, &control) == ERROR_SUCCESS) {
                 if (control == CTRL_STOPALL || control == CTRL_DEVRST) {
-                    ffb_force = 0;
-                    state_changed = true;
+                    ApplyFFBForce(0);
                 }
             }
             break;
         }
         default:
+            metrics::Increment(metrics::Counter::FfbOther);
             break;
     }
-    
-    if (state_changed) {
-        ffb_cv.notify_all();
-    }
 }
+#endif
 
-void WheelDevice::FFBUpdateThread() {
-    float filtered_ffb = 0.0f;
-    using clock = std::chrono::steady_clock;
-    auto last = clock::now();
-
-    while (true) {
-        std::unique_lock<std::mutex> lock(state_mutex);
-        ffb_cv.wait_for(lock, std::chrono::milliseconds(1));
-        if (!ffb_running || !running) break;
-
-        if (!enabled) {
-            lock.unlock();
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
-            continue;
-        }
-
-        int16_t local_force = ffb_force;
-        int16_t local_autocenter = ffb_autocenter;
-        float local_offset = ffb_offset;
-        float local_velocity = ffb_velocity;
-        float local_gain = ffb_gain;
-        float local_steering = steering;
-        lock.unlock();
-
-        auto now = clock::now();
-        float dt = std::chrono::duration<float>(now - last).count();
-        if (dt <= 0.0f) dt = 0.001f;
-        if (dt > 0.01f) dt = 0.01f;
-        last = now;
-
-        float commanded_force = ShapeFFBTorque(static_cast<float>(local_force));
-
-        const float force_filter_hz = 38.0f;
-        float alpha = 1.0f - std::exp(-dt * force_filter_hz);
-        alpha = std::clamp(alpha, 0.0f, 1.0f);
-        filtered_ffb += (commanded_force - filtered_ffb) * alpha;
-
-        float spring = 0.0f;
-        if (local_autocenter > 0) {
-            spring = -(local_steering * static_cast<float>(local_autocenter)) / 32768.0f;
-        }
+void WheelDevice::ApplyFFBForce(int16_t force) {
+    {
+        auto lock = LockState();
+        if (!lifecycle_.IsLive()) return;
+        ffb_force = force;
+    }
+    session::RecordFfbForce(hid_device_.DeviceId(), force);
+    flight::RecordFfbForce(hid_device_.DeviceId(), force);
+    if (physics_wake_) {
+        physics_parked_.store(false, std::memory_order_relaxed);
+        physics_wake_();
+    }
+}
 
-        const float offset_limit = 22000.0f;
-        float target_offset = (filtered_ffb + spring) * local_gain;
-        target_offset = std::clamp(target_offset, -offset_limit, offset_limit);
-
-        const float stiffness = 120.0f;
-        const float damping = 8.0f;
-        const float max_velocity = 90000.0f;
-        float error = target_offset - local_offset;
-        local_velocity += error * stiffness * dt;
-        float damping_factor = std::exp(-damping * dt);
-        local_velocity *= damping_factor;
-        local_velocity = std::clamp(local_velocity, -max_velocity, max_velocity);
-
-        local_offset += local_velocity * dt;
-        if (local_offset > offset_limit) {
-            local_offset = offset_limit;
-            local_velocity = 0.0f;
-        } else if (local_offset < -offset_limit) {
-            local_offset = -offset_limit;
-            local_velocity = 0.0f;
+bool WheelDevice::PhysicsTick(std::chrono::steady_clock::time_point now) {
+    TRACE_SCOPE("WheelDevice::PhysicsTick");
+    // At rest and nothing changed since (every change clears the flag): a
+    // resting seat that shares a worker with a busy one costs two loads per tick
+    if (physics_resting_ && physics_parked_.load(std::memory_order_relaxed)) {
+        last_physics_tick = now;
+        return false;
+    }
+    if (!lifecycle_.IsLive()) {
+        last_physics_tick = now;
+        auto lock = LockState();
+        if (lifecycle_.IsLive()) {
+            return true;  // enabled meanwhile; tick again
         }
-
-        lock.lock();
-        if (!ffb_running || !running) break;
-        ffb_offset = local_offset;
-        ffb_velocity = local_velocity;
-        bool steering_changed = ApplySteeringLocked();
-        lock.unlock();
-
-        if (steering_changed) {
-            state_dirty.store(true, std::memory_order_release);
-            state_cv.notify_all();
+        physics_resting_ = true;
+        physics_parked_.store(true, std::memory_order_relaxed);
+        if (state_export_) {
+            state_export_->Write(ExportStateLocked(now));
         }
+        return false;
     }
-}
-
-// FFB Torque Shaping
-float WheelDevice::ShapeFFBTorque(float raw_force) const {
-    float abs_force = std::fabs(raw_force);
-    if (abs_force < 80.0f) {
-        return raw_force * (abs_force / 80.0f);
+    auto lock = LockState();
+
+    FfbPhysicsInput input;
+    input.force = ffb_force;
+    input.autocenter = ffb_autocenter;
+    input.gain = ffb_gain;
+    input.steering = steering;
+    FfbPhysicsState physics;
+    physics.filtered_force = ffb_filtered;
+    physics.offset = ffb_offset;
+    physics.velocity = ffb_velocity;
+    lock.unlock();
+
+    float dt = std::chrono::duration<float>(now - last_physics_tick).count();
+    if (dt <= 0.0f || physics_resting_) dt = 0.001f;
+    if (dt > 0.01f) dt = 0.01f;
+    last_physics_tick = now;
+
+    const bool scoped = scope::Enabled();
+    FfbPhysicsSignals signals;
+    StepFfbPhysics(physics, input, dt, scoped ? &signals : nullptr);
+    bool settled = SettleFfbPhysics(physics, input);
+
+    RelockState(lock);
+    if (!lifecycle_.IsLive()) {
+        // Disabled while stepping; keep the neutral state
+        return true;
+    }
+    // FFB packets land under this lock; one that changed the input makes this step stale
+    settled = settled && ffb_force == input.force && ffb_gain == input.gain;
+    ffb_filtered = physics.filtered_force;
+    ffb_offset = physics.offset;
+    ffb_velocity = physics.velocity;
+    bool steering_changed = ApplySteeringLocked();
+    bool pedals_changed = AdvancePedalsLocked(dt);
+    const bool at_rest = settled && !steering_changed && !throttle_ramp.IsRamping() &&
+                         !brake_ramp.IsRamping() && !clutch_ramp.IsRamping();
+    physics_resting_ = at_rest;
+    if (at_rest) {
+        physics_parked_.store(true, std::memory_order_relaxed);
+    }
+    const float steering_now = steering;
+    shared_stats::SeatState exported{};
+    if (state_export_) {
+        exported = ExportStateLocked(now);
+    }
+    lock.unlock();
+
+    flight::RecordPhysics(hid_device_.DeviceId(), input.force, steering_now, physics.offset, physics.velocity);
+    if (scoped) {
+        scope::Signals scoped_signals;
+        scoped_signals.force = input.force;
+        scoped_signals.commanded_force = signals.commanded_force;
+        scoped_signals.filtered_force = physics.filtered_force;
+        scoped_signals.spring = signals.spring;
+        scoped_signals.target_offset = signals.target_offset;
+        scoped_signals.offset = physics.offset;
+        scoped_signals.velocity = physics.velocity;
+        scoped_signals.dt = dt;
+        scoped_signals.steering = steering_now;
+        scope::RecordTick(hid_device_.DeviceId(), now, scoped_signals);
+    }
+    if (state_export_) {
+        state_export_->Write(exported);
     }
 
-    const float min_gain = 0.25f;
-    const float slip_knee = 4000.0f;
-    const float slip_full = 14000.0f;
-    float t = (abs_force - 80.0f) / (slip_full - 80.0f);
-    t = std::clamp(t, 0.0f, 1.0f);
-    float slip_weight = t * t;
-
-    float gain = min_gain;
-    if (abs_force > slip_knee) {
-        float heavy = (abs_force - slip_knee) / (slip_full - slip_knee);
-        heavy = std::clamp(heavy, 0.0f, 1.0f);
-        gain = min_gain + (1.0f - min_gain) * heavy;
-    } else {
-        gain = min_gain + (slip_weight * (1.0f - min_gain));
+    if (steering_changed || pedals_changed) {
+        report_wake_.Signal(kReportPhysics);
     }
+    return !at_rest;
+}
 
-    const float boost = 3.0f; // Restored to 3.0f to match Linux config exactly
-    return raw_force * gain * boost;
+shared_stats::SeatState WheelDevice::ExportStateLocked(std::chrono::steady_clock::time_point now) const {
+    shared_stats::SeatState state{};
+    state.tick_ns = shared_stats::SteadyNanos(now);
+    state.lifecycle = static_cast<uint32_t>(lifecycle_.Load());
+    state.ffb_force = ffb_force;
+    state.steering = steering;
+    state.user_steering = user_steering;
+    state.ffb_offset = ffb_offset;
+    state.ffb_velocity = ffb_velocity;
+    state.ffb_gain = ffb_gain;
+    state.throttle = throttle;
+    state.brake = brake;
+    state.clutch = clutch;
+    return state;
 }
 
 bool WheelDevice::ApplySteeringLocked() {
@@ -543,13 +829,3 @@ bool WheelDevice::ApplySteeringLocked() {
     steering = combined;
     return true;
 }
-
-uint32_t WheelDevice::BuildButtonBitsLocked() const {
-    uint32_t bits = 0;
-    for (size_t i = 0; i < button_states.size(); ++i) {
-        if (button_states[i]) {
-            bits |= (1u << i);
-        }
-    }
-    return bits;
-}
@@ -3,12 +3,21 @@
 
 #include <array>
 #include <atomic>
-#include <condition_variable>
+#include <chrono>
+#include <functional>
 #include <mutex>
 #include <thread>
 
+#include "cache_line.h"
+#include "ffb_physics.h"
 #include "hid/hid_device.h"
 #include "input/wheel_input.h"
+#include "pedal_ramp.h"
+#include "physics_scheduler.h"
+#include "shared_stats.h"
+#include "thread_tuning.h"
+#include "wake_signal.h"
+#include "wheel_lifecycle.h"
 #include "wheel_types.h"
 
 class InputManager;
@@ -16,6 +25,16 @@ extern std::atomic<bool> running;
 
 class WheelDevice {
 public:
+    // Why the report thread was woken (WakeSignal reason bits)
+    enum ReportWake : uint32_t {
+        kReportInput = 1u << 0,
+        kReportPhysics = 1u << 1,
+        kReportControl = 1u << 2,
+        kReportStop = 1u << 3,
+    };
+    static constexpr std::array<const char*, WakeSignal::kMaxReasons> kReportWakeNames = {"input", "physics",
+                                                                                         "control", "stop"};
+
     WheelDevice();
     ~WheelDevice();
 
@@ -24,66 +43,174 @@ public:
     WheelDevice(WheelDevice&&) noexcept = delete;
     WheelDevice& operator=(WheelDevice&&) noexcept = delete;
 
+    // vJoy device this wheel drives; must be set before Create()
+    void SetVJoyId(unsigned int vjoy_id);
+    // Sees every submitted report on the report thread; set before Create()
+    void SetReportSink(hid::HidDevice::ReportSink sink);
+    // Reports reach the sink only, never vJoy (wheel-replay); set before Create()
+    void SetHeadless();
+    // Seqlock the physics tick publishes the live state to (shared_stats.h); set before ticking
+    void SetStateExport(Seqlock<shared_stats::SeatState>* slot);
     bool Create();
+    // Registers this wheel's physics tick; call before the scheduler starts
+    void AttachPhysics(PhysicsScheduler& scheduler);
+    // Event-loop runtime: the caller runs PhysicsTick() itself and `wake`
+    // requests an early tick from the FFB callback thread
+    void SetPhysicsWake(std::function<void()> wake);
+    // Event-loop runtime: no report thread is started; call ServiceReports()
+    // after input or physics changed the state and again at the deadline it returns
+    void UseExternalReportLoop();
+    // One report pass; returns when it needs to run again (time_point::max() = on the next change)
+    std::chrono::steady_clock::time_point ServiceReports(std::chrono::steady_clock::time_point now);
     void ShutdownThreads();
-    void NotifyAllShutdownCVs();
+    // Lets the report thread see `running` turn false
+    void WakeForShutdown();
+    WakeSignal::Stats ReportWakeStats() const { return report_wake_.GetStats(); }
 
-    bool IsEnabled();
+    // Lock-free; true while arming or active
+    bool IsEnabled() const;
+    // Lock-free; the phase itself (bench_lifecycle_stress)
+    LifecycleState GetLifecycleState() const { return lifecycle_.Load(); }
     void SetEnabled(bool enable, InputManager& input_manager);
     void ToggleEnabled(InputManager& input_manager);
     void SetFFBGain(float gain);
+    void SetPedalRamps(const PedalRampConfig& throttle_cfg, const PedalRampConfig& brake_cfg,
+                       const PedalRampConfig& clutch_cfg);
+    void SetMinButtonPulse(int pulse_ms);
+    // Priority/CPU set of the vJoy report thread; call before enabling
+    void SetThreading(const ThreadingConfig& threading);
+    // Deadline waits of the report thread (pulse releases); call before enabling
+    void SetTimer(const PreciseTimer& timer);
 
     void ProcessInputFrame(const InputFrame& frame, int sensitivity);
     void SendNeutral(bool reset_ffb = true);
     void ApplySnapshot(const WheelInputState& snapshot);
 
-    // vJoy FFB Callback
+#ifdef _WIN32
+    // vJoy FFB Callback; decodes the packet and calls ApplyFFBForce()
     void OnFFBPacket(void* data);
+#endif
+    // Constant force from the game (internal sign); ignored unless enabled
+    void ApplyFFBForce(int16_t force);
+    // One FFB/pedal step; run by the physics scheduler. Returns false once the
+    // wheel is at rest (disabled, or FFB settled with no pedal ramping): the
+    // caller may stop ticking until the physics wake asks for the next tick.
+    bool PhysicsTick(std::chrono::steady_clock::time_point now);
 
 private:
+    // bench/wheel.cpp times the private hot paths directly
+    friend struct WheelBench;
+
     void NotifyStateChanged();
+    // Input changed the state while the tick was parked at rest
+    void WakePhysicsIfParked();
+    // state_mutex acquisitions on the hot paths; counted and, when contended, timed (metrics.h)
+    std::unique_lock<std::mutex> LockState();
+    void RelockState(std::unique_lock<std::mutex>& lock);
     bool SendReport();
-    std::array<uint8_t, 13> BuildHIDReport();
-    std::array<uint8_t, 13> BuildHIDReportLocked() const;
+    // `trace_flow` receives the traced input frame this report is the first to carry
+    HidReport BuildHIDReport(uint64_t& trace_flow);
+    HidReport BuildHIDReportLocked() const;
     void VJoyPollingThread();
-    void FFBUpdateThread();
-    float ShapeFFBTorque(float raw_force) const;
+    // `reasons` are the report wakes taken since the last step; `sent` tells if a report went out
+    std::chrono::steady_clock::time_point ReportStepLocked(std::unique_lock<std::mutex>& lock,
+                                                           std::chrono::steady_clock::time_point now,
+                                                           uint32_t reasons, bool& sent);
+    shared_stats::SeatState ExportStateLocked(std::chrono::steady_clock::time_point now) const;
     bool ApplySteeringLocked();
     bool ApplySteeringDeltaLocked(int delta, int sensitivity);
-    bool ApplySnapshotLocked(const WheelInputState& snapshot);
+    // `ramp_started` is set when a pedal ramp began; it moves only on the physics tick
+    bool ApplySnapshotLocked(const WheelInputState& snapshot, bool& ramp_started);
+    bool AdvancePedalsLocked(float dt);
+    bool ApplyButtonEdgesLocked(const std::vector<ButtonEdge>& edges);
+    bool ReleaseExpiredPulsesLocked(std::chrono::steady_clock::time_point now);
     void ApplyNeutralLocked(bool reset_ffb);
-    uint32_t BuildButtonBitsLocked() const;
     void EnsurePollingThreadStarted();
     void StopPollingThread();
 
+    // Members are grouped by the threads that write them, each group starting
+    // on its own cache line, so a 1 kHz physics write does not invalidate the
+    // line the input thread or the vJoy callback is about to touch.
+
+    // Set up once / written on enable and disable only
     std::thread polling_thread_;
     std::atomic<bool> polling_running_;
-    std::thread ffb_thread;
-    std::atomic<bool> ffb_running;
-    std::atomic<bool> state_dirty;
-    std::atomic<int> warmup_frames;
-    std::atomic<bool> output_enabled;
+    // Event-loop runtime: no report thread, the owner calls ServiceReports()
+    bool external_reports_;
+    // timeBeginPeriod(1) is held only while enabled, so an idle emulator does
+    // not keep the 1 ms timer resolution (and its battery cost) raised
+    bool timer_resolution_held_;
+    // Serializes the enable/disable control path only; hot paths use lifecycle_
     std::mutex enable_mutex;
-    std::mutex state_mutex;
-    std::condition_variable state_cv;
-    std::condition_variable ffb_cv;
-
     hid::HidDevice hid_device_;
+    // Asks whoever runs PhysicsTick() for an early tick (FFB packet arrived)
+    std::function<void()> physics_wake_;
+    ThreadingConfig threading_;
+    PreciseTimer timer_;
+    Seqlock<shared_stats::SeatState>* state_export_;
+    float ffb_gain;
+    std::chrono::steady_clock::duration min_button_pulse;
+
+    // Cross-thread flags: each polled by one thread while others write it.
+    // report_wake_ replaces a dirty flag plus notify_all on every change: the
+    // pending reason bits are the dirty state and repeated changes coalesce.
+    WakeSignal report_wake_;
+    alignas(kCacheLineSize) WheelLifecycle lifecycle_;
+    // Set under state_mutex by a tick that found the wheel at rest; whoever
+    // changes the state afterwards clears it and wakes the physics
+    alignas(kCacheLineSize) std::atomic<bool> physics_parked_;
+
+    // Guards every group below. The cache lines do not replace it: they only
+    // keep one writer's stores off the fields the next lock holder touches.
+    alignas(kCacheLineSize) std::mutex state_mutex;
 
-    bool enabled;
-    float steering;
-    float user_steering;
+    // Input (seat loop) writes
+    alignas(kCacheLineSize) float user_steering;
+    int8_t dpad_x;
+    int8_t dpad_y;
+    // Positions (0..1) from analog device routes; a pedal reports the larger
+    // of its keyboard ramp and its analog route.
+    std::array<float, kPedalCount> pedal_analog;
+    ButtonMask button_states;
+
+    // Input -> report hand-off: the seat loop sets these on a frame, the
+    // report step clears them once a report carried them
+    // Trace flow of the last input frame applied, until a report takes it
+    alignas(kCacheLineSize) uint64_t report_trace_flow_;
+    // Presses held for at least min_button_pulse even if the key was released
+    // before a report went out. Output buttons = button_states | pulse_buttons.
+    ButtonMask pulse_buttons;
+    std::array<std::chrono::steady_clock::time_point, kMaxButtons> pulse_release_at;
+    // Pulses pressed again after a report showed them; the next report shows
+    // them released so the game sees two presses
+    ButtonMask pulse_gaps;
+    // Pulses a report has shown; only these may be released
+    ButtonMask reported_pulses;
+    // Gaps the last report sent; the next report goes out right away
+    ButtonMask pulse_represses;
+    std::chrono::steady_clock::time_point next_pulse_release;
+    // Written by the report step only
+    int arming_reports_;
+
+    // Physics tick writes every period (the pedal ramps are retargeted by
+    // input but advanced here)
+    alignas(kCacheLineSize) float steering;
     float ffb_offset;
     float ffb_velocity;
-    float ffb_gain;
+    // Touched only by the physics tick
+    float ffb_filtered;
+    std::chrono::steady_clock::time_point last_physics_tick;
+    // The previous tick parked; the next one steps one nominal period
+    bool physics_resting_;
     float throttle;
     float brake;
     float clutch;
-    std::array<uint8_t, static_cast<size_t>(WheelButton::Count)> button_states;
-    int8_t dpad_x;
-    int8_t dpad_y;
+    PedalRamp throttle_ramp;
+    PedalRamp brake_ramp;
+    PedalRamp clutch_ramp;
 
-    int16_t ffb_force;
+    // vJoy FFB callback writes
+    alignas(kCacheLineSize) int16_t ffb_force;
     int16_t ffb_autocenter;
 };
 
@@ -0,0 +1,85 @@
+#ifndef WHEEL_LIFECYCLE_H
+#define WHEEL_LIFECYCLE_H
+
+#include <atomic>
+#include <cstdint>
+
+// Emulation state of one wheel. Hot paths (input frames, FFB packets, the
+// physics tick) check it with a single acquire load.
+//
+//   Disabled --BeginArming--> Arming --FinishArming--> Active
+//      ^                        |                        |
+//      |                        +------BeginDraining-----+
+//      |                                    v
+//      +-----------FinishDraining------- Draining --BeginArming--> Arming
+//
+// Begin* run on the control path (enable/disable, serialized by the caller);
+// Finish* run on the report thread once it has sent the neutral reports the
+// transition needs, and fail if the control path moved on in the meantime.
+enum class LifecycleState : uint8_t {
+    Disabled = 0,
+    // Output acquired; neutral reports are being sent before input is reported
+    Arming,
+    Active,
+    // Input ignored; the final neutral report is still to be sent
+    Draining
+};
+
+inline const char* LifecycleStateName(LifecycleState state) {
+    switch (state) {
+        case LifecycleState::Disabled:
+            return "disabled";
+        case LifecycleState::Arming:
+            return "arming";
+        case LifecycleState::Active:
+            return "active";
+        case LifecycleState::Draining:
+            return "draining";
+    }
+    return "disabled";
+}
+
+class WheelLifecycle {
+public:
+    LifecycleState Load() const { return state_.load(std::memory_order_acquire); }
+
+    // Input and FFB are applied while arming or active
+    static bool IsLive(LifecycleState state) {
+        return state == LifecycleState::Arming || state == LifecycleState::Active;
+    }
+    bool IsLive() const { return IsLive(Load()); }
+
+    // Control path. Returns false if the wheel was already in the target phase.
+    bool BeginArming() {
+        LifecycleState current = Load();
+        if (IsLive(current)) {
+            return false;
+        }
+        state_.store(LifecycleState::Arming, std::memory_order_release);
+        return true;
+    }
+
+    bool BeginDraining() {
+        LifecycleState current = Load();
+        if (!IsLive(current)) {
+            return false;
+        }
+        state_.store(LifecycleState::Draining, std::memory_order_release);
+        return true;
+    }
+
+    // Report thread
+    bool FinishArming() { return Advance(LifecycleState::Arming, LifecycleState::Active); }
+    bool FinishDraining() { return Advance(LifecycleState::Draining, LifecycleState::Disabled); }
+
+    void ForceDisabled() { state_.store(LifecycleState::Disabled, std::memory_order_release); }
+
+private:
+    bool Advance(LifecycleState from, LifecycleState to) {
+        return state_.compare_exchange_strong(from, to, std::memory_order_acq_rel, std::memory_order_acquire);
+    }
+
+    std::atomic<LifecycleState> state_{LifecycleState::Disabled};
+};
+
+#endif  // WHEEL_LIFECYCLE_H
@@ -1,8 +1,63 @@
 #ifndef WHEEL_TYPES_H
 #define WHEEL_TYPES_H
 
+#include <array>
+#include <cstddef>
 #include <cstdint>
 
+// vJoy exposes up to 128 buttons (lButtons + lButtonsEx1..3)
+constexpr size_t kMaxButtons = 128;
+// One seat per vJoy device; vJoy exposes at most 16
+constexpr size_t kMaxSeats = 16;
+
+// Button state as a packed bitmask so frames are compared and diffed a word at a time.
+struct ButtonMask {
+    static constexpr size_t kWords = kMaxButtons / 64;
+    std::array<uint64_t, kWords> words{};
+
+    bool Test(size_t index) const {
+        return index < kMaxButtons && ((words[index / 64] >> (index % 64)) & 1u);
+    }
+    void Set(size_t index) {
+        if (index < kMaxButtons) words[index / 64] |= uint64_t{1} << (index % 64);
+    }
+    void Reset(size_t index) {
+        if (index < kMaxButtons) words[index / 64] &= ~(uint64_t{1} << (index % 64));
+    }
+    void Clear() { words.fill(0); }
+    bool Any() const { return (words[0] | words[1]) != 0; }
+
+    ButtonMask operator|(const ButtonMask& other) const {
+        return {{words[0] | other.words[0], words[1] | other.words[1]}};
+    }
+    ButtonMask operator&(const ButtonMask& other) const {
+        return {{words[0] & other.words[0], words[1] & other.words[1]}};
+    }
+    ButtonMask operator^(const ButtonMask& other) const {
+        return {{words[0] ^ other.words[0], words[1] ^ other.words[1]}};
+    }
+    ButtonMask operator~() const { return {{~words[0], ~words[1]}}; }
+    bool operator==(const ButtonMask& other) const {
+        return ((words[0] ^ other.words[0]) | (words[1] ^ other.words[1])) == 0;
+    }
+    bool operator!=(const ButtonMask& other) const { return !(*this == other); }
+};
+
+// Internal report: steering, clutch, throttle, brake (LE u16 each), hat, 128 button bits (LE)
+constexpr size_t kReportButtonOffset = 9;
+constexpr size_t kReportSize = kReportButtonOffset + kMaxButtons / 8;
+using HidReport = std::array<uint8_t, kReportSize>;
+
+enum class Pedal : uint8_t {
+    Throttle = 0,
+    Brake,
+    Clutch,
+    Count
+};
+
+constexpr size_t kPedalCount = static_cast<size_t>(Pedal::Count);
+
+// Named default buttons; any index below kMaxButtons can be bound.
 enum class WheelButton : uint8_t {
     South = 0,
     East,
@@ -0,0 +1,197 @@
+// Prints a flight recorder dump ([diagnostics] flight_file, written on a
+// crash or Ctrl+C): the events every seat saw in its last seconds, oldest
+// first, timed in ms before the dump. Slots that were being written when the
+// dump was taken are skipped.
+//
+//   wheel-flight FILE [--seat=N] [--last-ms=MS]
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "flight_recorder.h"
+
+namespace {
+
+struct Options {
+    std::string path;
+    double seat = 0.0;
+    double last_ms = 0.0;
+};
+
+const char* KindName(flight::EventKind kind) {
+    switch (kind) {
+        case flight::EventKind::InputFrame:
+            return "input";
+        case flight::EventKind::FfbPacket:
+            return "ffb packet";
+        case flight::EventKind::FfbForce:
+            return "ffb force";
+        case flight::EventKind::Physics:
+            return "physics";
+        case flight::EventKind::Report:
+            return "report";
+        case flight::EventKind::Enable:
+            return "enable";
+        case flight::EventKind::Neutral:
+            return "neutral";
+    }
+    return "?";
+}
+
+float FloatFromBits(uint32_t bits) {
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+unsigned Word(uint64_t payload, int index) {
+    return static_cast<unsigned>((payload >> (16 * index)) & 0xFFFF);
+}
+
+void PrintDetails(const flight::Slot& slot) {
+    const uint16_t small = slot.Small();
+    const uint32_t value = slot.Value();
+    switch (slot.Kind()) {
+        case flight::EventKind::InputFrame:
+            std::printf("dx=%d pedals=%c%c%c dpad=%d,%d buttons=%016llx edges=%u",
+                        static_cast<int32_t>(value), (small & 1) ? 'T' : '-', (small & 2) ? 'B' : '-',
+                        (small & 4) ? 'C' : '-', static_cast<int>((small >> 3) & 3) - 1,
+                        static_cast<int>((small >> 5) & 3) - 1, static_cast<unsigned long long>(slot.payload),
+                        static_cast<unsigned>(small >> 8));
+            break;
+        case flight::EventKind::FfbPacket:
+            std::printf("cmd=%u size=%u data=%016llx", static_cast<unsigned>(value), static_cast<unsigned>(small),
+                        static_cast<unsigned long long>(slot.payload));
+            break;
+        case flight::EventKind::FfbForce:
+            std::printf("force=%d", static_cast<int32_t>(value));
+            break;
+        case flight::EventKind::Physics:
+            std::printf("force=%d steering=%.1f offset=%.1f velocity=%.1f", static_cast<int16_t>(small),
+                        FloatFromBits(value), FloatFromBits(static_cast<uint32_t>(slot.payload)),
+                        FloatFromBits(static_cast<uint32_t>(slot.payload >> 32)));
+            break;
+        case flight::EventKind::Report:
+            std::printf("steering=%u clutch=%u throttle=%u brake=%u hat=%u buttons=%08x", Word(slot.payload, 0),
+                        Word(slot.payload, 1), Word(slot.payload, 2), Word(slot.payload, 3),
+                        static_cast<unsigned>(small), static_cast<unsigned>(value));
+            break;
+        case flight::EventKind::Enable:
+            std::printf("%s", small ? "on" : "off");
+            break;
+        case flight::EventKind::Neutral:
+            std::printf("reset_ffb=%s", small ? "yes" : "no");
+            break;
+    }
+}
+
+std::string DescribeReason(const flight::DumpHeader& header) {
+    char text[64];
+    switch (static_cast<flight::DumpReason>(header.reason)) {
+        case flight::DumpReason::Requested:
+            return "requested (Ctrl+C)";
+        case flight::DumpReason::Signal:
+            std::snprintf(text, sizeof(text), "signal %u", header.reason_code);
+            return text;
+        case flight::DumpReason::Exception:
+            std::snprintf(text, sizeof(text), "exception 0x%08x", header.reason_code);
+            return text;
+    }
+    return "unknown";
+}
+
+bool ParseArg(const char* arg, const char* name, double& out) {
+    const size_t len = std::strlen(name);
+    if (std::strncmp(arg, name, len) != 0 || arg[len] != '=') {
+        return false;
+    }
+    out = std::atof(arg + len + 1);
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        if (ParseArg(argv[i], "--seat", options.seat) || ParseArg(argv[i], "--last-ms", options.last_ms)) {
+            continue;
+        }
+        if (argv[i][0] != '-' && options.path.empty()) {
+            options.path = argv[i];
+            continue;
+        }
+        options.path.clear();
+        break;
+    }
+    if (options.path.empty()) {
+        std::fprintf(stderr, "usage: %s FILE [--seat=N] [--last-ms=MS]\n", argv[0]);
+        return 2;
+    }
+
+    std::FILE* in = std::fopen(options.path.c_str(), "rb");
+    if (!in) {
+        std::fprintf(stderr, "cannot open %s\n", options.path.c_str());
+        return 2;
+    }
+    flight::DumpHeader header{};
+    const bool header_read = std::fread(&header, sizeof(header), 1, in) == 1;
+    if (!header_read || header.magic != flight::kMagic || header.version != flight::kFormatVersion ||
+        header.slot_size != sizeof(flight::Slot) || header.capacity == 0 ||
+        (header.capacity & (header.capacity - 1)) != 0 || header.readings_per_second <= 0.0) {
+        std::fprintf(stderr, "%s: not a flight recorder dump\n", options.path.c_str());
+        std::fclose(in);
+        return 2;
+    }
+    std::vector<flight::Slot> slots(header.capacity);
+    const size_t read = std::fread(slots.data(), sizeof(flight::Slot), slots.size(), in);
+    std::fclose(in);
+    slots.resize(read);
+
+    // A slot holds sequence + 1 and sits at sequence % capacity. Once the
+    // ring has wrapped, an empty slot was cleared for an event being written
+    // when the dump was taken.
+    const bool wrapped = header.next_sequence >= header.capacity;
+    std::vector<flight::Slot> events;
+    size_t skipped = 0;
+    for (size_t i = 0; i < slots.size(); ++i) {
+        const flight::Slot& slot = slots[i];
+        if (slot.sequence == 0 || ((slot.sequence - 1) & (header.capacity - 1)) != i) {
+            skipped += wrapped || slot.sequence != 0 ? 1 : 0;
+            continue;
+        }
+        events.push_back(slot);
+    }
+    std::sort(events.begin(), events.end(),
+              [](const flight::Slot& a, const flight::Slot& b) { return a.sequence < b.sequence; });
+
+    auto ms_before_dump = [&header](const flight::Slot& slot) {
+        const double readings = static_cast<double>(static_cast<int64_t>(slot.reading - header.dump_reading));
+        return readings / header.readings_per_second * 1000.0;
+    };
+    std::printf("%s: %s, %llu events recorded, %zu held", options.path.c_str(), DescribeReason(header).c_str(),
+                static_cast<unsigned long long>(header.next_sequence), events.size());
+    if (!events.empty()) {
+        std::printf(" (last %.0f ms)", -ms_before_dump(events.front()));
+    }
+    if (skipped > 0) {
+        std::printf(", %zu being written", skipped);
+    }
+    std::printf("\n%12s %10s %4s %-11s %s\n", "sequence", "ms", "seat", "event", "details");
+    for (const flight::Slot& slot : events) {
+        const double ms = ms_before_dump(slot);
+        if ((options.seat > 0.0 && slot.VJoyId() != static_cast<unsigned>(options.seat)) ||
+            (options.last_ms > 0.0 && ms < -options.last_ms)) {
+            continue;
+        }
+        std::printf("%12llu %10.3f %4u %-11s ", static_cast<unsigned long long>(slot.sequence - 1), ms,
+                    slot.VJoyId(), KindName(slot.Kind()));
+        PrintDetails(slot);
+        std::printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,413 @@
+// Replays a session file ([diagnostics] record_file, bench_input_latency
+// --record) through the unmodified WheelDevice: steering, snapshots, button
+// pulses, pedal ramps, FFB physics and report building all run as in the
+// emulator's event-loop runtime, but the EventLoop runs on a SimulatedClock
+// that jumps from one event or deadline to the next, so an hour of driving
+// replays in seconds.
+// Every seat is headless; its reports are collected and compared with the
+// reports the session recorded.
+//
+// A recorded report matches if the replay produced the same report at or
+// before its time (plus --slack-ms); the report thread coalesces changes, so
+// the replay may have sent more reports in between. It also matches if it
+// lies between two consecutive replayed reports: pulses released microseconds
+// apart can go out as one replayed report but several live ones. Axes may differ by
+// --axis-tolerance raw counts: live physics ticks jitter, replayed ones do
+// not. Exits 1 if any recorded report is unmatched.
+//
+// The session does not hold the tuning; --config applies a config file's
+// ffb_gain, pedal ramps and button pulse, otherwise WheelDevice's defaults
+// are used (as in bench_input_latency).
+//
+//   wheel-replay SESSION [--config=FILE] [--out=FILE.csv] [--axis-tolerance=N] [--slack-ms=MS]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "config.h"
+#include "event_loop.h"
+#include "input/input_manager.h"
+#include "logging/logger.h"
+#include "session_recorder.h"
+#include "wheel_device.h"
+
+std::atomic<bool> running{true};
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::string session;
+    std::string config;
+    std::string out;
+    double axis_tolerance = 0.0;
+    double slack_ms = 1.0;
+};
+
+struct TimedReport {
+    Clock::time_point time;
+    HidReport report;
+};
+
+struct Seat {
+    unsigned vjoy_id = 1;
+    WheelDevice wheel;
+    // Never initialized: SetEnabled() only grabs and resyncs it
+    InputManager input;
+    size_t report_timer = 0;
+    std::vector<TimedReport> replayed;
+    std::vector<TimedReport> recorded;
+};
+
+struct Diff {
+    size_t matched = 0;
+    size_t differing = 0;
+    // Unmatched reports whose nearest replayed state has another hat or buttons
+    size_t button_differences = 0;
+    int max_axis_delta = 0;
+    Clock::time_point first_difference = Clock::time_point::max();
+};
+
+int Axis(const HidReport& report, size_t axis) {
+    return static_cast<int>(report[axis * 2]) | (static_cast<int>(report[axis * 2 + 1]) << 8);
+}
+
+// Largest axis difference; -1 if the hat or a button differs
+int AxisDelta(const HidReport& a, const HidReport& b) {
+    if (!std::equal(a.begin() + 8, a.end(), b.begin() + 8)) {
+        return -1;
+    }
+    int delta = 0;
+    for (size_t axis = 0; axis < 4; ++axis) {
+        delta = std::max(delta, std::abs(Axis(a, axis) - Axis(b, axis)));
+    }
+    return delta;
+}
+
+// Every field of `report` equals `a` or `b` (each button bit on its own) and
+// every axis lies between them
+bool Between(const HidReport& a, const HidReport& b, const HidReport& report, int tolerance) {
+    for (size_t axis = 0; axis < 4; ++axis) {
+        const int value = Axis(report, axis);
+        if (value < std::min(Axis(a, axis), Axis(b, axis)) - tolerance ||
+            value > std::max(Axis(a, axis), Axis(b, axis)) + tolerance) {
+            return false;
+        }
+    }
+    if (report[8] != a[8] && report[8] != b[8]) {
+        return false;
+    }
+    for (size_t i = kReportButtonOffset; i < kReportSize; ++i) {
+        if (((report[i] ^ a[i]) & (report[i] ^ b[i])) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+double Seconds(Clock::time_point time) {
+    return std::chrono::duration<double>(time.time_since_epoch()).count();
+}
+
+// The seats run on an EventLoop with a simulated clock, set up the way
+// RunEventLoop sets up the real one: physics timers that park at rest, the
+// physics wake as a loop signal, report timers re-armed after every pass. One
+// more timer applies the session's events at their times.
+class Replay {
+public:
+    Replay(const Config* config, Clock::duration period) : config_(config), period_(period) {
+        loop_.SetSimulatedClock(&clock_);
+        loop_.SetIdleHandler([this] {
+            const Clock::time_point now = loop_.Now();
+            for (const auto& seat : seats_) {
+                loop_.ArmTimer(seat->report_timer, seat->wheel.ServiceReports(now));
+            }
+        });
+    }
+
+    bool AddSeat(unsigned vjoy_id, Clock::time_point start) {
+        auto seat = std::make_unique<Seat>();
+        Seat& s = *seat;
+        s.vjoy_id = vjoy_id;
+        s.wheel.SetVJoyId(vjoy_id);
+        s.wheel.SetHeadless();
+        s.wheel.UseExternalReportLoop();
+        s.wheel.SetReportSink([this, &s](const HidReport& report) { s.replayed.push_back({loop_.Now(), report}); });
+        if (config_) {
+            s.wheel.SetFFBGain(config_->ffb_gain);
+            s.wheel.SetPedalRamps(config_->throttle_ramp, config_->brake_ramp, config_->clutch_ramp);
+            s.wheel.SetMinButtonPulse(config_->button_min_pulse_ms);
+        }
+        if (!s.wheel.Create()) {
+            return false;
+        }
+
+        clock_.AdvanceTo(start);
+        const Clock::duration period = period_;
+        WheelDevice& wheel = s.wheel;
+        const size_t physics_timer =
+            loop_.AddTimer(start + period, [&wheel, period, next = start + period](Clock::time_point now) mutable {
+                if (!wheel.PhysicsTick(now)) {
+                    return Clock::time_point::max();  // at rest: parked until the physics wake
+                }
+                next += period;
+                if (next <= now) {
+                    next = now + period;
+                }
+                return next;
+            });
+        const size_t wake = loop_.AddSignal([this, &wheel, physics_timer, period] {
+            const Clock::time_point now = loop_.Now();
+            if (wheel.PhysicsTick(now) && !loop_.TimerArmed(physics_timer)) {
+                loop_.ArmTimer(physics_timer, now + period);
+            }
+        });
+        wheel.SetPhysicsWake([this, wake] { loop_.Signal(wake); });
+        s.report_timer = loop_.AddTimer(Clock::time_point::max(),
+                                        [&wheel](Clock::time_point now) { return wheel.ServiceReports(now); });
+
+        by_id_[vjoy_id] = seat.get();
+        seats_.push_back(std::move(seat));
+        return true;
+    }
+
+    Seat* Find(unsigned vjoy_id) const { return vjoy_id <= kMaxSeats ? by_id_[vjoy_id] : nullptr; }
+    const std::vector<std::unique_ptr<Seat>>& Seats() const { return seats_; }
+
+    void Run(const std::vector<session::Event>& events) {
+        if (events.empty()) {
+            return;
+        }
+        size_t next = 0;
+        loop_.AddTimer(events.front().time, [&](Clock::time_point now) {
+            for (; next < events.size() && events[next].time <= now; ++next) {
+                Seat* seat = Find(events[next].vjoy_id);
+                if (seat) {
+                    Apply(*seat, events[next]);
+                }
+            }
+            return next < events.size() ? events[next].time : Clock::time_point::max();
+        });
+        // Let the last pulses release and the physics come to rest
+        loop_.RunUntil(events.back().time + std::chrono::seconds(1));
+    }
+
+private:
+    void Apply(Seat& seat, const session::Event& event) {
+        switch (event.kind) {
+            case session::EventKind::InputFrame:
+                seat.wheel.ProcessInputFrame(event.frame, event.sensitivity);
+                break;
+            case session::EventKind::FfbForce:
+                seat.wheel.ApplyFFBForce(event.force);
+                break;
+            case session::EventKind::Enable:
+                seat.wheel.SetEnabled(event.enable, seat.input);
+                // Enabling grabbed the idle input manager; on Windows that clips the cursor
+                seat.input.GrabDevices(false);
+                break;
+            case session::EventKind::Neutral:
+                seat.wheel.SendNeutral(event.enable);
+                break;
+            case session::EventKind::Report:
+                seat.recorded.push_back({event.time, event.report});
+                break;
+            case session::EventKind::FfbPacket:
+                // Its decoded force was recorded as an FfbForce event
+                break;
+        }
+    }
+
+    const Config* config_;
+    Clock::duration period_;
+    SimulatedClock clock_;
+    EventLoop loop_;
+    std::vector<std::unique_ptr<Seat>> seats_;
+    Seat* by_id_[kMaxSeats + 1] = {};
+};
+
+// Each recorded report is looked up among the replayed reports from the last
+// match up to its time plus the slack
+Diff Compare(const Seat& seat, const Options& options) {
+    Diff diff;
+    const auto slack = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double, std::milli>(options.slack_ms));
+    const int tolerance = static_cast<int>(options.axis_tolerance);
+    const std::vector<TimedReport>& replayed = seat.replayed;
+    size_t cursor = 0;
+    for (const TimedReport& recorded : seat.recorded) {
+        bool found = false;
+        for (size_t i = cursor; i < replayed.size() && replayed[i].time <= recorded.time + slack; ++i) {
+            const int delta = AxisDelta(replayed[i].report, recorded.report);
+            if (delta >= 0 && delta <= tolerance) {
+                cursor = i;
+                found = true;
+                break;
+            }
+            if (i > cursor && Between(replayed[i - 1].report, replayed[i].report, recorded.report, tolerance)) {
+                cursor = i - 1;
+                found = true;
+                break;
+            }
+        }
+        if (found) {
+            ++diff.matched;
+            continue;
+        }
+        ++diff.differing;
+        diff.first_difference = std::min(diff.first_difference, recorded.time);
+        // Against the state the replay had reported by then
+        auto latest = std::upper_bound(replayed.begin(), replayed.end(), recorded.time,
+                                       [](Clock::time_point time, const TimedReport& r) { return time < r.time; });
+        if (latest == replayed.begin()) {
+            continue;
+        }
+        const int delta = AxisDelta((latest - 1)->report, recorded.report);
+        if (delta < 0) {
+            ++diff.button_differences;
+        } else {
+            diff.max_axis_delta = std::max(diff.max_axis_delta, delta);
+        }
+    }
+    return diff;
+}
+
+void WriteReports(std::FILE* out, unsigned vjoy_id, const char* source, const std::vector<TimedReport>& reports) {
+    for (const TimedReport& r : reports) {
+        std::fprintf(out, "%.6f,%u,%s,%d,%d,%d,%d,%u,", Seconds(r.time), vjoy_id, source, Axis(r.report, 0) - 32768,
+                     Axis(r.report, 1), Axis(r.report, 2), Axis(r.report, 3), r.report[8] & 0x0F);
+        for (size_t i = kReportSize; i > kReportButtonOffset; --i) {
+            std::fprintf(out, "%02x", r.report[i - 1]);
+        }
+        std::fprintf(out, "\n");
+    }
+}
+
+bool WriteCsv(const std::string& path, const Replay& replay) {
+    std::FILE* out = std::fopen(path.c_str(), "w");
+    if (!out) {
+        std::fprintf(stderr, "cannot write %s\n", path.c_str());
+        return false;
+    }
+    std::fprintf(out, "time_s,seat,source,steering,clutch,throttle,brake,hat,buttons\n");
+    for (const auto& seat : replay.Seats()) {
+        WriteReports(out, seat->vjoy_id, "recorded", seat->recorded);
+        WriteReports(out, seat->vjoy_id, "replayed", seat->replayed);
+    }
+    return std::fclose(out) == 0;
+}
+
+bool ParseArg(const char* arg, const char* name, double& out) {
+    const size_t len = std::strlen(name);
+    if (std::strncmp(arg, name, len) != 0 || arg[len] != '=') {
+        return false;
+    }
+    out = std::atof(arg + len + 1);
+    return true;
+}
+
+bool ParseArg(const char* arg, const char* name, std::string& out) {
+    const size_t len = std::strlen(name);
+    if (std::strncmp(arg, name, len) != 0 || arg[len] != '=') {
+        return false;
+    }
+    out = arg + len + 1;
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        if (ParseArg(argv[i], "--config", options.config) || ParseArg(argv[i], "--out", options.out) ||
+            ParseArg(argv[i], "--axis-tolerance", options.axis_tolerance) ||
+            ParseArg(argv[i], "--slack-ms", options.slack_ms)) {
+            continue;
+        }
+        if (argv[i][0] != '-' && options.session.empty()) {
+            options.session = argv[i];
+            continue;
+        }
+        options.session.clear();
+        break;
+    }
+    if (options.session.empty()) {
+        std::fprintf(stderr, "usage: %s SESSION [--config=FILE] [--out=FILE.csv] [--axis-tolerance=N] "
+                     "[--slack-ms=MS]\n", argv[0]);
+        return 2;
+    }
+    logging::InitLogger(static_cast<int>(logging::LogLevel::Warn));
+
+    Config config;
+    if (!options.config.empty() && !config.LoadFromFile(options.config.c_str())) {
+        std::fprintf(stderr, "cannot read config %s\n", options.config.c_str());
+        return 2;
+    }
+
+    session::SessionReader reader;
+    if (!reader.Open(options.session)) {
+        std::fprintf(stderr, "%s: %s\n", options.session.c_str(), reader.Error().c_str());
+        return 2;
+    }
+    std::vector<session::Event> events;
+    session::Event event;
+    while (reader.Next(event)) {
+        events.push_back(event);
+    }
+    if (!reader.Error().empty()) {
+        std::fprintf(stderr, "%s: %s after %zu events; replaying those\n", options.session.c_str(),
+                     reader.Error().c_str(), events.size());
+    }
+    if (events.empty()) {
+        std::fprintf(stderr, "%s: no events\n", options.session.c_str());
+        return 2;
+    }
+
+    const int64_t period_ns = reader.GetHeader().physics_period_ns;
+    const Clock::duration period = std::chrono::nanoseconds(period_ns > 0 ? period_ns : 1000000);
+    Replay replay(options.config.empty() ? nullptr : &config, period);
+    for (const session::Event& e : events) {
+        if (!replay.Find(e.vjoy_id) && !replay.AddSeat(e.vjoy_id, events.front().time)) {
+            std::fprintf(stderr, "cannot create the wheel of vJoy device %u\n", e.vjoy_id);
+            return 2;
+        }
+    }
+
+    const auto wall_start = Clock::now();
+    replay.Run(events);
+    const double wall_s = std::chrono::duration<double>(Clock::now() - wall_start).count();
+    const double session_s = Seconds(events.back().time) - Seconds(events.front().time);
+
+    std::printf("%s: %zu events over %.2f s, %zu seat(s), physics period %.0f us\n", options.session.c_str(),
+                events.size(), session_s, replay.Seats().size(), static_cast<double>(period_ns) / 1000.0);
+    std::printf("replayed in %.1f ms (%.0fx real time)\n", wall_s * 1000.0, wall_s > 0.0 ? session_s / wall_s : 0.0);
+    std::printf("%-5s %10s %10s %10s %10s %8s %10s %12s\n", "seat", "recorded", "replayed", "matched", "differing",
+                "buttons", "max delta", "first diff s");
+    size_t differing = 0;
+    for (const auto& seat : replay.Seats()) {
+        const Diff diff = Compare(*seat, options);
+        differing += diff.differing;
+        std::printf("%-5u %10zu %10zu %10zu %10zu %8zu %10d ", seat->vjoy_id, seat->recorded.size(),
+                    seat->replayed.size(), diff.matched, diff.differing, diff.button_differences, diff.max_axis_delta);
+        if (diff.differing == 0) {
+            std::printf("%12s\n", "-");
+        } else {
+            std::printf("%12.6f\n", Seconds(diff.first_difference));
+        }
+    }
+
+    if (!options.out.empty() && !WriteCsv(options.out, replay)) {
+        return 2;
+    }
+    logging::ShutdownLogger();
+    return differing == 0 ? 0 : 1;
+}
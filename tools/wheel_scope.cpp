@@ -0,0 +1,123 @@
+// Converts a signal scope file ([diagnostics] scope_file, bench_input_latency
+// --scope) to CSV: one row per physics step, seats interleaved by time, with
+// the columns in signal_scope.h order. Floats are printed so they read back
+// exactly. A summary (steps per seat, bytes per step) goes to stderr.
+//
+//   wheel-scope FILE [--out=FILE.csv] [--seat=N]
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "signal_scope.h"
+#include "wheel_types.h"
+
+namespace {
+
+struct Options {
+    std::string path;
+    std::string out;
+    double seat = 0.0;
+};
+
+bool ParseArg(const char* arg, const char* name, double& out) {
+    const size_t len = std::strlen(name);
+    if (std::strncmp(arg, name, len) != 0 || arg[len] != '=') {
+        return false;
+    }
+    out = std::atof(arg + len + 1);
+    return true;
+}
+
+bool ParseArg(const char* arg, const char* name, std::string& out) {
+    const size_t len = std::strlen(name);
+    if (std::strncmp(arg, name, len) != 0 || arg[len] != '=') {
+        return false;
+    }
+    out = arg + len + 1;
+    return true;
+}
+
+void WriteRow(std::FILE* out, const scope::Sample& sample) {
+    const scope::Signals& s = sample.signals;
+    std::fprintf(out, "%.9f,%u,%d,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g\n",
+                 static_cast<double>(sample.time_ns) / 1e9, sample.vjoy_id, s.force, s.commanded_force,
+                 s.filtered_force, s.spring, s.target_offset, s.offset, s.velocity, s.dt, s.steering);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        if (ParseArg(argv[i], "--out", options.out) || ParseArg(argv[i], "--seat", options.seat)) {
+            continue;
+        }
+        if (argv[i][0] != '-' && options.path.empty()) {
+            options.path = argv[i];
+            continue;
+        }
+        options.path.clear();
+        break;
+    }
+    if (options.path.empty()) {
+        std::fprintf(stderr, "usage: %s FILE [--out=FILE.csv] [--seat=N]\n", argv[0]);
+        return 2;
+    }
+
+    scope::ScopeReader reader;
+    if (!reader.Open(options.path)) {
+        std::fprintf(stderr, "%s: %s\n", options.path.c_str(), reader.Error().c_str());
+        return 2;
+    }
+    // Blocks hold one seat each and are written as they fill, so seats
+    // come out of the file in runs; merge them back into time order
+    std::vector<scope::Sample> samples;
+    scope::Sample sample;
+    size_t per_seat[kMaxSeats] = {};
+    while (reader.Next(sample)) {
+        ++per_seat[sample.vjoy_id - 1];
+        if (options.seat <= 0.0 || sample.vjoy_id == static_cast<unsigned>(options.seat)) {
+            samples.push_back(sample);
+        }
+    }
+    if (!reader.Error().empty()) {
+        std::fprintf(stderr, "%s: %s after %zu steps; converting those\n", options.path.c_str(),
+                     reader.Error().c_str(), samples.size());
+    }
+    std::stable_sort(samples.begin(), samples.end(), [](const scope::Sample& a, const scope::Sample& b) {
+        return a.time_ns < b.time_ns;
+    });
+
+    std::FILE* out = options.out.empty() ? stdout : std::fopen(options.out.c_str(), "w");
+    if (!out) {
+        std::fprintf(stderr, "cannot write %s\n", options.out.c_str());
+        return 2;
+    }
+    std::fprintf(out, "time_s,seat");
+    for (size_t column = 1; column < scope::kColumnCount; ++column) {
+        std::fprintf(out, ",%s", scope::kColumns[column].name);
+    }
+    std::fprintf(out, "\n");
+    for (const scope::Sample& s : samples) {
+        WriteRow(out, s);
+    }
+    if (out != stdout) {
+        std::fclose(out);
+    }
+
+    size_t total = 0;
+    for (size_t seat = 0; seat < kMaxSeats; ++seat) {
+        if (per_seat[seat] != 0) {
+            std::fprintf(stderr, "seat %zu: %zu steps\n", seat + 1, per_seat[seat]);
+            total += per_seat[seat];
+        }
+    }
+    std::fprintf(stderr, "%zu steps in %llu bytes (%.2f bytes/step)\n", total,
+                 static_cast<unsigned long long>(reader.FileSize()),
+                 total ? static_cast<double>(reader.FileSize()) / static_cast<double>(total) : 0.0);
+    return 0;
+}
@@ -0,0 +1,175 @@
+// Reads the shared-memory segment a running emulator publishes with
+// [diagnostics] shared_stats=true: the live state of every seat and the
+// metrics totals. Reading a sample is a few loads with no syscall and no
+// lock, so --hz=1000 --csv can feed a logging rig without slowing the emulator.
+//
+//   wheel-stats [--name=NAME] [--hz=N] [--seconds=S] [--once] [--csv]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include "shared_stats.h"
+#include "wheel_lifecycle.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using shared_stats::Segment;
+
+struct Options {
+    std::string name = shared_stats::kDefaultName;
+    double hz = 2.0;
+    double seconds = 0.0;  // 0 = until interrupted
+    bool once = false;
+    bool csv = false;
+};
+
+const char* LifecycleName(uint32_t value) {
+    return value <= static_cast<uint32_t>(LifecycleState::Draining)
+               ? LifecycleStateName(static_cast<LifecycleState>(value))
+               : "unknown";
+}
+
+double AgeMs(uint64_t then_ns) {
+    const uint64_t now_ns = shared_stats::SteadyNanos(Clock::now());
+    return now_ns > then_ns ? static_cast<double>(now_ns - then_ns) / 1e6 : 0.0;
+}
+
+void PrintTable(const Segment& segment) {
+    const shared_stats::Header& header = segment.header;
+    std::printf("\nemulator pid %u, up %.1f s\n", header.writer_pid, AgeMs(header.start_ns) / 1000.0);
+    std::printf("%-5s %-9s %9s %9s %9s %7s %6s %8s %8s %8s %10s\n", "seat", "state", "steering", "user",
+                "ffb_off", "force", "gain", "throttle", "brake", "clutch", "age ms");
+    for (uint32_t seat = 0; seat < header.seat_count; ++seat) {
+        shared_stats::SeatState state{};
+        if (!segment.seats[seat].state.Read(state) || segment.seats[seat].state.Version() == 0) {
+            std::printf("%-5u %-9s\n", seat + 1, "-");
+            continue;
+        }
+        std::printf("%-5u %-9s %9.0f %9.0f %9.1f %7d %6.2f %8.1f %8.1f %8.1f %10.1f\n", seat + 1,
+                    LifecycleName(state.lifecycle), state.steering, state.user_steering, state.ffb_offset,
+                    state.ffb_force, state.ffb_gain, state.throttle, state.brake, state.clutch,
+                    AgeMs(state.tick_ns));
+    }
+
+    shared_stats::MetricsState metrics{};
+    if (segment.metrics.Version() == 0 || !segment.metrics.Read(metrics)) {
+        return;
+    }
+    std::printf("metrics (%.0f ms old):", AgeMs(metrics.taken_ns));
+    const uint32_t counters = std::min<uint32_t>(header.counter_count, shared_stats::kMaxCounters);
+    for (uint32_t i = 0; i < counters; ++i) {
+        std::printf("%s %s=%llu", i % 4 == 0 ? "\n " : "", header.counter_names[i],
+                    static_cast<unsigned long long>(metrics.counters[i]));
+    }
+    const uint32_t gauges = std::min<uint32_t>(header.gauge_count, shared_stats::kMaxGauges);
+    for (uint32_t i = 0; i < gauges; ++i) {
+        std::printf(" %s=%lld", header.gauge_names[i], static_cast<long long>(metrics.gauges[i]));
+    }
+    std::printf("\n %-16s %10s %10s %10s %10s %10s %10s\n", "histogram (us)", "count", "mean", "p50", "p99",
+                "p99.9", "max");
+    const uint32_t histograms = std::min<uint32_t>(header.histogram_count, shared_stats::kMaxHistograms);
+    for (uint32_t i = 0; i < histograms; ++i) {
+        const shared_stats::HistogramSummary& h = metrics.histograms[i];
+        std::printf(" %-16s %10llu %10.1f %10.1f %10.1f %10.1f %10.1f\n", header.histogram_names[i],
+                    static_cast<unsigned long long>(h.count), static_cast<double>(h.mean_ns) / 1000.0,
+                    static_cast<double>(h.p50_ns) / 1000.0, static_cast<double>(h.p99_ns) / 1000.0,
+                    static_cast<double>(h.p999_ns) / 1000.0, static_cast<double>(h.max_ns) / 1000.0);
+    }
+}
+
+// One row per seat whose state changed since the last sample
+void PrintCsv(const Segment& segment, uint32_t (&seen)[kMaxSeats]) {
+    for (uint32_t seat = 0; seat < segment.header.seat_count; ++seat) {
+        const uint32_t version = segment.seats[seat].state.Version();
+        shared_stats::SeatState state{};
+        if (version == seen[seat] || !segment.seats[seat].state.Read(state)) {
+            continue;
+        }
+        seen[seat] = version;
+        std::printf("%llu,%u,%s,%.1f,%.1f,%.2f,%.3f,%d,%.3f,%.2f,%.2f,%.2f\n",
+                    static_cast<unsigned long long>(state.tick_ns), seat + 1, LifecycleName(state.lifecycle),
+                    state.steering, state.user_steering, state.ffb_offset, state.ffb_velocity, state.ffb_force,
+                    state.ffb_gain, state.throttle, state.brake, state.clutch);
+    }
+}
+
+bool ParseArg(const char* arg, const char* name, double& out) {
+    const size_t len = std::strlen(name);
+    if (std::strncmp(arg, name, len) != 0 || arg[len] != '=') {
+        return false;
+    }
+    out = std::atof(arg + len + 1);
+    return true;
+}
+
+bool ParseArg(const char* arg, const char* name, std::string& out) {
+    const size_t len = std::strlen(name);
+    if (std::strncmp(arg, name, len) != 0 || arg[len] != '=') {
+        return false;
+    }
+    out = arg + len + 1;
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        if (ParseArg(argv[i], "--name", options.name) || ParseArg(argv[i], "--hz", options.hz) ||
+            ParseArg(argv[i], "--seconds", options.seconds)) {
+            continue;
+        }
+        if (std::strcmp(argv[i], "--once") == 0) {
+            options.once = true;
+            continue;
+        }
+        if (std::strcmp(argv[i], "--csv") == 0) {
+            options.csv = true;
+            continue;
+        }
+        std::fprintf(stderr, "usage: %s [--name=NAME] [--hz=N] [--seconds=S] [--once] [--csv]\n", argv[0]);
+        return 2;
+    }
+    const auto period = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(1.0 / std::clamp(options.hz, 0.1, 10000.0)));
+
+    shared_stats::SharedStats shared;
+    if (!shared.Open(options.name)) {
+        std::fprintf(stderr, "no emulator is publishing \"%s\" (shared_stats=true in [diagnostics]?)\n",
+                     options.name.c_str());
+        return 1;
+    }
+    const Segment& segment = *shared.View();
+
+    uint32_t seen[kMaxSeats] = {};
+    if (options.csv) {
+        std::printf("tick_ns,seat,state,steering,user_steering,ffb_offset,ffb_velocity,ffb_force,ffb_gain,"
+                    "throttle,brake,clutch\n");
+    }
+    auto next = Clock::now();
+    const auto deadline = options.seconds > 0.0
+                              ? next + std::chrono::duration_cast<Clock::duration>(
+                                           std::chrono::duration<double>(options.seconds))
+                              : Clock::time_point::max();
+    while (true) {
+        if (options.csv) {
+            PrintCsv(segment, seen);
+        } else {
+            PrintTable(segment);
+        }
+        std::fflush(stdout);
+        if (options.once || Clock::now() >= deadline) {
+            break;
+        }
+        next += period;
+        std::this_thread::sleep_until(next);
+    }
+    return 0;
+}